@@ -0,0 +1,83 @@
+#include <cstring>
+#include "AsmWriter.h"
+
+AsmWriter::AsmWriter(std::ostream &stream)
+	: stream(&stream), output(nullptr)
+{
+}
+
+AsmWriter::AsmWriter(std::string &output)
+	: stream(nullptr), output(&output)
+{
+}
+
+AsmWriter::~AsmWriter()
+{
+	flush();
+}
+
+AsmWriter &AsmWriter::write(char c)
+{
+	if (length == bufferSize) {
+		flush();
+	}
+	buffer[length++] = c;
+	return *this;
+}
+
+AsmWriter &AsmWriter::write(const char *s)
+{
+	append(s, (int)strlen(s));
+	return *this;
+}
+
+AsmWriter &AsmWriter::write(const std::string &s)
+{
+	append(s.data(), (int)s.length());
+	return *this;
+}
+
+AsmWriter &AsmWriter::write(int value)
+{
+	// formatted right to left into a local buffer, no allocations
+	char digits[12];
+	int pos = sizeof(digits);
+	unsigned int abs = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+	do {
+		digits[--pos] = '0' + abs % 10;
+		abs /= 10;
+	} while (abs != 0);
+	if (value < 0) {
+		digits[--pos] = '-';
+	}
+	append(digits + pos, sizeof(digits) - pos);
+	return *this;
+}
+
+void AsmWriter::flush()
+{
+	if (length == 0) {
+		return;
+	}
+	if (stream != nullptr) {
+		stream->write(buffer, length);
+	}
+	else {
+		output->append(buffer, length);
+	}
+	length = 0;
+}
+
+void AsmWriter::append(const char *s, int count)
+{
+	while (count > 0) {
+		if (length == bufferSize) {
+			flush();
+		}
+		int chunk = bufferSize - length < count ? bufferSize - length : count;
+		memcpy(buffer + length, s, chunk);
+		length += chunk;
+		s += chunk;
+		count -= chunk;
+	}
+}
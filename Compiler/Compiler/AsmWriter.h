@@ -0,0 +1,29 @@
+#pragma once
+#include <ostream>
+#include <string>
+
+class AsmWriter {
+public:
+	static const int bufferSize = 1 << 16;
+
+	AsmWriter(std::ostream &stream);
+	AsmWriter(std::string &output);
+	~AsmWriter();
+
+	AsmWriter &write(char c);
+	AsmWriter &write(const char *s);
+	AsmWriter &write(const std::string &s);
+	AsmWriter &write(int value);
+	void flush();
+
+	// GNU as syntax for x86-64, memory operands and the stack use 64-bit registers
+	bool x64 = false;
+
+private:
+	char buffer[bufferSize];
+	int length = 0;
+	std::ostream *stream;
+	std::string *output;
+
+	void append(const char *s, int count);
+};
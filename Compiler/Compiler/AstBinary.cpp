@@ -0,0 +1,75 @@
+#include <cstring>
+#include "AstBinary.h"
+
+AstBinaryReader::AstBinaryReader(const void *data, size_t size)
+	: data(static_cast<const char *>(data)), size(size)
+{
+	if (!astBinaryHostSupported()) {
+		throw std::exception("AST binary images need a little-endian host");
+	}
+	if (size < sizeof(AstBinHeader) || memcmp(this->data, "PAST", 4) != 0) {
+		throw std::exception("Not an AST binary image");
+	}
+	if (header().version != astBinaryVersion) {
+		throw std::exception("Unsupported AST binary version");
+	}
+	requireSection(header().strings, 1);
+	requireSection(header().types, sizeof(AstBinType));
+	requireSection(header().nodes, sizeof(AstBinNode));
+	requireSection(header().tables, sizeof(AstBinTable));
+	requireSection(header().symbols, sizeof(AstBinSymbol));
+	requireSection(header().refs, sizeof(uint32_t));
+}
+
+const AstBinHeader &AstBinaryReader::header() const
+{
+	return *reinterpret_cast<const AstBinHeader *>(data);
+}
+
+const AstBinType &AstBinaryReader::type(uint32_t index) const
+{
+	return record<AstBinType>(header().types, index);
+}
+
+const AstBinNode &AstBinaryReader::node(uint32_t index) const
+{
+	return record<AstBinNode>(header().nodes, index);
+}
+
+const AstBinTable &AstBinaryReader::table(uint32_t index) const
+{
+	return record<AstBinTable>(header().tables, index);
+}
+
+const AstBinSymbol &AstBinaryReader::symbol(uint32_t index) const
+{
+	return record<AstBinSymbol>(header().symbols, index);
+}
+
+uint32_t AstBinaryReader::child(const AstBinNode &node, uint32_t i) const
+{
+	require(i < node.childCount && node.children < header().refs.count && i < header().refs.count - node.children);
+	return record<uint32_t>(header().refs, node.children + i);
+}
+
+const char *AstBinaryReader::string(const AstBinString &s) const
+{
+	// the NUL after the last character is part of the pool
+	const AstBinSection &strings = header().strings;
+	require(s.offset < strings.count && s.length < strings.count - s.offset);
+	const char *res = data + strings.offset + s.offset;
+	require(res[s.length] == '\0');
+	return res;
+}
+
+void AstBinaryReader::require(bool valid) const
+{
+	if (!valid) {
+		throw std::exception("Corrupted AST binary image");
+	}
+}
+
+void AstBinaryReader::requireSection(const AstBinSection &section, size_t recordSize) const
+{
+	require(section.offset % 8 == 0 && section.offset <= size && (size - section.offset) / recordSize >= section.count);
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// Flat image of a parsed program as written by the -ast-bin option.
+// All integers are little-endian. Every section is an array of fixed-size
+// records addressed by index, so a file mapped into memory can be read in
+// place by AstBinaryReader without a parsing step.
+
+const uint32_t astBinaryVersion = 3;
+const uint32_t astBinaryNone = 0xFFFFFFFF;
+
+// records are written and read in place, which keeps them little-endian only on such a host
+inline bool astBinaryHostSupported()
+{
+	const uint32_t one = 1;
+	char first;
+	memcpy(&first, &one, 1);
+	return first == 1;
+}
+
+struct AstBinString {
+	uint32_t offset; // into the string pool, every string is NUL-terminated
+	uint32_t length;
+};
+
+struct AstBinSection {
+	uint32_t offset; // from the beginning of the image, 8-byte aligned
+	uint32_t count;
+};
+
+struct AstBinHeader {
+	char magic[4]; // "PAST"
+	uint32_t version;
+	uint32_t root; // type index of the main program
+	uint32_t reserved;
+	AstBinSection strings, types, nodes, tables, symbols, refs;
+};
+
+struct AstBinValue {
+	uint32_t category; // IdentifierValue::Category
+	uint32_t reserved;
+	union {
+		int32_t integer;
+		double _double;
+		AstBinString string; // CHAR and STRING
+	};
+};
+
+struct AstBinType {
+	enum Flag {
+		PACKED = 1, // packed ARRAY or RECORD
+		REORDERED = 2, // RECORD with fields placed by decreasing alignment
+	};
+
+	uint32_t category; // Type::Category
+	int32_t size;
+	uint32_t baseType; // element type of ARRAY, return type of FUNCTION
+	uint32_t low, high; // bound nodes of ARRAY
+	uint32_t fields; // table of RECORD
+	uint32_t parameters, declarations; // tables of FUNCTION
+	uint32_t body; // statements node of FUNCTION
+	AstBinString name; // FUNCTION name
+	uint32_t flags;
+};
+
+struct AstBinNode {
+	enum Kind {
+		NODE, VAR, UNARY_MINUS, BINARY_OP, NOT, CONST, TYPED_CONST, CAST, INDEX, FIELD_ACCESS,
+		ASSIGN, IF, WHILE, FOR, CONTINUE, BREAK, EXIT, READ, WRITE, FUNCTION_CALL,
+	};
+
+	enum Flag {
+		IF_THEN = 1, // IF has its then-part among the children
+		IF_ELSE = 2, // IF has its else-part among the children
+		DOWN_TO = 4, // FOR counts downwards
+	};
+
+	uint32_t kind;
+	uint32_t category; // SyntaxNode::Category
+	uint32_t tokenType;
+	int32_t row, col;
+	AstBinString text;
+	uint32_t type;
+	uint32_t children; // index of the first child in the refs section
+	uint32_t childCount;
+	uint32_t flags;
+	AstBinString variable; // variable token of INDEX and FIELD_ACCESS, strings of TYPED_CONST
+	uint32_t stringCount; // number of NUL-terminated strings in variable of TYPED_CONST
+	AstBinValue value; // CONST, memory image of TYPED_CONST as a string
+};
+
+struct AstBinTable {
+	uint32_t symbols; // index of the first symbol, symbols of a table are contiguous
+	uint32_t count;
+};
+
+struct AstBinSymbol {
+	AstBinString name;
+	uint32_t tokenType;
+	int32_t row, col;
+	uint32_t category; // Symbol::Category
+	uint32_t type;
+	uint32_t value; // node index or astBinaryNone
+};
+
+static_assert(sizeof(double) == 8, "double layout");
+static_assert(sizeof(AstBinString) == 8, "AstBinString layout");
+static_assert(sizeof(AstBinSection) == 8, "AstBinSection layout");
+static_assert(sizeof(AstBinHeader) == 64, "AstBinHeader layout");
+static_assert(sizeof(AstBinValue) == 16 && offsetof(AstBinValue, integer) == 8, "AstBinValue layout");
+static_assert(sizeof(AstBinType) == 48 && offsetof(AstBinType, flags) == 44, "AstBinType layout");
+static_assert(sizeof(AstBinNode) == 72 && offsetof(AstBinNode, value) == 56, "AstBinNode layout");
+static_assert(sizeof(AstBinTable) == 8, "AstBinTable layout");
+static_assert(sizeof(AstBinSymbol) == 32 && offsetof(AstBinSymbol, value) == 28, "AstBinSymbol layout");
+
+class AstBinaryReader {
+public:
+	AstBinaryReader(const void *data, size_t size);
+
+	const AstBinHeader &header() const;
+	const AstBinType &type(uint32_t index) const;
+	const AstBinNode &node(uint32_t index) const;
+	const AstBinTable &table(uint32_t index) const;
+	const AstBinSymbol &symbol(uint32_t index) const;
+	uint32_t child(const AstBinNode &node, uint32_t i) const;
+	const char *string(const AstBinString &s) const;
+	// throws unless the image is valid, the loader checks the records against each other with it
+	void require(bool valid) const;
+
+private:
+	const char *data;
+	size_t size;
+
+	void requireSection(const AstBinSection &section, size_t recordSize) const;
+	template<class T>
+	const T &record(const AstBinSection &section, uint32_t index) const;
+};
+
+template<class T>
+inline const T &AstBinaryReader::record(const AstBinSection &section, uint32_t index) const
+{
+	require(index < section.count);
+	return reinterpret_cast<const T *>(data + section.offset)[index];
+}
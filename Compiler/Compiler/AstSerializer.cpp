@@ -0,0 +1,490 @@
+#include <climits>
+#include <cstring>
+#include "AstSerializer.h"
+
+AstBinString AstBinaryWriter::addString(const std::string &s)
+{
+	auto it = stringIndex.find(s);
+	if (it != stringIndex.end()) {
+		return it->second;
+	}
+	AstBinString res = { (uint32_t)strings.length(), (uint32_t)s.length() };
+	strings.append(s.c_str(), s.length() + 1);
+	stringIndex[s] = res;
+	return res;
+}
+
+uint32_t AstBinaryWriter::addType(PType type)
+{
+	if (type == nullptr) {
+		return astBinaryNone;
+	}
+	if (typeIndex.count(type.get())) {
+		return typeIndex[type.get()];
+	}
+
+	uint32_t index = (uint32_t)types.size();
+	typeIndex[type.get()] = index;
+	types.push_back(AstBinType());
+
+	AstBinType res = {};
+	res.category = type->category;
+	res.size = type->size;
+	res.baseType = res.low = res.high = res.fields = astBinaryNone;
+	res.parameters = res.declarations = res.body = astBinaryNone;
+
+	if (type->category == Type::ARRAY) {
+		auto arrayType = std::static_pointer_cast<ArrayType>(type);
+		res.baseType = addType(arrayType->elementType);
+		res.low = addNode(arrayType->left);
+		res.high = addNode(arrayType->right);
+		res.flags |= (arrayType->packed ? AstBinType::PACKED : 0);
+	}
+	else if (type->category == Type::RECORD) {
+		auto recordType = std::static_pointer_cast<RecordType>(type);
+		res.fields = addTable(recordType->fields);
+		res.flags |= (recordType->packed ? AstBinType::PACKED : 0);
+		res.flags |= (recordType->reordered ? AstBinType::REORDERED : 0);
+	}
+	else if (type->category == Type::FUNCTION) {
+		auto functionType = std::static_pointer_cast<FunctionType>(type);
+		res.baseType = addType(functionType->returnType);
+		res.parameters = addTable(functionType->parameters);
+		res.declarations = addTable(functionType->declarations);
+		res.body = addNode(functionType->body);
+		res.name = addString(functionType->name);
+	}
+
+	types[index] = res;
+	return index;
+}
+
+uint32_t AstBinaryWriter::addNode(PSyntaxNode node)
+{
+	if (node == nullptr) {
+		return astBinaryNone;
+	}
+	if (nodeIndex.count(node.get())) {
+		return nodeIndex[node.get()];
+	}
+
+	uint32_t index = (uint32_t)nodes.size();
+	nodeIndex[node.get()] = index;
+	nodes.push_back(AstBinNode());
+
+	AstBinNode res = {};
+	res.kind = nodeKind(node);
+	res.category = node->category;
+	res.value.category = IdentifierValue::NIL;
+	if (node->token != nullptr) {
+		res.tokenType = node->token->type;
+		res.row = node->token->row;
+		res.col = node->token->col;
+		res.text = addString(node->token->text);
+	}
+
+	std::vector<uint32_t> children;
+	for (auto child : node->children) {
+		children.push_back(addNode(child));
+	}
+	res.children = (uint32_t)refs.size();
+	res.childCount = (uint32_t)children.size();
+	refs.insert(refs.end(), children.begin(), children.end());
+	res.type = addType(node->type);
+
+	if (res.kind == AstBinNode::IF) {
+		auto ifNode = std::static_pointer_cast<IfStatement>(node);
+		res.flags |= (ifNode->ifPart != nullptr ? AstBinNode::IF_THEN : 0);
+		res.flags |= (ifNode->elsePart != nullptr ? AstBinNode::IF_ELSE : 0);
+	}
+	else if (res.kind == AstBinNode::FOR) {
+		res.flags |= (std::static_pointer_cast<ForNode>(node)->downTo ? AstBinNode::DOWN_TO : 0);
+	}
+	else if (res.kind == AstBinNode::INDEX) {
+		res.variable = addString(std::static_pointer_cast<IndexNode>(node)->variableToken->text);
+	}
+	else if (res.kind == AstBinNode::FIELD_ACCESS) {
+		res.variable = addString(std::static_pointer_cast<FieldAccessNode>(node)->variableToken->text);
+	}
+	else if (res.kind == AstBinNode::TYPED_CONST) {
+		auto typedConst = std::static_pointer_cast<TypedConstNode>(node);
+		std::string strings;
+		for (auto &it : typedConst->data->strings) {
+			strings.append(it.c_str(), it.length() + 1);
+		}
+		res.variable = addString(strings);
+		res.stringCount = (uint32_t)typedConst->data->strings.size();
+		res.value.string = addString(std::string(typedConst->data->bytes.data() + typedConst->offset, node->type->size));
+	}
+	else if (res.kind == AstBinNode::CONST) {
+		PIdentifierValue value = std::static_pointer_cast<ConstNode>(node)->value;
+		if (value != nullptr) {
+			res.value.category = value->category;
+			if (value->category == IdentifierValue::INTEGER) {
+				res.value.integer = value->getInteger();
+			}
+			else if (value->category == IdentifierValue::DOUBLE) {
+				res.value._double = value->getDouble();
+			}
+			else {
+				res.value.string = addString(value->getString());
+			}
+		}
+	}
+
+	nodes[index] = res;
+	return index;
+}
+
+uint32_t AstBinaryWriter::addTable(PSymbolTable table)
+{
+	if (table == nullptr) {
+		return astBinaryNone;
+	}
+	if (tableIndex.count(table.get())) {
+		return tableIndex[table.get()];
+	}
+
+	uint32_t index = (uint32_t)tables.size();
+	tableIndex[table.get()] = index;
+	uint32_t first = (uint32_t)symbols.size();
+	tables.push_back({ first, (uint32_t)table->symbolsArray.size() });
+	symbols.resize(first + table->symbolsArray.size());
+
+	for (int i = 0; i < table->symbolsArray.size(); ++i) {
+		PSymbol symbol = table->symbolsArray[i];
+		AstBinSymbol res = {};
+		res.name = addString(symbol->token->text);
+		res.tokenType = symbol->token->type;
+		res.row = symbol->token->row;
+		res.col = symbol->token->col;
+		res.category = symbol->category;
+		res.type = addType(symbol->type);
+		res.value = addNode(symbol->value);
+		symbols[first + i] = res;
+	}
+	return index;
+}
+
+AstBinNode::Kind AstBinaryWriter::nodeKind(PSyntaxNode node)
+{
+	SyntaxNode *p = node.get();
+	if (dynamic_cast<VarNode *>(p)) return AstBinNode::VAR;
+	if (dynamic_cast<UnaryMinusNode *>(p)) return AstBinNode::UNARY_MINUS;
+	if (dynamic_cast<BinaryOpNode *>(p)) return AstBinNode::BINARY_OP;
+	if (dynamic_cast<NotNode *>(p)) return AstBinNode::NOT;
+	if (dynamic_cast<ConstNode *>(p)) return AstBinNode::CONST;
+	if (dynamic_cast<TypedConstNode *>(p)) return AstBinNode::TYPED_CONST;
+	if (dynamic_cast<CastNode *>(p)) return AstBinNode::CAST;
+	if (dynamic_cast<IndexNode *>(p)) return AstBinNode::INDEX;
+	if (dynamic_cast<FieldAccessNode *>(p)) return AstBinNode::FIELD_ACCESS;
+	if (dynamic_cast<AssignStatement *>(p)) return AstBinNode::ASSIGN;
+	if (dynamic_cast<IfStatement *>(p)) return AstBinNode::IF;
+	if (dynamic_cast<WhileNode *>(p)) return AstBinNode::WHILE;
+	if (dynamic_cast<ForNode *>(p)) return AstBinNode::FOR;
+	if (dynamic_cast<ContinueNode *>(p)) return AstBinNode::CONTINUE;
+	if (dynamic_cast<BreakNode *>(p)) return AstBinNode::BREAK;
+	if (dynamic_cast<ExitNode *>(p)) return AstBinNode::EXIT;
+	if (dynamic_cast<ReadNode *>(p)) return AstBinNode::READ;
+	if (dynamic_cast<WriteNode *>(p)) return AstBinNode::WRITE;
+	if (dynamic_cast<FunctionCallNode *>(p)) return AstBinNode::FUNCTION_CALL;
+	return AstBinNode::NODE;
+}
+
+static uint32_t alignSection(uint32_t offset)
+{
+	return (offset + 7) & ~7u;
+}
+
+void AstBinaryWriter::write(std::ostream &output, PType mainFunction)
+{
+	if (!astBinaryHostSupported()) {
+		throw std::exception("AST binary images need a little-endian host");
+	}
+	AstBinHeader header = {};
+	memcpy(header.magic, "PAST", 4);
+	header.version = astBinaryVersion;
+	header.root = addType(mainFunction);
+
+	struct Section {
+		AstBinSection &section;
+		const char *data;
+		size_t count, recordSize;
+	} sections[] = {
+		{ header.strings, strings.data(), strings.size(), 1 },
+		{ header.types, (const char *)types.data(), types.size(), sizeof(AstBinType) },
+		{ header.nodes, (const char *)nodes.data(), nodes.size(), sizeof(AstBinNode) },
+		{ header.tables, (const char *)tables.data(), tables.size(), sizeof(AstBinTable) },
+		{ header.symbols, (const char *)symbols.data(), symbols.size(), sizeof(AstBinSymbol) },
+		{ header.refs, (const char *)refs.data(), refs.size(), sizeof(uint32_t) },
+	};
+
+	uint32_t offset = sizeof(AstBinHeader);
+	for (auto &it : sections) {
+		offset = alignSection(offset);
+		it.section = { offset, (uint32_t)it.count };
+		offset += (uint32_t)(it.count * it.recordSize);
+	}
+
+	output.write((const char *)&header, sizeof(header));
+	uint32_t written = sizeof(AstBinHeader);
+	for (auto &it : sections) {
+		static const char padding[8] = {};
+		output.write(padding, it.section.offset - written);
+		output.write(it.data, it.count * it.recordSize);
+		written = it.section.offset + (uint32_t)(it.count * it.recordSize);
+	}
+}
+
+AstBinaryLoader::AstBinaryLoader(const AstBinaryReader &reader)
+	: reader(reader), types(reader.header().types.count), nodes(reader.header().nodes.count),
+	tables(reader.header().tables.count), loadingTypes(types.size()), loadingNodes(nodes.size()), loadingTables(tables.size())
+{
+}
+
+PType AstBinaryLoader::load()
+{
+	PType res = loadType(reader.header().root);
+	reader.require(res != nullptr && res->category == Type::FUNCTION);
+	return res;
+}
+
+PType AstBinaryLoader::loadType(uint32_t index, bool reference)
+{
+	if (index == astBinaryNone) {
+		return nullptr;
+	}
+	reader.require(index < types.size());
+	if (types[index] != nullptr) {
+		reader.require(!loadingTypes[index] || reference);
+		return types[index];
+	}
+
+	const AstBinType &rec = reader.type(index);
+	reader.require(rec.category <= Type::NIL);
+	Type::Category category = (Type::Category)rec.category;
+
+	// aggregate types are registered before their parts are loaded,
+	// a function body may refer back to the function itself
+	loadingTypes[index] = true;
+	if (category == Type::ARRAY) {
+		auto res = std::make_shared<ArrayType>(nullptr, nullptr, nullptr);
+		types[index] = res;
+		res->elementType = loadDataType(rec.baseType);
+		res->left = std::dynamic_pointer_cast<ConstNode>(loadNode(rec.low));
+		res->right = std::dynamic_pointer_cast<ConstNode>(loadNode(rec.high));
+		for (auto bound : { res->left, res->right }) {
+			reader.require(bound != nullptr && bound->value != nullptr && bound->value->category == IdentifierValue::INTEGER);
+		}
+		long long count = (long long)res->right->value->getInteger() - res->left->value->getInteger() + 1;
+		reader.require(count >= 0 && count * res->elementType->size <= INT_MAX);
+		res->packed = (rec.flags & AstBinType::PACKED) != 0;
+		Layout::apply(*res);
+		types[index] = Type::intern(res);
+	}
+	else if (category == Type::RECORD) {
+		auto res = std::make_shared<RecordType>(nullptr);
+		types[index] = res;
+		res->fields = loadTable(rec.fields);
+		reader.require(res->fields != nullptr);
+		long long size = 0;
+		for (auto &field : res->fields->symbolsArray) {
+			reader.require(field->type != nullptr && field->type->category != Type::FUNCTION && field->type->category != Type::NIL);
+			size += field->type->size + field->type->alignment;
+		}
+		reader.require(size <= INT_MAX);
+		res->packed = (rec.flags & AstBinType::PACKED) != 0;
+		res->reordered = (rec.flags & AstBinType::REORDERED) != 0;
+		Layout::apply(*res);
+		types[index] = Type::intern(res);
+	}
+	else if (category == Type::FUNCTION) {
+		auto res = std::make_shared<FunctionType>(nullptr, nullptr, nullptr, nullptr, reader.string(rec.name));
+		types[index] = res;
+		res->returnType = loadType(rec.baseType);
+		res->parameters = loadTable(rec.parameters);
+		res->declarations = loadTable(rec.declarations);
+		res->body = loadNode(rec.body);
+		reader.require(res->returnType != nullptr && res->parameters != nullptr && res->declarations != nullptr && res->body != nullptr);
+		res->size = rec.size;
+	}
+	else {
+		types[index] = Type::getSimpleType(category);
+	}
+	loadingTypes[index] = false;
+
+	// the sizes of data types follow from their layout, interned types are shared
+	reader.require(types[index]->size == rec.size);
+	return types[index];
+}
+
+PType AstBinaryLoader::loadDataType(uint32_t index)
+{
+	PType res = loadType(index);
+	reader.require(res != nullptr && res->category != Type::FUNCTION && res->category != Type::NIL);
+	return res;
+}
+
+PSyntaxNode AstBinaryLoader::loadNode(uint32_t index)
+{
+	if (index == astBinaryNone) {
+		return nullptr;
+	}
+	reader.require(index < nodes.size() && !loadingNodes[index]);
+	if (nodes[index] != nullptr) {
+		return nodes[index];
+	}
+
+	const AstBinNode &rec = reader.node(index);
+	reader.require(rec.kind <= AstBinNode::FUNCTION_CALL && rec.category <= SyntaxNode::VAR_NODE &&
+		rec.tokenType <= OP_GREATER_OR_EQUAL);
+	loadingNodes[index] = true;
+	PToken token = std::make_shared<Token>((TokenType)rec.tokenType, rec.row, rec.col, reader.string(rec.text));
+	PType type = loadType(rec.type, true);
+	std::vector<PSyntaxNode> children;
+	for (uint32_t i = 0; i < rec.childCount; ++i) {
+		children.push_back(loadNode(reader.child(rec, i)));
+		reader.require(children.back() != nullptr);
+	}
+	auto child = [&children](size_t i) { return i < children.size() ? children[i] : nullptr; };
+	// children the constructor of the node takes apart
+	auto requireChildren = [&](size_t count) { reader.require(children.size() >= count); };
+
+	PSyntaxNode res;
+	switch (rec.kind) {
+		case AstBinNode::VAR:
+			res = std::make_shared<VarNode>(token, type, children, (SyntaxNode::Category)rec.category);
+			break;
+		case AstBinNode::UNARY_MINUS:	res = std::make_shared<UnaryMinusNode>(token, type, children); break;
+		case AstBinNode::BINARY_OP:		res = std::make_shared<BinaryOpNode>(token, type, children); break;
+		case AstBinNode::NOT:			res = std::make_shared<NotNode>(token, type, children); break;
+		case AstBinNode::CONTINUE:		res = std::make_shared<ContinueNode>(token, type, children); break;
+		case AstBinNode::BREAK:			res = std::make_shared<BreakNode>(token, type, children); break;
+		case AstBinNode::EXIT:			res = std::make_shared<ExitNode>(token, type, children); break;
+		case AstBinNode::CONST:
+			res = std::make_shared<ConstNode>(token, type, loadValue(rec.value));
+			break;
+		case AstBinNode::TYPED_CONST: {
+			reader.require(type != nullptr && type->category != Type::FUNCTION && type->category != Type::NIL &&
+				rec.value.string.length == (uint32_t)type->size);
+			PConstData data = std::make_shared<ConstData>(0);
+			const char *bytes = reader.string(rec.value.string);
+			data->bytes.assign(bytes, bytes + rec.value.string.length);
+			const char *strings = reader.string(rec.variable);
+			size_t used = 0;
+			for (uint32_t i = 0; i < rec.stringCount; ++i) {
+				reader.require(used <= rec.variable.length);
+				data->strings.push_back(strings + used);
+				used += data->strings.back().length() + 1;
+			}
+			checkConstData(type, data->bytes, 0, data->strings.size());
+			res = std::make_shared<TypedConstNode>(type, data);
+			break;
+		}
+		case AstBinNode::CAST:
+			requireChildren(1);
+			res = std::make_shared<CastNode>(child(0), type, token->text);
+			break;
+		case AstBinNode::INDEX:
+			res = std::make_shared<IndexNode>(type, children,
+				std::make_shared<Token>(IDENTIFIER, rec.row, rec.col, reader.string(rec.variable)));
+			break;
+		case AstBinNode::FIELD_ACCESS:
+			res = std::make_shared<FieldAccessNode>(type, children,
+				std::make_shared<Token>(IDENTIFIER, rec.row, rec.col, reader.string(rec.variable)));
+			break;
+		case AstBinNode::ASSIGN:
+			res = std::make_shared<AssignStatement>(type, children);
+			break;
+		case AstBinNode::IF: {
+			size_t i = 1;
+			PSyntaxNode ifPart = (rec.flags & AstBinNode::IF_THEN) ? child(i++) : nullptr;
+			PSyntaxNode elsePart = (rec.flags & AstBinNode::IF_ELSE) ? child(i++) : nullptr;
+			requireChildren(i);
+			res = std::make_shared<IfStatement>(token, type, child(0), ifPart, elsePart);
+			break;
+		}
+		case AstBinNode::WHILE:
+			requireChildren(1);
+			res = std::make_shared<WhileNode>(token, type, child(0), child(1));
+			break;
+		case AstBinNode::FOR:
+			requireChildren(3);
+			res = std::make_shared<ForNode>(token, type, child(0), child(1), child(2),
+				(rec.flags & AstBinNode::DOWN_TO) != 0, child(3));
+			break;
+		case AstBinNode::READ:			res = std::make_shared<ReadNode>(token, type, children); break;
+		case AstBinNode::WRITE:			res = std::make_shared<WriteNode>(token, type, children); break;
+		case AstBinNode::FUNCTION_CALL:	res = std::make_shared<FunctionCallNode>(token, type, children); break;
+		default:
+			res = std::make_shared<SyntaxNode>(token, type, children, (SyntaxNode::Category)rec.category);
+			break;
+	}
+
+	// node constructors derive their own tokens, restore the written ones
+	res->token = token;
+	res->category = (SyntaxNode::Category)rec.category;
+	nodes[index] = res;
+	loadingNodes[index] = false;
+	return res;
+}
+
+PSymbolTable AstBinaryLoader::loadTable(uint32_t index)
+{
+	if (index == astBinaryNone) {
+		return nullptr;
+	}
+	reader.require(index < tables.size() && !loadingTables[index]);
+	if (tables[index] != nullptr) {
+		return tables[index];
+	}
+
+	const AstBinTable &rec = reader.table(index);
+	PSymbolTable res = std::make_shared<SymbolTable>();
+	tables[index] = res;
+	loadingTables[index] = true;
+
+	for (uint32_t i = 0; i < rec.count; ++i) {
+		reader.require(rec.symbols <= UINT32_MAX - i);
+		const AstBinSymbol &symbol = reader.symbol(rec.symbols + i);
+		reader.require(symbol.tokenType <= OP_GREATER_OR_EQUAL && symbol.category <= Symbol::VAR_PARAMETER);
+		PToken token = std::make_shared<Token>((TokenType)symbol.tokenType, symbol.row, symbol.col, reader.string(symbol.name));
+		PType type = loadType(symbol.type);
+		reader.require(type != nullptr);
+		res->addVariable(token, type, loadNode(symbol.value), (Symbol::Category)symbol.category);
+	}
+	loadingTables[index] = false;
+	return res;
+}
+
+void AstBinaryLoader::checkConstData(PType type, const std::vector<char> &bytes, int offset, size_t stringCount)
+{
+	if (type->category == Type::STRING) {
+		int index;
+		memcpy(&index, bytes.data() + offset, sizeof(index));
+		reader.require(index >= 0 && index < stringCount);
+	}
+	else if (type->category == Type::ARRAY) {
+		PType elementType = std::static_pointer_cast<ArrayType>(type)->elementType;
+		for (int i = 0; elementType->size != 0 && i < type->size / elementType->size; ++i) {
+			checkConstData(elementType, bytes, offset + i * elementType->size, stringCount);
+		}
+	}
+	else if (type->category == Type::RECORD) {
+		auto recordType = std::static_pointer_cast<RecordType>(type);
+		for (int i = 0; i < recordType->fields->symbolsArray.size(); ++i) {
+			checkConstData(recordType->fields->symbolsArray[i]->type, bytes, offset + recordType->fieldOffset(i), stringCount);
+		}
+	}
+}
+
+PIdentifierValue AstBinaryLoader::loadValue(const AstBinValue &value)
+{
+	switch (value.category) {
+		case IdentifierValue::INTEGER:	return std::make_shared<IdentifierValue>((int)value.integer);
+		case IdentifierValue::DOUBLE:	return std::make_shared<IdentifierValue>(value._double);
+		case IdentifierValue::CHAR:		return std::make_shared<IdentifierValue>(reader.string(value.string)[0]);
+		case IdentifierValue::STRING:	return std::make_shared<IdentifierValue>(std::string(reader.string(value.string)));
+		default:						return nullptr;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "AstBinary.h"
+#include "SyntaxObject.h"
+#include "SymbolTable.h"
+#include "Types.h"
+
+class AstBinaryWriter {
+public:
+	void write(std::ostream &output, PType mainFunction);
+
+private:
+	std::string strings;
+	std::vector<AstBinType> types;
+	std::vector<AstBinNode> nodes;
+	std::vector<AstBinTable> tables;
+	std::vector<AstBinSymbol> symbols;
+	std::vector<uint32_t> refs;
+
+	std::map<std::string, AstBinString> stringIndex;
+	std::map<Type *, uint32_t> typeIndex;
+	std::map<SyntaxNode *, uint32_t> nodeIndex;
+	std::map<SymbolTable *, uint32_t> tableIndex;
+
+	AstBinString addString(const std::string &s);
+	uint32_t addType(PType type);
+	uint32_t addNode(PSyntaxNode node);
+	uint32_t addTable(PSymbolTable table);
+	AstBinNode::Kind nodeKind(PSyntaxNode node);
+};
+
+class AstBinaryLoader {
+public:
+	AstBinaryLoader(const AstBinaryReader &reader);
+	PType load();
+
+private:
+	const AstBinaryReader &reader;
+	std::vector<PType> types;
+	std::vector<PSyntaxNode> nodes;
+	std::vector<PSymbolTable> tables;
+	// parts being loaded, only a node may refer back to one of them and only to a type
+	std::vector<bool> loadingTypes, loadingNodes, loadingTables;
+
+	// reference tells the type of a node, which may be that of the function being loaded
+	PType loadType(uint32_t index, bool reference = false);
+	// data types are those of variables, fields and elements
+	PType loadDataType(uint32_t index);
+	PSyntaxNode loadNode(uint32_t index);
+	PSymbolTable loadTable(uint32_t index);
+	PIdentifierValue loadValue(const AstBinValue &value);
+	// checks that the strings of a typed constant are among its own
+	void checkConstData(PType type, const std::vector<char> &bytes, int offset, size_t stringCount);
+};
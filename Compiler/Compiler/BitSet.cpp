@@ -0,0 +1,44 @@
+#include "BitSet.h"
+
+bool BitSet::unite(const BitSet &other)
+{
+	bool changed = false;
+	for (int i = 0; i < words.size(); ++i) {
+		uint64_t word = words[i] | other.words[i];
+		changed |= word != words[i];
+		words[i] = word;
+	}
+	return changed;
+}
+
+void BitSet::subtract(const BitSet &other)
+{
+	for (int i = 0; i < words.size(); ++i) {
+		words[i] &= ~other.words[i];
+	}
+}
+
+bool BitSet::operator==(const BitSet &other) const
+{
+	return words == other.words;
+}
+
+bool BitSet::operator!=(const BitSet &other) const
+{
+	return words != other.words;
+}
+
+std::vector<int> BitSet::elements() const
+{
+	std::vector<int> res;
+	for (int i = 0; i < words.size(); ++i) {
+		for (uint64_t word = words[i]; word != 0; word &= word - 1) {
+			int bit = 0;
+			while (!((word >> bit) & 1)) {
+				++bit;
+			}
+			res.push_back(i * 64 + bit);
+		}
+	}
+	return res;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Set of the numbers from 0 to a size, like those of registers, kept as bits of whole words
+// so that sets are merged and compared a word at a time.
+class BitSet {
+public:
+	BitSet(int size = 0)
+		: words((size + 63) / 64)
+	{}
+
+	bool operator[](int i) const
+	{
+		return (words[i >> 6] >> (i & 63)) & 1;
+	}
+
+	void set(int i)
+	{
+		words[i >> 6] |= (uint64_t)1 << (i & 63);
+	}
+
+	void reset(int i)
+	{
+		words[i >> 6] &= ~((uint64_t)1 << (i & 63));
+	}
+
+	// adds the numbers of the other set, false if all of them were here
+	bool unite(const BitSet &other);
+	void subtract(const BitSet &other);
+	bool operator==(const BitSet &other) const;
+	bool operator!=(const BitSet &other) const;
+	// the numbers in increasing order
+	std::vector<int> elements() const;
+
+private:
+	std::vector<uint64_t> words;
+};
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <map>
+#include "Cfg.h"
+
+Cfg::Cfg(IrFunction &function)
+	: function(function)
+{
+	update();
+}
+
+void Cfg::update()
+{
+	liveIn.clear();
+	liveOut.clear();
+	loops.clear();
+	computeEdges();
+	computeOrder();
+	computeDominators();
+	computeLoops();
+}
+
+bool Cfg::reachable(int block)
+{
+	return orderIndex[block] >= 0;
+}
+
+bool Cfg::dominates(int a, int b)
+{
+	if (!reachable(a) || !reachable(b)) {
+		return false;
+	}
+	// a dominator precedes the blocks it dominates in reverse postorder
+	while (b != -1 && orderIndex[b] > orderIndex[a]) {
+		b = idom[b];
+	}
+	return b == a;
+}
+
+void Cfg::computeEdges()
+{
+	int n = (int)function.blocks.size();
+	successors.assign(n, {});
+	predecessors.assign(n, {});
+	for (auto &block : function.blocks) {
+		for (int target : block.successors()) {
+			successors[block.id].push_back(target);
+			predecessors[target].push_back(block.id);
+		}
+	}
+}
+
+void Cfg::computeOrder()
+{
+	int n = (int)function.blocks.size();
+	std::vector<bool> visited(n);
+	std::vector<int> postorder;
+	// iterative depth-first search, each entry is a block and the next successor to visit
+	std::vector<std::pair<int, int>> stack;
+	if (n > 0) {
+		stack.push_back({ 0, 0 });
+		visited[0] = true;
+	}
+	while (!stack.empty()) {
+		auto &top = stack.back();
+		if (top.second < successors[top.first].size()) {
+			int next = successors[top.first][top.second++];
+			if (!visited[next]) {
+				visited[next] = true;
+				stack.push_back({ next, 0 });
+			}
+			continue;
+		}
+		postorder.push_back(top.first);
+		stack.pop_back();
+	}
+
+	order.assign(postorder.rbegin(), postorder.rend());
+	orderIndex.assign(n, -1);
+	for (int i = 0; i < order.size(); ++i) {
+		orderIndex[order[i]] = i;
+	}
+
+	// edges of unreachable blocks are dropped, the analyses consider reachable code only
+	for (int block = 0; block < n; ++block) {
+		if (!reachable(block)) {
+			successors[block].clear();
+		}
+		auto &preds = predecessors[block];
+		preds.erase(std::remove_if(preds.begin(), preds.end(), [this](int pred) { return !reachable(pred); }), preds.end());
+	}
+}
+
+// the iterative algorithm of Cooper, Harvey and Kennedy
+void Cfg::computeDominators()
+{
+	int n = (int)function.blocks.size();
+	idom.assign(n, -1);
+	dominated.assign(n, {});
+	if (order.empty()) {
+		return;
+	}
+
+	int entry = order[0];
+	idom[entry] = entry;
+	for (bool changed = true; changed; ) {
+		changed = false;
+		for (int i = 1; i < order.size(); ++i) {
+			int block = order[i];
+			int dom = -1;
+			for (int pred : predecessors[block]) {
+				if (idom[pred] == -1) {
+					continue;
+				}
+				if (dom == -1) {
+					dom = pred;
+					continue;
+				}
+				// walks both fingers up to their common dominator
+				int x = pred;
+				while (x != dom) {
+					while (orderIndex[x] > orderIndex[dom]) x = idom[x];
+					while (orderIndex[dom] > orderIndex[x]) dom = idom[dom];
+				}
+			}
+			if (idom[block] != dom) {
+				idom[block] = dom;
+				changed = true;
+			}
+		}
+	}
+	idom[entry] = -1;
+
+	for (int block : order) {
+		if (idom[block] != -1) {
+			dominated[idom[block]].push_back(block);
+		}
+	}
+}
+
+void Cfg::computeLiveness()
+{
+	int n = (int)function.blocks.size();
+	int registers = function.registerCnt;
+	std::vector<BitSet> use(n, BitSet(registers)), def(use);
+	for (auto &block : function.blocks) {
+		for (auto &instruction : block.instructions) {
+			for (int reg : instruction.uses()) {
+				if (!def[block.id][reg]) {
+					use[block.id].set(reg);
+				}
+			}
+			if (instruction.def() != -1) {
+				def[block.id].set(instruction.def());
+			}
+		}
+	}
+
+	liveIn.assign(n, BitSet(registers));
+	liveOut.assign(n, BitSet(registers));
+	for (bool changed = true; changed; ) {
+		changed = false;
+		for (int i = (int)order.size() - 1; i >= 0; --i) {
+			int block = order[i];
+			for (int succ : successors[block]) {
+				liveOut[block].unite(liveIn[succ]);
+			}
+			BitSet live = liveOut[block];
+			live.subtract(def[block]);
+			live.unite(use[block]);
+			if (live != liveIn[block]) {
+				liveIn[block] = live;
+				changed = true;
+			}
+		}
+	}
+}
+
+void Cfg::computeLoops()
+{
+	int n = (int)function.blocks.size();
+	std::map<int, Loop> byHeader;
+	for (int block : order) {
+		for (int header : successors[block]) {
+			if (!dominates(header, block)) {
+				continue;
+			}
+			auto &loop = byHeader[header];
+			if (loop.contains.empty()) {
+				loop.header = header;
+				loop.contains.assign(n, false);
+				loop.contains[header] = true;
+			}
+			// the blocks reaching the back edge without passing the header
+			std::vector<int> stack;
+			if (!loop.contains[block]) {
+				loop.contains[block] = true;
+				stack.push_back(block);
+			}
+			while (!stack.empty()) {
+				int top = stack.back();
+				stack.pop_back();
+				for (int pred : predecessors[top]) {
+					if (!loop.contains[pred]) {
+						loop.contains[pred] = true;
+						stack.push_back(pred);
+					}
+				}
+			}
+		}
+	}
+
+	for (auto &it : byHeader) {
+		auto &loop = it.second;
+		for (int block = 0; block < n; ++block) {
+			if (loop.contains[block]) {
+				loop.blocks.push_back(block);
+			}
+		}
+		loops.push_back(loop);
+	}
+	// a loop nested in another one has fewer blocks
+	std::stable_sort(loops.begin(), loops.end(), [](const Loop &a, const Loop &b) {
+		return a.blocks.size() < b.blocks.size();
+	});
+}
+
+static void printList(AsmWriter &writer, const char *title, const std::vector<int> &items, char prefix)
+{
+	writer.write("; ").write(title).write(':');
+	if (items.empty()) {
+		writer.write(" -");
+	}
+	for (int item : items) {
+		writer.write(' ').write(prefix).write(item);
+	}
+	writer.write('\n');
+}
+
+void Cfg::print(AsmWriter &writer)
+{
+	computeLiveness();
+	writer.write("function ").write(function.name).write('\n');
+	for (auto &it : function.variables) {
+		writer.write("; ").write(it.first).write(" = v").write(it.second).write('\n');
+	}
+	for (auto &loop : loops) {
+		writer.write("; loop");
+		for (int block : loop.blocks) {
+			writer.write(" b").write(block);
+		}
+		writer.write('\n');
+	}
+	for (auto &block : function.blocks) {
+		if (!reachable(block.id)) {
+			continue;
+		}
+		writer.write('b').write(block.id).write(' ').write(block.name).write(":\n");
+		printList(writer, "preds", predecessors[block.id], 'b');
+		printList(writer, "idom", idom[block.id] == -1 ? std::vector<int>() : std::vector<int>({ idom[block.id] }), 'b');
+		printList(writer, "live in", liveIn[block.id].elements(), 'v');
+		for (auto &instruction : block.instructions) {
+			writer.write('\t');
+			instruction.print(writer);
+			writer.write('\n');
+		}
+		printList(writer, "live out", liveOut[block.id].elements(), 'v');
+	}
+}
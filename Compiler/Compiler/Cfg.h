@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+
+#include "Ir.h"
+#include "BitSet.h"
+
+// Control-flow graph of an IR function with its dominator tree, loops and the liveness of registers.
+// The analyses describe the function as it was at construction or at the last update.
+// The liveness is the costly one, it is only found for the passes asking for it.
+class Cfg {
+public:
+	// natural loop of the back edges to a header
+	struct Loop {
+		int header;
+		// blocks of the loop in layout order, the header included
+		std::vector<int> blocks;
+		std::vector<bool> contains;
+	};
+
+	IrFunction &function;
+	std::vector<std::vector<int>> successors, predecessors;
+	// reachable blocks in reverse postorder, the entry comes first
+	std::vector<int> order;
+	// immediate dominator of each block, -1 for the entry and unreachable blocks
+	std::vector<int> idom;
+	// children in the dominator tree
+	std::vector<std::vector<int>> dominated;
+	// registers live at the start and at the end of each block, found by computeLiveness
+	std::vector<BitSet> liveIn, liveOut;
+	// inner loops come before the loops containing them
+	std::vector<Loop> loops;
+
+	Cfg(IrFunction &function);
+
+	// finds the analyses again after the blocks or the jumps of the function changed
+	void update();
+	bool reachable(int block);
+	bool dominates(int a, int b);
+	// finds the liveness again, as it is after the instructions changed
+	void computeLiveness();
+	// dumps the function annotated with the analyses
+	void print(AsmWriter &writer);
+
+private:
+	std::vector<int> orderIndex;
+
+	void computeEdges();
+	void computeOrder();
+	void computeDominators();
+	void computeLoops();
+};
@@ -0,0 +1,313 @@
+#include <algorithm>
+#include "DeadCodeEliminator.h"
+
+DeadCodeEliminator::DeadCodeEliminator(IrFunction &function, Cfg &cfg, AsmCode &code, const std::set<std::string> &pure)
+	: function(function), cfg(cfg), code(code), pure(pure)
+{
+}
+
+void DeadCodeEliminator::run()
+{
+	// removing code may make the values it used dead and branches on them constant
+	for (bool changed = true; changed; ) {
+		changed = foldBranches();
+		changed |= removeUnreachableBlocks();
+		changed |= mergeBlocks();
+		changed |= removeDeadDefinitions();
+		changed |= removeDeadStores();
+	}
+}
+
+bool DeadCodeEliminator::foldBranches()
+{
+	std::vector<bool> variable(function.registerCnt);
+	for (auto &it : function.variables) {
+		variable[it.second] = true;
+	}
+	std::vector<int> definitions(function.registerCnt);
+	std::vector<IrOperand> constants(function.registerCnt);
+	for (auto &block : function.blocks) {
+		for (auto &instruction : block.instructions) {
+			int def = instruction.def();
+			if (def == -1) {
+				continue;
+			}
+			++definitions[def];
+			if (instruction.opcode == IrInstruction::MOV && instruction.type == IrInstruction::I32 && instruction.a.isImmediate()) {
+				constants[def] = instruction.a;
+			}
+		}
+	}
+	auto constant = [&](const IrOperand &operand) {
+		if (operand.isRegister() && !variable[operand.value] && definitions[operand.value] == 1 &&
+			constants[operand.value].isImmediate())
+		{
+			return constants[operand.value];
+		}
+		return operand;
+	};
+
+	bool changed = false;
+	for (auto &block : function.blocks) {
+		if (block.instructions.empty() || block.instructions.back().opcode != IrInstruction::BRANCH) {
+			continue;
+		}
+		auto &branch = block.instructions.back();
+		int taken;
+		IrOperand a = constant(branch.a), b = constant(branch.b);
+		if (branch.targets[0] == branch.targets[1]) {
+			taken = branch.targets[0];
+		}
+		else if (branch.type != IrInstruction::F64 && a.isImmediate() && b.isImmediate()) {
+			taken = branch.targets[IrInstruction::evaluate(branch.condition, a.value, b.value) ? 0 : 1];
+		}
+		else {
+			continue;
+		}
+		IrInstruction jump(IrInstruction::JUMP);
+		jump.targets = { taken };
+		branch = jump;
+		changed = true;
+	}
+	if (changed) {
+		cfg.update();
+	}
+	return changed;
+}
+
+bool DeadCodeEliminator::removeUnreachableBlocks()
+{
+	std::vector<int> number(function.blocks.size(), -1);
+	std::vector<IrBlock> blocks;
+	for (auto &block : function.blocks) {
+		if (cfg.reachable(block.id)) {
+			number[block.id] = (int)blocks.size();
+			blocks.push_back(block);
+		}
+	}
+	if (blocks.size() == function.blocks.size()) {
+		return false;
+	}
+	// only the last block falls off the end of the function, so the blocks left keep their terminators
+	for (auto &block : blocks) {
+		block.id = number[block.id];
+		for (auto &instruction : block.instructions) {
+			for (int &target : instruction.targets) {
+				target = number[target];
+			}
+		}
+	}
+	function.blocks = blocks;
+	cfg.update();
+	return true;
+}
+
+bool DeadCodeEliminator::mergeBlocks()
+{
+	bool changed = false;
+	for (auto &block : function.blocks) {
+		auto &instructions = block.instructions;
+		while (!instructions.empty() && instructions.back().opcode == IrInstruction::JUMP) {
+			int target = instructions.back().targets[0];
+			auto &next = function.blocks[target].instructions;
+			// the last block falls off the end of the function, so it can't be moved into the middle
+			if (target == 0 || target == block.id || cfg.predecessors[target].size() != 1 ||
+				next.empty() || !next.back().isTerminator())
+			{
+				break;
+			}
+			// the merged block is left empty and unreachable, the edges of its successors keep their number
+			instructions.pop_back();
+			instructions.insert(instructions.end(), next.begin(), next.end());
+			next.clear();
+			changed = true;
+		}
+	}
+	if (changed) {
+		cfg.update();
+	}
+	return changed;
+}
+
+bool DeadCodeEliminator::removeDeadDefinitions()
+{
+	static const std::set<IrInstruction::Opcode> effects = {
+		IrInstruction::STORE, IrInstruction::WRITE, IrInstruction::READ, IrInstruction::PARAM, IrInstruction::CHECK, IrInstruction::RETURN,
+		IrInstruction::JUMP, IrInstruction::BRANCH,
+	};
+	auto removable = [this](const IrInstruction &instruction) {
+		return !effects.count(instruction.opcode) && (instruction.opcode != IrInstruction::CALL || pure.count(instruction.a.name));
+	};
+
+	// registers whose values reach an instruction with an effect, a variable only updated from itself isn't needed
+	std::vector<std::vector<const IrInstruction *>> definitions(function.registerCnt);
+	std::vector<bool> needed(function.registerCnt);
+	std::vector<int> stack;
+	for (auto &block : function.blocks) {
+		for (auto &instruction : block.instructions) {
+			if (instruction.def() != -1) {
+				definitions[instruction.def()].push_back(&instruction);
+			}
+			if (removable(instruction)) {
+				continue;
+			}
+			for (int reg : instruction.uses()) {
+				if (!needed[reg]) {
+					needed[reg] = true;
+					stack.push_back(reg);
+				}
+			}
+		}
+	}
+	while (!stack.empty()) {
+		int top = stack.back();
+		stack.pop_back();
+		for (auto instruction : definitions[top]) {
+			for (int reg : instruction->uses()) {
+				if (!needed[reg]) {
+					needed[reg] = true;
+					stack.push_back(reg);
+				}
+			}
+		}
+	}
+
+	// a definition is also dead where it is overwritten before any use
+	cfg.computeLiveness();
+	bool changed = false;
+	for (auto &block : function.blocks) {
+		auto live = cfg.liveOut[block.id];
+		auto &instructions = block.instructions;
+		for (int i = (int)instructions.size() - 1; i >= 0; --i) {
+			auto &instruction = instructions[i];
+			int def = instruction.def();
+			if (def != -1 && (!live[def] || !needed[def]) && !effects.count(instruction.opcode)) {
+				// a call of a routine with side effects stays, only its result is dropped
+				if (removable(instruction)) {
+					instructions.erase(instructions.begin() + i);
+					changed = true;
+					continue;
+				}
+				instruction.dst = IrOperand();
+				changed = true;
+			}
+			if (def != -1) {
+				live.reset(def);
+			}
+			for (int reg : instruction.uses()) {
+				live.set(reg);
+			}
+		}
+	}
+	return changed;
+}
+
+bool DeadCodeEliminator::removeDeadStores()
+{
+	// a frame variable is read if it is named anywhere but as the address of a store
+	std::set<std::string> read;
+	for (auto &block : function.blocks) {
+		for (auto &instruction : block.instructions) {
+			std::vector<const IrOperand *> operands = { &instruction.b };
+			if (instruction.opcode != IrInstruction::STORE) {
+				operands.push_back(&instruction.a);
+			}
+			for (auto &argument : instruction.arguments) {
+				operands.push_back(&argument);
+			}
+			for (auto operand : operands) {
+				if (operand->kind == IrOperand::VARIABLE) {
+					read.insert(operand->name);
+				}
+			}
+		}
+	}
+
+	bool changed = false;
+	for (auto &block : function.blocks) {
+		auto &instructions = block.instructions;
+		auto end = std::remove_if(instructions.begin(), instructions.end(), [&](const IrInstruction &instruction) {
+			return instruction.opcode == IrInstruction::STORE && instruction.a.kind == IrOperand::VARIABLE &&
+				code.offsets.count(instruction.a.name) && !read.count(instruction.a.name);
+		});
+		changed |= end != instructions.end();
+		instructions.erase(end, instructions.end());
+	}
+	return changed;
+}
+
+std::vector<bool> DeadCodeEliminator::frameAddresses(const IrFunction &function, AsmCode &code)
+{
+	// every defined register is assumed to be an address in the frame until one of its definitions isn't
+	std::vector<bool> res(function.registerCnt);
+	for (auto &block : function.blocks) {
+		for (auto &instruction : block.instructions) {
+			if (instruction.def() != -1) {
+				res[instruction.def()] = true;
+			}
+		}
+	}
+	auto inFrame = [&res](const IrOperand &operand) { return operand.isRegister() && res[operand.value]; };
+	for (bool changed = true; changed; ) {
+		changed = false;
+		for (auto &block : function.blocks) {
+			for (auto &instruction : block.instructions) {
+				int def = instruction.def();
+				if (def == -1 || !res[def]) {
+					continue;
+				}
+				bool derived = false;
+				switch (instruction.opcode) {
+				case IrInstruction::ADDR:
+					derived = instruction.a.kind == IrOperand::VARIABLE && code.offsets.count(instruction.a.name);
+					break;
+				case IrInstruction::MOV:
+					derived = inFrame(instruction.a);
+					break;
+				case IrInstruction::ADD:
+					derived = inFrame(instruction.a) != inFrame(instruction.b);
+					break;
+				case IrInstruction::SUB:
+					derived = inFrame(instruction.a) && !inFrame(instruction.b);
+					break;
+				}
+				if (!derived) {
+					res[def] = false;
+					changed = true;
+				}
+			}
+		}
+	}
+	return res;
+}
+
+bool DeadCodeEliminator::isPure(const IrFunction &function, AsmCode &code, const std::set<std::string> &pure)
+{
+	auto frame = frameAddresses(function, code);
+	for (auto &block : function.blocks) {
+		for (auto &instruction : block.instructions) {
+			switch (instruction.opcode) {
+			case IrInstruction::WRITE:
+			case IrInstruction::READ:
+			// a range check error ends the program
+			case IrInstruction::CHECK:
+				return false;
+			case IrInstruction::CALL:
+				if (!pure.count(instruction.a.name)) {
+					return false;
+				}
+				break;
+			case IrInstruction::STORE: {
+				auto &address = instruction.a;
+				bool local = address.kind == IrOperand::VARIABLE ? code.offsets.count(address.name) > 0 :
+					address.isRegister() && frame[address.value];
+				if (!local) {
+					return false;
+				}
+				break;
+			}
+			}
+		}
+	}
+	return true;
+}
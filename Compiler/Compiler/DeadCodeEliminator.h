@@ -0,0 +1,41 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <set>
+
+#include "Ir.h"
+#include "Cfg.h"
+#include "Generator.h"
+
+// Removes the code of a function that never runs or whose results are never used. Branches on constants
+// become jumps and the blocks no longer reachable are dropped, such as those following exit, break and
+// continue, then a block left with a single predecessor is merged into it. Definitions of registers that
+// aren't live after them, stores to frame variables that are never loaded and calls of side-effect free
+// routines whose results aren't used are deleted.
+class DeadCodeEliminator {
+public:
+	// pure holds the labels of the side-effect free routines compiled before the function,
+	// the graph of the function is updated as blocks and jumps change
+	DeadCodeEliminator(IrFunction &function, Cfg &cfg, AsmCode &code, const std::set<std::string> &pure);
+	void run();
+
+	// whether a call of the routine compiled in the current frame of the code may be dropped when its result
+	// isn't used: it writes nothing, stores only to its own frame and calls only side-effect free routines
+	static bool isPure(const IrFunction &function, AsmCode &code, const std::set<std::string> &pure);
+
+private:
+	IrFunction &function;
+	Cfg &cfg;
+	AsmCode &code;
+	const std::set<std::string> &pure;
+
+	// branches whose operands are constants, or registers defined once by a constant, become jumps
+	bool foldBranches();
+	bool removeUnreachableBlocks();
+	// a block jumped to only by the one before it is appended to that one
+	bool mergeBlocks();
+	bool removeDeadDefinitions();
+	bool removeDeadStores();
+	// registers holding addresses in the frame of the current routine, whatever path defines them
+	static std::vector<bool> frameAddresses(const IrFunction &function, AsmCode &code);
+};
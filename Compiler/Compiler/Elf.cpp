@@ -0,0 +1,54 @@
+#include <cstring>
+#include "Elf.h"
+#include "Linker.h"
+#include "Layout.h"
+#include "Runtime.h"
+
+ElfWriter::ElfWriter(AsmCode &code)
+	: code(code)
+{
+}
+
+void ElfWriter::write(std::ostream &output)
+{
+	Encoder encoder(code);
+	encoder.run();
+	Linker linker(code, encoder);
+
+	int textOffset = Layout::alignUp(sizeof(ElfHeader) + 2 * sizeof(ElfProgramHeader), 16);
+	int offset = textOffset + (int)encoder.text.size();
+	linker.place(true, true, offset);
+	int codeEnd = offset;
+	int dataOffset = offset = Layout::alignUp(offset, pageSize);
+	linker.place(false, true, offset);
+	int fileEnd = offset;
+	linker.place(false, false, offset);
+	int memoryEnd = offset;
+	linker.locate(baseAddress + textOffset, baseAddress);
+
+	std::string image(fileEnd, '\0');
+	linker.writeText(&image[textOffset]);
+	linker.writeData(&image[0]);
+
+	ElfHeader header = {};
+	const unsigned char ident[] = { 0x7F, 'E', 'L', 'F', 2, 1, 1 };
+	memcpy(header.ident, ident, sizeof(ident));
+	header.type = 2;
+	header.machine = 62;
+	header.version = 1;
+	header.entry = linker.address(Runtime::start);
+	header.phoff = sizeof(ElfHeader);
+	header.ehsize = sizeof(ElfHeader);
+	header.phentsize = sizeof(ElfProgramHeader);
+	header.phnum = 2;
+	header.shentsize = 64;
+	memcpy(&image[0], &header, sizeof(header));
+
+	ElfProgramHeader segments[2] = {
+		{ 1, 5, 0, baseAddress, baseAddress, (uint64_t)codeEnd, (uint64_t)codeEnd, pageSize },
+		{ 1, 6, (uint64_t)dataOffset, baseAddress + dataOffset, baseAddress + dataOffset,
+			(uint64_t)(fileEnd - dataOffset), (uint64_t)(memoryEnd - dataOffset), pageSize },
+	};
+	memcpy(&image[sizeof(ElfHeader)], segments, sizeof(segments));
+	output.write(image.data(), image.size());
+}
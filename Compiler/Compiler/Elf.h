@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "Generator.h"
+
+// Static executable of Linux x86-64 written without an assembler and a linker. The headers, the code
+// and the constants are loaded at 0x400000 as one readable and executable segment, the variables
+// follow in a writable one from the next page, the variables without initial values aren't stored
+// in the file. All addresses are below 2 GB, so the 32-bit pointers of the code hold them.
+
+struct ElfHeader {
+	unsigned char ident[16];
+	uint16_t type, machine;
+	uint32_t version;
+	uint64_t entry, phoff, shoff;
+	uint32_t flags;
+	uint16_t ehsize, phentsize, phnum, shentsize, shnum, shstrndx;
+};
+
+struct ElfProgramHeader {
+	uint32_t type, flags;
+	uint64_t offset, vaddr, paddr, filesz, memsz, align;
+};
+
+class ElfWriter {
+public:
+	static const uint64_t baseAddress = 0x400000;
+	static const int pageSize = 0x1000;
+
+	ElfWriter(AsmCode &code);
+	void write(std::ostream &output);
+
+private:
+	AsmCode &code;
+};
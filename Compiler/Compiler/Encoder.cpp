@@ -0,0 +1,504 @@
+#include <cstdlib>
+#include <climits>
+#include "Encoder.h"
+
+struct RegisterCode {
+	AsmRegister::RegisterType type;
+	int number, size;
+};
+
+// the stack pointer and the frame base are 64-bit on x86-64, the others keep 32-bit values
+static const RegisterCode registerCodes[] = {
+	{ AsmRegister::eax, 0, 4 }, { AsmRegister::ecx, 1, 4 }, { AsmRegister::edx, 2, 4 }, { AsmRegister::ebx, 3, 4 },
+	{ AsmRegister::esp, 4, 8 }, { AsmRegister::ebp, 5, 8 }, { AsmRegister::esi, 6, 4 }, { AsmRegister::edi, 7, 4 },
+	{ AsmRegister::r8d, 8, 4 }, { AsmRegister::r9d, 9, 4 }, { AsmRegister::r10d, 10, 4 }, { AsmRegister::r11d, 11, 4 },
+	{ AsmRegister::r12d, 12, 4 }, { AsmRegister::r13d, 13, 4 }, { AsmRegister::r14d, 14, 4 }, { AsmRegister::r15d, 15, 4 },
+	{ AsmRegister::rax, 0, 8 }, { AsmRegister::rcx, 1, 8 }, { AsmRegister::rdx, 2, 8 }, { AsmRegister::rbx, 3, 8 },
+	{ AsmRegister::rsp, 4, 8 }, { AsmRegister::rbp, 5, 8 }, { AsmRegister::rsi, 6, 8 }, { AsmRegister::rdi, 7, 8 },
+	{ AsmRegister::r8, 8, 8 }, { AsmRegister::r9, 9, 8 }, { AsmRegister::r10, 10, 8 }, { AsmRegister::r11, 11, 8 },
+	{ AsmRegister::r12, 12, 8 }, { AsmRegister::r13, 13, 8 }, { AsmRegister::r14, 14, 8 }, { AsmRegister::r15, 15, 8 },
+	{ AsmRegister::al, 0, 1 }, { AsmRegister::cl, 1, 1 }, { AsmRegister::dl, 2, 1 }, { AsmRegister::bl, 3, 1 },
+	{ AsmRegister::ah, 4, 1 }, { AsmRegister::ax, 0, 2 },
+	{ AsmRegister::xmm0, 0, 16 }, { AsmRegister::xmm1, 1, 16 }, { AsmRegister::xmm2, 2, 16 }, { AsmRegister::xmm3, 3, 16 },
+	{ AsmRegister::xmm4, 4, 16 }, { AsmRegister::xmm5, 5, 16 }, { AsmRegister::xmm6, 6, 16 }, { AsmRegister::xmm7, 7, 16 },
+	{ AsmRegister::xmm8, 8, 16 }, { AsmRegister::xmm9, 9, 16 }, { AsmRegister::xmm10, 10, 16 }, { AsmRegister::xmm11, 11, 16 },
+	{ AsmRegister::xmm12, 12, 16 }, { AsmRegister::xmm13, 13, 16 }, { AsmRegister::xmm14, 14, 16 }, { AsmRegister::xmm15, 15, 16 },
+};
+
+static const int dataSizeBytes[] = { 1, 2, 4, 8, 16 };
+
+static const std::map<AsmCommand::CommandType, int> jumpConditions = {
+	{ AsmCommand::jb, 0x2 }, { AsmCommand::jae, 0x3 }, { AsmCommand::jz, 0x4 }, { AsmCommand::jnz, 0x5 },
+	{ AsmCommand::jbe, 0x6 }, { AsmCommand::ja, 0x7 }, { AsmCommand::jp, 0xA }, { AsmCommand::jnp, 0xB },
+	{ AsmCommand::jl, 0xC }, { AsmCommand::jge, 0xD }, { AsmCommand::jle, 0xE }, { AsmCommand::jg, 0xF },
+};
+
+static const std::map<AsmCommand::CommandType, int> setConditions = {
+	{ AsmCommand::setb, 0x2 }, { AsmCommand::setae, 0x3 }, { AsmCommand::sete, 0x4 }, { AsmCommand::setne, 0x5 },
+	{ AsmCommand::setbe, 0x6 }, { AsmCommand::seta, 0x7 }, { AsmCommand::setl, 0xC }, { AsmCommand::setge, 0xD },
+	{ AsmCommand::setle, 0xE }, { AsmCommand::setg, 0xF }, { AsmCommand::setp, 0xA }, { AsmCommand::setnp, 0xB },
+};
+
+// the field of the ModRM byte selecting the operation of the groups of arithmetic and unary commands
+static const std::map<AsmCommand::CommandType, int> extensions = {
+	{ AsmCommand::add, 0 }, { AsmCommand::or, 1 }, { AsmCommand::and, 4 }, { AsmCommand::sub, 5 },
+	{ AsmCommand::xor, 6 }, { AsmCommand::cmp, 7 },
+	{ AsmCommand::not, 2 }, { AsmCommand::neg, 3 }, { AsmCommand::div, 6 }, { AsmCommand::idiv, 7 },
+	{ AsmCommand::inc, 0 }, { AsmCommand::dec, 1 },
+};
+
+struct SseOpcode {
+	int prefix;
+	// the opcode writing the register and the one writing memory, -1 if there is none
+	int load, store;
+};
+
+static const std::map<AsmCommand::CommandType, SseOpcode> sseOpcodes = {
+	{ AsmCommand::movsd, { 0xF2, 0x10, 0x11 } }, { AsmCommand::movd, { 0x66, 0x6E, 0x7E } },
+	{ AsmCommand::movdqa, { 0x66, 0x6F, 0x7F } }, { AsmCommand::movdqu, { 0xF3, 0x6F, 0x7F } },
+	{ AsmCommand::movapd, { 0x66, 0x28, 0x29 } }, { AsmCommand::movupd, { 0x66, 0x10, 0x11 } },
+	{ AsmCommand::addsd, { 0xF2, 0x58, -1 } }, { AsmCommand::mulsd, { 0xF2, 0x59, -1 } },
+	{ AsmCommand::subsd, { 0xF2, 0x5C, -1 } }, { AsmCommand::divsd, { 0xF2, 0x5E, -1 } },
+	{ AsmCommand::comisd, { 0x66, 0x2F, -1 } }, { AsmCommand::ucomisd, { 0x66, 0x2E, -1 } },
+	{ AsmCommand::cvtsi2sd, { 0xF2, 0x2A, -1 } }, { AsmCommand::cvttsd2si, { 0xF2, 0x2C, -1 } },
+	{ AsmCommand::cvtsd2si, { 0xF2, 0x2D, -1 } }, { AsmCommand::movmskpd, { 0x66, 0x50, -1 } },
+	{ AsmCommand::pshufd, { 0x66, 0x70, -1 } }, { AsmCommand::unpcklpd, { 0x66, 0x14, -1 } },
+	{ AsmCommand::unpckhpd, { 0x66, 0x15, -1 } }, { AsmCommand::paddd, { 0x66, 0xFE, -1 } },
+	{ AsmCommand::psubd, { 0x66, 0xFA, -1 } }, { AsmCommand::pand, { 0x66, 0xDB, -1 } },
+	{ AsmCommand::pandn, { 0x66, 0xDF, -1 } }, { AsmCommand::por, { 0x66, 0xEB, -1 } },
+	{ AsmCommand::pcmpgtd, { 0x66, 0x66, -1 } }, { AsmCommand::addpd, { 0x66, 0x58, -1 } },
+	{ AsmCommand::subpd, { 0x66, 0x5C, -1 } }, { AsmCommand::mulpd, { 0x66, 0x59, -1 } },
+	{ AsmCommand::divpd, { 0x66, 0x5E, -1 } }, { AsmCommand::minpd, { 0x66, 0x5D, -1 } },
+	{ AsmCommand::maxpd, { 0x66, 0x5F, -1 } },
+};
+
+static bool fitsByte(long long value)
+{
+	return value >= -128 && value <= 127;
+}
+
+Encoder::Encoder(AsmCode &code)
+	: code(code)
+{
+}
+
+void Encoder::run()
+{
+	std::vector<AsmRoutine> routines = { code.mainRoutine() };
+	routines.insert(routines.end(), code.routines.begin(), code.routines.end());
+	for (auto &routine : routines) {
+		Instruction label;
+		label.label = routine.label;
+		instructions.push_back(label);
+		for (auto &command : routine.frameCommands64()) {
+			encode(command);
+		}
+	}
+	relax();
+}
+
+Encoder::Operand Encoder::operand(std::shared_ptr<AsmParameter> par)
+{
+	Operand res;
+	if (auto reg = std::dynamic_pointer_cast<AsmRegister>(par)) {
+		const RegisterCode *registerCode = nullptr;
+		for (auto &it : registerCodes) {
+			if (it.type == reg->registerType) {
+				registerCode = &it;
+			}
+		}
+		if (registerCode == nullptr || reg->isVirtual()) {
+			throw std::exception("The register can't be encoded");
+		}
+		res.reg = registerCode->number;
+		if (reg->full) {
+			res.kind = Operand::MEM;
+			res.size = dataSizeBytes[reg->dataSize];
+			res.disp = -reg->offset;
+			return res;
+		}
+		res.kind = Operand::REG;
+		res.size = registerCode->size;
+		res.xmm = reg->isXmm();
+		return res;
+	}
+	if (auto memory = std::dynamic_pointer_cast<AsmMemory>(par)) {
+		res.kind = Operand::MEM;
+		res.reg = 5;
+		res.size = dataSizeBytes[memory->dataSize];
+		res.disp = -memory->offset;
+		return res;
+	}
+	if (auto memory = std::dynamic_pointer_cast<AsmLabelMemory>(par)) {
+		res.kind = Operand::MEM;
+		res.reg = -1;
+		res.size = dataSizeBytes[memory->dataSize];
+		res.label = memory->label;
+		res.disp = memory->offset;
+		return res;
+	}
+	auto value = std::static_pointer_cast<AsmValue>(par)->value;
+	char *end;
+	res.value = strtoll(value.c_str(), &end, 10);
+	res.kind = !value.empty() && *end == 0 ? Operand::IMM : Operand::LABEL;
+	res.label = value;
+	return res;
+}
+
+void Encoder::emit(Instruction &instruction, int prefix, bool w, const std::vector<unsigned char> &opcode, int field, const Operand &rm)
+{
+	auto &bytes = instruction.bytes;
+	if (prefix != 0) {
+		bytes.push_back(prefix);
+	}
+	int rex = 0x40 | (w ? 8 : 0) | (field >= 8 ? 4 : 0) | (rm.reg >= 8 ? 1 : 0);
+	if (rex != 0x40) {
+		bytes.push_back(rex);
+	}
+	bytes.insert(bytes.end(), opcode.begin(), opcode.end());
+
+	int reg = (field & 7) << 3;
+	if (rm.kind == Operand::REG) {
+		bytes.push_back(0xC0 | reg | (rm.reg & 7));
+		return;
+	}
+	if (rm.reg == -1) {
+		bytes.push_back(0x05 | reg);
+		instruction.fixups.push_back({ (int)bytes.size(), rm.label, rm.disp, true, 0 });
+		emitImmediate(instruction, 0, 4);
+		return;
+	}
+	// rsp and r12 as bases need a SIB byte, rbp and r13 always have a displacement
+	int mod = rm.disp == 0 && (rm.reg & 7) != 5 ? 0x00 : fitsByte(rm.disp) ? 0x40 : 0x80;
+	bytes.push_back(mod | reg | (rm.reg & 7));
+	if ((rm.reg & 7) == 4) {
+		bytes.push_back(0x24);
+	}
+	if (mod != 0x00) {
+		emitImmediate(instruction, rm.disp, mod == 0x40 ? 1 : 4);
+	}
+}
+
+void Encoder::emitImmediate(Instruction &instruction, long long value, int size)
+{
+	for (int i = 0; i < size; ++i) {
+		instruction.bytes.push_back((unsigned char)(value >> (8 * i)));
+	}
+}
+
+void Encoder::encode(const AsmCommand &command)
+{
+	auto type = command.commandType;
+	std::vector<Operand> operands;
+	for (auto &par : command.parameters) {
+		operands.push_back(operand(par));
+	}
+	// a call and ret also hold the registers of the arguments and the result
+	if (type == AsmCommand::call) {
+		operands.resize(1);
+	}
+	else if (type == AsmCommand::ret) {
+		operands.clear();
+	}
+	if (operands.size() >= 2 && operands[0].kind == Operand::MEM && operands[1].kind == Operand::MEM) {
+		throw std::exception("A command can't have two memory operands");
+	}
+
+	if (type == AsmCommand::label) {
+		Instruction label;
+		label.label = operands[0].label;
+		instructions.push_back(label);
+		return;
+	}
+	if ((type == AsmCommand::jmp || type == AsmCommand::call) && operands[0].kind == Operand::REG) {
+		// an indirect jump or call to the 64-bit address in the register
+		Instruction instruction;
+		emit(instruction, 0, false, { 0xFF }, type == AsmCommand::jmp ? 4 : 2, operands[0]);
+		instructions.push_back(instruction);
+		return;
+	}
+	// jumps to anything but a label are rejected by encodeJump
+	if (type == AsmCommand::jmp || type == AsmCommand::call || type == AsmCommand::loop || jumpConditions.count(type)) {
+		encodeJump(type == AsmCommand::jmp ? -1 : type == AsmCommand::call ? -2 : type == AsmCommand::loop ? -3 : jumpConditions.at(type), operands[0]);
+		return;
+	}
+	if (sseOpcodes.count(type)) {
+		encodeSse(command, operands[0], operands[1]);
+		return;
+	}
+
+	Instruction instruction;
+	auto &bytes = instruction.bytes;
+	Operand dst = operands.empty() ? Operand() : operands[0];
+	int size = dst.size;
+	int prefix = size == 2 ? 0x66 : 0;
+	bool w = size == 8;
+	switch (type) {
+	case AsmCommand::ret:
+		bytes = { 0xC3 };
+		break;
+	case AsmCommand::cdq:
+		bytes = { 0x99 };
+		break;
+	case AsmCommand::lahf:
+		bytes = { 0x9F };
+		break;
+	case AsmCommand::syscall:
+		bytes = { 0x0F, 0x05 };
+		break;
+	case AsmCommand::push:
+	case AsmCommand::pop:
+		if (dst.kind == Operand::REG) {
+			if (dst.reg >= 8) {
+				bytes.push_back(0x41);
+			}
+			bytes.push_back((type == AsmCommand::push ? 0x50 : 0x58) + (dst.reg & 7));
+		}
+		else if (dst.kind == Operand::IMM) {
+			bytes.push_back(0x68);
+			emitImmediate(instruction, dst.value, 4);
+		}
+		else {
+			emit(instruction, 0, false, { (unsigned char)(type == AsmCommand::push ? 0xFF : 0x8F) }, type == AsmCommand::push ? 6 : 0, dst);
+		}
+		break;
+	case AsmCommand::mov: {
+		auto &src = operands[1];
+		if (src.kind == Operand::IMM && dst.kind == Operand::REG && (size != 8 || src.value < INT_MIN || src.value > INT_MAX)) {
+			// mov to a register has the register in the opcode and an immediate of its size,
+			// a 64-bit register takes a sign-extended dword unless the value doesn't fit it
+			if (prefix != 0) {
+				bytes.push_back(prefix);
+			}
+			if (w || dst.reg >= 8) {
+				bytes.push_back(0x40 | (w ? 8 : 0) | (dst.reg >= 8 ? 1 : 0));
+			}
+			bytes.push_back((size == 1 ? 0xB0 : 0xB8) + (dst.reg & 7));
+			emitImmediate(instruction, src.value, size);
+		}
+		else if (src.kind == Operand::IMM) {
+			emit(instruction, prefix, w, { (unsigned char)(size == 1 ? 0xC6 : 0xC7) }, 0, dst);
+			emitImmediate(instruction, src.value, size == 8 ? 4 : size);
+		}
+		else if (src.kind == Operand::REG) {
+			size = src.size;
+			emit(instruction, size == 2 ? 0x66 : 0, size == 8, { (unsigned char)(size == 1 ? 0x88 : 0x89) }, src.reg, dst);
+		}
+		else {
+			emit(instruction, prefix, w, { (unsigned char)(size == 1 ? 0x8A : 0x8B) }, dst.reg, src);
+		}
+		break;
+	}
+	case AsmCommand::add:
+	case AsmCommand::or:
+	case AsmCommand::and:
+	case AsmCommand::sub:
+	case AsmCommand::xor:
+	case AsmCommand::cmp:
+		encodeArithmetic(extensions.at(type), dst, operands[1]);
+		return;
+	case AsmCommand::test: {
+		auto &src = operands[1];
+		if (src.kind == Operand::IMM && dst.kind == Operand::REG && dst.reg == 0) {
+			if (prefix != 0) {
+				bytes.push_back(prefix);
+			}
+			if (w) {
+				bytes.push_back(0x48);
+			}
+			bytes.push_back(size == 1 ? 0xA8 : 0xA9);
+			emitImmediate(instruction, src.value, size == 8 ? 4 : size);
+		}
+		else if (src.kind == Operand::IMM) {
+			emit(instruction, prefix, w, { (unsigned char)(size == 1 ? 0xF6 : 0xF7) }, 0, dst);
+			emitImmediate(instruction, src.value, size == 8 ? 4 : size);
+		}
+		else {
+			emit(instruction, prefix, w, { (unsigned char)(size == 1 ? 0x84 : 0x85) }, src.reg, dst);
+		}
+		break;
+	}
+	case AsmCommand::imul: {
+		// the two operand form with an immediate multiplies the register by itself
+		auto &src = operands[1];
+		auto &immediate = operands.size() == 3 ? operands[2] : src;
+		if (immediate.kind == Operand::IMM) {
+			emit(instruction, prefix, w, { (unsigned char)(fitsByte(immediate.value) ? 0x6B : 0x69) }, dst.reg, operands.size() == 3 ? src : dst);
+			emitImmediate(instruction, immediate.value, fitsByte(immediate.value) ? 1 : size == 2 ? 2 : 4);
+		}
+		else {
+			emit(instruction, prefix, w, { 0x0F, 0xAF }, dst.reg, src);
+		}
+		break;
+	}
+	case AsmCommand::idiv:
+	case AsmCommand::div:
+	case AsmCommand::neg:
+	case AsmCommand::not:
+		emit(instruction, prefix, w, { (unsigned char)(size == 1 ? 0xF6 : 0xF7) }, extensions.at(type), dst);
+		break;
+	case AsmCommand::inc:
+	case AsmCommand::dec:
+		emit(instruction, prefix, w, { (unsigned char)(size == 1 ? 0xFE : 0xFF) }, extensions.at(type), dst);
+		break;
+	case AsmCommand::lea:
+		emit(instruction, prefix, w, { 0x8D }, dst.reg, operands[1]);
+		break;
+	case AsmCommand::movsx:
+	case AsmCommand::movzx: {
+		int opcode = (type == AsmCommand::movsx ? 0xBE : 0xB6) + (operands[1].size == 2 ? 1 : 0);
+		emit(instruction, prefix, w, { 0x0F, (unsigned char)opcode }, dst.reg, operands[1]);
+		break;
+	}
+	case AsmCommand::setge:
+	case AsmCommand::setg:
+	case AsmCommand::setle:
+	case AsmCommand::setl:
+	case AsmCommand::sete:
+	case AsmCommand::setne:
+	case AsmCommand::setbe:
+	case AsmCommand::setb:
+	case AsmCommand::seta:
+	case AsmCommand::setae:
+	case AsmCommand::setp:
+	case AsmCommand::setnp:
+		emit(instruction, 0, false, { 0x0F, (unsigned char)(0x90 + setConditions.at(type)) }, 0, dst);
+		break;
+	default:
+		throw std::exception("The command can't be encoded for x86-64");
+	}
+	instructions.push_back(instruction);
+}
+
+void Encoder::encodeJump(int condition, const Operand &target)
+{
+	if (target.kind != Operand::LABEL) {
+		throw std::exception("Jumps and calls take a label");
+	}
+	Instruction instruction;
+	instruction.target = target.label;
+	instruction.condition = condition;
+	// calls have no short form
+	instruction.near = condition == -2;
+	instructions.push_back(instruction);
+}
+
+void Encoder::encodeArithmetic(int extension, const Operand &dst, const Operand &src)
+{
+	Instruction instruction;
+	int size = dst.kind == Operand::REG || src.kind != Operand::REG ? dst.size : src.size;
+	int prefix = size == 2 ? 0x66 : 0;
+	bool w = size == 8;
+	if (src.kind == Operand::IMM && dst.kind == Operand::REG && dst.reg == 0 && (size == 1 || !fitsByte(src.value))) {
+		// the accumulator has a form without ModRM
+		if (prefix != 0) {
+			instruction.bytes.push_back(prefix);
+		}
+		if (w) {
+			instruction.bytes.push_back(0x48);
+		}
+		instruction.bytes.push_back(extension * 8 + (size == 1 ? 4 : 5));
+		emitImmediate(instruction, src.value, size == 8 ? 4 : size);
+	}
+	else if (src.kind == Operand::IMM) {
+		if (size == 1 || fitsByte(src.value)) {
+			emit(instruction, prefix, w, { (unsigned char)(size == 1 ? 0x80 : 0x83) }, extension, dst);
+			emitImmediate(instruction, src.value, 1);
+		}
+		else {
+			emit(instruction, prefix, w, { 0x81 }, extension, dst);
+			emitImmediate(instruction, src.value, size == 2 ? 2 : 4);
+		}
+	}
+	else if (src.kind == Operand::REG) {
+		emit(instruction, prefix, w, { (unsigned char)(extension * 8 + (size == 1 ? 0 : 1)) }, src.reg, dst);
+	}
+	else {
+		emit(instruction, prefix, w, { (unsigned char)(extension * 8 + (size == 1 ? 2 : 3)) }, dst.reg, src);
+	}
+	instructions.push_back(instruction);
+}
+
+void Encoder::encodeSse(const AsmCommand &command, const Operand &dst, const Operand &src)
+{
+	Instruction instruction;
+	auto type = command.commandType;
+	auto &opcode = sseOpcodes.at(type);
+	bool load = dst.kind == Operand::REG && (dst.xmm || opcode.store == -1);
+	if (type == AsmCommand::movd) {
+		load = dst.xmm;
+	}
+	// integer operands of conversions are 64-bit with REX.W
+	bool w = (type == AsmCommand::cvtsi2sd && src.kind == Operand::REG && src.size == 8) ||
+		((type == AsmCommand::cvttsd2si || type == AsmCommand::cvtsd2si) && dst.size == 8);
+	if (load) {
+		emit(instruction, opcode.prefix, w, { 0x0F, (unsigned char)opcode.load }, dst.reg, src);
+	}
+	else {
+		emit(instruction, opcode.prefix, w, { 0x0F, (unsigned char)opcode.store }, src.reg, dst);
+	}
+	if (type == AsmCommand::pshufd) {
+		emitImmediate(instruction, operand(command.parameters[2]).value, 1);
+	}
+	instructions.push_back(instruction);
+}
+
+void Encoder::relax()
+{
+	for (bool changed = true; changed; ) {
+		changed = false;
+		int offset = 0;
+		for (auto &it : instructions) {
+			it.offset = offset;
+			if (!it.label.empty()) {
+				labels[it.label] = offset;
+			}
+			else if (!it.target.empty()) {
+				offset += !it.near ? 2 : it.condition == -1 || it.condition == -2 ? 5 : 6;
+			}
+			else {
+				offset += (int)it.bytes.size();
+			}
+		}
+		for (auto &it : instructions) {
+			if (it.target.empty() || it.near) {
+				continue;
+			}
+			if (!labels.count(it.target)) {
+				throw std::exception("Jump to an undefined label");
+			}
+			if (!fitsByte(labels[it.target] - (it.offset + 2))) {
+				if (it.condition == -3) {
+					throw std::exception("The target of loop is out of reach");
+				}
+				it.near = true;
+				changed = true;
+			}
+		}
+	}
+
+	text.clear();
+	fixups.clear();
+	for (auto &it : instructions) {
+		if (!it.target.empty()) {
+			if (!labels.count(it.target)) {
+				throw std::exception("Jump to an undefined label");
+			}
+			if (!it.near) {
+				it.bytes = { (unsigned char)(it.condition == -1 ? 0xEB : it.condition == -3 ? 0xE2 : 0x70 + it.condition) };
+				emitImmediate(it, labels[it.target] - (it.offset + 2), 1);
+			}
+			else {
+				it.bytes = it.condition == -1 ? std::vector<unsigned char>{ 0xE9 } : it.condition == -2 ? std::vector<unsigned char>{ 0xE8 } :
+					std::vector<unsigned char>{ 0x0F, (unsigned char)(0x80 + it.condition) };
+				emitImmediate(it, labels[it.target] - (it.offset + (int)it.bytes.size() + 4), 4);
+			}
+		}
+		for (auto fixup : it.fixups) {
+			fixup.position += it.offset;
+			fixup.end = it.offset + (int)it.bytes.size();
+			fixups.push_back(fixup);
+		}
+		text.insert(text.end(), it.bytes.begin(), it.bytes.end());
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+
+#include "Generator.h"
+
+// Machine code of x86-64 for the commands of the Linux target. Each command is encoded on its own,
+// jumps are short at first and those whose targets are out of reach become near ones until none
+// changes. Labels of the code are resolved here, references to data are left to the linker as fixups.
+class Encoder {
+public:
+	// a 32-bit field at the position in the code holding the address of the label plus the addend,
+	// a relative one holds its distance from the end of the instruction
+	struct Fixup {
+		int position;
+		std::string label;
+		int addend;
+		bool relative;
+		int end;
+	};
+
+	Encoder(AsmCode &code);
+	void run();
+
+	std::vector<char> text;
+	// offsets of the routines and labels in the code
+	std::map<std::string, int> labels;
+	std::vector<Fixup> fixups;
+
+private:
+	struct Operand {
+		enum Kind {
+			REG, MEM, IMM, LABEL,
+		};
+
+		Kind kind = IMM;
+		// number of a register, or of the base of memory, -1 for memory addressed relative to rip
+		int reg = 0;
+		// bytes of the operand, 16 for xmm registers and vectors
+		int size = 4;
+		bool xmm = false;
+		int disp = 0;
+		long long value = 0;
+		std::string label;
+	};
+
+	struct Instruction {
+		std::vector<unsigned char> bytes;
+		// positions of the fixups are relative to the instruction
+		std::vector<Fixup> fixups;
+		// a jump or a call to the label, the label is defined by an empty instruction otherwise
+		std::string target;
+		std::string label;
+		// condition code of a conditional jump, -1 for jmp, -2 for call and -3 for loop
+		int condition = -1;
+		bool near = false;
+		int offset = 0;
+	};
+
+	AsmCode &code;
+	std::vector<Instruction> instructions;
+
+	static Operand operand(std::shared_ptr<AsmParameter> par);
+	void encode(const AsmCommand &command);
+	void encodeJump(int condition, const Operand &target);
+	// prefix and REX, the opcode, ModRM with the field of the operation and the register or memory operand
+	void emit(Instruction &instruction, int prefix, bool w, const std::vector<unsigned char> &opcode, int field, const Operand &rm);
+	void emitImmediate(Instruction &instruction, long long value, int size);
+	void encodeArithmetic(int extension, const Operand &dst, const Operand &src);
+	void encodeSse(const AsmCommand &command, const Operand &dst, const Operand &src);
+	void relax();
+};
@@ -0,0 +1,395 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include "Evaluator.h"
+#include "IrBuilder.h"
+#include "Layout.h"
+#include "Operation.h"
+
+// integers wrap around as in the machine code
+static int32_t wrap(int64_t value)
+{
+	return (int32_t)(uint32_t)value;
+}
+
+PIdentifierValue Evaluator::evaluate(std::shared_ptr<FunctionType> function, const std::vector<PSyntaxNode> &arguments)
+{
+	auto category = function->returnType->category;
+	if (category != Type::INTEGER && category != Type::DOUBLE && category != Type::CHAR) {
+		return nullptr;
+	}
+	try {
+		Frame caller;
+		Value res = call(function, arguments, caller);
+		if (category == Type::DOUBLE) {
+			return std::make_shared<IdentifierValue>(res.d);
+		}
+		if (category == Type::CHAR) {
+			return std::make_shared<IdentifierValue>((char)res.i);
+		}
+		return std::make_shared<IdentifierValue>(res.i);
+	}
+	catch (std::exception) {
+		return nullptr;
+	}
+}
+
+void Evaluator::step()
+{
+	if (--steps < 0) {
+		throw std::exception("Too many steps to evaluate at compile time");
+	}
+}
+
+Evaluator::Value Evaluator::call(std::shared_ptr<FunctionType> function, const std::vector<PSyntaxNode> &arguments, Frame &caller)
+{
+	// the body of a routine isn't known in its own declaration
+	if (function == nullptr || function->body == nullptr || depth >= maxDepth) {
+		throw std::exception("Routine can't be evaluated");
+	}
+
+	// the variables are placed before any is initialized, so the storage isn't moved
+	Frame frame;
+	std::vector<std::pair<PSymbol, int>> placed;
+	int size = 0;
+	auto &parameters = function->parameters->symbolsArray;
+	for (int i = 0; i < parameters.size(); ++i) {
+		if (IrBuilder::byReference(parameters[i]) && parameters[i]->category != Symbol::NIL) {
+			frame.variables[lowerString(parameters[i]->token->text)] = address(arguments[i], caller,
+				parameters[i]->category == Symbol::VAR_PARAMETER);
+			continue;
+		}
+		size = Layout::alignUp(size, parameters[i]->type->alignment);
+		placed.push_back({ parameters[i], size });
+		size += parameters[i]->type->size;
+	}
+	for (auto symbol : function->declarations->symbolsArray) {
+		if (symbol->category != Symbol::NIL || symbol->type->category == Type::FUNCTION) {
+			continue;
+		}
+		// initialized variables of routines keep their data between calls
+		if (symbol->value != nullptr) {
+			throw std::exception("Routine with initialized variables can't be evaluated");
+		}
+		size = Layout::alignUp(size, symbol->type->alignment);
+		placed.push_back({ symbol, size });
+		size += symbol->type->size;
+	}
+	frame.storage.assign(size, 0);
+	frame.assigned.assign(size, 0);
+	for (auto &it : placed) {
+		frame.variables[lowerString(it.first->token->text)] = { frame.storage.data() + it.second, frame.assigned.data() + it.second };
+	}
+
+	// the routines evaluated only depend on their arguments, a call repeated with the same scalars isn't run again
+	bool scalars = true;
+	std::vector<int64_t> key;
+	for (int i = 0; i < parameters.size(); ++i) {
+		auto parameter = parameters[i];
+		if (IrBuilder::byReference(parameter)) {
+			if (parameter->category == Symbol::NIL) {
+				auto copy = frame.variables.at(lowerString(parameter->token->text));
+				auto argument = address(arguments[i], caller, false);
+				memcpy(copy.bytes, argument.bytes, parameter->type->size);
+				if (argument.assigned != nullptr) {
+					memcpy(copy.assigned, argument.assigned, parameter->type->size);
+				}
+				else {
+					memset(copy.assigned, 1, parameter->type->size);
+				}
+			}
+			scalars = false;
+			continue;
+		}
+		Value argument = convert(value(arguments[i], caller), arguments[i]->type, parameter->type);
+		store(parameter->type, frame.variables.at(lowerString(parameter->token->text)), argument);
+		int64_t bits;
+		memcpy(&bits, &argument.d, sizeof(bits));
+		key.push_back(parameter->type->category == Type::DOUBLE ? bits : argument.i);
+	}
+	auto known = results.find({ function.get(), key });
+	if (scalars && known != results.end()) {
+		return known->second;
+	}
+
+	++depth;
+	execute(function->body, frame);
+	--depth;
+	Value res;
+	if (function->returnType->category != Type::NIL) {
+		res = load(function->returnType, frame.variables.at("result"));
+	}
+	if (scalars) {
+		results[{ function.get(), key }] = res;
+	}
+	return res;
+}
+
+Evaluator::Flow Evaluator::execute(PSyntaxNode node, Frame &frame)
+{
+	step();
+	if (std::dynamic_pointer_cast<FunctionCallNode>(node)) {
+		value(node, frame);
+		return NEXT;
+	}
+	if (std::dynamic_pointer_cast<AssignStatement>(node)) {
+		auto left = node->children[0], right = node->children[1];
+		if (!Type::simpleCategories.count(left->type->category)) {
+			throw std::exception("Only simple values are assigned at compile time");
+		}
+		store(left->type, address(left, frame, true), convert(value(right, frame), right->type, left->type));
+		return NEXT;
+	}
+	if (auto statement = std::dynamic_pointer_cast<IfStatement>(node)) {
+		auto part = condition(statement->condition, frame) ? statement->ifPart : statement->elsePart;
+		return part != nullptr ? execute(part, frame) : NEXT;
+	}
+	if (auto loop = std::dynamic_pointer_cast<WhileNode>(node)) {
+		while (condition(loop->condition, frame)) {
+			step();
+			Flow flow = loop->body != nullptr ? execute(loop->body, frame) : NEXT;
+			if (flow == BREAK) {
+				break;
+			}
+			if (flow == EXIT) {
+				return EXIT;
+			}
+		}
+		return NEXT;
+	}
+	if (auto loop = std::dynamic_pointer_cast<ForNode>(node)) {
+		// the bound is evaluated once before the start as in the compiled code
+		int32_t bound = value(loop->to, frame).i;
+		auto counter = address(loop->counter, frame, true);
+		store(loop->counter->type, counter, value(loop->from, frame));
+		while (loop->downTo ? load(loop->counter->type, counter).i >= bound : load(loop->counter->type, counter).i <= bound) {
+			step();
+			Flow flow = loop->body != nullptr ? execute(loop->body, frame) : NEXT;
+			if (flow == BREAK) {
+				break;
+			}
+			if (flow == EXIT) {
+				return EXIT;
+			}
+			Value next;
+			next.i = wrap((int64_t)load(loop->counter->type, counter).i + (loop->downTo ? -1 : 1));
+			store(loop->counter->type, counter, next);
+		}
+		return NEXT;
+	}
+	if (std::dynamic_pointer_cast<ContinueNode>(node)) {
+		return CONTINUE;
+	}
+	if (std::dynamic_pointer_cast<BreakNode>(node)) {
+		return BREAK;
+	}
+	if (std::dynamic_pointer_cast<ExitNode>(node)) {
+		// the compiled code doesn't return the value of exit
+		if (!node->children.empty()) {
+			throw std::exception("Exit with a value can't be evaluated");
+		}
+		return EXIT;
+	}
+	if (std::dynamic_pointer_cast<ReadNode>(node) || std::dynamic_pointer_cast<WriteNode>(node)) {
+		throw std::exception("Routines reading or writing can't be evaluated");
+	}
+	for (auto child : node->children) {
+		Flow flow = execute(child, frame);
+		if (flow != NEXT) {
+			return flow;
+		}
+	}
+	return NEXT;
+}
+
+bool Evaluator::condition(PSyntaxNode node, Frame &frame)
+{
+	Value res = value(node, frame);
+	return node->type->category == Type::DOUBLE ? res.d != 0 : res.i != 0;
+}
+
+Evaluator::Value Evaluator::value(PSyntaxNode node, Frame &frame)
+{
+	Value res;
+	if (auto constant = std::dynamic_pointer_cast<ConstNode>(node)) {
+		auto category = node->type->category;
+		if (category == Type::DOUBLE) {
+			res.d = constant->value->toDouble();
+		}
+		else if (category == Type::INTEGER || category == Type::CHAR) {
+			res.i = constant->value->toInteger();
+		}
+		else {
+			throw std::exception("Strings aren't evaluated at compile time");
+		}
+		return res;
+	}
+	if (auto call = std::dynamic_pointer_cast<FunctionCallNode>(node)) {
+		return this->call(call->function, call->children, frame);
+	}
+	if (std::dynamic_pointer_cast<BinaryOpNode>(node)) {
+		return binary(node, frame);
+	}
+	if (std::dynamic_pointer_cast<UnaryMinusNode>(node)) {
+		Value a = value(node->children[0], frame);
+		if (node->type->category == Type::DOUBLE) {
+			res.d = -a.d;
+		}
+		else {
+			res.i = wrap(-(int64_t)a.i);
+		}
+		return res;
+	}
+	if (std::dynamic_pointer_cast<NotNode>(node)) {
+		res.i = ~value(node->children[0], frame).i;
+		return res;
+	}
+	if (auto cast = std::dynamic_pointer_cast<CastNode>(node)) {
+		return convert(value(node->children[0], frame), node->children[0]->type, cast->newType);
+	}
+	if (!Type::simpleCategories.count(node->type->category)) {
+		throw std::exception("Expression can't be evaluated at compile time");
+	}
+	return load(node->type, address(node, frame, false));
+}
+
+// comparisons are 0 or -1 as in the compiled code
+Evaluator::Value Evaluator::binary(PSyntaxNode node, Frame &frame)
+{
+	auto operation = node->token->type;
+	auto operandType = node->children[0]->type;
+	Value a = value(node->children[0], frame), b = value(node->children[1], frame), res;
+	if (Operation::logicalTypes.count(operation)) {
+		bool holds = operandType->category == Type::DOUBLE ? Operation::evalLogicalOperation<double>(a.d, b.d, node->token) :
+			Operation::evalLogicalOperation<int>(a.i, b.i, node->token);
+		res.i = holds ? -1 : 0;
+		return res;
+	}
+	if (node->type->category == Type::DOUBLE) {
+		res.d = Operation::evalDoubles(a.d, b.d, node->token);
+		return res;
+	}
+	switch (operation) {
+	case OP_PLUS:
+		res.i = wrap((int64_t)a.i + b.i);
+		break;
+	case OP_MINUS:
+		res.i = wrap((int64_t)a.i - b.i);
+		break;
+	case OP_MULT:
+		res.i = wrap((int64_t)a.i * b.i);
+		break;
+	case KEYWORD_DIV:
+	case KEYWORD_MOD:
+		if (b.i == 0) {
+			throw std::exception("Division by zero");
+		}
+		// the quotient doesn't fit, idiv traps on it as on division by zero
+		if (a.i == INT_MIN && b.i == -1) {
+			throw std::exception("Division overflow");
+		}
+		res.i = wrap(operation == KEYWORD_DIV ? (int64_t)a.i / b.i : (int64_t)a.i % b.i);
+		break;
+	case KEYWORD_AND:
+	case KEYWORD_OR:
+	case KEYWORD_XOR:
+		res.i = Operation::evalIntegers(a.i, b.i, node->token);
+		break;
+	default:
+		throw std::exception("Operation can't be evaluated at compile time");
+	}
+	return res;
+}
+
+Evaluator::Location Evaluator::address(PSyntaxNode node, Frame &frame, bool store)
+{
+	if (std::dynamic_pointer_cast<VarNode>(node)) {
+		auto it = frame.variables.find(lowerString(node->token->text));
+		if (it == frame.variables.end()) {
+			throw std::exception("Routines using variables other than their own can't be evaluated");
+		}
+		return it->second;
+	}
+	if (auto constant = std::dynamic_pointer_cast<TypedConstNode>(node)) {
+		if (store) {
+			throw std::exception("Typed constants can't be changed");
+		}
+		return { constant->data->bytes.data() + constant->offset, nullptr };
+	}
+	int offset;
+	if (std::dynamic_pointer_cast<IndexNode>(node)) {
+		auto arrayType = std::static_pointer_cast<ArrayType>(node->children[0]->type);
+		int32_t index = value(node->children[1], frame).i;
+		if (index < arrayType->left->value->toInteger() || index > arrayType->right->value->toInteger()) {
+			throw std::exception("Index out of range");
+		}
+		offset = (index - arrayType->left->value->toInteger()) * arrayType->elementType->size;
+	}
+	else if (std::dynamic_pointer_cast<FieldAccessNode>(node)) {
+		auto recordType = std::static_pointer_cast<RecordType>(node->children[0]->type);
+		offset = recordType->fieldOffset(recordType->fieldIndex(node->children[1]->token->text));
+	}
+	else {
+		throw std::exception("Variable expected");
+	}
+	auto base = address(node->children[0], frame, store);
+	return { base.bytes + offset, base.assigned != nullptr ? base.assigned + offset : nullptr };
+}
+
+// chars are bytes in memory, they are loaded without the sign
+Evaluator::Value Evaluator::load(PType type, Location location)
+{
+	if (location.assigned != nullptr && std::count(location.assigned, location.assigned + type->size, 0) > 0) {
+		throw std::exception("Variable is read before it is assigned");
+	}
+	Value res;
+	switch (type->category) {
+	case Type::INTEGER:
+		memcpy(&res.i, location.bytes, sizeof(res.i));
+		break;
+	case Type::CHAR:
+		res.i = (unsigned char)*location.bytes;
+		break;
+	case Type::DOUBLE:
+		memcpy(&res.d, location.bytes, sizeof(res.d));
+		break;
+	default:
+		throw std::exception("Values of this type aren't evaluated at compile time");
+	}
+	return res;
+}
+
+void Evaluator::store(PType type, Location location, Value value)
+{
+	switch (type->category) {
+	case Type::INTEGER:
+		memcpy(location.bytes, &value.i, sizeof(value.i));
+		break;
+	case Type::CHAR:
+		*location.bytes = (char)value.i;
+		break;
+	case Type::DOUBLE:
+		memcpy(location.bytes, &value.d, sizeof(value.d));
+		break;
+	default:
+		throw std::exception("Values of this type aren't evaluated at compile time");
+	}
+	if (location.assigned != nullptr) {
+		memset(location.assigned, 1, type->size);
+	}
+}
+
+// integers and chars share registers, doubles are converted with the fraction truncated
+Evaluator::Value Evaluator::convert(Value value, PType from, PType to)
+{
+	bool fromDouble = from->category == Type::DOUBLE, toDouble = to->category == Type::DOUBLE;
+	Value res = value;
+	if (toDouble && !fromDouble) {
+		res.d = value.i;
+	}
+	else if (fromDouble && !toDouble) {
+		// cvttsd2si gives the least integer for values out of its range
+		res.i = value.d > -2147483649.0 && value.d < 2147483648.0 ? (int32_t)value.d : INT32_MIN;
+	}
+	return res;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "SyntaxObject.h"
+#include "Types.h"
+
+// Runs side-effect free routines at compile time, so their calls with constant arguments become constants.
+// The tree of a routine is interpreted with its variables laid out in memory as in its frame, and values
+// behave as in the compiled code. A routine isn't evaluated if it reads or writes, uses variables other
+// than its own, indexes out of the bounds of an array, divides by zero or runs out of steps.
+class Evaluator {
+public:
+	static const int maxSteps = 100000;
+	static const int maxDepth = 256;
+
+	// value of the call of the function with constant arguments, nullptr if it can't be evaluated
+	PIdentifierValue evaluate(std::shared_ptr<FunctionType> function, const std::vector<PSyntaxNode> &arguments);
+
+private:
+	// integers and chars are kept in i as in registers, doubles in d
+	struct Value {
+		int32_t i = 0;
+		double d = 0;
+	};
+
+	// bytes of a variable and the flags of those assigned, constants have no flags
+	struct Location {
+		char *bytes;
+		char *assigned;
+	};
+
+	// variables of a routine by their names, var parameters are located in the frame of the caller
+	struct Frame {
+		std::map<std::string, Location> variables;
+		std::vector<char> storage, assigned;
+	};
+
+	enum Flow {
+		NEXT, BREAK, CONTINUE, EXIT,
+	};
+
+	int steps = maxSteps;
+	int depth = 0;
+	// results of the calls with scalar arguments by the routine and the bits of the arguments
+	std::map<std::pair<const FunctionType *, std::vector<int64_t>>, Value> results;
+
+	void step();
+	Value call(std::shared_ptr<FunctionType> function, const std::vector<PSyntaxNode> &arguments, Frame &caller);
+	Flow execute(PSyntaxNode node, Frame &frame);
+	Value value(PSyntaxNode node, Frame &frame);
+	Value binary(PSyntaxNode node, Frame &frame);
+	bool condition(PSyntaxNode node, Frame &frame);
+	// variable in the frame or element of a typed constant, which can't be stored to
+	Location address(PSyntaxNode node, Frame &frame, bool store);
+	// the values of variables not assigned yet aren't known
+	static Value load(PType type, Location location);
+	static void store(PType type, Location location, Value value);
+	static Value convert(Value value, PType from, PType to);
+};
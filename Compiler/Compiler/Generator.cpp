@@ -1,37 +1,176 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
 #include "Generator.h"
 #include "SymbolTable.h"
 #include "Types.h"
+#include "Layout.h"
+#include "Runtime.h"
 #include "Utils.h"
 
 const std::string AsmMemory::dataSizeName[] = {
-	"byte", "word", "dword", "qword",
+	"byte", "word", "dword", "qword", "xmmword",
 };
 
 const std::string AsmRegister::registerName[] = {
-	"eax", "ebx", "ecx", "edx", "xmm0", "xmm1", "esp", "ebp", "al", "cl", "ah", "bl", "ax",
+	"eax", "ebx", "ecx", "edx", "xmm0", "xmm1", "esp", "ebp", "al", "cl", "ah", "bl", "ax", "esi", "edi",
+	"xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+	"r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d",
+	"xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15",
+	"rax", "rbx", "rcx", "rdx", "rsp", "rbp", "rsi", "rdi", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15", "dl",
 };
 
 const std::string AsmCommand::commandName[] = {
 	"mov", "push", "pop", "add", "sub", "imul", "idiv", "cdq", "printf", "movsd",
 	"and", "or", "xor", "mulsd", "addsd", "divsd", "subsd",
 	"setge", "setg", "setle", "setl", "sete", "setne", "cmp", "jmp", "",
-	"comisd", "ucomisd", "setbe", "setb", "seta", "setae", "jp", "jnp", "lahf", "test",
+	"comisd", "ucomisd", "setbe", "setb", "seta", "setae", "setp", "setnp", "jp", "jnp", "lahf", "test",
 	"loop", "jnz", "jz", "inc", "dec", "jge", "jle",
-	"movsx",
+	"movsx", "movzx", "lea", "neg", "not", "jl", "jg",
+	"cvtsi2sd", "cvttsd2si", "ja", "jae", "jb", "jbe",
+	"movd", "movdqa", "movdqu", "movapd", "movupd", "pshufd", "unpcklpd", "unpckhpd",
+	"paddd", "psubd", "pand", "pandn", "por", "pcmpgtd", "addpd", "subpd", "mulpd", "divpd", "minpd", "maxpd",
+	"call", "ret",
+	"syscall", "div", "cvtsd2si", "movmskpd",
 };
 
-std::string AsmMemory::toString()
+const std::string AsmData::directiveName[] = {
+	"db", "dd", "dq", "dd",
+};
+
+std::string AsmParameter::toString()
+{
+	std::string res;
+	{
+		AsmWriter writer(res);
+		emit(writer);
+	}
+	return res;
+}
+
+// labels of GNU as can't start with '$', "$name1@" is written as the local label ".Lname1"
+static void writeLabel(AsmWriter &writer, const std::string &label)
+{
+	if (writer.x64 && !label.empty() && label[0] == '$') {
+		writer.write(".L").write(label.substr(1, label.length() - 2));
+		return;
+	}
+	writer.write(label);
+}
+
+void AsmMemory::emit(AsmWriter &writer)
+{
+	writer.write(dataSizeName[dataSize]).write(writer.x64 ? " ptr [rbp - " : " ptr [ebp - ").write(offset).write(']');
+}
+
+PAsmRegister AsmRegister::virtualRegister(int index, RegisterType registerClass, AsmMemory::DataSize dataSize)
+{
+	auto reg = std::make_shared<AsmRegister>(registerClass);
+	reg->index = index;
+	reg->dataSize = dataSize;
+	return reg;
+}
+
+PAsmRegister AsmRegister::memory(PAsmRegister base, AsmMemory::DataSize dataSize, int offset)
 {
-	return dataSizeName[dataSize] + " ptr [ebp - " + std::to_string(offset) + "]";
+	auto reg = std::make_shared<AsmRegister>(base->registerType, dataSize, offset);
+	reg->index = base->index;
+	return reg;
 }
 
-std::string AsmRegister::toString()
+AsmRegister::RegisterType AsmRegister::wide(RegisterType type)
 {
+	static const std::map<RegisterType, RegisterType> registers = {
+		{ eax, rax }, { ebx, rbx }, { ecx, rcx }, { edx, rdx }, { esp, rsp }, { ebp, rbp }, { esi, rsi }, { edi, rdi },
+		{ r8d, r8 }, { r9d, r9 }, { r10d, r10 }, { r11d, r11 }, { r12d, r12 }, { r13d, r13 }, { r14d, r14 }, { r15d, r15 },
+	};
+	auto it = registers.find(type);
+	return it != registers.end() ? it->second : type;
+}
+
+void AsmRegister::emit(AsmWriter &writer)
+{
+	// on x86-64 the stack pointer, the frame base and the bases of memory operands are 64-bit
+	bool wideName = writer.x64 && (full || registerType == esp || registerType == ebp);
+	std::string name = isVirtual() ? "v" + std::to_string(index) : registerName[wideName ? wide(registerType) : registerType];
 	if (full) {
-		return AsmMemory::dataSizeName[dataSize] + " ptr [" + registerName[registerType]
-			+ " - " + std::to_string(offset) + "]";
+		// arguments are above the frame base
+		writer.write(AsmMemory::dataSizeName[dataSize]).write(" ptr [").write(name)
+			.write(offset < 0 ? " + " : " - ").write(offset < 0 ? -offset : offset).write(']');
+		return;
+	}
+	writer.write(name);
+}
+
+void AsmLabelMemory::emit(AsmWriter &writer)
+{
+	writer.write(AsmMemory::dataSizeName[dataSize]).write(writer.x64 ? " ptr [rip + " : " ptr [");
+	writeLabel(writer, label);
+	if (offset != 0) {
+		writer.write(" + ").write(offset);
 	}
-	return registerName[registerType];
+	writer.write(']');
+}
+
+void AsmData::emit(AsmWriter &writer)
+{
+	static const int valuesPerLine = 16;
+	static const int directiveSize[] = { 1, 4, 8, 4 };
+	static const std::string gasDirectiveName[] = { ".byte", ".long", ".quad", ".long" };
+
+	writer.write(writer.x64 ? ".balign " : "align ").write(alignment).write('\n');
+	writeLabel(writer, label);
+	writer.write(writer.x64 ? ": " : " ");
+	const char *p = bytes.data();
+	bool first = true;
+	for (auto &run : runs) {
+		for (int i = 0; i < run.count; ++i) {
+			if (i % valuesPerLine == 0) {
+				if (!first) {
+					writer.write('\n');
+				}
+				writer.write((writer.x64 ? gasDirectiveName : directiveName)[run.directive]).write(' ');
+				first = false;
+			}
+			else {
+				writer.write(", ");
+			}
+
+			if (run.directive == db) {
+				writer.write((int)(unsigned char)*p);
+			}
+			else if (run.directive == dq) {
+				// exact bit pattern of a double
+				unsigned long long value;
+				char hex[24];
+				memcpy(&value, p, sizeof(value));
+				sprintf(hex, writer.x64 ? "0x%016llX" : "0%016llXh", value);
+				writer.write(hex);
+			}
+			else {
+				int value;
+				memcpy(&value, p, sizeof(value));
+				if (run.directive == pointer) {
+					writer.write(writer.x64 ? "" : "offset ");
+					writeLabel(writer, pointers[value]);
+				}
+				else {
+					writer.write(value);
+				}
+			}
+			p += directiveSize[run.directive];
+		}
+	}
+	if (first && reserved > 0 && writer.x64) {
+		writer.write(".zero ").write(reserved);
+	}
+	else if (first && reserved > 0) {
+		writer.write("db ").write(reserved).write(" dup (0)");
+	}
+	else if (first) {
+		writer.write(writer.x64 ? ".byte 0" : "db 0");
+	}
+	writer.write('\n');
 }
 
 std::string AsmCode::getLabel(std::string name)
@@ -39,10 +178,227 @@ std::string AsmCode::getLabel(std::string name)
 	return "$" + name + std::to_string(labelCnt++) + "@";
 }
 
-void AsmCode::addSymbol(PSymbol symbol)
+void AsmCode::addSymbol(PSymbol symbol, bool isStatic)
+{
+	// simple constants are pushed as immediate values, types and functions need no storage
+	if (symbol->category == Symbol::TYPE || symbol->type->category == Type::FUNCTION ||
+		(symbol->category == Symbol::CONST && Type::simpleCategories.count(symbol->type->category)))
+	{
+		return;
+	}
+	if (symbol->value != nullptr) {
+		addData(symbol);
+		return;
+	}
+	std::string name = lowerString(symbol->token->text);
+	if (isStatic) {
+		AsmData item(getLabel(name), false);
+		item.alignment = std::max(item.alignment, Layout::objectAlignment(symbol->type));
+		item.reserved = symbol->type->size;
+		labels[name] = item.label;
+		data.push_back(item);
+		return;
+	}
+	addLocal(name, symbol->type);
+}
+
+void AsmCode::addLocal(const std::string &name, PType type)
+{
+	int alignment = Layout::objectAlignment(type);
+	if ((long long)size + type->size + alignment > INT_MAX) {
+		throw std::exception("Variables don't fit in the frame");
+	}
+	size = Layout::alignUp(size + type->size, alignment);
+	frameAlignment = std::max(frameAlignment, alignment);
+	offsets[name] = size;
+}
+
+void AsmCode::beginRoutine()
+{
+	Frame frame;
+	frame.routine.commands.swap(commands);
+	frame.routine.size = size;
+	frame.routine.frameAlignment = frameAlignment;
+	frame.routine.argumentCopies.swap(argumentCopies);
+	frame.offsets.swap(offsets);
+	frame.labels = labels;
+	frame.registerCnt = registerCnt;
+	frames.push_back(frame);
+
+	size = 0;
+	frameAlignment = 4;
+	registerCnt = 0;
+}
+
+void AsmCode::endRoutine(const std::string &label)
+{
+	auto &frame = frames.back();
+	AsmRoutine routine;
+	routine.label = label;
+	routine.commands.swap(commands);
+	routine.size = size;
+	routine.frameAlignment = frameAlignment;
+	routine.argumentCopies.swap(argumentCopies);
+	routines.push_back(routine);
+
+	commands.swap(frame.routine.commands);
+	size = frame.routine.size;
+	frameAlignment = frame.routine.frameAlignment;
+	argumentCopies.swap(frame.routine.argumentCopies);
+	offsets.swap(frame.offsets);
+	labels.swap(frame.labels);
+	registerCnt = frame.registerCnt;
+	frames.pop_back();
+}
+
+static void appendRun(std::vector<AsmData::Run> &runs, AsmData::Directive directive, int count)
+{
+	if (!runs.empty() && runs.back().directive == directive) {
+		runs.back().count += count;
+	}
+	else if (count > 0) {
+		runs.push_back({ directive, count });
+	}
+}
+
+static void appendRuns(std::vector<AsmData::Run> &runs, PType type)
+{
+	if (type->category == Type::INTEGER) {
+		appendRun(runs, AsmData::dd, 1);
+	}
+	else if (type->category == Type::DOUBLE) {
+		appendRun(runs, AsmData::dq, 1);
+	}
+	else if (type->category == Type::CHAR) {
+		appendRun(runs, AsmData::db, 1);
+	}
+	else if (type->category == Type::STRING) {
+		appendRun(runs, AsmData::pointer, 1);
+	}
+	else if (type->category == Type::ARRAY) {
+		auto arrayType = std::static_pointer_cast<ArrayType>(type);
+		int count = arrayType->right->value->toInteger() - arrayType->left->value->toInteger() + 1;
+		std::vector<AsmData::Run> element;
+		appendRuns(element, arrayType->elementType);
+
+		if (element.size() == 1) {
+			appendRun(runs, element[0].directive, element[0].count * count);
+			return;
+		}
+		for (int i = 0; i < count; ++i) {
+			for (auto &it : element) {
+				appendRun(runs, it.directive, it.count);
+			}
+		}
+	}
+	else if (type->category == Type::RECORD) {
+		// fields in memory order, padding is emitted as zero bytes
+		auto recordType = std::static_pointer_cast<RecordType>(type);
+		auto &fields = recordType->fields->symbolsArray;
+		std::vector<int> order(fields.size());
+		for (int i = 0; i < order.size(); ++i) {
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [&recordType](int a, int b) {
+			return recordType->offsets[a] < recordType->offsets[b];
+		});
+
+		int offset = 0;
+		for (int i : order) {
+			appendRun(runs, AsmData::db, recordType->offsets[i] - offset);
+			appendRuns(runs, fields[i]->type);
+			offset = recordType->offsets[i] + fields[i]->type->size;
+		}
+		appendRun(runs, AsmData::db, type->size - offset);
+	}
+}
+
+void AsmCode::addData(PSymbol symbol)
+{
+	std::string name = lowerString(symbol->token->text);
+	AsmData item(getLabel(name), symbol->category == Symbol::CONST);
+
+	PConstData value;
+	int offset = 0;
+	if (auto typedConst = std::dynamic_pointer_cast<TypedConstNode>(symbol->value)) {
+		value = typedConst->data;
+		offset = typedConst->offset;
+	}
+	else {
+		value = std::make_shared<ConstData>(symbol->type->size);
+		value->store(symbol->type, 0, std::static_pointer_cast<ConstNode>(symbol->value)->value);
+	}
+
+	item.alignment = std::max(item.alignment, Layout::objectAlignment(symbol->type));
+	item.bytes.assign(value->bytes.begin() + offset, value->bytes.begin() + offset + symbol->type->size);
+	appendRuns(item.runs, symbol->type);
+	for (auto &it : value->strings) {
+		item.pointers.push_back(stringLabel(it));
+	}
+
+	labels[name] = item.label;
+	if (std::dynamic_pointer_cast<TypedConstNode>(symbol->value)) {
+		constantLabels[symbol->value.get()] = item.label;
+	}
+	data.push_back(item);
+}
+
+std::string AsmCode::stringLabel(const std::string &s)
+{
+	auto it = stringLabels.find(s);
+	if (it != stringLabels.end()) {
+		return it->second;
+	}
+
+	AsmData item(getLabel("STR"), true);
+	item.bytes.assign(s.begin(), s.end());
+	item.bytes.push_back(0);
+	item.runs.push_back({ AsmData::db, (int)item.bytes.size() });
+	stringLabels[s] = item.label;
+	data.push_back(item);
+	return item.label;
+}
+
+std::string AsmCode::doubleLabel(double value)
+{
+	unsigned long long bits;
+	memcpy(&bits, &value, sizeof(bits));
+	auto it = doubleLabels.find(bits);
+	if (it != doubleLabels.end()) {
+		return it->second;
+	}
+
+	AsmData item(getLabel("DBL"), true);
+	item.alignment = 8;
+	item.bytes.resize(sizeof(value));
+	memcpy(item.bytes.data(), &value, sizeof(value));
+	item.runs.push_back({ AsmData::dq, 1 });
+	doubleLabels[bits] = item.label;
+	data.push_back(item);
+	return item.label;
+}
+
+std::shared_ptr<AsmParameter> AsmCode::variable(std::string name, AsmMemory::DataSize dataSize)
+{
+	// locals of a routine hide the static variables of the main program
+	auto offset = offsets.find(name);
+	if (offset != offsets.end()) {
+		return std::make_shared<AsmMemory>(dataSize, offset->second);
+	}
+	auto it = labels.find(name);
+	if (it != labels.end()) {
+		return std::make_shared<AsmLabelMemory>(dataSize, it->second);
+	}
+	// static variables of inlined routines are named by their labels
+	if (name[0] == '$') {
+		return std::make_shared<AsmLabelMemory>(dataSize, name);
+	}
+	throw std::exception("Variable is not placed in memory");
+}
+
+PAsmRegister AsmCode::newRegister(AsmRegister::RegisterType registerClass, AsmMemory::DataSize dataSize)
 {
-	size += symbol->type->size;
-	offsets[lowerString(symbol->token->text)] = size;
+	return AsmRegister::virtualRegister(registerCnt++, registerClass, dataSize);
 }
 
 void AsmCode::push_back(AsmCommand && command)
@@ -50,15 +406,232 @@ void AsmCode::push_back(AsmCommand && command)
 	commands.push_back(command);
 }
 
+void AsmCode::emit(AsmWriter &writer)
+{
+	if (target == linux64) {
+		emitLinux64(writer);
+		return;
+	}
+	writer.write("include c:\\masm32\\include\\masm32rt.inc\n.xmm\n.const\n");
+	bool variables = false;
+	for (auto &it : data) {
+		if (it.constant) {
+			it.emit(writer);
+		}
+		variables |= !it.constant;
+	}
+	if (variables) {
+		writer.write(".data\n");
+		for (auto &it : data) {
+			if (!it.constant) {
+				it.emit(writer);
+			}
+		}
+	}
+	writer.write(".code\nstart:\n");
+	if (frameAlignment > 4) {
+		// the entry stack pointer is kept below the locals of the aligned frame
+		writer.write("push ebp\nmov eax, esp\nand esp, ").write(-frameAlignment).write('\n');
+		writer.write("mov ebp, esp\nsub esp, ").write(size + 4).write('\n');
+		writer.write("mov dword ptr [ebp - ").write(size + 4).write("], eax\n");
+	}
+	else {
+		writer.write("push ebp\nmov ebp, esp\nsub esp, ").write(size).write('\n');
+	}
+	for (auto &command : commands) {
+		command.emit(writer);
+		writer.write('\n');
+	}
+	if (frameAlignment > 4) {
+		writer.write("mov esp, dword ptr [ebp - ").write(size + 4).write("]\npop ebp\n");
+	}
+	else {
+		writer.write("mov esp, ebp\npop ebp\n");
+	}
+	writer.write("exit\n");
+	for (auto &routine : routines) {
+		routine.emit(writer);
+	}
+	writer.write("end start\n");
+}
+
+void AsmCode::emitLinux64(AsmWriter &writer)
+{
+	writer.x64 = true;
+	writer.write(".intel_syntax noprefix\n.section .rodata\n");
+	for (auto &it : data) {
+		if (it.constant) {
+			it.emit(writer);
+		}
+	}
+	writer.write(".data\n");
+	for (auto &it : data) {
+		if (!it.constant) {
+			it.emit(writer);
+		}
+	}
+	writer.write(".text\n.globl ").write(Runtime::start).write('\n');
+	mainRoutine().emit(writer);
+	for (auto &routine : routines) {
+		routine.emit(writer);
+	}
+}
+
+// the main program is a routine called by the entry point of the runtime
+AsmRoutine AsmCode::mainRoutine()
+{
+	AsmRoutine res;
+	res.label = Runtime::main;
+	res.commands = commands;
+	res.commands.push_back(AsmCommand(AsmCommand::ret));
+	res.size = size;
+	res.frameAlignment = frameAlignment;
+	return res;
+}
+
+std::vector<AsmRegister::RegisterType> AsmRoutine::savedRegisters(bool x64)
+{
+	static const std::vector<AsmRegister::RegisterType> preserved = { AsmRegister::ebx, AsmRegister::esi, AsmRegister::edi };
+	static const std::vector<AsmRegister::RegisterType> preserved64 = {
+		AsmRegister::ebx, AsmRegister::r12d, AsmRegister::r13d, AsmRegister::r14d, AsmRegister::r15d,
+	};
+	std::vector<AsmRegister::RegisterType> res;
+	for (auto type : x64 ? preserved64 : preserved) {
+		bool used = false;
+		for (auto &command : commands) {
+			for (auto &par : command.parameters) {
+				auto reg = std::dynamic_pointer_cast<AsmRegister>(par);
+				used |= reg != nullptr && (reg->registerType == type || (type == AsmRegister::ebx && reg->registerType == AsmRegister::bl));
+			}
+		}
+		if (used) {
+			res.push_back(type);
+		}
+	}
+	return res;
+}
+
+// a routine needing no frame keeps the frame pointer of its caller, stack arguments are always copied
+// to the frame, an aligned frame keeps the frame pointer of the caller below its locals
+void AsmRoutine::emit(AsmWriter &writer)
+{
+	if (writer.x64) {
+		emit64(writer);
+		return;
+	}
+	auto saved = savedRegisters(false);
+	writeLabel(writer, label);
+	writer.write(":\n");
+	if (size > 0 || frameAlignment > 4 || !argumentCopies.empty()) {
+		writer.write("push ebp\nmov ebp, esp\n");
+		if (frameAlignment > 4) {
+			writer.write("and esp, ").write(-frameAlignment).write("\nsub esp, ").write(size + 4).write('\n');
+		}
+		else if (size > 0) {
+			writer.write("sub esp, ").write(size).write('\n');
+		}
+		for (auto &it : argumentCopies) {
+			writer.write("push dword ptr [ebp + ").write(8 + it.first).write("]\n");
+			if (frameAlignment > 4) {
+				// pop computes an address relative to esp after popping
+				writer.write("pop dword ptr [esp + ").write(size + 4 - it.second).write("]\n");
+			}
+			else {
+				writer.write("pop dword ptr [ebp - ").write(it.second).write("]\n");
+			}
+		}
+		if (frameAlignment > 4) {
+			writer.write("mov dword ptr [esp], ebp\nlea ebp, [esp + ").write(size + 4).write("]\n");
+		}
+	}
+	for (auto type : saved) {
+		writer.write("push ").write(AsmRegister::registerName[type]).write('\n');
+	}
+	for (auto &command : commands) {
+		if (command.commandType == AsmCommand::ret) {
+			emitEpilogue(writer, saved);
+		}
+		command.emit(writer);
+		writer.write('\n');
+	}
+}
+
+void AsmRoutine::emitEpilogue(AsmWriter &writer, const std::vector<AsmRegister::RegisterType> &saved)
+{
+	for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+		writer.write("pop ").write(AsmRegister::registerName[*it]).write('\n');
+	}
+	if (frameAlignment > 4) {
+		writer.write("mov esp, dword ptr [ebp - ").write(size + 4).write("]\npop ebp\n");
+	}
+	else if (size > 0 || !argumentCopies.empty()) {
+		writer.write("mov esp, ebp\npop ebp\n");
+	}
+}
+
+void AsmRoutine::emit64(AsmWriter &writer)
+{
+	writeLabel(writer, label);
+	writer.write(":\n");
+	for (auto &command : frameCommands64()) {
+		command.emit(writer);
+		writer.write('\n');
+	}
+}
+
+// a routine without locals, arguments on the stack and calls keeps the frame base of its caller,
+// the locals are padded so that the stack is aligned again below the saved registers
+std::vector<AsmCommand> AsmRoutine::frameCommands64()
+{
+	if (naked) {
+		return commands;
+	}
+	auto saved = savedRegisters(true);
+	bool frame = size > 0;
+	for (auto &command : commands) {
+		frame |= command.commandType == AsmCommand::call;
+		for (auto &par : command.parameters) {
+			auto reg = std::dynamic_pointer_cast<AsmRegister>(par);
+			frame |= reg != nullptr && reg->registerType == AsmRegister::ebp;
+		}
+	}
+
+	std::vector<AsmCommand> res;
+	if (frame) {
+		int savedSize = 8 * (int)saved.size();
+		int localSize = Layout::alignUp(size + savedSize, 16) - savedSize;
+		res.push_back({ AsmCommand::push, AsmRegister::rbp });
+		res.push_back({ AsmCommand::mov, AsmRegister::rbp, AsmRegister::rsp });
+		if (localSize > 0) {
+			res.push_back({ AsmCommand::sub, AsmRegister::rsp, std::to_string(localSize) });
+		}
+	}
+	for (auto type : saved) {
+		res.push_back({ AsmCommand::push, AsmRegister::wide(type) });
+	}
+	for (auto &command : commands) {
+		if (command.commandType == AsmCommand::ret) {
+			for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+				res.push_back({ AsmCommand::pop, AsmRegister::wide(*it) });
+			}
+			if (frame) {
+				res.push_back({ AsmCommand::mov, AsmRegister::rsp, AsmRegister::rbp });
+				res.push_back({ AsmCommand::pop, AsmRegister::rbp });
+			}
+		}
+		res.push_back(command);
+	}
+	return res;
+}
+
 std::string AsmCode::toString()
 {
-	std::string result = "include c:\\masm32\\include\\masm32rt.inc\n.xmm\n.const\n";
-	result += ".code\nstart:\n";
-	result += "push ebp\nmov ebp, esp\nsub esp, " + std::to_string(size) + "\n";
-	for (auto &command : commands)
-		result += command.toString() + '\n';
-	result += "mov esp, ebp\npop ebp\n";
-	return result + "exit\nend start\n";
+	std::string res;
+	{
+		AsmWriter writer(res);
+		emit(writer);
+	}
+	return res;
 }
 
 AsmCommand::AsmCommand(CommandType commandType, AsmRegister::RegisterType reg1)
@@ -91,6 +664,36 @@ AsmCommand::AsmCommand(CommandType commandType, AsmMemory::DataSize dataSize, in
 	push_back(std::make_shared<AsmMemory>(dataSize, offset));
 }
 
+AsmCommand::AsmCommand(CommandType commandType, std::shared_ptr<AsmParameter> par)
+	: commandType(commandType)
+{
+	push_back(par);
+}
+
+AsmCommand::AsmCommand(CommandType commandType, std::shared_ptr<AsmParameter> par, AsmRegister::RegisterType reg)
+	: commandType(commandType)
+{
+	push_back(par, std::make_shared<AsmRegister>(reg));
+}
+
+AsmCommand::AsmCommand(CommandType commandType, AsmRegister::RegisterType reg, std::shared_ptr<AsmParameter> par)
+	: commandType(commandType)
+{
+	push_back(std::make_shared<AsmRegister>(reg), par);
+}
+
+AsmCommand::AsmCommand(CommandType commandType, std::shared_ptr<AsmParameter> par, std::string value)
+	: commandType(commandType)
+{
+	push_back(par, std::make_shared<AsmValue>(value));
+}
+
+AsmCommand::AsmCommand(CommandType commandType, std::shared_ptr<AsmParameter> par1, std::shared_ptr<AsmParameter> par2)
+	: commandType(commandType)
+{
+	push_back(par1, par2);
+}
+
 AsmCommand::AsmCommand(CommandType commandType, AsmMemory::DataSize dataSize, int offset, AsmRegister::RegisterType reg)
 	: commandType(commandType)
 {
@@ -136,19 +739,55 @@ void AsmCommand::push_back(std::shared_ptr<AsmParameter> par1, std::shared_ptr<A
 	push_back(par2);
 }
 
-std::string AsmCommand::toString()
+void AsmCommand::emit(AsmWriter &writer)
 {
 	if (commandType == label) {
-		return parameters[0]->toString() + ":";
+		parameters[0]->emit(writer);
+		writer.write(':');
+		return;
 	}
-	std::string res = commandName[commandType] + (commandType == CommandType::printf ? "(" : " ");
+	if (commandType == call || commandType == ret) {
+		writer.write(commandName[commandType]);
+		if (commandType == call) {
+			writer.write(' ');
+			parameters[0]->emit(writer);
+		}
+		return;
+	}
+	writer.write(commandName[commandType]).write(commandType == CommandType::printf ? '(' : ' ');
 	for (auto i = 0; i < parameters.size(); ++i) {
-		res += parameters[i]->toString() + (i + 1 != parameters.size() ? ", " : "");
+		parameters[i]->emit(writer);
+		if (i + 1 != parameters.size()) {
+			writer.write(", ");
+		}
+	}
+	if (commandType == CommandType::printf) {
+		writer.write(')');
+	}
+}
+
+AsmCommand::CommandType AsmCommand::commandByName(const std::string &name)
+{
+	int count = sizeof(commandName) / sizeof(commandName[0]);
+	for (int i = 0; i < count; ++i) {
+		if (commandName[i] == name) {
+			return (CommandType)i;
+		}
+	}
+	throw std::exception("Unknown assembler command");
+}
+
+std::string AsmCommand::toString()
+{
+	std::string res;
+	{
+		AsmWriter writer(res);
+		emit(writer);
 	}
-	return (commandType == CommandType::printf ? res + ")" : res);
+	return res;
 }
 
-std::string AsmValue::toString()
+void AsmValue::emit(AsmWriter &writer)
 {
-	return value;
+	writeLabel(writer, value);
 }
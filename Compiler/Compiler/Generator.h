@@ -4,15 +4,18 @@
 #include <vector>
 #include <map>
 
+#include "AsmWriter.h"
+
 class AsmParameter {
 public:
-	virtual std::string toString() = 0;
+	virtual void emit(AsmWriter &writer) = 0;
+	std::string toString();
 };
 
 class AsmMemory : public AsmParameter {
 public:
 	enum DataSize {
-		byte, word, dword, qword,
+		byte, word, dword, qword, xmmword,
 	};
 
 	DataSize dataSize;
@@ -22,20 +25,30 @@ public:
 		dataSize(dataSize), offset(offset)
 	{}
 
-	std::string toString() override;
+	void emit(AsmWriter &writer) override;
 	static const std::string dataSizeName[];
 };
 
+class AsmRegister;
+typedef std::shared_ptr<AsmRegister> PAsmRegister;
+
 class AsmRegister : public AsmParameter {
 public:
 	enum RegisterType {
-		eax, ebx, ecx, edx, xmm0, xmm1, esp, ebp, al, cl, ah, bl, ax,
+		eax, ebx, ecx, edx, xmm0, xmm1, esp, ebp, al, cl, ah, bl, ax, esi, edi,
+		xmm2, xmm3, xmm4, xmm5, xmm6, xmm7,
+		// registers added by x86-64, the generated code keeps 32-bit values in them
+		r8d, r9d, r10d, r11d, r12d, r13d, r14d, r15d,
+		xmm8, xmm9, xmm10, xmm11, xmm12, xmm13, xmm14, xmm15,
+		rax, rbx, rcx, rdx, rsp, rbp, rsi, rdi, r8, r9, r10, r11, r12, r13, r14, r15, dl,
 	};
 
 	RegisterType registerType;
 	AsmMemory::DataSize dataSize;
 	int offset;
 	bool full;
+	// number of a virtual register, -1 for physical ones
+	int index = -1;
 
 	AsmRegister(RegisterType registerType)
 		: registerType(registerType), full(false)
@@ -44,10 +57,35 @@ public:
 		: registerType(registerType), dataSize(dataSize), offset(offset), full(true)
 	{}
 
-	std::string toString() override;
+	bool isVirtual() { return index >= 0; }
+	bool isXmm() { return registerType == xmm0 || registerType == xmm1 || (registerType >= xmm2 && registerType <= xmm7) ||
+		(registerType >= xmm8 && registerType <= xmm15); }
+
+	// the type of a virtual register is eax or xmm0 and tells which physical registers it can take,
+	// the data size of an xmm one tells whether it holds a double or a vector
+	static PAsmRegister virtualRegister(int index, RegisterType registerClass = eax, AsmMemory::DataSize dataSize = AsmMemory::dword);
+	// memory at the address held by a register
+	static PAsmRegister memory(PAsmRegister base, AsmMemory::DataSize dataSize, int offset = 0);
+	// the 64-bit register a 32-bit one is part of, addresses are held zero-extended in it
+	static RegisterType wide(RegisterType type);
+
+	void emit(AsmWriter &writer) override;
 	static const std::string registerName[];
 };
 
+class AsmLabelMemory : public AsmParameter {
+public:
+	AsmMemory::DataSize dataSize;
+	std::string label;
+	int offset;
+
+	AsmLabelMemory(AsmMemory::DataSize dataSize, std::string label, int offset = 0)
+		: dataSize(dataSize), label(label), offset(offset)
+	{}
+
+	void emit(AsmWriter &writer) override;
+};
+
 class AsmValue : public AsmParameter {
 public:
 	std::string value;
@@ -55,7 +93,7 @@ public:
 		: value(value)
 	{}
 
-	std::string toString() override;
+	void emit(AsmWriter &writer) override;
 };
 
 class AsmCommand {
@@ -63,12 +101,19 @@ public:
 	enum CommandType {
 		mov, push, pop, add, sub, imul, idiv, cdq, printf, movsd, and, or , xor, mulsd, addsd, divsd, subsd,
 		setge, setg, setle, setl, sete, setne, cmp, jmp, label,
-		comisd, ucomisd, setbe, setb, seta, setae, jp, jnp, lahf, test,
+		comisd, ucomisd, setbe, setb, seta, setae, setp, setnp, jp, jnp, lahf, test,
 		loop, jnz, jz, inc, dec, jge, jle,
-		movsx,
+		movsx, movzx, lea, neg, not, jl, jg,
+		cvtsi2sd, cvttsd2si, ja, jae, jb, jbe,
+		movd, movdqa, movdqu, movapd, movupd, pshufd, unpcklpd, unpckhpd,
+		paddd, psubd, pand, pandn, por, pcmpgtd, addpd, subpd, mulpd, divpd, minpd, maxpd,
+		call, ret,
+		syscall, div, cvtsd2si, movmskpd,
 	};
 
 	CommandType commandType;
+	// a call is followed by the registers holding its arguments and ret by the one holding the result,
+	// they are read by the command but not printed
 	std::vector<std::shared_ptr<AsmParameter>> parameters;
 
 	AsmCommand(CommandType commandType);
@@ -77,6 +122,11 @@ public:
 	AsmCommand(CommandType commandType, AsmRegister::RegisterType reg, std::string value);
 	AsmCommand(CommandType commandType, std::string value);
 	AsmCommand(CommandType commandType, AsmMemory::DataSize dataSize, int offset);
+	AsmCommand(CommandType commandType, std::shared_ptr<AsmParameter> par);
+	AsmCommand(CommandType commandType, std::shared_ptr<AsmParameter> par, AsmRegister::RegisterType reg);
+	AsmCommand(CommandType commandType, AsmRegister::RegisterType reg, std::shared_ptr<AsmParameter> par);
+	AsmCommand(CommandType commandType, std::shared_ptr<AsmParameter> par, std::string value);
+	AsmCommand(CommandType commandType, std::shared_ptr<AsmParameter> par1, std::shared_ptr<AsmParameter> par2);
 
 	AsmCommand(CommandType commandType, AsmMemory::DataSize dataSize, int offset, AsmRegister::RegisterType reg);
 	AsmCommand(CommandType commandType, AsmMemory::DataSize dataSize, AsmRegister::RegisterType reg1, AsmRegister::RegisterType reg2);
@@ -93,26 +143,139 @@ public:
 	void push_back(std::shared_ptr<AsmParameter> par1, std::shared_ptr<AsmParameter> par2);
 	void push_back(std::shared_ptr<AsmParameter> par);
 
+	void emit(AsmWriter &writer);
 	std::string toString();
 	static const std::string commandName[];
+	static CommandType commandByName(const std::string &name);
+};
+
+// Initialized object placed in .data or .const, bytes are already laid out
+// as in memory and runs tell which directive emits each part of them.
+class AsmData {
+public:
+	enum Directive {
+		db, dd, dq, pointer,
+	};
+
+	struct Run {
+		Directive directive;
+		int count;
+	};
+
+	std::string label;
+	bool constant;
+	int alignment = 4;
+	std::vector<char> bytes;
+	std::vector<Run> runs;
+	// labels of pointer runs, the bytes of a pointer hold an index into this vector
+	std::vector<std::string> pointers;
+	// zero bytes emitted when there are no runs
+	int reserved = 0;
+
+	AsmData(std::string label, bool constant)
+		: label(label), constant(constant)
+	{}
+
+	void emit(AsmWriter &writer);
+	static const std::string directiveName[];
 };
 
 class Symbol;
 typedef std::shared_ptr<Symbol> PSymbol;
+class Type;
+typedef std::shared_ptr<Type> PType;
+
+// Commands and frame of a routine, rets are expanded to its epilogue when it is emitted
+class AsmRoutine {
+public:
+	std::string label;
+	std::vector<AsmCommand> commands;
+	int size = 0;
+	int frameAlignment = 4;
+	// dwords of the arguments passed on the stack copied to frame slots by the prologue,
+	// the offset of each above the return address and its slot
+	std::vector<std::pair<int, int>> argumentCopies;
+	// routines of the runtime are emitted as they are written, without a frame
+	bool naked = false;
+
+	void emit(AsmWriter &writer);
+	// the commands with the prologue and the epilogues of x86-64, the frame keeps the stack aligned
+	// to 16 bytes at calls, so it is never realigned
+	std::vector<AsmCommand> frameCommands64();
+
+private:
+	// ebx, esi and edi are preserved for the caller, on x86-64 rbx and r12-r15
+	std::vector<AsmRegister::RegisterType> savedRegisters(bool x64);
+	void emitEpilogue(AsmWriter &writer, const std::vector<AsmRegister::RegisterType> &saved);
+	void emit64(AsmWriter &writer);
+};
 
 class AsmCode {
 public:
+	// Windows with MASM32 and its printf, or Linux on x86-64 with GNU as, the System V calling convention
+	// and the runtime linked into the code
+	enum Target {
+		win32, linux64,
+	};
+
 	AsmCode() {}
 
+	Target target = win32;
 	int size = 0;
+	// alignment of the frame base, the prologue realigns the stack if it exceeds 4
+	int frameAlignment = 4;
 	std::vector<AsmCommand> commands;
 	std::map<std::string, int> offsets;
+	std::vector<AsmData> data;
+	std::map<std::string, std::string> labels;
+	// data labels of typed constant nodes
+	std::map<const void *, std::string> constantLabels;
+	int registerCnt = 0;
+	std::vector<std::pair<int, int>> argumentCopies;
+	// labels of the routines by their function types, each is compiled separately and emitted after the main program
+	std::map<const void *, std::string> routineLabels;
+	std::vector<AsmRoutine> routines;
+	// how many times each peephole rule fired
+	std::map<std::string, int> peepholeCounts;
+	// for loops over arrays are vectorized, whether each was and why not goes to the report
+	bool vectorize = false;
+	std::vector<std::string> vectorizerReport;
+	// calls the inliner has replaced or kept
+	std::vector<std::string> inlinerReport;
 
 	std::string getLabel(std::string name);
-	void addSymbol(PSymbol symbol);
+	// static variables are placed in .data, the others in the frame
+	void addSymbol(PSymbol symbol, bool isStatic = false);
+	// frame slot of a variable of the type
+	void addLocal(const std::string &name, PType type);
+	// the frame and the commands of the main program are put aside while a routine is compiled,
+	// data and the labels of static variables are shared
+	void beginRoutine();
+	void endRoutine(const std::string &label);
+	// label of a constant double in .const, equal values share one
+	std::string doubleLabel(double value);
+	std::shared_ptr<AsmParameter> variable(std::string name, AsmMemory::DataSize dataSize = AsmMemory::dword);
+	PAsmRegister newRegister(AsmRegister::RegisterType registerClass = AsmRegister::eax, AsmMemory::DataSize dataSize = AsmMemory::dword);
 	void push_back(AsmCommand&& command);
+	void emit(AsmWriter &writer);
 	std::string toString();
+	// the main program as a routine of the Linux x86-64 target
+	AsmRoutine mainRoutine();
 
 private:
+	struct Frame {
+		AsmRoutine routine;
+		std::map<std::string, int> offsets;
+		std::map<std::string, std::string> labels;
+		int registerCnt;
+	};
+
 	int labelCnt = 0;
+	std::vector<Frame> frames;
+	std::map<std::string, std::string> stringLabels;
+	std::map<unsigned long long, std::string> doubleLabels;
+
+	void emitLinux64(AsmWriter &writer);
+	void addData(PSymbol symbol);
+	std::string stringLabel(const std::string &s);
 };
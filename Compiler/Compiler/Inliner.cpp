@@ -0,0 +1,207 @@
+#include <algorithm>
+#include "Inliner.h"
+#include "Cfg.h"
+#include "Types.h"
+
+const int Inliner::alwaysSize;
+const int Inliner::sizeLimit;
+const int Inliner::loopSizeLimit;
+const int Inliner::minGrowth;
+
+Inliner::Inliner(IrFunction &function, AsmCode &code, const std::string &label, std::map<std::string, Routine> &routines)
+	: function(function), code(code), label(label), routines(routines)
+{
+}
+
+Inliner::Routine Inliner::capture(const IrFunction &function, AsmCode &code, const std::string &label, const std::map<std::string, PType> &types)
+{
+	Routine res;
+	res.function = function;
+	res.size = size(function);
+	for (auto &block : res.function.blocks) {
+		for (auto &instruction : block.instructions) {
+			res.recursive |= instruction.opcode == IrInstruction::CALL && instruction.a.name == label;
+			std::vector<IrOperand *> operands = { &instruction.a, &instruction.b };
+			for (auto &argument : instruction.arguments) {
+				operands.push_back(&argument);
+			}
+			for (auto operand : operands) {
+				// static variables of routines inlined into this one are named by their labels already
+				if (operand->kind != IrOperand::VARIABLE || operand->name[0] == '$') {
+					continue;
+				}
+				if (!code.offsets.count(operand->name)) {
+					operand->name = code.labels.at(operand->name);
+					continue;
+				}
+				res.locals[operand->name] = types.at(operand->name);
+			}
+		}
+	}
+	return res;
+}
+
+int Inliner::size(const IrFunction &function)
+{
+	int res = 0;
+	for (auto &block : function.blocks) {
+		for (auto &instruction : block.instructions) {
+			auto opcode = instruction.opcode;
+			res += opcode != IrInstruction::PARAM && opcode != IrInstruction::RETURN && opcode != IrInstruction::JUMP;
+		}
+	}
+	return res;
+}
+
+void Inliner::run()
+{
+	int growth = 0, growthLimit = std::max(size(function), minGrowth);
+	std::vector<bool> inLoop(function.blocks.size());
+	for (auto &loop : Cfg(function).loops) {
+		for (int block : loop.blocks) {
+			inLoop[block] = true;
+		}
+	}
+
+	for (int block = 0; block < function.blocks.size(); ++block) {
+		auto &instructions = function.blocks[block].instructions;
+		for (int i = 0; i < instructions.size(); ++i) {
+			if (instructions[i].opcode != IrInstruction::CALL || !decide(instructions[i], inLoop[block], growth, growthLimit)) {
+				continue;
+			}
+			auto &routine = routines.at(instructions[i].a.name);
+			inlineCall(block, i, routine);
+			// the copy and the rest of the block are in the loops of the call
+			inLoop.insert(inLoop.begin() + block + 1, routine.function.blocks.size() + 1, inLoop[block]);
+			// the scan goes on in the block holding the rest of this one, calls in the copy were decided for the routine
+			block += (int)routine.function.blocks.size();
+			break;
+		}
+	}
+}
+
+bool Inliner::decide(const IrInstruction &call, bool inLoop, int &growth, int growthLimit)
+{
+	auto it = routines.find(call.a.name);
+	if (call.a.name == label) {
+		report(call, "not inlined, recursive");
+		return false;
+	}
+	if (it == routines.end()) {
+		report(call, "not inlined, the routine encloses the caller");
+		return false;
+	}
+
+	auto &routine = it->second;
+	std::string size = std::to_string(routine.size);
+	if (routine.recursive) {
+		report(call, "not inlined, recursive");
+		return false;
+	}
+	// the call, the return, the result and the arguments are saved
+	int cost = std::max(routine.size - (int)call.arguments.size() - 3, 0);
+	if (routine.size > alwaysSize) {
+		int limit = inLoop ? loopSizeLimit : sizeLimit;
+		if (routine.size > limit) {
+			report(call, "not inlined, size " + size + " exceeds " + std::to_string(limit));
+			return false;
+		}
+		if (growth + cost > growthLimit) {
+			report(call, "not inlined, the caller would grow by more than " + std::to_string(growthLimit));
+			return false;
+		}
+	}
+	growth += cost;
+	report(call, "inlined, size " + size);
+	return true;
+}
+
+void Inliner::inlineCall(int block, int index, const Routine &routine)
+{
+	auto call = function.blocks[block].instructions[index];
+	int count = (int)routine.function.blocks.size();
+	int tail = block + count + 1;
+	for (int k = 0; k < count; ++k) {
+		function.insertBlock(block + k + 1, k == 0 ? "INLINE" : routine.function.blocks[k].name);
+	}
+	function.insertBlock(tail, "INLINE_END");
+
+	// the instructions after the call continue in a new block the return jumps to
+	auto &head = function.blocks[block].instructions;
+	function.blocks[tail].instructions.assign(head.begin() + index + 1, head.end());
+	head.erase(head.begin() + index, head.end());
+	IrInstruction jump(IrInstruction::JUMP);
+	jump.targets = { block + 1 };
+	head.push_back(jump);
+
+	// registers of the routine follow those of the caller, each copy has its own frame variables
+	int base = function.registerCnt;
+	function.registerCnt += routine.function.registerCnt;
+	std::map<std::string, std::string> names;
+	for (auto &it : routine.locals) {
+		names[it.first] = it.first + "$" + std::to_string(instances);
+		code.addLocal(names[it.first], it.second);
+		locals[names[it.first]] = it.second;
+	}
+	for (auto &it : routine.function.variables) {
+		function.variables[it.first + "$" + std::to_string(instances)] = it.second + base;
+	}
+	++instances;
+
+	for (int k = 0; k < count; ++k) {
+		auto &instructions = function.blocks[block + k + 1].instructions;
+		for (auto instruction : routine.function.blocks[k].instructions) {
+			std::vector<IrOperand *> operands = { &instruction.dst, &instruction.a, &instruction.b };
+			for (auto &argument : instruction.arguments) {
+				operands.push_back(&argument);
+			}
+			for (auto operand : operands) {
+				if (operand->isRegister()) {
+					operand->value += base;
+				}
+				else if (operand->kind == IrOperand::VARIABLE && names.count(operand->name)) {
+					operand->name = names.at(operand->name);
+				}
+			}
+			for (int &target : instruction.targets) {
+				target += block + 1;
+			}
+
+			if (instruction.opcode == IrInstruction::PARAM) {
+				IrInstruction mov(IrInstruction::MOV, instruction.type);
+				mov.dst = instruction.dst;
+				mov.a = call.arguments[instruction.a.value];
+				instructions.push_back(mov);
+				continue;
+			}
+			if (instruction.opcode == IrInstruction::RETURN) {
+				if (call.dst.isRegister() && instruction.a.kind != IrOperand::NONE) {
+					IrInstruction mov(IrInstruction::MOV, instruction.type);
+					mov.dst = call.dst;
+					mov.a = instruction.a;
+					instructions.push_back(mov);
+				}
+				instructions.push_back(jump);
+				instructions.back().targets = { tail };
+				continue;
+			}
+			instructions.push_back(instruction);
+		}
+		// only the last block of a routine may fall off its end
+		if (instructions.empty() || !instructions.back().isTerminator()) {
+			instructions.push_back(jump);
+			instructions.back().targets = { tail };
+		}
+	}
+}
+
+void Inliner::report(const IrInstruction &call, const std::string &text)
+{
+	std::string name = call.a.name;
+	for (auto &it : code.routineLabels) {
+		if (it.second == call.a.name) {
+			name = static_cast<const FunctionType *>(it.first)->name;
+		}
+	}
+	code.inlinerReport.push_back("line " + std::to_string(call.line) + ": " + name + " in " + function.name + " " + text);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+
+#include "Ir.h"
+#include "Generator.h"
+
+// Replaces calls of small routines by copies of their IR. Arguments become copies to the registers of
+// the parameters, so value, var and const parameters keep their meaning, and the frame variables of
+// the routine get slots in the frame of the caller. A routine is inlined if its size doesn't exceed
+// a limit, which is higher for calls in loops, and the code of the caller doesn't grow too much.
+// Recursive routines are never inlined, the copied code isn't inlined again.
+class Inliner {
+public:
+	// IR of a compiled routine that may be copied into its callers
+	struct Routine {
+		IrFunction function;
+		// variables of the routine in its frame
+		std::map<std::string, PType> locals;
+		// instructions left once parameters, calls and the return are replaced
+		int size = 0;
+		bool recursive = false;
+	};
+
+	// the label is the one of the routine being compiled, routines holds those compiled before it
+	Inliner(IrFunction &function, AsmCode &code, const std::string &label, std::map<std::string, Routine> &routines);
+	void run();
+
+	// the static variables the routine uses are renamed to their labels, so they aren't hidden by the caller,
+	// types are those of the variables in the frame of the routine
+	static Routine capture(const IrFunction &function, AsmCode &code, const std::string &label, const std::map<std::string, PType> &types);
+
+	// frame variables given to the copies
+	std::map<std::string, PType> locals;
+
+	// routines of this size or smaller are cheaper to inline than to call
+	static const int alwaysSize = 8;
+	static const int sizeLimit = 16;
+	static const int loopSizeLimit = 48;
+	// the caller may grow by its own size, but at least by this many instructions
+	static const int minGrowth = 32;
+
+private:
+	IrFunction &function;
+	AsmCode &code;
+	std::string label;
+	std::map<std::string, Routine> &routines;
+	int instances = 0;
+
+	static int size(const IrFunction &function);
+	// whether the call is inlined, the reason goes to the report
+	bool decide(const IrInstruction &call, bool inLoop, int &growth, int growthLimit);
+	void inlineCall(int block, int index, const Routine &routine);
+	void report(const IrInstruction &call, const std::string &text);
+};
@@ -0,0 +1,669 @@
+#include <algorithm>
+#include <set>
+#include "InstructionSelector.h"
+#include "Cfg.h"
+#include "Layout.h"
+#include "Runtime.h"
+
+static const std::map<IrInstruction::Opcode, AsmCommand::CommandType> binaryCommands = {
+	{ IrInstruction::ADD, AsmCommand::add },
+	{ IrInstruction::SUB, AsmCommand::sub },
+	{ IrInstruction::MUL, AsmCommand::imul },
+	{ IrInstruction::AND, AsmCommand::and },
+	{ IrInstruction::OR, AsmCommand::or },
+	{ IrInstruction::XOR, AsmCommand::xor },
+};
+
+static const std::map<IrInstruction::Opcode, AsmCommand::CommandType> doubleCommands = {
+	{ IrInstruction::ADD, AsmCommand::addsd },
+	{ IrInstruction::SUB, AsmCommand::subsd },
+	{ IrInstruction::MUL, AsmCommand::mulsd },
+	{ IrInstruction::DIV, AsmCommand::divsd },
+};
+
+// SSE2 has no packed multiplication, division, minimum or maximum of dwords
+static const std::map<IrInstruction::Opcode, AsmCommand::CommandType> vectorCommands = {
+	{ IrInstruction::ADD, AsmCommand::paddd },
+	{ IrInstruction::SUB, AsmCommand::psubd },
+};
+
+static const std::map<IrInstruction::Opcode, AsmCommand::CommandType> doubleVectorCommands = {
+	{ IrInstruction::ADD, AsmCommand::addpd },
+	{ IrInstruction::SUB, AsmCommand::subpd },
+	{ IrInstruction::MUL, AsmCommand::mulpd },
+	{ IrInstruction::DIV, AsmCommand::divpd },
+	{ IrInstruction::MIN, AsmCommand::minpd },
+	{ IrInstruction::MAX, AsmCommand::maxpd },
+	{ IrInstruction::HADD, AsmCommand::addpd },
+	{ IrInstruction::HMIN, AsmCommand::minpd },
+	{ IrInstruction::HMAX, AsmCommand::maxpd },
+};
+
+// copies between registers of each type
+static AsmCommand::CommandType moveCommand(IrInstruction::Type type)
+{
+	switch (type) {
+	case IrInstruction::F64:
+		return AsmCommand::movsd;
+	case IrInstruction::V4I32:
+		return AsmCommand::movdqa;
+	case IrInstruction::V2F64:
+		return AsmCommand::movapd;
+	default:
+		return AsmCommand::mov;
+	}
+}
+
+// jumps taken when the condition holds
+static const AsmCommand::CommandType jumpCommands[] = {
+	AsmCommand::jz, AsmCommand::jnz, AsmCommand::jl, AsmCommand::jle, AsmCommand::jg, AsmCommand::jge,
+};
+
+// setcc of the inverted condition, sub 1 turns its 1/0 into the 0/-1 of a boolean
+static const AsmCommand::CommandType invertedSetCommands[] = {
+	AsmCommand::setne, AsmCommand::sete, AsmCommand::setge, AsmCommand::setg, AsmCommand::setle, AsmCommand::setl,
+};
+
+// ucomisd sets the flags like an unsigned comparison and all of ZF, PF and CF for unordered operands,
+// so that a comparison with NaN doesn't hold, except for <>. Only above and above or equal are false
+// for unordered operands, less compares the operands swapped, equality also tests PF.
+static const AsmCommand::CommandType doubleJumpCommands[] = {
+	AsmCommand::jz, AsmCommand::jnz, AsmCommand::ja, AsmCommand::jae, AsmCommand::ja, AsmCommand::jae,
+};
+
+static const AsmCommand::CommandType doubleNotJumpCommands[] = {
+	AsmCommand::jnz, AsmCommand::jz, AsmCommand::jbe, AsmCommand::jb, AsmCommand::jbe, AsmCommand::jb,
+};
+
+static const AsmCommand::CommandType doubleInvertedSetCommands[] = {
+	AsmCommand::setne, AsmCommand::sete, AsmCommand::setbe, AsmCommand::setb, AsmCommand::setbe, AsmCommand::setb,
+};
+
+// the first three integers are passed in eax, edx and ecx and the first three doubles in xmm0-xmm2,
+// the others are pushed from the last one, so each is found at its offset above the return address.
+// The System V convention of x86-64 passes six integers in edi, esi, edx, ecx, r8d and r9d and eight doubles
+// in xmm0-xmm7, each of the others takes 8 bytes.
+static std::vector<std::pair<AsmRegister::RegisterType, int>> argumentLocations(const std::vector<IrInstruction::Type> &types, int &stackSize,
+	bool x64)
+{
+	static const std::vector<AsmRegister::RegisterType> integerRegisters = { AsmRegister::eax, AsmRegister::edx, AsmRegister::ecx };
+	static const std::vector<AsmRegister::RegisterType> doubleRegisters = { AsmRegister::xmm0, AsmRegister::xmm1, AsmRegister::xmm2 };
+	static const std::vector<AsmRegister::RegisterType> integerRegisters64 = {
+		AsmRegister::edi, AsmRegister::esi, AsmRegister::edx, AsmRegister::ecx, AsmRegister::r8d, AsmRegister::r9d,
+	};
+	static const std::vector<AsmRegister::RegisterType> doubleRegisters64 = {
+		AsmRegister::xmm0, AsmRegister::xmm1, AsmRegister::xmm2, AsmRegister::xmm3,
+		AsmRegister::xmm4, AsmRegister::xmm5, AsmRegister::xmm6, AsmRegister::xmm7,
+	};
+
+	std::vector<std::pair<AsmRegister::RegisterType, int>> res;
+	int integers = 0, doubles = 0;
+	stackSize = 0;
+	for (auto type : types) {
+		bool isDouble = type == IrInstruction::F64;
+		auto &registers = isDouble ? (x64 ? doubleRegisters64 : doubleRegisters) : (x64 ? integerRegisters64 : integerRegisters);
+		int &count = isDouble ? doubles : integers;
+		if (count < registers.size()) {
+			res.push_back({ registers[count++], 0 });
+			continue;
+		}
+		res.push_back({ AsmRegister::esp, stackSize });
+		stackSize += isDouble || x64 ? 8 : 4;
+	}
+	return res;
+}
+
+InstructionSelector::InstructionSelector(AsmCode &code)
+	: code(code)
+{
+}
+
+void InstructionSelector::run(IrFunction &function)
+{
+	code.registerCnt = std::max(code.registerCnt, function.registerCnt);
+	int stackSize;
+	parameterLocations = argumentLocations(function.parameterTypes, stackSize, code.target == AsmCode::linux64);
+	Cfg cfg(function);
+
+	std::vector<int> layout;
+	for (auto &block : function.blocks) {
+		if (cfg.reachable(block.id)) {
+			layout.push_back(block.id);
+		}
+	}
+	labels.assign(function.blocks.size(), "");
+	for (int block : layout) {
+		if (!cfg.predecessors[block].empty()) {
+			labels[block] = code.getLabel(function.blocks[block].name);
+		}
+	}
+
+	for (int i = 0; i < layout.size(); ++i) {
+		auto &block = function.blocks[layout[i]];
+		if (!labels[block.id].empty()) {
+			code.push_back({ AsmCommand::label, labels[block.id] });
+		}
+		int next = i + 1 < layout.size() ? layout[i + 1] : -1;
+		for (auto &instruction : block.instructions) {
+			select(instruction, next);
+		}
+	}
+}
+
+std::shared_ptr<AsmParameter> InstructionSelector::value(const IrOperand &operand, IrInstruction::Type type)
+{
+	if (operand.isImmediate()) {
+		return std::make_shared<AsmValue>(std::to_string(operand.value));
+	}
+	if (IrInstruction::isVector(type)) {
+		return AsmRegister::virtualRegister(operand.value, AsmRegister::xmm0, AsmMemory::xmmword);
+	}
+	return AsmRegister::virtualRegister(operand.value, type == IrInstruction::F64 ? AsmRegister::xmm0 : AsmRegister::eax);
+}
+
+PAsmRegister InstructionSelector::temporary(IrInstruction::Type type)
+{
+	if (IrInstruction::isVector(type)) {
+		return code.newRegister(AsmRegister::xmm0, AsmMemory::xmmword);
+	}
+	return code.newRegister(type == IrInstruction::F64 ? AsmRegister::xmm0 : AsmRegister::eax);
+}
+
+PAsmRegister InstructionSelector::inRegister(const IrOperand &operand)
+{
+	if (operand.isRegister()) {
+		return AsmRegister::virtualRegister(operand.value);
+	}
+	auto reg = code.newRegister();
+	code.push_back({ AsmCommand::mov, reg, value(operand) });
+	return reg;
+}
+
+std::shared_ptr<AsmParameter> InstructionSelector::memory(const IrOperand &address, IrInstruction::Type type)
+{
+	auto dataSize = type == IrInstruction::I8 ? AsmMemory::byte : type == IrInstruction::F64 ? AsmMemory::qword :
+		IrInstruction::isVector(type) ? AsmMemory::xmmword : AsmMemory::dword;
+	switch (address.kind) {
+	case IrOperand::REGISTER:
+		return AsmRegister::memory(AsmRegister::virtualRegister(address.value), dataSize);
+	case IrOperand::VARIABLE:
+		return code.variable(address.name, dataSize);
+	case IrOperand::LABEL:
+		return std::make_shared<AsmLabelMemory>(dataSize, address.name);
+	default:
+		throw std::exception("Address expected");
+	}
+}
+
+IrInstruction::Condition InstructionSelector::compare(IrOperand a, IrOperand b, IrInstruction::Condition condition, IrInstruction::Type type)
+{
+	if (type == IrInstruction::F64) {
+		if (condition == IrInstruction::LT || condition == IrInstruction::LE) {
+			std::swap(a, b);
+			condition = IrInstruction::swapped(condition);
+		}
+		code.push_back({ AsmCommand::ucomisd, value(a, type), value(b, type) });
+		return condition;
+	}
+	if (a.isImmediate() && b.isRegister()) {
+		std::swap(a, b);
+		condition = IrInstruction::swapped(condition);
+	}
+	code.push_back({ AsmCommand::cmp, inRegister(a), value(b) });
+	return condition;
+}
+
+void InstructionSelector::binary(AsmCommand::CommandType command, IrInstruction &instruction)
+{
+	IrOperand a = instruction.a, b = instruction.b;
+	auto type = instruction.type;
+	static const std::set<AsmCommand::CommandType> nonCommutative = {
+		AsmCommand::sub, AsmCommand::subsd, AsmCommand::divsd, AsmCommand::psubd, AsmCommand::subpd, AsmCommand::divpd,
+		AsmCommand::minpd, AsmCommand::maxpd,
+	};
+	auto move = moveCommand(type);
+	bool commutative = !nonCommutative.count(command);
+	if (b == instruction.dst && a != instruction.dst) {
+		if (!commutative) {
+			// the destination is overwritten before b is read
+			auto reg = temporary(type);
+			code.push_back({ move, reg, value(a, type) });
+			code.push_back({ command, reg, value(b, type) });
+			code.push_back({ move, value(instruction.dst, type), reg });
+			return;
+		}
+		std::swap(a, b);
+	}
+	if (a != instruction.dst) {
+		code.push_back({ move, value(instruction.dst, type), value(a, type) });
+	}
+	code.push_back({ command, value(instruction.dst, type), value(b, type) });
+}
+
+void InstructionSelector::selectDouble(IrInstruction &instruction)
+{
+	auto dst = value(instruction.dst, IrInstruction::F64);
+	switch (instruction.opcode) {
+	case IrInstruction::MOV:
+		code.push_back({ AsmCommand::movsd, dst, value(instruction.a, IrInstruction::F64) });
+		break;
+	case IrInstruction::ADD:
+	case IrInstruction::SUB:
+	case IrInstruction::MUL:
+	case IrInstruction::DIV:
+		binary(doubleCommands.at(instruction.opcode), instruction);
+		break;
+	case IrInstruction::NEG:
+		// multiplying by -1 flips the sign of zero too
+		if (instruction.a != instruction.dst) {
+			code.push_back({ AsmCommand::movsd, dst, value(instruction.a, IrInstruction::F64) });
+		}
+		code.push_back({ AsmCommand::mulsd, dst, std::make_shared<AsmLabelMemory>(AsmMemory::qword, code.doubleLabel(-1.0)) });
+		break;
+	case IrInstruction::LOAD:
+		code.push_back({ AsmCommand::movsd, dst, memory(instruction.a, instruction.type) });
+		break;
+	case IrInstruction::STORE:
+		code.push_back({ AsmCommand::movsd, memory(instruction.a, instruction.type), value(instruction.b, IrInstruction::F64) });
+		break;
+	case IrInstruction::WRITE: {
+		if (code.target == AsmCode::linux64) {
+			write(Runtime::writeDouble, AsmRegister::xmm0, instruction);
+			break;
+		}
+		// printf takes the double on the stack, it is passed from a frame slot
+		if (writeSlot == 0) {
+			code.size = Layout::alignUp(code.size + 8, 8);
+			code.frameAlignment = std::max(code.frameAlignment, 8);
+			writeSlot = code.size;
+		}
+		auto slot = std::make_shared<AsmMemory>(AsmMemory::qword, writeSlot);
+		code.push_back({ AsmCommand::movsd, slot, value(instruction.a, IrInstruction::F64) });
+		code.push_back({ AsmCommand::printf, std::make_shared<AsmValue>("\"%f\\n\""), slot });
+		break;
+	}
+	case IrInstruction::ITOF:
+		code.push_back({ AsmCommand::cvtsi2sd, dst, inRegister(instruction.a) });
+		break;
+	default:
+		throw std::exception("Unsupported operation on doubles");
+	}
+}
+
+// dst = the maximum or the minimum of the dwords of a and b, selected through a mask of the lanes where a > b
+void InstructionSelector::vectorMinMax(PAsmRegister dst, PAsmRegister a, PAsmRegister b, bool max)
+{
+	auto mask = temporary(IrInstruction::V4I32), res = temporary(IrInstruction::V4I32);
+	code.push_back({ AsmCommand::movdqa, mask, max ? a : b });
+	code.push_back({ AsmCommand::pcmpgtd, mask, max ? b : a });
+	code.push_back({ AsmCommand::movdqa, res, a });
+	code.push_back({ AsmCommand::pand, res, mask });
+	code.push_back({ AsmCommand::pandn, mask, b });
+	code.push_back({ AsmCommand::por, res, mask });
+	code.push_back({ AsmCommand::movdqa, dst, res });
+}
+
+void InstructionSelector::shuffle(PAsmRegister dst, PAsmRegister a, int order)
+{
+	AsmCommand command(AsmCommand::pshufd, dst, a);
+	command.push_back(std::make_shared<AsmValue>(std::to_string(order)));
+	code.push_back(std::move(command));
+}
+
+void InstructionSelector::selectVector(IrInstruction &instruction)
+{
+	auto type = instruction.type;
+	bool doubles = type == IrInstruction::V2F64;
+	auto vector = [&](const IrOperand &operand) { return std::static_pointer_cast<AsmRegister>(value(operand, type)); };
+	switch (instruction.opcode) {
+	case IrInstruction::MOV:
+		code.push_back({ moveCommand(type), value(instruction.dst, type), value(instruction.a, type) });
+		break;
+	case IrInstruction::ADD:
+	case IrInstruction::SUB:
+	case IrInstruction::MUL:
+	case IrInstruction::DIV:
+		binary((doubles ? doubleVectorCommands : vectorCommands).at(instruction.opcode), instruction);
+		break;
+	case IrInstruction::MIN:
+	case IrInstruction::MAX:
+		if (doubles) {
+			binary(doubleVectorCommands.at(instruction.opcode), instruction);
+			break;
+		}
+		vectorMinMax(vector(instruction.dst), vector(instruction.a), vector(instruction.b), instruction.opcode == IrInstruction::MAX);
+		break;
+	case IrInstruction::LOAD:
+		code.push_back({ doubles ? AsmCommand::movupd : AsmCommand::movdqu, value(instruction.dst, type), memory(instruction.a, type) });
+		break;
+	case IrInstruction::STORE:
+		code.push_back({ doubles ? AsmCommand::movupd : AsmCommand::movdqu, memory(instruction.a, type), value(instruction.b, type) });
+		break;
+	case IrInstruction::SPLAT: {
+		auto dst = vector(instruction.dst);
+		if (doubles) {
+			code.push_back({ AsmCommand::movsd, dst, value(instruction.a, IrInstruction::F64) });
+			code.push_back({ AsmCommand::unpcklpd, dst, dst });
+			break;
+		}
+		code.push_back({ AsmCommand::movd, dst, inRegister(instruction.a) });
+		shuffle(dst, dst, 0);
+		break;
+	}
+	case IrInstruction::HADD:
+	case IrInstruction::HMIN:
+	case IrInstruction::HMAX: {
+		auto a = vector(instruction.a);
+		if (doubles) {
+			// the high lane is combined with the low one
+			auto high = temporary(type);
+			code.push_back({ AsmCommand::movapd, high, a });
+			code.push_back({ AsmCommand::unpckhpd, high, high });
+			code.push_back({ doubleVectorCommands.at(instruction.opcode), high, a });
+			code.push_back({ AsmCommand::movsd, value(instruction.dst, IrInstruction::F64), high });
+			break;
+		}
+		// the upper half is combined with the lower one, then lane 1 with lane 0
+		auto half = temporary(type), lane = temporary(type);
+		shuffle(half, a, 0xEE);
+		if (instruction.opcode == IrInstruction::HADD) {
+			code.push_back({ AsmCommand::paddd, half, a });
+			shuffle(lane, half, 0x55);
+			code.push_back({ AsmCommand::paddd, lane, half });
+		}
+		else {
+			vectorMinMax(half, half, a, instruction.opcode == IrInstruction::HMAX);
+			shuffle(lane, half, 0x55);
+			vectorMinMax(lane, lane, half, instruction.opcode == IrInstruction::HMAX);
+		}
+		code.push_back({ AsmCommand::movd, value(instruction.dst), lane });
+		break;
+	}
+	default:
+		throw std::exception("Unsupported operation on vectors");
+	}
+}
+
+void InstructionSelector::select(IrInstruction &instruction, int next)
+{
+	switch (instruction.opcode) {
+	case IrInstruction::PARAM:
+		parameter(instruction);
+		return;
+	case IrInstruction::CALL:
+		call(instruction);
+		return;
+	case IrInstruction::READ:
+		read(instruction);
+		return;
+	case IrInstruction::RETURN:
+		ret(instruction);
+		return;
+	}
+	if (IrInstruction::isVector(instruction.type)) {
+		selectVector(instruction);
+		return;
+	}
+	if (instruction.type == IrInstruction::F64 && instruction.opcode != IrInstruction::SET && instruction.opcode != IrInstruction::BRANCH) {
+		selectDouble(instruction);
+		return;
+	}
+	auto dst = instruction.dst.isRegister() ? value(instruction.dst) : nullptr;
+	switch (instruction.opcode) {
+	case IrInstruction::MOV:
+		code.push_back({ AsmCommand::mov, dst, value(instruction.a) });
+		break;
+	case IrInstruction::ADD:
+	case IrInstruction::SUB:
+	case IrInstruction::MUL:
+	case IrInstruction::AND:
+	case IrInstruction::OR:
+	case IrInstruction::XOR:
+		binary(binaryCommands.at(instruction.opcode), instruction);
+		break;
+	case IrInstruction::DIV:
+	case IrInstruction::MOD:
+		code.push_back({ AsmCommand::mov, AsmRegister::eax, value(instruction.a) });
+		code.push_back({ AsmCommand::cdq });
+		code.push_back({ AsmCommand::idiv, inRegister(instruction.b) });
+		code.push_back({ AsmCommand::mov, dst, std::make_shared<AsmRegister>(instruction.opcode == IrInstruction::DIV ? AsmRegister::eax : AsmRegister::edx) });
+		break;
+	case IrInstruction::NEG:
+	case IrInstruction::NOT:
+		if (instruction.a != instruction.dst) {
+			code.push_back({ AsmCommand::mov, dst, value(instruction.a) });
+		}
+		code.push_back({ instruction.opcode == IrInstruction::NEG ? AsmCommand::neg : AsmCommand::not, dst });
+		break;
+	case IrInstruction::SET: {
+		auto condition = compare(instruction.a, instruction.b, instruction.condition, instruction.type);
+		bool equality = condition == IrInstruction::EQ || condition == IrInstruction::NE;
+		if (instruction.type == IrInstruction::F64 && equality) {
+			// al is set if the comparison fails, by the result or by unordered operands
+			bool eq = condition == IrInstruction::EQ;
+			code.push_back({ eq ? AsmCommand::setne : AsmCommand::sete, AsmRegister::al });
+			code.push_back({ eq ? AsmCommand::setp : AsmCommand::setnp, AsmRegister::ah });
+			code.push_back({ eq ? AsmCommand::or : AsmCommand::and, AsmRegister::al, AsmRegister::ah });
+		}
+		else {
+			auto setCommands = instruction.type == IrInstruction::F64 ? doubleInvertedSetCommands : invertedSetCommands;
+			code.push_back({ setCommands[condition], AsmRegister::al });
+		}
+		code.push_back({ AsmCommand::sub, AsmRegister::al, "1" });
+		code.push_back({ AsmCommand::movsx, dst, std::make_shared<AsmRegister>(AsmRegister::al) });
+		break;
+	}
+	case IrInstruction::ADDR:
+		code.push_back({ AsmCommand::lea, dst, memory(instruction.a, IrInstruction::I32) });
+		break;
+	case IrInstruction::LOAD:
+		code.push_back({ instruction.type == IrInstruction::I8 ? AsmCommand::movzx : AsmCommand::mov, dst, memory(instruction.a, instruction.type) });
+		break;
+	case IrInstruction::STORE:
+		// a byte register can only be stored through al
+		if (instruction.type == IrInstruction::I8 && !instruction.b.isImmediate()) {
+			code.push_back({ AsmCommand::mov, AsmRegister::eax, value(instruction.b) });
+			code.push_back({ AsmCommand::mov, memory(instruction.a, instruction.type), AsmRegister::al });
+			break;
+		}
+		code.push_back({ AsmCommand::mov, memory(instruction.a, instruction.type), value(instruction.b) });
+		break;
+	case IrInstruction::WRITE:
+		if (code.target == AsmCode::linux64) {
+			write(instruction.type == IrInstruction::I8 ? Runtime::writeChar : Runtime::writeInt, AsmRegister::edi, instruction);
+			break;
+		}
+		code.push_back({ AsmCommand::printf, std::make_shared<AsmValue>(instruction.type == IrInstruction::I8 ? "\"%c\\n\"" : "\"%d\\n\""), value(instruction.a) });
+		break;
+	case IrInstruction::CHECK:
+		// a negative index is a large unsigned one, so a single comparison checks both bounds
+		if (instruction.a.isImmediate()) {
+			if ((unsigned)instruction.a.value > (unsigned)instruction.b.value) {
+				code.push_back({ AsmCommand::jmp, Runtime::rangeError });
+			}
+			break;
+		}
+		code.push_back({ AsmCommand::cmp, inRegister(instruction.a), value(instruction.b) });
+		code.push_back({ AsmCommand::ja, Runtime::rangeError });
+		break;
+	case IrInstruction::FTOI:
+		code.push_back({ AsmCommand::cvttsd2si, dst, value(instruction.a, IrInstruction::F64) });
+		break;
+	case IrInstruction::JUMP:
+		if (instruction.targets[0] != next) {
+			code.push_back({ AsmCommand::jmp, labels[instruction.targets[0]] });
+		}
+		break;
+	case IrInstruction::BRANCH:
+		branch(instruction, next);
+		break;
+	}
+}
+
+void InstructionSelector::branch(IrInstruction &instruction, int next)
+{
+	int target = instruction.targets[0], otherTarget = instruction.targets[1];
+	auto condition = instruction.condition;
+	if (instruction.a.isImmediate() && instruction.b.isImmediate()) {
+		int taken = IrInstruction::evaluate(condition, instruction.a.value, instruction.b.value) ? target : otherTarget;
+		if (taken != next) {
+			code.push_back({ AsmCommand::jmp, labels[taken] });
+		}
+		return;
+	}
+	if (instruction.type == IrInstruction::F64) {
+		doubleBranch(instruction, next);
+		return;
+	}
+	if (target == next) {
+		std::swap(target, otherTarget);
+		condition = IrInstruction::inverse(condition);
+	}
+
+	if (instruction.a.isRegister() && instruction.b == IrOperand::immediate(0) &&
+		(condition == IrInstruction::EQ || condition == IrInstruction::NE))
+	{
+		auto reg = value(instruction.a);
+		code.push_back({ AsmCommand::test, reg, reg });
+	}
+	else {
+		condition = compare(instruction.a, instruction.b, condition, instruction.type);
+	}
+	code.push_back({ jumpCommands[condition], labels[target] });
+	if (otherTarget != next) {
+		code.push_back({ AsmCommand::jmp, labels[otherTarget] });
+	}
+}
+
+// the inverse of a comparison of doubles also holds for unordered operands, so the branch doesn't invert it
+void InstructionSelector::doubleBranch(IrInstruction &instruction, int next)
+{
+	int target = instruction.targets[0], otherTarget = instruction.targets[1];
+	auto condition = compare(instruction.a, instruction.b, instruction.condition, instruction.type);
+	if (condition == IrInstruction::EQ) {
+		code.push_back({ AsmCommand::jp, labels[otherTarget] });
+	}
+	else if (condition == IrInstruction::NE) {
+		code.push_back({ AsmCommand::jp, labels[target] });
+	}
+	if (target == next) {
+		code.push_back({ doubleNotJumpCommands[condition], labels[otherTarget] });
+		return;
+	}
+	code.push_back({ doubleJumpCommands[condition], labels[target] });
+	if (otherTarget != next) {
+		code.push_back({ AsmCommand::jmp, labels[otherTarget] });
+	}
+}
+
+void InstructionSelector::parameter(IrInstruction &instruction)
+{
+	auto type = instruction.type;
+	auto location = parameterLocations[instruction.a.value];
+	if (location.first != AsmRegister::esp) {
+		code.push_back({ moveCommand(type), value(instruction.dst, type), std::make_shared<AsmRegister>(location.first) });
+		return;
+	}
+	if (code.target == AsmCode::linux64) {
+		// the frame base of x86-64 isn't realigned, arguments are read above the return address
+		auto argument = std::make_shared<AsmRegister>(AsmRegister::ebp, type == IrInstruction::F64 ? AsmMemory::qword : AsmMemory::dword,
+			-(16 + location.second));
+		code.push_back({ moveCommand(type), value(instruction.dst, type), argument });
+		return;
+	}
+
+	// the frame base may be realigned, so the prologue copies the dwords of the argument to a frame slot
+	int size = type == IrInstruction::F64 ? 8 : 4;
+	code.size = Layout::alignUp(code.size + size, size);
+	code.frameAlignment = std::max(code.frameAlignment, size);
+	for (int offset = 0; offset < size; offset += 4) {
+		code.argumentCopies.push_back({ location.second + offset, code.size - offset });
+	}
+	auto slot = std::make_shared<AsmMemory>(type == IrInstruction::F64 ? AsmMemory::qword : AsmMemory::dword, code.size);
+	code.push_back({ moveCommand(type), value(instruction.dst, type), slot });
+}
+
+void InstructionSelector::call(IrInstruction &instruction)
+{
+	int stackSize;
+	bool x64 = code.target == AsmCode::linux64;
+	auto locations = argumentLocations(instruction.argumentTypes, stackSize, x64);
+	if (x64) {
+		// the stack stays aligned to 16 bytes, the arguments are stored to the area below the stack pointer
+		stackSize = Layout::alignUp(stackSize, 16);
+		if (stackSize > 0) {
+			code.push_back({ AsmCommand::sub, AsmRegister::esp, std::to_string(stackSize) });
+		}
+	}
+	for (int i = (int)locations.size() - 1; i >= 0; --i) {
+		if (locations[i].first != AsmRegister::esp) {
+			continue;
+		}
+		if (x64) {
+			auto type = instruction.argumentTypes[i];
+			auto slot = std::make_shared<AsmRegister>(AsmRegister::esp, type == IrInstruction::F64 ? AsmMemory::qword : AsmMemory::dword,
+				-locations[i].second);
+			code.push_back({ moveCommand(type), slot, type == IrInstruction::F64 ? value(instruction.arguments[i], type) : inRegister(instruction.arguments[i]) });
+		}
+		else if (instruction.argumentTypes[i] == IrInstruction::F64) {
+			code.push_back({ AsmCommand::sub, AsmRegister::esp, "8" });
+			code.push_back({ AsmCommand::movsd, std::make_shared<AsmRegister>(AsmRegister::esp, AsmMemory::qword),
+				value(instruction.arguments[i], IrInstruction::F64) });
+		}
+		else {
+			code.push_back({ AsmCommand::push, value(instruction.arguments[i]) });
+		}
+	}
+
+	// arguments in registers are moved last, so the registers are busy for a short time
+	AsmCommand command(AsmCommand::call, instruction.a.name);
+	for (int i = 0; i < locations.size(); ++i) {
+		if (locations[i].first == AsmRegister::esp) {
+			continue;
+		}
+		auto type = instruction.argumentTypes[i];
+		code.push_back({ moveCommand(type), locations[i].first, value(instruction.arguments[i], type) });
+		command.push_back(std::make_shared<AsmRegister>(locations[i].first));
+	}
+	code.push_back(std::move(command));
+	if (stackSize > 0) {
+		code.push_back({ AsmCommand::add, AsmRegister::esp, std::to_string(stackSize) });
+	}
+	if (instruction.dst.isRegister()) {
+		auto type = instruction.type;
+		code.push_back({ moveCommand(type), value(instruction.dst, type),
+			std::make_shared<AsmRegister>(type == IrInstruction::F64 ? AsmRegister::xmm0 : AsmRegister::eax) });
+	}
+}
+
+void InstructionSelector::write(const std::string &routine, AsmRegister::RegisterType reg, IrInstruction &instruction)
+{
+	auto type = instruction.type == IrInstruction::F64 ? IrInstruction::F64 : IrInstruction::I32;
+	code.push_back({ moveCommand(type), reg, value(instruction.a, type) });
+	AsmCommand command(AsmCommand::call, routine);
+	command.push_back(std::make_shared<AsmRegister>(reg));
+	code.push_back(std::move(command));
+}
+
+void InstructionSelector::read(IrInstruction &instruction)
+{
+	if (code.target != AsmCode::linux64) {
+		throw std::exception("Read is only supported on Linux x86-64");
+	}
+	bool isDouble = instruction.type == IrInstruction::F64;
+	code.push_back({ AsmCommand::call, isDouble ? Runtime::readDouble : instruction.type == IrInstruction::I8 ? Runtime::readChar : Runtime::readInt });
+	auto type = isDouble ? IrInstruction::F64 : IrInstruction::I32;
+	code.push_back({ moveCommand(type), value(instruction.dst, type), std::make_shared<AsmRegister>(isDouble ? AsmRegister::xmm0 : AsmRegister::eax) });
+}
+
+void InstructionSelector::ret(IrInstruction &instruction)
+{
+	AsmCommand command(AsmCommand::ret);
+	if (instruction.a.kind != IrOperand::NONE) {
+		auto type = instruction.type;
+		auto reg = type == IrInstruction::F64 ? AsmRegister::xmm0 : AsmRegister::eax;
+		code.push_back({ moveCommand(type), reg, value(instruction.a, type) });
+		command.push_back(std::make_shared<AsmRegister>(reg));
+	}
+	code.push_back(std::move(command));
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Ir.h"
+#include "Generator.h"
+
+// Lowers an IR function to commands on virtual registers, IR register k becomes virtual register k.
+// Unreachable blocks are dropped and jumps to the block laid out next become fall-throughs.
+class InstructionSelector {
+public:
+	InstructionSelector(AsmCode &code);
+	void run(IrFunction &function);
+
+private:
+	AsmCode &code;
+	std::vector<std::string> labels;
+	// frame slot doubles are written from, 0 until one is needed
+	int writeSlot = 0;
+	// registers the parameters of the routine are passed in, esp and the offset for those on the stack
+	std::vector<std::pair<AsmRegister::RegisterType, int>> parameterLocations;
+
+	// registers holding doubles are virtual registers of the xmm class
+	std::shared_ptr<AsmParameter> value(const IrOperand &operand, IrInstruction::Type type = IrInstruction::I32);
+	PAsmRegister temporary(IrInstruction::Type type);
+	// a register holding the operand, immediates are moved to a new one
+	PAsmRegister inRegister(const IrOperand &operand);
+	std::shared_ptr<AsmParameter> memory(const IrOperand &address, IrInstruction::Type type);
+	// compares a with b and returns the condition to test, it is swapped with the operands
+	IrInstruction::Condition compare(IrOperand a, IrOperand b, IrInstruction::Condition condition, IrInstruction::Type type);
+	void binary(AsmCommand::CommandType command, IrInstruction &instruction);
+	void select(IrInstruction &instruction, int next);
+	void selectDouble(IrInstruction &instruction);
+	// vectors are held in xmm registers, memory is accessed unaligned
+	void selectVector(IrInstruction &instruction);
+	void vectorMinMax(PAsmRegister dst, PAsmRegister a, PAsmRegister b, bool max);
+	// pshufd, each two bits of the order pick the source dword of a lane
+	void shuffle(PAsmRegister dst, PAsmRegister a, int order);
+	void branch(IrInstruction &instruction, int next);
+	void doubleBranch(IrInstruction &instruction, int next);
+	void parameter(IrInstruction &instruction);
+	void call(IrInstruction &instruction);
+	// a value is written by a routine of the runtime of x86-64, which takes it in the register
+	void write(const std::string &routine, AsmRegister::RegisterType reg, IrInstruction &instruction);
+	// the value is returned by a routine of the runtime in eax or xmm0
+	void read(IrInstruction &instruction);
+	void ret(IrInstruction &instruction);
+};
@@ -0,0 +1,189 @@
+#include "Ir.h"
+
+const std::string IrInstruction::opcodeName[] = {
+	"mov", "add", "sub", "mul", "div", "mod", "and", "or", "xor", "neg", "not",
+	"set", "addr", "load", "store", "write", "read", "itof", "ftoi", "min", "max", "splat",
+	"hadd", "hmin", "hmax", "param", "check", "call", "return", "jump", "branch",
+};
+
+const std::string IrInstruction::conditionName[] = {
+	"eq", "ne", "lt", "le", "gt", "ge",
+};
+
+const std::string IrInstruction::typeName[] = {
+	"i32", "i8", "f64", "v4i32", "v2f64",
+};
+
+IrOperand IrOperand::reg(int number)
+{
+	IrOperand operand;
+	operand.kind = REGISTER;
+	operand.value = number;
+	return operand;
+}
+
+IrOperand IrOperand::immediate(int value)
+{
+	IrOperand operand;
+	operand.kind = IMMEDIATE;
+	operand.value = value;
+	return operand;
+}
+
+IrOperand IrOperand::variable(const std::string &name)
+{
+	IrOperand operand;
+	operand.kind = VARIABLE;
+	operand.name = name;
+	return operand;
+}
+
+IrOperand IrOperand::label(const std::string &name)
+{
+	IrOperand operand;
+	operand.kind = LABEL;
+	operand.name = name;
+	return operand;
+}
+
+bool IrOperand::operator==(const IrOperand &other) const
+{
+	return kind == other.kind && value == other.value && name == other.name;
+}
+
+void IrOperand::print(AsmWriter &writer) const
+{
+	switch (kind) {
+	case REGISTER:
+		writer.write('v').write(value);
+		break;
+	case IMMEDIATE:
+		writer.write(value);
+		break;
+	case VARIABLE:
+		writer.write('@').write(name);
+		break;
+	case LABEL:
+		writer.write(name);
+		break;
+	default:
+		writer.write('-');
+	}
+}
+
+int IrInstruction::def() const
+{
+	return dst.isRegister() ? dst.value : -1;
+}
+
+std::vector<int> IrInstruction::uses() const
+{
+	std::vector<int> res;
+	if (a.isRegister()) {
+		res.push_back(a.value);
+	}
+	if (b.isRegister()) {
+		res.push_back(b.value);
+	}
+	for (auto &argument : arguments) {
+		if (argument.isRegister()) {
+			res.push_back(argument.value);
+		}
+	}
+	return res;
+}
+
+void IrInstruction::print(AsmWriter &writer) const
+{
+	if (dst.kind != IrOperand::NONE) {
+		dst.print(writer);
+		writer.write(" = ");
+	}
+	writer.write(opcodeName[opcode]);
+	if (opcode == SET || opcode == BRANCH) {
+		writer.write('.').write(conditionName[condition]);
+	}
+	if (opcode == LOAD || opcode == STORE || opcode == WRITE || opcode == READ || type == F64 || isVector(type)) {
+		writer.write('.').write(typeName[type]);
+	}
+
+	bool first = true;
+	for (auto operand : { &a, &b }) {
+		if (operand->kind != IrOperand::NONE) {
+			writer.write(first ? " " : ", ");
+			operand->print(writer);
+			first = false;
+		}
+	}
+	for (auto &argument : arguments) {
+		writer.write(first ? " " : ", ");
+		argument.print(writer);
+		first = false;
+	}
+	for (int target : targets) {
+		writer.write(first ? " b" : ", b").write(target);
+		first = false;
+	}
+}
+
+IrInstruction::Condition IrInstruction::inverse(Condition condition)
+{
+	static const Condition res[] = { NE, EQ, GE, GT, LE, LT };
+	return res[condition];
+}
+
+IrInstruction::Condition IrInstruction::swapped(Condition condition)
+{
+	static const Condition res[] = { EQ, NE, GT, GE, LT, LE };
+	return res[condition];
+}
+
+bool IrInstruction::evaluate(Condition condition, int a, int b)
+{
+	switch (condition) {
+	case EQ: return a == b;
+	case NE: return a != b;
+	case LT: return a < b;
+	case LE: return a <= b;
+	case GT: return a > b;
+	default: return a >= b;
+	}
+}
+
+std::vector<int> IrBlock::successors() const
+{
+	if (instructions.empty() || !instructions.back().isTerminator()) {
+		return {};
+	}
+	return instructions.back().targets;
+}
+
+int IrFunction::newRegister()
+{
+	return registerCnt++;
+}
+
+int IrFunction::newBlock(const std::string &name)
+{
+	int id = (int)blocks.size();
+	blocks.push_back(IrBlock(id, name));
+	return id;
+}
+
+int IrFunction::insertBlock(int position, const std::string &name)
+{
+	for (auto &block : blocks) {
+		if (block.id >= position) {
+			++block.id;
+		}
+		for (auto &instruction : block.instructions) {
+			for (int &target : instruction.targets) {
+				if (target >= position) {
+					++target;
+				}
+			}
+		}
+	}
+	blocks.insert(blocks.begin() + position, IrBlock(position, name));
+	return position;
+}
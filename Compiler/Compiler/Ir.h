@@ -0,0 +1,153 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+
+#include "AsmWriter.h"
+
+// Operand of an IR instruction
+class IrOperand {
+public:
+	enum Kind {
+		NONE, REGISTER, IMMEDIATE, VARIABLE, LABEL,
+	};
+
+	Kind kind = NONE;
+	// number of a virtual register or an immediate value
+	int value = 0;
+	// name of a variable in memory or a data label
+	std::string name;
+
+	static IrOperand reg(int number);
+	static IrOperand immediate(int value);
+	static IrOperand variable(const std::string &name);
+	static IrOperand label(const std::string &name);
+
+	bool isRegister() const { return kind == REGISTER; }
+	bool isImmediate() const { return kind == IMMEDIATE; }
+	bool operator==(const IrOperand &other) const;
+	bool operator!=(const IrOperand &other) const { return !(*this == other); }
+	void print(AsmWriter &writer) const;
+};
+
+// Three-address instruction, registers are assigned once by the instruction
+// that defines them except those of scalar variables
+class IrInstruction {
+public:
+	enum Opcode {
+		MOV, ADD, SUB, MUL, DIV, MOD, AND, OR, XOR, NEG, NOT,
+		// dst = a <condition> b ? -1 : 0
+		SET,
+		// dst = address of the variable or label a
+		ADDR,
+		// dst = value at the address a, which is a register, a variable or a label
+		LOAD,
+		// value at the address a = b
+		STORE,
+		WRITE,
+		// dst = integer, character or double of the type read from the input
+		READ,
+		// dst = a converted from an integer to a double and back, the fraction is truncated
+		ITOF, FTOI,
+		// lane-wise minimum and maximum of vectors
+		MIN, MAX,
+		// dst = vector with the scalar a in every lane
+		SPLAT,
+		// dst = sum, minimum or maximum of the lanes of the vector a
+		HADD, HMIN, HMAX,
+		// dst = parameter number a of the routine
+		PARAM,
+		// stops the program with a range check error unless 0 <= a <= b, a is the index of an array
+		// element counted from 0 and b its last one
+		CHECK,
+		// dst = result of the routine at the label a called with the arguments, there is no dst for procedures
+		CALL,
+		// leaves the routine with the result a
+		RETURN,
+		// to targets[0]
+		JUMP,
+		// to targets[0] if a <condition> b, otherwise to targets[1]
+		BRANCH,
+	};
+
+	enum Condition {
+		EQ, NE, LT, LE, GT, GE,
+	};
+
+	// type of the value computed, loaded, stored or written, comparisons have the type of their operands
+	enum Type {
+		I32, I8, F64,
+		// packed values in an SSE register
+		V4I32, V2F64,
+	};
+
+	Opcode opcode;
+	Type type = I32;
+	Condition condition = NE;
+	IrOperand dst, a, b;
+	std::vector<int> targets;
+	// values passed by a call and the types they are passed as
+	std::vector<IrOperand> arguments;
+	std::vector<Type> argumentTypes;
+	// source line of a call
+	int line = 0;
+
+	IrInstruction(Opcode opcode, Type type = I32)
+		: opcode(opcode), type(type)
+	{}
+
+	bool isTerminator() const { return opcode == JUMP || opcode == BRANCH; }
+	// register written by the instruction, -1 if there is none
+	int def() const;
+	std::vector<int> uses() const;
+	void print(AsmWriter &writer) const;
+
+	static Condition inverse(Condition condition);
+	// the condition holding for swapped operands
+	static Condition swapped(Condition condition);
+	static bool evaluate(Condition condition, int a, int b);
+	static bool isVector(Type type) { return type == V4I32 || type == V2F64; }
+	// type of the lanes of a vector
+	static Type elementType(Type type) { return type == V4I32 ? I32 : type == V2F64 ? F64 : type; }
+	static int lanes(Type type) { return type == V4I32 ? 4 : type == V2F64 ? 2 : 1; }
+
+	static const std::string opcodeName[];
+	static const std::string conditionName[];
+	static const std::string typeName[];
+};
+
+class IrBlock {
+public:
+	int id;
+	std::string name;
+	std::vector<IrInstruction> instructions;
+
+	IrBlock(int id, const std::string &name)
+		: id(id), name(name)
+	{}
+
+	// blocks the terminator may transfer control to, empty for the last one of a function
+	std::vector<int> successors() const;
+};
+
+// Blocks are kept in the order they are laid out in, so a block
+// without a terminator falls off the end of the function
+class IrFunction {
+public:
+	std::string name;
+	std::vector<IrBlock> blocks;
+	int registerCnt = 0;
+	// registers holding scalar variables
+	std::map<std::string, int> variables;
+	// types the parameters of a routine are passed as, they tell where each one is found
+	std::vector<IrInstruction::Type> parameterTypes;
+
+	IrFunction(const std::string &name = "")
+		: name(name)
+	{}
+
+	int newRegister();
+	int newBlock(const std::string &name);
+	// places a new block before the one at the position, the following blocks and jumps to them are renumbered
+	int insertBlock(int position, const std::string &name);
+};
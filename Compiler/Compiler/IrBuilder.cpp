@@ -0,0 +1,282 @@
+#include "IrBuilder.h"
+#include "SymbolTable.h"
+#include "Types.h"
+#include "Utils.h"
+
+IrBuilder::IrBuilder(IrFunction &function, AsmCode &code)
+	: function(function), code(code), shortCircuit(false), rangeChecks(false)
+{
+	current = startNewBlock("ENTRY");
+}
+
+void IrBuilder::declare(PSymbol symbol)
+{
+	std::string name = lowerString(symbol->token->text);
+	auto category = symbol->type->category;
+	if (shared.count(name)) {
+		code.addSymbol(symbol, true);
+		return;
+	}
+	if (symbol->category != Symbol::NIL || addressTaken.count(name) ||
+		(category != Type::INTEGER && category != Type::CHAR && category != Type::DOUBLE))
+	{
+		code.addSymbol(symbol);
+		return;
+	}
+
+	// scalars live in registers, initialized ones are loaded from their data once
+	int reg = function.newRegister();
+	function.variables[name] = reg;
+	if (symbol->value != nullptr) {
+		code.addSymbol(symbol);
+		IrInstruction load(IrInstruction::LOAD, category == Type::CHAR ? IrInstruction::I8 :
+			category == Type::DOUBLE ? IrInstruction::F64 : IrInstruction::I32);
+		load.dst = IrOperand::reg(reg);
+		load.a = IrOperand::variable(name);
+		emit(load);
+	}
+}
+
+void IrBuilder::declareParameters(const std::vector<PSymbol> &parameters)
+{
+	// all arguments are read first, copying one may need the registers the others are passed in
+	std::vector<int> values;
+	for (int i = 0; i < parameters.size(); ++i) {
+		auto type = !byReference(parameters[i]) && parameters[i]->type->category == Type::DOUBLE ? IrInstruction::F64 : IrInstruction::I32;
+		function.parameterTypes.push_back(type);
+		values.push_back(emit(IrInstruction::PARAM, IrOperand::immediate(i), IrOperand(), type).value);
+	}
+
+	for (int i = 0; i < parameters.size(); ++i) {
+		auto symbol = parameters[i];
+		std::string name = lowerString(symbol->token->text);
+		auto category = symbol->type->category;
+		if (byReference(symbol) && symbol->category != Symbol::NIL) {
+			references[name] = values[i];
+		}
+		else if (byReference(symbol)) {
+			code.addLocal(name, symbol->type);
+			copy(emit(IrInstruction::ADDR, IrOperand::variable(name)).value, values[i], symbol->type->size);
+		}
+		else if (addressTaken.count(name) || category == Type::STRING) {
+			code.addLocal(name, symbol->type);
+			IrInstruction store(IrInstruction::STORE, category == Type::CHAR ? IrInstruction::I8 :
+				category == Type::DOUBLE ? IrInstruction::F64 : IrInstruction::I32);
+			store.a = IrOperand::variable(name);
+			store.b = IrOperand::reg(values[i]);
+			emit(store);
+		}
+		else {
+			function.variables[name] = values[i];
+		}
+	}
+}
+
+bool IrBuilder::byReference(PSymbol parameter)
+{
+	return parameter->category == Symbol::VAR_PARAMETER || !Type::simpleCategories.count(parameter->type->category);
+}
+
+IrOperand IrBuilder::storage(const std::string &name)
+{
+	auto it = references.find(name);
+	return it == references.end() ? IrOperand::variable(name) : IrOperand::reg(it->second);
+}
+
+void IrBuilder::copy(int to, int from, int size)
+{
+	if (size / 4 > 16) {
+		// long values are copied a dword at a time in a loop, the pointers end at the bytes left
+		int count = function.newRegister(), source = function.newRegister(), target = function.newRegister();
+		for (auto it : { std::make_pair(count, IrOperand::immediate(size / 4)),
+			std::make_pair(source, IrOperand::reg(from)), std::make_pair(target, IrOperand::reg(to)) })
+		{
+			IrInstruction mov(IrInstruction::MOV);
+			mov.dst = IrOperand::reg(it.first);
+			mov.a = it.second;
+			emit(mov);
+		}
+		int body = newBlock("COPY"), end = newBlock("COPY_END");
+		startBlock(body);
+		IrInstruction store(IrInstruction::STORE);
+		store.a = IrOperand::reg(target);
+		store.b = emit(IrInstruction::LOAD, IrOperand::reg(source));
+		emit(store);
+		for (int reg : { source, target, count }) {
+			IrInstruction step(reg == count ? IrInstruction::SUB : IrInstruction::ADD);
+			step.dst = step.a = IrOperand::reg(reg);
+			step.b = IrOperand::immediate(reg == count ? 1 : 4);
+			emit(step);
+		}
+		branch(IrInstruction::NE, IrOperand::reg(count), IrOperand::immediate(0), body, end);
+		startBlock(end);
+		from = source;
+		to = target;
+		size %= 4;
+	}
+
+	for (int offset = 0; offset < size; ) {
+		auto type = size - offset >= 4 ? IrInstruction::I32 : IrInstruction::I8;
+		IrOperand source = IrOperand::reg(from), target = IrOperand::reg(to);
+		if (offset != 0) {
+			source = emit(IrInstruction::ADD, source, IrOperand::immediate(offset));
+			target = emit(IrInstruction::ADD, target, IrOperand::immediate(offset));
+		}
+		IrInstruction store(IrInstruction::STORE, type);
+		store.a = target;
+		store.b = emit(IrInstruction::LOAD, source, IrOperand(), type);
+		emit(store);
+		offset += type == IrInstruction::I32 ? 4 : 1;
+	}
+}
+
+int IrBuilder::variableRegister(const std::string &name)
+{
+	auto it = function.variables.find(name);
+	return it == function.variables.end() ? -1 : it->second;
+}
+
+bool IrBuilder::isVariable(IrOperand operand)
+{
+	for (auto &it : function.variables) {
+		if (operand == IrOperand::reg(it.second)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void IrBuilder::emit(IrInstruction instruction)
+{
+	if (current == -1) {
+		// code after a jump is never executed but still has to be lowered
+		current = startNewBlock("UNREACHABLE");
+	}
+	function.blocks[current].instructions.push_back(instruction);
+	if (instruction.isTerminator()) {
+		current = -1;
+	}
+}
+
+IrOperand IrBuilder::emit(IrInstruction::Opcode opcode, IrOperand a, IrOperand b, IrInstruction::Type type)
+{
+	IrInstruction instruction(opcode, type);
+	instruction.dst = IrOperand::reg(function.newRegister());
+	instruction.a = a;
+	instruction.b = b;
+	emit(instruction);
+	return instruction.dst;
+}
+
+void IrBuilder::move(int reg, IrOperand value, IrInstruction::Type type)
+{
+	if (current != -1 && value.isRegister() && !function.blocks[current].instructions.empty()) {
+		auto &last = function.blocks[current].instructions.back();
+		// a temporary is defined once, so nothing has read it yet
+		if (!isVariable(value) && last.dst == value) {
+			last.dst = IrOperand::reg(reg);
+			return;
+		}
+	}
+	IrInstruction mov(IrInstruction::MOV, type);
+	mov.dst = IrOperand::reg(reg);
+	mov.a = value;
+	emit(mov);
+}
+
+void IrBuilder::jump(int target)
+{
+	IrInstruction instruction(IrInstruction::JUMP);
+	instruction.targets = { target };
+	emit(instruction);
+}
+
+void IrBuilder::branch(IrInstruction::Condition condition, IrOperand a, IrOperand b, int target, int otherTarget, IrInstruction::Type type)
+{
+	IrInstruction instruction(IrInstruction::BRANCH, type);
+	instruction.condition = condition;
+	instruction.a = a;
+	instruction.b = b;
+	instruction.targets = { target, otherTarget };
+	emit(instruction);
+}
+
+void IrBuilder::exit()
+{
+	if (current == -1) {
+		current = startNewBlock("UNREACHABLE");
+	}
+	exits.push_back(current);
+	jump(-1);
+}
+
+void IrBuilder::finish()
+{
+	if (!exits.empty()) {
+		int block = newBlock("EXIT");
+		startBlock(block);
+		for (int it : exits) {
+			function.blocks[it].instructions.back().targets[0] = block;
+		}
+	}
+
+	// blocks of an inner statement are created after those of the outer one but started before its end
+	std::vector<int> number(function.blocks.size(), -1);
+	for (int i = 0; i < started.size(); ++i) {
+		number[started[i]] = i;
+	}
+	std::vector<IrBlock> blocks;
+	for (int block : started) {
+		blocks.push_back(function.blocks[block]);
+		blocks.back().id = number[block];
+		for (auto &instruction : blocks.back().instructions) {
+			for (int &target : instruction.targets) {
+				target = number[target];
+			}
+		}
+	}
+	function.blocks = blocks;
+}
+
+void IrBuilder::finishRoutine(PSymbol result)
+{
+	int block = newBlock("EXIT");
+	startBlock(block);
+	for (int it : exits) {
+		function.blocks[it].instructions.back().targets[0] = block;
+	}
+	exits.clear();
+
+	IrInstruction ret(IrInstruction::RETURN);
+	auto category = result->type->category;
+	if (category != Type::NIL) {
+		std::string name = lowerString(result->token->text);
+		int reg = variableRegister(name);
+		ret.type = category == Type::DOUBLE ? IrInstruction::F64 : IrInstruction::I32;
+		ret.a = reg != -1 ? IrOperand::reg(reg) :
+			emit(IrInstruction::LOAD, storage(name), IrOperand(), category == Type::CHAR ? IrInstruction::I8 : ret.type);
+	}
+	emit(ret);
+	finish();
+}
+
+int IrBuilder::newBlock(const std::string &name)
+{
+	return function.newBlock(name);
+}
+
+void IrBuilder::startBlock(int block)
+{
+	if (current != -1) {
+		jump(block);
+	}
+	current = block;
+	started.push_back(block);
+}
+
+int IrBuilder::startNewBlock(const std::string &name)
+{
+	int block = function.newBlock(name);
+	started.push_back(block);
+	return block;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+
+#include "Ir.h"
+#include "Generator.h"
+
+class Symbol;
+typedef std::shared_ptr<Symbol> PSymbol;
+
+// Appends instructions to the blocks of a function while the syntax tree is lowered.
+// Storage of the variables that stay in memory is allocated in the code.
+class IrBuilder {
+public:
+	IrFunction &function;
+	AsmCode &code;
+	// and/or of comparisons in conditions skip the right operand when the left one decides, {$B-}
+	bool shortCircuit;
+	// indexes of array elements are checked against the bounds when the program runs, {$R+}
+	bool rangeChecks;
+	// variables of the main program used by routines, they are static
+	std::set<std::string> shared;
+	// variables passed by reference, they stay in memory
+	std::set<std::string> addressTaken;
+
+	IrBuilder(IrFunction &function, AsmCode &code);
+
+	// places a variable in a register or in memory
+	void declare(PSymbol symbol);
+	// reads the arguments of a routine, structured values passed by value are copied to its frame
+	void declareParameters(const std::vector<PSymbol> &parameters);
+	// var parameters and structured ones are passed as addresses
+	static bool byReference(PSymbol parameter);
+	// address of a variable in memory, the register holding it for a parameter passed by reference
+	IrOperand storage(const std::string &name);
+	// register of a scalar variable, -1 if it is kept in memory
+	int variableRegister(const std::string &name);
+	bool isVariable(IrOperand operand);
+
+	void emit(IrInstruction instruction);
+	// dst = a op b in a new register
+	IrOperand emit(IrInstruction::Opcode opcode, IrOperand a, IrOperand b = IrOperand(), IrInstruction::Type type = IrInstruction::I32);
+	// reg = value, a temporary computed by the last instruction is computed into reg instead
+	void move(int reg, IrOperand value, IrInstruction::Type type = IrInstruction::I32);
+	void jump(int target);
+	void branch(IrInstruction::Condition condition, IrOperand a, IrOperand b, int target, int otherTarget, IrInstruction::Type type = IrInstruction::I32);
+	// jumps to the end of the function
+	void exit();
+	// ends the function with the block exit jumps to and lays the blocks out in the order they were started
+	void finish();
+	// ends a routine returning the value of its result variable if it has one
+	void finishRoutine(PSymbol result);
+
+	int newBlock(const std::string &name);
+	// continues in the block, the current one falls through to it
+	void startBlock(int block);
+
+	// targets of break and continue in the innermost loop
+	struct Loop {
+		int continueTarget, breakTarget;
+	};
+	std::vector<Loop> loops;
+
+private:
+	// -1 after a terminator until the next block starts
+	int current;
+	// blocks ending with an exit jump, their target is known when the function is finished
+	std::vector<int> exits;
+	std::vector<int> started;
+	// registers holding the addresses of parameters passed by reference
+	std::map<std::string, int> references;
+
+	int startNewBlock(const std::string &name);
+	// copies size bytes from the address in a register to the address in another one
+	void copy(int to, int from, int size);
+};
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include "Jit.h"
+#include "Encoder.h"
+#include "Linker.h"
+#include "Layout.h"
+#include "Runtime.h"
+
+static const std::string entry = "$jit_entry@";
+static const size_t outputSize = 1 << 16;
+static std::string output;
+
+static void flushOutput()
+{
+	fwrite(output.data(), 1, output.size(), stdout);
+	fflush(stdout);
+	output.clear();
+}
+
+// the functions are called as the routines of the runtime, by the System V convention
+static void writeInt(int value)
+{
+	char text[16];
+	output.append(text, sprintf(text, "%d\n", value));
+	if (output.size() >= outputSize) {
+		flushOutput();
+	}
+}
+
+static void writeChar(int value)
+{
+	output += (char)value;
+	output += '\n';
+	if (output.size() >= outputSize) {
+		flushOutput();
+	}
+}
+
+static void writeDouble(double value)
+{
+	// the largest double has 309 digits before the point
+	char text[320];
+	output.append(text, snprintf(text, sizeof(text), "%f\n", value));
+	if (output.size() >= outputSize) {
+		flushOutput();
+	}
+}
+
+// the text written so far is printed before the program waits for the input
+static int readInt()
+{
+	flushOutput();
+	return Runtime::inputInt();
+}
+
+static int readChar()
+{
+	flushOutput();
+	return Runtime::inputChar();
+}
+
+static double readDouble()
+{
+	flushOutput();
+	return Runtime::inputDouble();
+}
+
+static void rangeError()
+{
+	flushOutput();
+	fputs("Range check error\n", stderr);
+	exit(Runtime::rangeErrorCode);
+}
+
+Jit::Jit(AsmCode &code)
+	: code(code)
+{
+}
+
+void Jit::addRuntime(uint64_t stackTop)
+{
+	std::pair<std::string, void *> functions[] = {
+		{ Runtime::writeInt, (void *)writeInt }, { Runtime::writeChar, (void *)writeChar }, { Runtime::writeDouble, (void *)writeDouble },
+		{ Runtime::readInt, (void *)readInt }, { Runtime::readChar, (void *)readChar }, { Runtime::readDouble, (void *)readDouble },
+	};
+	for (auto &it : functions) {
+		AsmRoutine routine;
+		routine.label = it.first;
+		routine.naked = true;
+		routine.commands = {
+			{ AsmCommand::mov, AsmRegister::rax, std::to_string((uint64_t)it.second) },
+			{ AsmCommand::jmp, AsmRegister::rax },
+		};
+		code.routines.push_back(routine);
+	}
+	// a failed check jumps to the error from any depth of the stack, it is aligned for the call
+	AsmRoutine error;
+	error.label = Runtime::rangeError;
+	error.naked = true;
+	error.commands = {
+		{ AsmCommand::and, AsmRegister::rsp, "-16" },
+		{ AsmCommand::mov, AsmRegister::rax, std::to_string((uint64_t)rangeError) },
+		{ AsmCommand::call, AsmRegister::rax },
+	};
+	code.routines.push_back(error);
+
+	// the frame base of the caller is kept in rbp while the program runs on its stack
+	AsmRoutine routine;
+	routine.label = entry;
+	routine.naked = true;
+	routine.commands = {
+		{ AsmCommand::push, AsmRegister::rbp },
+		{ AsmCommand::mov, AsmRegister::rbp, AsmRegister::rsp },
+		{ AsmCommand::mov, AsmRegister::rsp, std::to_string(stackTop) },
+		{ AsmCommand::call, Runtime::main },
+		{ AsmCommand::mov, AsmRegister::rsp, AsmRegister::rbp },
+		{ AsmCommand::pop, AsmRegister::rbp },
+		{ AsmCommand::ret },
+	};
+	code.routines.push_back(routine);
+}
+
+#ifdef _WIN32
+void Jit::run()
+{
+	throw std::exception("The JIT runs on Linux x86-64 only");
+}
+#else
+// the stack overflows into a guard below it rather than into the code or the data mapped there
+static char *stackBase;
+
+// the handler runs on a stack of its own, so only functions safe in signal handlers are called
+static void fault(int signal, siginfo_t *info, void *)
+{
+	char *address = (char *)info->si_addr;
+	bool overflow = address < stackBase && address >= stackBase - Runtime::guardSize;
+	const char *message = signal == SIGFPE ? "Division by zero\n" : overflow ? "Stack overflow\n" : "Access violation\n";
+	int code = signal == SIGFPE ? Runtime::divisionErrorCode : overflow ? Runtime::stackOverflowCode : Runtime::accessViolationCode;
+	// the text written so far goes out before the message
+	if (write(1, output.data(), output.size()) < 0 || write(2, message, strlen(message)) < 0) {
+		_exit(1);
+	}
+	_exit(code);
+}
+
+static char *map(size_t size)
+{
+	void *res = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+	if (res == MAP_FAILED) {
+		throw std::exception("Memory for the code can't be mapped");
+	}
+	return (char *)res;
+}
+
+void Jit::run()
+{
+	auto start = std::chrono::steady_clock::now();
+	size_t stackSize = Runtime::guardSize + Runtime::stackBytes(code.size);
+	char *stack = map(stackSize);
+	mprotect(stack, Runtime::guardSize, PROT_NONE);
+	stackBase = stack + Runtime::guardSize;
+	addRuntime((uint64_t)(stack + stackSize));
+	Encoder encoder(code);
+	encoder.run();
+	Linker linker(code, encoder);
+	int dataSize = 0;
+	linker.place(true, true, dataSize);
+	linker.place(false, true, dataSize);
+	linker.place(false, false, dataSize);
+
+	size_t textSize = Layout::alignUp((int)encoder.text.size(), 4096);
+	char *text = map(textSize);
+	char *data = map(std::max(dataSize, 1));
+	linker.locate((uint64_t)text, (uint64_t)data);
+	linker.writeText(text);
+	linker.writeData(data);
+	if (mprotect(text, textSize, PROT_READ | PROT_EXEC) != 0) {
+		throw std::exception("The code can't be made executable");
+	}
+	auto loaded = std::chrono::steady_clock::now();
+
+	std::vector<char> signalStack(Runtime::signalStackSize);
+	stack_t handlerStack = {}, previousStack;
+	handlerStack.ss_sp = signalStack.data();
+	handlerStack.ss_size = Runtime::signalStackSize;
+	sigaltstack(&handlerStack, &previousStack);
+	struct sigaction action = {}, previous[2];
+	action.sa_sigaction = fault;
+	action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+	sigaction(SIGFPE, &action, &previous[0]);
+	sigaction(SIGSEGV, &action, &previous[1]);
+	((void (*)())linker.address(entry))();
+	sigaction(SIGFPE, &previous[0], nullptr);
+	sigaction(SIGSEGV, &previous[1], nullptr);
+	sigaltstack(&previousStack, nullptr);
+	auto finished = std::chrono::steady_clock::now();
+	flushOutput();
+	loadTime = std::chrono::duration<double>(loaded - start).count();
+	runTime = std::chrono::duration<double>(finished - loaded).count();
+
+	munmap(text, textSize);
+	munmap(data, std::max(dataSize, 1));
+	munmap(stack, stackSize);
+}
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+
+#include "Generator.h"
+
+// Runs the code of the Linux x86-64 target in the memory of the compiler. The code and the data are mapped
+// in the low 2 GB as the ELF writer places them, the code is writable only until it is copied there.
+// The write and read routines jump to functions of the compiler and the main program is called by an entry routine
+// switching to a stack of its own, so the addresses the program works with fit 32-bit registers.
+// A division by zero or a fault of the program ends the compiler as it ends the executable.
+class Jit {
+public:
+	Jit(AsmCode &code);
+	// the text written by the program is buffered and printed when the buffer fills up and when it returns
+	void run();
+
+	// seconds spent encoding and loading the code and running it
+	double loadTime = 0, runTime = 0;
+
+private:
+	AsmCode &code;
+
+	void addRuntime(uint64_t stackTop);
+};
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <vector>
+#include "Layout.h"
+#include "Types.h"
+
+const int Layout::cacheLineSize;
+const int Layout::largeObjectSize;
+
+void Layout::apply(ArrayType &type)
+{
+	// element size is a multiple of its alignment, so elements follow each other without gaps
+	int count = type.right->value->toInteger() - type.left->value->toInteger() + 1;
+	type.size = count * type.elementType->size;
+	type.alignment = type.packed ? 1 : type.elementType->alignment;
+}
+
+void Layout::apply(RecordType &type)
+{
+	auto &fields = type.fields->symbolsArray;
+	std::vector<int> order(fields.size());
+	for (int i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	if (type.reordered) {
+		std::stable_sort(order.begin(), order.end(), [&fields](int a, int b) {
+			return fields[a]->type->alignment > fields[b]->type->alignment;
+		});
+	}
+
+	type.offsets.assign(fields.size(), 0);
+	type.alignment = 1;
+	int offset = 0;
+	for (int i : order) {
+		PType fieldType = fields[i]->type;
+		if (!type.packed) {
+			offset = alignUp(offset, fieldType->alignment);
+			type.alignment = std::max(type.alignment, fieldType->alignment);
+		}
+		type.offsets[i] = offset;
+		offset += fieldType->size;
+	}
+	type.size = alignUp(offset, type.alignment);
+}
+
+int Layout::alignUp(int offset, int alignment)
+{
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+int Layout::objectAlignment(PType type)
+{
+	int alignment = type->alignment;
+	if (type->size >= largeObjectSize) {
+		alignment = std::max(alignment, cacheLineSize);
+	}
+	return alignment;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <memory>
+
+class Type;
+typedef std::shared_ptr<Type> PType;
+class ArrayType;
+class RecordType;
+
+// Memory layout of types: sizes, alignments and offsets of record fields.
+// Types are naturally aligned unless packed, a reordered record places its
+// fields by decreasing alignment to minimize padding.
+class Layout {
+public:
+	static const int cacheLineSize = 64;
+	// objects at least this big start on a cache line
+	static const int largeObjectSize = 256;
+
+	static void apply(ArrayType &type);
+	static void apply(RecordType &type);
+
+	static int alignUp(int offset, int alignment);
+	// alignment of a variable or constant of the type placed in a frame or a data section
+	static int objectAlignment(PType type);
+};
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <cstring>
+#include "Linker.h"
+#include "Layout.h"
+
+Linker::Linker(AsmCode &code, const Encoder &encoder)
+	: code(code), encoder(encoder)
+{
+}
+
+// data without bytes takes at least one byte as in the assembly
+void Linker::place(bool constant, bool initialized, int &offset)
+{
+	for (auto &it : code.data) {
+		if (it.constant != constant || (!constant && it.bytes.empty() == initialized)) {
+			continue;
+		}
+		offset = Layout::alignUp(offset, it.alignment);
+		offsets[it.label] = offset;
+		placed.push_back({ &it, offset });
+		offset += it.bytes.empty() ? std::max(it.reserved, 1) : (int)it.bytes.size();
+	}
+}
+
+void Linker::locate(uint64_t textAddress, uint64_t dataAddress)
+{
+	this->textAddress = textAddress;
+	this->dataAddress = dataAddress;
+}
+
+uint64_t Linker::address(const std::string &label)
+{
+	auto it = encoder.labels.find(label);
+	if (it != encoder.labels.end()) {
+		return textAddress + it->second;
+	}
+	auto data = offsets.find(label);
+	if (data == offsets.end()) {
+		throw std::exception("Reference to an undefined label");
+	}
+	return dataAddress + data->second;
+}
+
+void Linker::writeText(char *text)
+{
+	memcpy(text, encoder.text.data(), encoder.text.size());
+	for (auto &fixup : encoder.fixups) {
+		int64_t value = (int64_t)address(fixup.label) + fixup.addend;
+		if (fixup.relative) {
+			value -= textAddress + fixup.end;
+		}
+		int32_t field = (int32_t)value;
+		memcpy(text + fixup.position, &field, sizeof(field));
+	}
+}
+
+void Linker::writeData(char *image)
+{
+	static const int directiveSize[] = { 1, 4, 8, 4 };
+
+	for (auto &it : placed) {
+		auto &data = *it.first;
+		memcpy(image + it.second, data.bytes.data(), data.bytes.size());
+		// pointers hold the index of their label
+		int position = it.second;
+		for (auto &run : data.runs) {
+			for (int i = 0; i < run.count; ++i, position += directiveSize[run.directive]) {
+				if (run.directive != AsmData::pointer) {
+					continue;
+				}
+				int index;
+				memcpy(&index, image + position, sizeof(index));
+				uint32_t pointer = (uint32_t)address(data.pointers[index]);
+				memcpy(image + position, &pointer, sizeof(pointer));
+			}
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "Generator.h"
+#include "Encoder.h"
+
+// Places the encoded code and the data of the Linux x86-64 target at addresses and resolves
+// the references between them, for the ELF writer and the JIT. The data is placed in an image
+// loaded at one address, the code may be loaded apart from it.
+class Linker {
+public:
+	Linker(AsmCode &code, const Encoder &encoder);
+
+	// places the data of the kind from the offset in the image, data without bytes has only zeros
+	void place(bool constant, bool initialized, int &offset);
+	void locate(uint64_t textAddress, uint64_t dataAddress);
+	uint64_t address(const std::string &label);
+	// copies the code with the references to the labels resolved
+	void writeText(char *text);
+	// copies the placed data to the image, pointers hold the addresses of their labels
+	void writeData(char *image);
+
+private:
+	AsmCode &code;
+	const Encoder &encoder;
+	// data with its offset in the image
+	std::vector<std::pair<const AsmData *, int>> placed;
+	std::map<std::string, int> offsets;
+	uint64_t textAddress = 0, dataAddress = 0;
+};
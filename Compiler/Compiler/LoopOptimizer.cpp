@@ -0,0 +1,387 @@
+#include <algorithm>
+#include <tuple>
+#include <set>
+#include <map>
+#include "LoopOptimizer.h"
+
+LoopOptimizer::LoopOptimizer(IrFunction &function, Cfg &cfg)
+	: function(function), cfg(cfg)
+{
+}
+
+void LoopOptimizer::run()
+{
+	// preheaders are added first, so that one graph serves all the loops
+	bool inserted = false;
+	// blocks move down as preheaders are inserted before them
+	std::vector<int> position(function.blocks.size());
+	for (int block = 0; block < position.size(); ++block) {
+		position[block] = block;
+	}
+	for (auto &loop : cfg.loops) {
+		if (preheader(cfg, loop) != -1) {
+			continue;
+		}
+		std::vector<int> outside;
+		for (int pred : cfg.predecessors[loop.header]) {
+			if (!loop.contains[pred]) {
+				outside.push_back(position[pred]);
+			}
+		}
+		int block = position[loop.header];
+		insertPreheader(block, outside);
+		for (int &it : position) {
+			it += it >= block;
+		}
+		inserted = true;
+	}
+	if (inserted) {
+		cfg.update();
+	}
+
+	for (auto &loop : cfg.loops) {
+		int block = preheader(cfg, loop);
+		countDefinitions(loop);
+		hoistInvariants(loop, block);
+		countDefinitions(loop);
+		reduceInductionVariables(loop, block);
+	}
+	removeDeadCode();
+}
+
+void LoopOptimizer::countDefinitions(const Cfg::Loop &loop)
+{
+	variable.assign(function.registerCnt, false);
+	for (auto &it : function.variables) {
+		variable[it.second] = true;
+	}
+	definitions.assign(function.registerCnt, 0);
+	loopDefinitions.assign(function.registerCnt, 0);
+	for (auto &block : function.blocks) {
+		for (auto &instruction : block.instructions) {
+			if (instruction.def() != -1) {
+				++definitions[instruction.def()];
+				loopDefinitions[instruction.def()] += loop.contains[block.id];
+			}
+		}
+	}
+}
+
+int LoopOptimizer::preheader(Cfg &cfg, const Cfg::Loop &loop)
+{
+	int res = -1;
+	for (int pred : cfg.predecessors[loop.header]) {
+		if (loop.contains[pred]) {
+			continue;
+		}
+		if (res != -1) {
+			return -1;
+		}
+		res = pred;
+	}
+	return res != -1 && cfg.successors[res].size() == 1 ? res : -1;
+}
+
+void LoopOptimizer::insertPreheader(int header, const std::vector<int> &outside)
+{
+	int block = function.insertBlock(header, "PREHEADER");
+	for (int pred : outside) {
+		for (int &target : function.blocks[pred >= block ? pred + 1 : pred].instructions.back().targets) {
+			if (target == header + 1) {
+				target = block;
+			}
+		}
+	}
+	IrInstruction jump(IrInstruction::JUMP);
+	jump.targets = { header + 1 };
+	function.blocks[block].instructions.push_back(jump);
+}
+
+// instructions computing the same value wherever they are executed, without side effects or traps
+bool LoopOptimizer::movable(const IrInstruction &instruction, bool stores)
+{
+	int def = instruction.def();
+	if (def == -1 || variable[def] || definitions[def] != 1) {
+		return false;
+	}
+	switch (instruction.opcode) {
+	case IrInstruction::MOV:
+	case IrInstruction::ADD:
+	case IrInstruction::SUB:
+	case IrInstruction::MUL:
+	case IrInstruction::AND:
+	case IrInstruction::OR:
+	case IrInstruction::XOR:
+	case IrInstruction::NEG:
+	case IrInstruction::NOT:
+	case IrInstruction::SET:
+	case IrInstruction::ADDR:
+	case IrInstruction::ITOF:
+	case IrInstruction::FTOI:
+	case IrInstruction::MIN:
+	case IrInstruction::MAX:
+	case IrInstruction::SPLAT:
+		return true;
+	case IrInstruction::DIV:
+	case IrInstruction::MOD:
+		// division of doubles doesn't trap
+		return IrInstruction::elementType(instruction.type) == IrInstruction::F64 ||
+			(instruction.b.isImmediate() && instruction.b.value != 0 && instruction.b.value != -1);
+	case IrInstruction::LOAD:
+		// a variable is always addressable, an element address may be valid only when the loop runs,
+		// labels are read directly only for constants
+		return instruction.a.kind == IrOperand::LABEL || (!stores && !instruction.a.isRegister());
+	default:
+		return false;
+	}
+}
+
+void LoopOptimizer::addToPreheader(int preheader, const IrInstruction &instruction)
+{
+	auto &instructions = function.blocks[preheader].instructions;
+	instructions.insert(instructions.end() - 1, instruction);
+}
+
+void LoopOptimizer::hoistInvariants(const Cfg::Loop &loop, int preheader)
+{
+	bool stores = false;
+	for (int block : loop.blocks) {
+		for (auto &instruction : function.blocks[block].instructions) {
+			// a routine may store to any variable in memory
+			stores |= instruction.opcode == IrInstruction::STORE || instruction.opcode == IrInstruction::CALL;
+		}
+	}
+	auto invariant = [this](const IrOperand &operand) {
+		return !operand.isRegister() || loopDefinitions[operand.value] == 0;
+	};
+
+	for (bool changed = true; changed; ) {
+		changed = false;
+		for (int block : loop.blocks) {
+			auto &instructions = function.blocks[block].instructions;
+			for (int i = 0; i < instructions.size(); ) {
+				auto instruction = instructions[i];
+				if (!movable(instruction, stores) || !invariant(instruction.a) || !invariant(instruction.b)) {
+					++i;
+					continue;
+				}
+				addToPreheader(preheader, instruction);
+				--loopDefinitions[instruction.def()];
+				instructions.erase(instructions.begin() + i);
+				changed = true;
+			}
+		}
+	}
+}
+
+bool LoopOptimizer::derive(const IrInstruction &instruction, std::map<int, Affine> &affine, Affine &res)
+{
+	IrOperand x = instruction.a, y = instruction.b;
+	if (instruction.type != IrInstruction::I32) {
+		return false;
+	}
+	if (instruction.opcode == IrInstruction::SUB && x.isImmediate() && y.isRegister() && affine.count(y.value)) {
+		// c - x
+		res = affine[y.value];
+		res.scale = -res.scale;
+		res.constant = x.value - res.constant;
+		return res.reg == -1;
+	}
+	bool commutative = instruction.opcode == IrInstruction::ADD || instruction.opcode == IrInstruction::MUL;
+	if (commutative && !(x.isRegister() && affine.count(x.value))) {
+		std::swap(x, y);
+	}
+	if (!x.isRegister() || !affine.count(x.value)) {
+		return false;
+	}
+
+	res = affine[x.value];
+	switch (instruction.opcode) {
+	case IrInstruction::ADD:
+		if (y.isImmediate()) {
+			res.constant += y.value;
+			return true;
+		}
+		if (y.isRegister() && loopDefinitions[y.value] == 0 && res.reg == -1) {
+			res.reg = y.value;
+			return true;
+		}
+		return false;
+	case IrInstruction::SUB:
+		if (!y.isImmediate()) {
+			return false;
+		}
+		res.constant -= y.value;
+		return true;
+	case IrInstruction::MUL:
+		if (!y.isImmediate() || res.reg != -1) {
+			return false;
+		}
+		res.scale *= y.value;
+		res.constant *= y.value;
+		res.multiplied = true;
+		return true;
+	default:
+		return false;
+	}
+}
+
+// a basic induction variable is only changed in the loop by adding a constant to it, a derived one is
+// computed from it by additions and multiplications by constants and additions of invariant registers
+void LoopOptimizer::reduceInductionVariables(const Cfg::Loop &loop, int preheader)
+{
+	std::map<int, Affine> affine;
+	std::map<int, int> steps;
+	for (int block : loop.blocks) {
+		for (auto &instruction : function.blocks[block].instructions) {
+			bool step = (instruction.opcode == IrInstruction::ADD || instruction.opcode == IrInstruction::SUB) &&
+				instruction.type == IrInstruction::I32 && instruction.a == instruction.dst && instruction.b.isImmediate();
+			int def = instruction.def();
+			if (step && loopDefinitions[def] == 1) {
+				steps[def] = instruction.opcode == IrInstruction::ADD ? instruction.b.value : -instruction.b.value;
+				affine[def] = { def, 1, 0, -1, false };
+			}
+		}
+	}
+	if (steps.empty()) {
+		return;
+	}
+
+	for (bool changed = true; changed; ) {
+		changed = false;
+		for (int block : loop.blocks) {
+			for (auto &instruction : function.blocks[block].instructions) {
+				int def = instruction.def();
+				Affine res;
+				if (def == -1 || affine.count(def) || variable[def] || definitions[def] != 1 || !derive(instruction, affine, res)) {
+					continue;
+				}
+				affine[def] = res;
+				changed = true;
+			}
+		}
+	}
+
+	// values used by something else than the computation of other derived values
+	std::vector<int> candidates;
+	for (int block : loop.blocks) {
+		auto &instructions = function.blocks[block].instructions;
+		for (int i = 0; i < instructions.size(); ++i) {
+			int def = instructions[i].def();
+			bool derived = def != -1 && affine.count(def) && !steps.count(def);
+			for (int reg : instructions[i].uses()) {
+				auto it = affine.find(reg);
+				if (it == affine.end() || !it->second.multiplied || it->second.scale == 0 || derived) {
+					continue;
+				}
+				if (std::find(candidates.begin(), candidates.end(), reg) == candidates.end()) {
+					candidates.push_back(reg);
+				}
+			}
+		}
+	}
+
+	// equal values share a register
+	std::map<std::tuple<int, int, int, int>, int> reduced;
+	for (int reg : candidates) {
+		auto &value = affine[reg];
+		auto key = std::make_tuple(value.iv, value.scale, value.constant, value.reg);
+		int pointer;
+		if (reduced.count(key)) {
+			pointer = reduced[key];
+		}
+		else {
+			pointer = function.newRegister();
+			reduced[key] = pointer;
+
+			IrInstruction init(value.scale == 1 ? IrInstruction::MOV : IrInstruction::MUL);
+			init.dst = IrOperand::reg(pointer);
+			init.a = IrOperand::reg(value.iv);
+			if (value.scale != 1) {
+				init.b = IrOperand::immediate(value.scale);
+			}
+			addToPreheader(preheader, init);
+			init = IrInstruction(IrInstruction::ADD);
+			init.dst = init.a = IrOperand::reg(pointer);
+			if (value.constant != 0) {
+				init.b = IrOperand::immediate(value.constant);
+				addToPreheader(preheader, init);
+			}
+			if (value.reg != -1) {
+				init.b = IrOperand::reg(value.reg);
+				addToPreheader(preheader, init);
+			}
+
+			// steps right after the induction variable, so it equals the value everywhere in the loop
+			for (int block : loop.blocks) {
+				auto &instructions = function.blocks[block].instructions;
+				for (int i = 0; i < instructions.size(); ++i) {
+					if (instructions[i].def() == value.iv) {
+						IrInstruction step(IrInstruction::ADD);
+						step.dst = step.a = IrOperand::reg(pointer);
+						step.b = IrOperand::immediate(value.scale * steps[value.iv]);
+						instructions.insert(instructions.begin() + i + 1, step);
+						break;
+					}
+				}
+			}
+		}
+
+		// the old computation becomes a copy, uses up to the next step read the register directly
+		for (int block : loop.blocks) {
+			auto &instructions = function.blocks[block].instructions;
+			for (int i = 0; i < instructions.size(); ++i) {
+				if (instructions[i].def() != reg) {
+					continue;
+				}
+				IrInstruction copy(IrInstruction::MOV);
+				copy.dst = IrOperand::reg(reg);
+				copy.a = IrOperand::reg(pointer);
+				instructions[i] = copy;
+				for (int j = i + 1; j < instructions.size() && instructions[j].def() != pointer; ++j) {
+					for (auto operand : { &instructions[j].a, &instructions[j].b }) {
+						if (*operand == IrOperand::reg(reg)) {
+							*operand = IrOperand::reg(pointer);
+						}
+					}
+				}
+				break;
+			}
+		}
+	}
+}
+
+void LoopOptimizer::removeDeadCode()
+{
+	static const std::set<IrInstruction::Opcode> effects = {
+		IrInstruction::STORE, IrInstruction::WRITE, IrInstruction::READ, IrInstruction::CALL, IrInstruction::RETURN,
+		IrInstruction::JUMP, IrInstruction::BRANCH,
+	};
+
+	variable.assign(function.registerCnt, false);
+	for (auto &it : function.variables) {
+		variable[it.second] = true;
+	}
+	for (bool changed = true; changed; ) {
+		changed = false;
+		std::vector<int> uses(function.registerCnt);
+		for (auto &block : function.blocks) {
+			for (auto &instruction : block.instructions) {
+				for (int reg : instruction.uses()) {
+					++uses[reg];
+				}
+			}
+		}
+		for (auto &block : function.blocks) {
+			auto &instructions = block.instructions;
+			for (int i = (int)instructions.size() - 1; i >= 0; --i) {
+				int def = instructions[i].def();
+				if (effects.count(instructions[i].opcode) || def == -1 || variable[def] || uses[def] != 0) {
+					continue;
+				}
+				instructions.erase(instructions.begin() + i);
+				changed = true;
+			}
+		}
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <map>
+
+#include "Ir.h"
+#include "Cfg.h"
+
+// Moves loop-invariant instructions to the preheaders of loops and replaces values linear in
+// a basic induction variable, like the addresses of array elements, by registers stepped with it.
+// Inner loops go first, so invariants of several nested loops move out one loop at a time.
+class LoopOptimizer {
+public:
+	// the graph is the one of the function, preheaders added to it update it
+	LoopOptimizer(IrFunction &function, Cfg &cfg);
+	void run();
+
+private:
+	// scale * iv + constant + reg, reg is invariant in the loop or -1
+	struct Affine {
+		int iv;
+		int scale;
+		int constant;
+		int reg;
+		bool multiplied;
+	};
+
+	IrFunction &function;
+	Cfg &cfg;
+	// registers of scalar variables, they have several definitions
+	std::vector<bool> variable;
+	// definitions of each register in the whole function
+	std::vector<int> definitions;
+	// definitions of each register in the current loop
+	std::vector<int> loopDefinitions;
+
+	void countDefinitions(const Cfg::Loop &loop);
+	// the single block outside the loop jumping to its header, -1 if there is none
+	int preheader(Cfg &cfg, const Cfg::Loop &loop);
+	// a block jumping to the header, the blocks outside the loop jumping there go to it instead
+	void insertPreheader(int header, const std::vector<int> &outside);
+	bool movable(const IrInstruction &instruction, bool stores);
+	void addToPreheader(int preheader, const IrInstruction &instruction);
+	void hoistInvariants(const Cfg::Loop &loop, int preheader);
+	// value of the register defined by the instruction if it is a derived induction variable
+	bool derive(const IrInstruction &instruction, std::map<int, Affine> &affine, Affine &res);
+	void reduceInductionVariables(const Cfg::Loop &loop, int preheader);
+	void removeDeadCode();
+};
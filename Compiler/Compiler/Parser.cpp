@@ -1,7 +1,18 @@
 #include <functional>
 #include <algorithm>
+#include <climits>
 #include "Parser.h"
 #include "Exceptions.h"
+#include "IrBuilder.h"
+#include "InstructionSelector.h"
+#include "LoopOptimizer.h"
+#include "DeadCodeEliminator.h"
+#include "RangeCheckEliminator.h"
+#include "ValueNumbering.h"
+#include "RegisterAllocator.h"
+#include "Peephole.h"
+#include "Runtime.h"
+#include "Evaluator.h"
 
 Parser::Parser(std::shared_ptr<Tokenizer> tokenizer)
 	: tokenizer(tokenizer), mainProgram(nullptr)
@@ -112,16 +123,14 @@ PSyntaxNode Parser::parseFactor()
 			return std::make_shared<UnaryMinusNode>(token, factor->type, std::initializer_list<PSyntaxNode>({ factor }));
 		}
 
+		// constant nodes are shared between references, fold into a new one
 		auto res = std::static_pointer_cast<ConstNode>(factor);
 		if (res->type->category == Type::DOUBLE) {
-			res->value->setDouble(-res->value->getDouble());
+			return std::make_shared<ConstNode>(std::make_shared<Token>(*res->token), res->type,
+				std::make_shared<IdentifierValue>(-res->value->getDouble()));
 		}
-		else {
-			res->value->setInteger(-res->value->toInteger());
-			res->type = Type::getSimpleType(Type::INTEGER);
-		}
-		res->token->text = res->value->toString();
-		return res;
+		return std::make_shared<ConstNode>(std::make_shared<Token>(*res->token), Type::getSimpleType(Type::INTEGER),
+			std::make_shared<IdentifierValue>(-res->value->toInteger()));
 	}
 	else if (token->type == KEYWORD_NOT) {
 		PSyntaxNode factor = parseFactor();
@@ -133,19 +142,15 @@ PSyntaxNode Parser::parseFactor()
 			return std::make_shared<NotNode>(token, factor->type, std::initializer_list<PSyntaxNode>({ factor }));
 		}
 
+		// bitwise as in the compiled code, comparisons are 0 or -1
 		auto res = std::static_pointer_cast<ConstNode>(factor);
-		res->value->setInteger(!res->value->toInteger());
-		res->token->text = res->value->toString();
-		return res;
+		return std::make_shared<ConstNode>(std::make_shared<Token>(*res->token), res->type,
+			std::make_shared<IdentifierValue>(~res->value->toInteger()));
 	}
 	else if (token->type == IDENTIFIER) {
 		if (instanceOfConstNode(getSymbol(token)->value) && getSymbol(token)->category == Symbol::CONST) {
 			// it can have either simple or complex type
-			PSyntaxNode node = parseIdentifier(token);
-			if (!node->children.empty()) {
-				node = constNodeAccess(node);
-			}
-			return deepCopyNode(node);
+			return constNodeAccess(parseIdentifier(token));
 		}
 		return parseIdentifier(token);
 	}
@@ -183,7 +188,7 @@ PSyntaxNode Parser::parseIdentifier(PToken token)
 	PSymbol symbol = getSymbol(token);
 	PSyntaxNode node;
 	if (symbol->value != nullptr && symbol->category == Symbol::CONST)
-		node = std::make_shared<ConstNode>(token, symbol->type, std::static_pointer_cast<ConstNode>(symbol->value)->value);
+		node = symbol->value;
 	else
 		node = std::make_shared<VarNode>(token, symbol->type);
 
@@ -206,20 +211,28 @@ PSyntaxNode Parser::parseIdentifier(PToken token)
 
 PSyntaxNode Parser::constNodeAccess(PSyntaxNode node)
 {
-	if (node->children.empty()) {
-		return getSymbol(node->token)->value;
+	if (instanceOfConstNode(node)) {
+		return node;
+	}
+
+	// element of a typed constant is picked at compile time only by constant indices
+	auto base = constNodeAccess(node->children[0]);
+	if (!instanceOfConstNode(base)) {
+		return node;
 	}
 	// array
 	else if (node->token->type == SEP_BRACKET_SQUARE_LEFT) {
-		auto arrNode = constNodeAccess(node->children[0]);
-		auto arrType = std::static_pointer_cast<ArrayType>(arrNode->type);
+		if (!instanceOfConstNode(node->children[1])) {
+			return node;
+		}
+		auto arrType = std::static_pointer_cast<ArrayType>(base->type);
 		int idx = std::static_pointer_cast<ConstNode>(node->children[1])->value->toInteger();
-		return arrNode->children[idx - arrType->left->value->toInteger()];
+		return std::static_pointer_cast<TypedConstNode>(base)->element(arrType->elementType,
+			(idx - arrType->left->value->toInteger()) * arrType->elementType->size);
 	}
 	// record
 	else if (node->token->type == SEP_DOT) {
-		auto recNode = constNodeAccess(node->children[0]);
-		auto recType = std::static_pointer_cast<RecordType>(recNode->type);
+		auto recType = std::static_pointer_cast<RecordType>(base->type);
 
 		std::string field = node->children[1]->token->text;
 		int idx;
@@ -228,7 +241,8 @@ PSyntaxNode Parser::constNodeAccess(PSyntaxNode node)
 				break;
 		}
 
-		return recNode->children[idx];
+		return std::static_pointer_cast<TypedConstNode>(base)->element(recType->fields->symbolsArray[idx]->type,
+			recType->fieldOffset(idx));
 	}
 	throw LexicalException(node->token->row, node->token->col, "Illegal expression");
 }
@@ -271,7 +285,8 @@ PType Parser::getOperationType(PType left, PType right, PToken operation)
 		std::set<Type::Category> integers = { Type::Category::INTEGER, Type::Category::CHAR };
 		
 		if (numbers.count(left->category) && numbers.count(right->category)) {
-			if (integers.count(left->category) && integers.count(right->category)) {
+			// division of integers gives a double as well
+			if (integers.count(left->category) && integers.count(right->category) && operation->type != OP_DIVISION) {
 				return Type::getSimpleType(Type::Category::INTEGER);
 			}
 			else {
@@ -298,6 +313,10 @@ PSyntaxNode Parser::cast(PSyntaxNode node, PType to)
 	if (type->category == Type::FUNCTION) {
 		type = std::static_pointer_cast<FunctionType>(node->type)->returnType;
 	}
+	// arrays and records are only passed to parameters of compatible types as they are
+	if (type->category == Type::ARRAY || type->category == Type::RECORD) {
+		return node;
+	}
 
 	bool compatibilityTable[4][4] = {
 		/* --- INT, DBL, CHR, STR */
@@ -324,19 +343,18 @@ PSyntaxNode Parser::castConstNode(PSyntaxNode node, PType to)
 {
 	if (node->type->category != to->category) {
 		auto cur = std::static_pointer_cast<ConstNode>(node);
+		PIdentifierValue value = cur->value;
 		if (to->category == Type::Category::DOUBLE) {
-			cur->value->setDouble((double)cur->value->toInteger());
+			value = std::make_shared<IdentifierValue>((double)cur->value->toInteger());
 		}
 		else if (to->category == Type::Category::INTEGER) {
-			cur->value->setInteger((int)cur->value->toDouble());
+			value = std::make_shared<IdentifierValue>((int)cur->value->toDouble());
 		}
 		else if (to->category == Type::Category::CHAR) {
-			cur->value->setChar((int)cur->value->toDouble());
+			value = std::make_shared<IdentifierValue>((char)cur->value->toDouble());
 		}
 
-		cur->type = Type::getSimpleType(to->category);
-		node->token->text = cur->value->toString();
-		return cur;
+		return std::make_shared<ConstNode>(std::make_shared<Token>(*node->token), Type::getSimpleType(to->category), value);
 	}
 	return node;
 }
@@ -355,20 +373,21 @@ PSyntaxNode Parser::createOperationNode(PSyntaxNode left, PSyntaxNode right, PTo
 		std::set<Type::Category> strings = { Type::CHAR, Type::STRING };
 
 		if (leftIsConst && rightIsConst) {
-			PIdentifierValue value = nullptr;
+			bool holds;
 			auto lNode = std::static_pointer_cast<ConstNode>(left);
 			auto rNode = std::static_pointer_cast<ConstNode>(right);
 
 			if (strings.count(lcat) && strings.count(rcat)) {
-				value = std::make_shared<IdentifierValue>(Operation::evalLogicalOperation<std::string>(lNode->value->getString(), rNode->value->getString(), operation));
+				holds = Operation::evalLogicalOperation<std::string>(lNode->value->getString(), rNode->value->getString(), operation);
 			}
 			else if (lcat == Type::DOUBLE || rcat == Type::DOUBLE) {
-				value = std::make_shared<IdentifierValue>(Operation::evalLogicalOperation<double>(lNode->value->toDouble(), rNode->value->toDouble(), operation));
+				holds = Operation::evalLogicalOperation<double>(lNode->value->toDouble(), rNode->value->toDouble(), operation);
 			}
 			else {
-				value = std::make_shared<IdentifierValue>(Operation::evalLogicalOperation<int>(lNode->value->toInteger(), rNode->value->toInteger(), operation));
+				holds = Operation::evalLogicalOperation<int>(lNode->value->toInteger(), rNode->value->toInteger(), operation);
 			}
-			return std::make_shared<ConstNode>(operation, operationType, value);
+			// comparisons are 0 or -1 as in the compiled code, so that not negates a folded one as well
+			return std::make_shared<ConstNode>(operation, operationType, std::make_shared<IdentifierValue>(holds ? -1 : 0));
 		}
 		else {
 			PType operandsType = getOperationType(left->type, right->type, std::make_shared<Token>(OP_PLUS, 0, 0));
@@ -432,11 +451,191 @@ PType Parser::parse()
 	return mainProgram;
 }
 
-void Parser::toAsmCode(AsmCode &code)
+// names of the variables a tree reads or writes
+static void usedVariables(PSyntaxNode node, std::set<std::string> &names)
+{
+	if (std::dynamic_pointer_cast<VarNode>(node)) {
+		names.insert(lowerString(node->token->text));
+	}
+	for (auto child : node->children) {
+		usedVariables(child, names);
+	}
+}
+
+// variables passed to var parameters, their addresses are taken
+static void addressTakenVariables(PSyntaxNode node, std::set<std::string> &names)
+{
+	auto call = std::dynamic_pointer_cast<FunctionCallNode>(node);
+	for (int i = 0; call != nullptr && call->function != nullptr && i < call->children.size(); ++i) {
+		if (IrBuilder::byReference(call->function->parameters->symbolsArray[i]) && std::dynamic_pointer_cast<VarNode>(call->children[i])) {
+			names.insert(lowerString(call->children[i]->token->text));
+		}
+	}
+	for (auto child : node->children) {
+		addressTakenVariables(child, names);
+	}
+}
+
+static std::set<std::string> declaredNames(std::shared_ptr<FunctionType> routine)
+{
+	std::set<std::string> res;
+	for (auto table : { routine->parameters, routine->declarations }) {
+		for (auto symbol : table->symbolsArray) {
+			res.insert(lowerString(symbol->token->text));
+		}
+	}
+	return res;
+}
+
+// routines declared in the declarations and, at any depth, in those of the routines
+static void routines(PSymbolTable declarations, std::vector<std::shared_ptr<FunctionType>> &res)
+{
+	for (auto symbol : declarations->symbolsArray) {
+		if (symbol->type->category == Type::FUNCTION) {
+			auto routine = std::static_pointer_cast<FunctionType>(symbol->type);
+			routines(routine->declarations, res);
+			res.push_back(routine);
+		}
+	}
+}
+
+void Parser::toIr(AsmCode &code, IrFunction &function)
 {
 	if (mainProgram == nullptr) parse();
-	mainProgram->declarations->toAsmCode(code);
-	mainProgram->body->toAsmCode(code);
+	function.name = programName;
+	IrBuilder builder(function, code);
+	builder.shortCircuit = tokenizer->getDirective("B") == "-";
+	builder.rangeChecks = tokenizer->getDirective("R") == "+";
+
+	// calls may precede the routines they call, variables of the main program used by routines are static
+	std::vector<std::shared_ptr<FunctionType>> nested;
+	routines(mainProgram->declarations, nested);
+	for (auto routine : nested) {
+		code.routineLabels[routine.get()] = code.getLabel(lowerString(routine->name));
+		std::set<std::string> used, own = declaredNames(routine);
+		usedVariables(routine->body, used);
+		for (auto &name : used) {
+			if (!own.count(name)) {
+				builder.shared.insert(name);
+			}
+		}
+	}
+	addressTakenVariables(mainProgram->body, builder.addressTaken);
+	mainProgram->declarations->toIr(builder);
+	// the routines are compiled before the body, so their calls may be inlined
+	routinesToAsmCode(code, mainProgram->declarations, {});
+	mainProgram->body->toIr(builder);
+	builder.finish();
+	inlineCalls(code, function, "");
+	// the passes share the graph of the function
+	Cfg cfg(function);
+	ValueNumbering(function, cfg, code, pure).run();
+	DeadCodeEliminator(function, cfg, code, pure).run();
+	RangeCheckEliminator(function, cfg, pure).run();
+	LoopOptimizer(function, cfg).run();
+}
+
+void Parser::toAsmCode(AsmCode &code)
+{
+	IrFunction function;
+	toIr(code, function);
+	InstructionSelector(code).run(function);
+	Peephole(code).run();
+	RegisterAllocator(code).run();
+	Peephole(code).run();
+	if (code.target == AsmCode::linux64) {
+		Runtime::add(code);
+	}
+	if (tokenizer->getDirective("R") == "+") {
+		Runtime::addRangeError(code);
+	}
+}
+
+void Parser::toBytecode(AsmCode &code, Vm &vm)
+{
+	IrFunction function;
+	this->vm = &vm;
+	toIr(code, function);
+	this->vm = nullptr;
+	vm.add(function, Runtime::main);
+}
+
+void Parser::routinesToAsmCode(AsmCode &code, PSymbolTable declarations, const std::set<std::string> &enclosing)
+{
+	for (auto symbol : declarations->symbolsArray) {
+		if (symbol->type->category != Type::FUNCTION) {
+			continue;
+		}
+		auto routine = std::static_pointer_cast<FunctionType>(symbol->type);
+		std::set<std::string> used, own = declaredNames(routine);
+		usedVariables(routine->body, used);
+		for (auto &name : used) {
+			if (enclosing.count(name) && !own.count(name)) {
+				throw std::exception("Variables of enclosing routines can't be used by nested ones");
+			}
+		}
+		std::set<std::string> inner = enclosing;
+		inner.insert(own.begin(), own.end());
+		routinesToAsmCode(code, routine->declarations, inner);
+
+		code.beginRoutine();
+		IrFunction function(routine->name);
+		std::string label = code.routineLabels.at(routine.get());
+		routineToIr(code, routine, function);
+		if (vm != nullptr) {
+			vm->add(function, label);
+		}
+		else {
+			InstructionSelector(code).run(function);
+			Peephole(code).run();
+			RegisterAllocator(code).run();
+			Peephole(code).run();
+		}
+		code.endRoutine(label);
+	}
+}
+
+void Parser::routineToIr(AsmCode &code, std::shared_ptr<FunctionType> routine, IrFunction &function)
+{
+	if (!Type::simpleCategories.count(routine->returnType->category)) {
+		throw std::exception("Functions returning arrays or records aren't supported");
+	}
+	IrBuilder builder(function, code);
+	builder.shortCircuit = tokenizer->getDirective("B") == "-";
+	builder.rangeChecks = tokenizer->getDirective("R") == "+";
+	addressTakenVariables(routine->body, builder.addressTaken);
+	builder.declareParameters(routine->parameters->symbolsArray);
+	routine->declarations->toIr(builder);
+	routine->body->toIr(builder);
+	builder.finishRoutine(routine->declarations->symbolsMap.at("result"));
+	std::string label = code.routineLabels.at(routine.get());
+	auto locals = inlineCalls(code, function, label);
+	// the passes share the graph of the function
+	Cfg cfg(function);
+	ValueNumbering(function, cfg, code, pure).run();
+	DeadCodeEliminator(function, cfg, code, pure).run();
+	RangeCheckEliminator(function, cfg, pure).run();
+	LoopOptimizer(function, cfg).run();
+	if (DeadCodeEliminator::isPure(function, code, pure)) {
+		pure.insert(label);
+	}
+
+	for (auto table : { routine->parameters, routine->declarations }) {
+		for (auto symbol : table->symbolsArray) {
+			locals[lowerString(symbol->token->text)] = symbol->type;
+		}
+	}
+	inlinable[label] = Inliner::capture(function, code, label, locals);
+}
+
+std::map<std::string, PType> Parser::inlineCalls(AsmCode &code, IrFunction &function, const std::string &label)
+{
+	if (tokenizer->getDirective("INLINE") == "OFF") {
+		return {};
+	}
+	Inliner inliner(function, code, label, inlinable);
+	inliner.run();
+	return inliner.locals;
 }
 
 void Parser::parseProgram()
@@ -512,6 +711,12 @@ PType Parser::parseType()
 	else if (token->type == KEYWORD_RECORD) {
 		return parseRecordType();
 	}
+	else if (token->type == KEYWORD_PACKED) {
+		requireCurrent({ KEYWORD_ARRAY, KEYWORD_RECORD });
+		bool array = (currentTokenType() == KEYWORD_ARRAY);
+		goToNextToken();
+		return array ? parseArrayType(true) : parseRecordType(true);
+	}
 	else if (simpleCategories.count(token->type)) {
 		return Type::getSimpleType(simpleCategories[token->type]);
 	}
@@ -525,7 +730,7 @@ PType Parser::typeAlias(PToken token)
 	return getSymbol(token)->type;
 }
 
-PType Parser::parseArrayType()
+PType Parser::parseArrayType(bool packed)
 {
 	requireThenNext({ SEP_BRACKET_SQUARE_LEFT });
 
@@ -553,39 +758,33 @@ PType Parser::parseArrayType()
 	}
 
 	requireThenNext({ KEYWORD_OF });
-	return std::make_shared<ArrayType>(parseType(), std::static_pointer_cast<ConstNode>(left), std::static_pointer_cast<ConstNode>(right));
+	PType elementType = parseType();
+	// sizes and offsets of variables are ints
+	long long count = (long long)rightConst->value->toInteger() - leftConst->value->toInteger() + 1;
+	if (count * elementType->size > INT_MAX) {
+		throw LexicalException(left->token->row, left->token->col, "Array is too large");
+	}
+	return Type::intern(std::make_shared<ArrayType>(elementType, leftConst, rightConst, packed));
 }
 
-PType Parser::parseRecordType()
+PType Parser::parseRecordType(bool packed)
 {
 	PSymbolTable fields = std::make_shared<SymbolTable>();
+	// bound of the size with the padding any field may need
+	long long size = 0;
 	while (currentTokenType() == IDENTIFIER) {
 		auto list = identifierList();
-		fields->addVariables(list, parseType(), nullptr);
+		PType type = parseType();
+		fields->addVariables(list, type, nullptr);
+		size += ((long long)type->size + type->alignment) * (long long)list.size();
+		if (size > INT_MAX) {
+			throw LexicalException(list[0]->row, list[0]->col, "Record is too large");
+		}
 		requireThenNext({ SEP_SEMICOLON });
 	}
 	requireThenNext({ KEYWORD_END });
-	return std::make_shared<RecordType>(fields);
-}
-
-PSyntaxNode Parser::deepCopyNode(PSyntaxNode node)
-{
-	if (node->category == SyntaxNode::CONST_NODE) {
-		auto res = std::make_shared<ConstNode>(*std::static_pointer_cast<ConstNode>(node));
-		res->token = std::make_shared<Token>(*res->token);
-		res->type = std::make_shared<Type>(*res->type);
-		if (res->value != nullptr) {
-			res->value = std::make_shared<IdentifierValue>(*res->value);
-			res->value->get = res->value->cloneValue();
-		}
-		return res;
-	}
-	else {
-		auto res = PSyntaxNode();
-		res->token = std::make_shared<Token>(*res->token);
-		res->type = std::make_shared<Type>(*res->type);
-		return res;
-	}
+	bool reordered = (tokenizer->getDirective("OPTIMIZATION") == "ORDERFIELDS");
+	return Type::intern(std::make_shared<RecordType>(fields, packed, reordered));
 }
 
 PSyntaxNode Parser::parseConstValue(std::vector<PToken> identifiers, PType type)
@@ -674,57 +873,45 @@ void Parser::requireTypesCompatibility(PType left, PType right)
 	if (right->category == Type::FUNCTION)
 		right = std::static_pointer_cast<FunctionType>(right)->returnType;
 
-	std::vector<std::pair<Type::Category, Type::Category>> pairs = {
-		{ Type::DOUBLE, Type::INTEGER },
-		{ Type::INTEGER, Type::CHAR },
-		{ Type::CHAR, Type::INTEGER },
-		{ Type::STRING, Type::CHAR },
-	};
-
-	auto compatibilityException = LexicalException(currentToken()->row, currentToken()->col,
-		"Incompatible types, expected \"" + left->toString() + "\" but found \"" + right->toString() + "\"");
-
-	if (left->category == Type::ARRAY && right->category == Type::ARRAY) {
-		auto leftArr = std::static_pointer_cast<ArrayType>(left);
-		auto rightArr = std::static_pointer_cast<ArrayType>(right);
-		
-		if (leftArr->left->value->toInteger() != rightArr->left->value->toInteger() ||
-			leftArr->right->value->toInteger() != rightArr->right->value->toInteger())
-		{
-			throw compatibilityException;
-		}
-		requireTypesCompatibility(leftArr->elementType, rightArr->elementType);
+	if (Type::compatible(left, right)) {
 		return;
 	}
 
-	if (left->category == Type::RECORD && right->category == Type::RECORD) {
-		auto leftRec = std::static_pointer_cast<RecordType>(left);
-		auto rightRec = std::static_pointer_cast<RecordType>(right);
-
-		auto leftFields = leftRec->fields->symbolsArray;
-		auto rightFields = rightRec->fields->symbolsArray;
-		
-		if (leftFields.size() != rightFields.size()) {
-			throw compatibilityException;
-		}
-
-		for (int i = 0; i < leftFields.size(); ++i) {
-			if (lowerString(leftFields[i]->token->text) != lowerString(leftFields[i]->token->text)) {
-				throw compatibilityException;
+	// report the innermost pair of types that don't match
+	while (left->category == right->category && (left->category == Type::ARRAY || left->category == Type::RECORD)) {
+		if (left->category == Type::ARRAY) {
+			auto leftArr = std::static_pointer_cast<ArrayType>(left);
+			auto rightArr = std::static_pointer_cast<ArrayType>(right);
+			if (leftArr->packed != rightArr->packed ||
+				leftArr->left->value->toInteger() != rightArr->left->value->toInteger() ||
+				leftArr->right->value->toInteger() != rightArr->right->value->toInteger())
+			{
+				break;
 			}
-			requireTypesCompatibility(leftFields[i]->type, rightFields[i]->type);
+			left = leftArr->elementType;
+			right = rightArr->elementType;
+			continue;
 		}
-		return;
-	}
 
-	bool res = (left->category == right->category);
-	for (auto it : pairs) {
-		res = std::max(res, left->category == it.first && right->category == it.second);
+		auto leftRecord = std::static_pointer_cast<RecordType>(left);
+		auto rightRecord = std::static_pointer_cast<RecordType>(right);
+		auto &leftFields = leftRecord->fields->symbolsArray;
+		auto &rightFields = rightRecord->fields->symbolsArray;
+		if (leftRecord->packed != rightRecord->packed || leftRecord->reordered != rightRecord->reordered ||
+			leftFields.size() != rightFields.size())
+		{
+			break;
+		}
+		int i = 0;
+		while (Type::compatible(leftFields[i]->type, rightFields[i]->type)) {
+			++i;
+		}
+		left = leftFields[i]->type;
+		right = rightFields[i]->type;
 	}
 
-	if (!res) {
-		throw compatibilityException;
-	}
+	throw LexicalException(currentToken()->row, currentToken()->col,
+		"Incompatible types, expected \"" + left->toString() + "\" but found \"" + right->toString() + "\"");
 }
 
 PSyntaxNode Parser::typedConstant(PType type)
@@ -739,26 +926,35 @@ PSyntaxNode Parser::typedConstant(PType type)
 			throw LexicalException(node->token->row, node->token->col, "Illegal expression");
 		}
 	}
+
+	PConstData data = std::make_shared<ConstData>(type->size);
+	typedConstantData(type, *data, 0);
+	return std::make_shared<TypedConstNode>(type, data);
+}
+
+void Parser::typedConstantData(PType type, ConstData &data, int offset)
+{
+	if (Type::simpleCategories.count(type->category)) {
+		data.store(type, offset, std::static_pointer_cast<ConstNode>(typedConstant(type))->value);
+	}
 	else if (type->category == Type::ARRAY) {
 		auto arrayType = std::static_pointer_cast<ArrayType>(type);
-		PSyntaxNode node = std::make_shared<TypedConstNode>(type, "Array");
 		int left = arrayType->left->value->getInteger();
 		int right = arrayType->right->value->getInteger();
+		int elementSize = arrayType->elementType->size;
 		requireThenNext({ SEP_BRACKET_LEFT });
 		
 		for (int i = left; i <= right; ++i) {
-			node->children.push_back(typedConstant(arrayType->elementType));
+			typedConstantData(arrayType->elementType, data, offset + (i - left) * elementSize);
 			if (i < right) {
 				requireThenNext({ SEP_COMMA });
 			}
 		}
 		requireThenNext({ SEP_BRACKET_RIGHT });
-		return node;
 	}
 	else if (type->category == Type::RECORD) {
 		requireThenNext({ SEP_BRACKET_LEFT });
 		auto recordType = std::static_pointer_cast<RecordType>(type);
-		PSyntaxNode node = std::make_shared<TypedConstNode>(type, "Record");
 		
 		for (int i = 0; i < recordType->fields->symbolsArray.size(); ++i) {
 			PToken token = currentToken();
@@ -771,13 +967,12 @@ PSyntaxNode Parser::typedConstant(PType type)
 			}
 
 			requireThenNext({ OP_COLON });
-			node->children.push_back(typedConstant(recordType->fields->symbolsArray[i]->type));
+			typedConstantData(recordType->fields->symbolsArray[i]->type, data, offset + recordType->fieldOffset(i));
 			if (i < (int)recordType->fields->symbolsArray.size() - 1) {
 				requireThenNext({ SEP_SEMICOLON });
 			}
 		}
 		requireThenNext({ SEP_BRACKET_RIGHT });
-		return node;
 	}
 }
 
@@ -971,6 +1166,9 @@ PSyntaxNode Parser::assignStatement()
 
 	requireTypesCompatibility(node->type, expr->type);
 	PSyntaxNode castExpr = cast(expr, node->type);
+	if (instanceOfConstNode(castExpr)) {
+		expr = castExpr;
+	}
 
 	return std::make_shared<AssignStatement>(node->type, std::initializer_list<PSyntaxNode>({ node, expr }));
 }
@@ -1185,7 +1383,14 @@ PSyntaxNode Parser::parseFunctionCall(PSyntaxNode node)
 {
 	auto functionType = std::static_pointer_cast<FunctionType>(node->type);
 	auto children = parameterList(functionType);
-	auto res = std::make_shared<FunctionCallNode>(node->token, functionType->returnType, children);
+	auto res = std::make_shared<FunctionCallNode>(node->token, functionType->returnType, children, functionType);
+	// calls of side-effect free functions with constant arguments are evaluated like operations on constants
+	if (std::all_of(children.begin(), children.end(), [this](PSyntaxNode child) { return instanceOfConstNode(child); })) {
+		auto value = Evaluator().evaluate(functionType, children);
+		if (value != nullptr) {
+			return std::make_shared<ConstNode>(std::make_shared<Token>(*node->token), functionType->returnType, value);
+		}
+	}
 	if (res->type->category == Type::ARRAY) {
 		return indexedVariable(res, res->token);
 	}
@@ -5,12 +5,19 @@
 #include "SymbolTable.h"
 #include "Operation.h"
 #include "Generator.h"
+#include "Ir.h"
+#include "Inliner.h"
+#include "Vm.h"
 
 class Parser {
 public:
 	Parser(std::shared_ptr<Tokenizer> tokenizer);
 	PType parse();
+	// lowers the main program, variables in memory are allocated in the code
+	void toIr(AsmCode &code, IrFunction &function);
 	void toAsmCode(AsmCode &code);
+	// lowers the program and its routines to the bytecode of the VM instead of machine code
+	void toBytecode(AsmCode &code, Vm &vm);
 
 private:
 	std::shared_ptr<Tokenizer> tokenizer;
@@ -18,6 +25,18 @@ private:
 	std::vector<PSymbolTable> tables;
 	std::shared_ptr<FunctionType> mainProgram;
 	int loopCnt = 0;
+	// IR of the compiled routines by their labels, calls of later routines may be replaced by it
+	std::map<std::string, Inliner::Routine> inlinable;
+	// labels of the compiled routines without side effects, their calls are dropped when the results aren't used
+	std::set<std::string> pure;
+	// the routines are added to it instead of being compiled to commands while it is set
+	Vm *vm = nullptr;
+
+	// compiles the routines in the declarations, inner ones first, enclosing are the variables of the routines around them
+	void routinesToAsmCode(AsmCode &code, PSymbolTable declarations, const std::set<std::string> &enclosing);
+	void routineToIr(AsmCode &code, std::shared_ptr<FunctionType> routine, IrFunction &function);
+	// inlining is disabled by {$INLINE OFF}, returns the frame variables of the inlined copies
+	std::map<std::string, PType> inlineCalls(AsmCode &code, IrFunction &function, const std::string &label);
 
 	void goToNextToken();
 	PToken currentToken();
@@ -49,10 +68,9 @@ private:
 	PType parseType();
 	PType typeAlias(PToken token);
 
-	PType parseArrayType();
-	PType parseRecordType();
+	PType parseArrayType(bool packed = false);
+	PType parseRecordType(bool packed = false);
 
-	PSyntaxNode deepCopyNode(PSyntaxNode node);
 	PSyntaxNode parseConstValue(std::vector<PToken> identifiers, PType type);
 	void variableDeclarationPart();
 	std::vector<PToken> identifierList();
@@ -61,6 +79,7 @@ private:
 	void constDeclarationPart();
 	void requireTypesCompatibility(PType left, PType right);
 	PSyntaxNode typedConstant(PType type);
+	void typedConstantData(PType type, ConstData &data, int offset);
 
 	enum functionDeclarationCategory {
 		FUNCTION,
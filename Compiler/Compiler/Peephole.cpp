@@ -0,0 +1,281 @@
+#include <algorithm>
+#include "Peephole.h"
+
+static bool isMemory(std::shared_ptr<AsmParameter> par)
+{
+	if (auto reg = std::dynamic_pointer_cast<AsmRegister>(par)) {
+		return reg->full;
+	}
+	return std::dynamic_pointer_cast<AsmValue>(par) == nullptr;
+}
+
+static bool isImmediate(std::shared_ptr<AsmParameter> par)
+{
+	auto value = std::dynamic_pointer_cast<AsmValue>(par);
+	if (value == nullptr || value->value.empty()) {
+		return false;
+	}
+	char c = value->value[0];
+	return isdigit(c) || c == '-' || c == '\'';
+}
+
+static bool isLabel(std::shared_ptr<AsmParameter> par)
+{
+	auto value = std::dynamic_pointer_cast<AsmValue>(par);
+	return value != nullptr && !value->value.empty() && value->value[0] == '$';
+}
+
+// x86 allows at most one memory operand
+static bool notBothMemory(Peephole::Bindings &bindings)
+{
+	return !isMemory(bindings["A"]) || !isMemory(bindings["B"]);
+}
+
+static bool registerOperand(Peephole::Bindings &bindings)
+{
+	return !isMemory(bindings["A"]) && !isImmediate(bindings["A"]);
+}
+
+static bool firstOperandAllowed(Peephole::Bindings &bindings)
+{
+	return !isImmediate(bindings["A"]) && notBothMemory(bindings);
+}
+
+// the moved value doesn't depend on the register written in between
+static bool notOverwritten(Peephole::Bindings &bindings)
+{
+	return notBothMemory(bindings) && bindings["A"]->toString().find(bindings["B"]->toString()) == std::string::npos;
+}
+
+// the overwritten register isn't read by the second move
+static bool notReadAgain(Peephole::Bindings &bindings)
+{
+	return bindings["B"]->toString().find(bindings["%R"]->toString()) == std::string::npos;
+}
+
+const std::vector<Peephole::Rule> Peephole::rules = {
+	{ "dead register", { "mov ~T, A" }, {}, nullptr },
+	{ "dead register", { "movsd ~T, A" }, {}, nullptr },
+	{ "immediate folding", { "mov ~T, #N", "add|sub|imul|and|or|xor|cmp|mov B, ~T" }, { "* B, #N" }, nullptr },
+	{ "immediate folding", { "mov ~T, #N", "printf F, ~T" }, { "printf F, #N" }, nullptr },
+	{ "copy forwarding", { "mov ~T, A", "add|sub|imul|and|or|xor|cmp|mov B, ~T" }, { "* B, A" }, notBothMemory },
+	{ "copy forwarding", { "mov ~T, A", "printf F, ~T" }, { "printf F, A" }, nullptr },
+	{ "copy forwarding", { "mov ~T, A", "mov B, C", "add|sub|imul|and|or|xor B, ~T" }, { "mov B, C", "* B, A" }, notOverwritten },
+	{ "copy forwarding", { "mov ~T, A", "cmp ~T, B" }, { "cmp A, B" }, firstOperandAllowed },
+	{ "copy forwarding", { "mov ~T, A", "test ~T, ~T" }, { "test A, A" }, registerOperand },
+	{ "copy forwarding", { "movsd ~T, A", "addsd|subsd|mulsd|divsd|ucomisd|movsd B, ~T" }, { "* B, A" }, notBothMemory },
+	{ "copy forwarding", { "movsd ~T, A", "movsd B, C", "addsd|subsd|mulsd|divsd B, ~T" }, { "movsd B, C", "* B, A" }, notOverwritten },
+	{ "operation in place", { "mov ~T, A", "add|sub|and|or|xor ~T, B", "mov A, ~T" }, { "* A, B" }, notBothMemory },
+	{ "operation in place", { "mov ~T, A", "imul ~T, B", "mov A, ~T" }, { "imul A, B" }, registerOperand },
+	{ "operation in place", { "mov ~T, A", "neg|not|inc|dec ~T", "mov A, ~T" }, { "* A" }, nullptr },
+	{ "operation in place", { "movsd ~T, A", "addsd|subsd|mulsd|divsd ~T, B", "movsd A, ~T" }, { "* A, B" }, registerOperand },
+	{ "increment", { "add A, 1" }, { "inc A" }, nullptr },
+	{ "increment", { "sub A, 1" }, { "dec A" }, nullptr },
+	{ "cancelling", { "inc A", "dec A" }, {}, nullptr },
+	{ "cancelling", { "dec A", "inc A" }, {}, nullptr },
+	{ "push/pop", { "push A", "pop A" }, {}, nullptr },
+	{ "push/pop forwarding", { "push A", "pop B" }, { "mov B, A" }, notBothMemory },
+	{ "self move", { "mov %R, %R" }, {}, nullptr },
+	{ "self move", { "movsd|movapd|movdqa %R, %R" }, {}, nullptr },
+	{ "dead move", { "mov %R, A", "mov %R, B" }, { "mov %R, B" }, notReadAgain },
+	{ "branch to next", { "jmp @L", "@L:" }, { "@L:" }, nullptr },
+	{ "branch to next", { "jmp @L", "@M:", "@L:" }, { "@M:", "@L:" }, nullptr },
+	{ "inverted branch", { "jz @L", "jmp @M", "@L:" }, { "jnz @M", "@L:" }, nullptr },
+	{ "inverted branch", { "jnz @L", "jmp @M", "@L:" }, { "jz @M", "@L:" }, nullptr },
+};
+
+Peephole::Peephole(AsmCode &code)
+	: code(code)
+{
+	for (auto &rule : rules) {
+		CompiledRule it;
+		it.rule = &rule;
+		for (auto &line : rule.pattern) {
+			it.pattern.push_back(parseLine(line, false));
+		}
+		for (auto &line : rule.replacement) {
+			it.replacement.push_back(parseLine(line, true));
+		}
+		compiled.push_back(it);
+	}
+}
+
+Peephole::Line Peephole::parseLine(const std::string &text, bool replacement)
+{
+	Line line;
+	line.label = text.back() == ':';
+	if (line.label) {
+		line.operands.push_back(text.substr(0, text.length() - 1));
+		return line;
+	}
+
+	size_t space = text.find(' ');
+	std::string commands = text.substr(0, space);
+	if (!(replacement && commands == "*")) {
+		for (size_t start = 0, end; start <= commands.length(); start = end + 1) {
+			end = std::min(commands.find('|', start), commands.length());
+			line.commands.push_back(AsmCommand::commandByName(commands.substr(start, end - start)));
+		}
+	}
+	if (space == std::string::npos) {
+		return line;
+	}
+	for (size_t start = space + 1, end; start <= text.length(); start = end + 2) {
+		end = std::min(text.find(", ", start), text.length());
+		line.operands.push_back(text.substr(start, end - start));
+	}
+	return line;
+}
+
+void Peephole::run()
+{
+	int longest = 0;
+	for (auto &rule : compiled) {
+		longest = std::max(longest, (int)rule.pattern.size());
+	}
+
+	// counts only decrease after a rewrite, so stale ones just make ~T match less often until the next sweep
+	for (bool changed = true; changed; ) {
+		changed = false;
+		countOccurrences();
+		for (int i = 0; i < code.commands.size(); ) {
+			bool fired = false;
+			for (auto &rule : compiled) {
+				Bindings bindings;
+				AsmCommand::CommandType matched = AsmCommand::label;
+				if (!match(rule, i, bindings, matched)) {
+					continue;
+				}
+				auto replacement = build(rule, bindings, matched);
+				code.commands.erase(code.commands.begin() + i, code.commands.begin() + i + rule.pattern.size());
+				code.commands.insert(code.commands.begin() + i, replacement.begin(), replacement.end());
+				++code.peepholeCounts[rule.rule->name];
+				fired = changed = true;
+				break;
+			}
+			// the rewritten commands may complete a pattern starting a bit earlier
+			i = fired ? std::max(0, i - longest + 1) : i + 1;
+		}
+	}
+}
+
+void Peephole::countOccurrences()
+{
+	occurrences.assign(code.registerCnt, 0);
+	for (auto &command : code.commands) {
+		for (auto &par : command.parameters) {
+			auto reg = std::dynamic_pointer_cast<AsmRegister>(par);
+			if (reg != nullptr && reg->isVirtual()) {
+				++occurrences[reg->index];
+			}
+		}
+	}
+}
+
+bool Peephole::match(CompiledRule &rule, int position, Bindings &bindings, AsmCommand::CommandType &matched)
+{
+	if (position + rule.pattern.size() > code.commands.size()) {
+		return false;
+	}
+	for (int k = 0; k < rule.pattern.size(); ++k) {
+		auto &line = rule.pattern[k];
+		auto &command = code.commands[position + k];
+		if (line.label) {
+			if (command.commandType != AsmCommand::label) {
+				return false;
+			}
+		}
+		else if (std::find(line.commands.begin(), line.commands.end(), command.commandType) == line.commands.end()) {
+			return false;
+		}
+		else if (line.commands.size() > 1) {
+			matched = command.commandType;
+		}
+
+		if (command.parameters.size() != line.operands.size()) {
+			return false;
+		}
+		for (int j = 0; j < line.operands.size(); ++j) {
+			if (!matchOperand(line.operands[j], command.parameters[j], bindings)) {
+				return false;
+			}
+		}
+	}
+	if (!windowLocal(bindings, position, (int)rule.pattern.size())) {
+		return false;
+	}
+	return rule.rule->condition == nullptr || rule.rule->condition(bindings);
+}
+
+bool Peephole::matchOperand(const std::string &pattern, std::shared_ptr<AsmParameter> par, Bindings &bindings)
+{
+	auto reg = std::dynamic_pointer_cast<AsmRegister>(par);
+	switch (pattern[0]) {
+	case '%':
+		if (reg == nullptr || reg->full) return false;
+		break;
+	case '#':
+		if (!isImmediate(par)) return false;
+		break;
+	case '@':
+		if (!isLabel(par)) return false;
+		break;
+	case '~':
+		if (reg == nullptr || reg->full || !reg->isVirtual()) return false;
+		break;
+	default:
+		if (!isupper(pattern[0])) {
+			return par->toString() == pattern;
+		}
+	}
+
+	auto it = bindings.find(pattern);
+	if (it != bindings.end()) {
+		return it->second->toString() == par->toString();
+	}
+	bindings[pattern] = par;
+	return true;
+}
+
+// every occurrence of a ~T register is inside the window and none of the other operands refers to it,
+// so it disappears with the matched commands
+bool Peephole::windowLocal(Bindings &bindings, int position, int length)
+{
+	for (auto &it : bindings) {
+		if (it.first[0] != '~') {
+			continue;
+		}
+		int index = std::static_pointer_cast<AsmRegister>(it.second)->index;
+		int count = 0;
+		for (int k = position; k < position + length; ++k) {
+			for (auto &par : code.commands[k].parameters) {
+				auto reg = std::dynamic_pointer_cast<AsmRegister>(par);
+				count += reg != nullptr && reg->index == index;
+			}
+		}
+		if (count != occurrences[index]) {
+			return false;
+		}
+		for (auto &other : bindings) {
+			auto reg = std::dynamic_pointer_cast<AsmRegister>(other.second);
+			if (other.first[0] != '~' && reg != nullptr && reg->index == index) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+std::vector<AsmCommand> Peephole::build(CompiledRule &rule, Bindings &bindings, AsmCommand::CommandType matched)
+{
+	std::vector<AsmCommand> result;
+	for (auto &line : rule.replacement) {
+		AsmCommand command(line.label ? AsmCommand::label : (line.commands.empty() ? matched : line.commands[0]));
+		for (auto &operand : line.operands) {
+			auto it = bindings.find(operand);
+			command.push_back(it != bindings.end() ? it->second : std::make_shared<AsmValue>(operand));
+		}
+		result.push_back(command);
+	}
+	return result;
+}
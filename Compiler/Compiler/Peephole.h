@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+
+#include "Generator.h"
+
+// Rewrites short sequences of commands by the rules of a pattern table.
+// A pattern line is a command (alternatives separated by '|') or a label "@L:",
+// its operands are literals or variables bound to the operands of the command:
+//   A    any operand, repeated names must be equal
+//   %R   register
+//   #N   immediate value
+//   @L   label
+//   ~T   virtual register used only inside the matched commands
+// In a replacement '*' stands for the command matched by an alternative.
+class Peephole {
+public:
+	typedef std::map<std::string, std::shared_ptr<AsmParameter>> Bindings;
+
+	struct Rule {
+		std::string name;
+		std::vector<std::string> pattern;
+		std::vector<std::string> replacement;
+		// additional check of the bound operands
+		bool (*condition)(Bindings &bindings);
+	};
+
+	static const std::vector<Rule> rules;
+
+	Peephole(AsmCode &code);
+	// applies the rules until none of them matches, firing counts are added to code.peepholeCounts
+	void run();
+
+private:
+	struct Line {
+		bool label;
+		std::vector<AsmCommand::CommandType> commands;
+		std::vector<std::string> operands;
+	};
+
+	struct CompiledRule {
+		const Rule *rule;
+		std::vector<Line> pattern, replacement;
+	};
+
+	AsmCode &code;
+	std::vector<CompiledRule> compiled;
+	// occurrences of each virtual register in the whole code
+	std::vector<int> occurrences;
+
+	static Line parseLine(const std::string &line, bool replacement);
+	void countOccurrences();
+	bool match(CompiledRule &rule, int position, Bindings &bindings, AsmCommand::CommandType &matched);
+	bool matchOperand(const std::string &pattern, std::shared_ptr<AsmParameter> par, Bindings &bindings);
+	bool windowLocal(Bindings &bindings, int position, int length);
+	std::vector<AsmCommand> build(CompiledRule &rule, Bindings &bindings, AsmCommand::CommandType matched);
+};
@@ -0,0 +1,507 @@
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include "RangeCheckEliminator.h"
+
+static const long long minInt = INT_MIN, maxInt = INT_MAX;
+
+RangeCheckEliminator::RangeCheckEliminator(IrFunction &function, Cfg &cfg, const std::set<std::string> &pure)
+	: function(function), cfg(cfg), pure(pure)
+{
+}
+
+void RangeCheckEliminator::run()
+{
+	bool checks = false;
+	for (auto &block : function.blocks) {
+		for (auto &instruction : block.instructions) {
+			checks |= instruction.opcode == IrInstruction::CHECK;
+		}
+	}
+	if (!checks) {
+		return;
+	}
+	// checks moved before a loop may be redundant there or be moved out of the loop around it
+	removeRedundant();
+	while (hoist()) {
+		removeRedundant();
+	}
+}
+
+void RangeCheckEliminator::analyze()
+{
+	int n = (int)function.blocks.size();
+	std::vector<int> position(n);
+	for (int i = 0; i < cfg.order.size(); ++i) {
+		position[cfg.order[i]] = i;
+	}
+	auto start = [this](std::vector<State> &states, std::vector<bool> &flags) {
+		states.assign(function.blocks.size(), State());
+		flags.assign(function.blocks.size(), false);
+		states[0].assign(function.registerCnt, { minInt, maxInt });
+		flags[0] = true;
+	};
+	// states on the edges leaving the block
+	auto successors = [this](int block) {
+		std::vector<std::pair<int, State>> res;
+		State state = in[block];
+		auto &instructions = function.blocks[block].instructions;
+		for (auto &instruction : instructions) {
+			transfer(instruction, state);
+		}
+		auto targets = function.blocks[block].successors();
+		for (int i = 0; i < targets.size(); ++i) {
+			State taken = state;
+			if ((i == 0 || targets[i] != targets[0]) && edge(instructions.back(), targets[i], taken)) {
+				res.push_back({ targets[i], taken });
+			}
+		}
+		return res;
+	};
+
+	// a range growing along an edge back in the order grows to the end, so the ranges stop changing
+	start(in, reached);
+	for (bool changed = true; changed; ) {
+		changed = false;
+		for (int block : cfg.order) {
+			if (!reached[block]) {
+				continue;
+			}
+			for (auto &it : successors(block)) {
+				int target = it.first;
+				bool widen = position[target] <= position[block];
+				if (!reached[target]) {
+					in[target] = it.second;
+					reached[target] = true;
+					changed = true;
+					continue;
+				}
+				for (int reg = 0; reg < function.registerCnt; ++reg) {
+					auto &old = in[target][reg];
+					auto &value = it.second[reg];
+					if (value.low < old.low) {
+						old.low = widen ? minInt : value.low;
+						changed = true;
+					}
+					if (value.high > old.high) {
+						old.high = widen ? maxInt : value.high;
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+
+	// the widened ranges are narrowed by recomputing the states from those of the predecessors
+	for (int pass = 0; pass < 2; ++pass) {
+		std::vector<State> next;
+		std::vector<bool> nextReached;
+		start(next, nextReached);
+		for (int block : cfg.order) {
+			if (!reached[block]) {
+				continue;
+			}
+			for (auto &it : successors(block)) {
+				int target = it.first;
+				if (!nextReached[target]) {
+					next[target] = it.second;
+					nextReached[target] = true;
+					continue;
+				}
+				for (int reg = 0; reg < function.registerCnt; ++reg) {
+					auto &old = next[target][reg];
+					old.low = std::min(old.low, it.second[reg].low);
+					old.high = std::max(old.high, it.second[reg].high);
+				}
+			}
+		}
+		in = next;
+		reached = nextReached;
+	}
+}
+
+void RangeCheckEliminator::transfer(const IrInstruction &instruction, State &state)
+{
+	if (instruction.opcode == IrInstruction::CHECK) {
+		// the code after a check runs only with the index in the bounds
+		if (instruction.a.isRegister()) {
+			auto &index = state[instruction.a.value];
+			index.low = std::max(index.low, 0LL);
+			index.high = std::min(index.high, (long long)instruction.b.value);
+			if (index.low > index.high) {
+				index = { 0, instruction.b.value };
+			}
+		}
+		return;
+	}
+	int def = instruction.def();
+	if (def == -1) {
+		return;
+	}
+
+	Range a = range(instruction.a, state), b = range(instruction.b, state), res = { minInt, maxInt };
+	if (instruction.type == IrInstruction::I32 || instruction.type == IrInstruction::I8) {
+		switch (instruction.opcode) {
+		case IrInstruction::MOV:
+			res = a;
+			break;
+		case IrInstruction::ADD:
+			res = { a.low + b.low, a.high + b.high };
+			break;
+		case IrInstruction::SUB:
+			res = { a.low - b.high, a.high - b.low };
+			break;
+		case IrInstruction::MUL: {
+			long long products[] = { a.low * b.low, a.low * b.high, a.high * b.low, a.high * b.high };
+			res = { *std::min_element(products, products + 4), *std::max_element(products, products + 4) };
+			break;
+		}
+		case IrInstruction::NEG:
+			res = { -a.high, -a.low };
+			break;
+		case IrInstruction::AND:
+			// the bits of a value that isn't negative
+			if (a.low >= 0 || b.low >= 0) {
+				res = { 0, std::min(a.low >= 0 ? a.high : maxInt, b.low >= 0 ? b.high : maxInt) };
+			}
+			break;
+		case IrInstruction::DIV:
+			if (b.low == b.high && b.low > 0) {
+				res = { a.low / b.low, a.high / b.low };
+			}
+			break;
+		case IrInstruction::MOD:
+			// the remainder has the sign of the dividend
+			if (b.low == b.high && b.low != 0) {
+				long long largest = std::abs(b.low) - 1;
+				res = { a.low >= 0 ? 0 : std::max(a.low, -largest), a.high <= 0 ? 0 : std::min(a.high, largest) };
+			}
+			break;
+		case IrInstruction::SET:
+			res = { -1, 0 };
+			break;
+		case IrInstruction::MIN:
+			res = { std::min(a.low, b.low), std::min(a.high, b.high) };
+			break;
+		case IrInstruction::MAX:
+			res = { std::max(a.low, b.low), std::max(a.high, b.high) };
+			break;
+		case IrInstruction::LOAD:
+			if (instruction.type == IrInstruction::I8) {
+				res = { 0, 255 };
+			}
+			break;
+		}
+	}
+	// a result out of the int wraps around
+	if (res.low < minInt || res.high > maxInt) {
+		res = { minInt, maxInt };
+	}
+	state[def] = res;
+}
+
+bool RangeCheckEliminator::edge(const IrInstruction &branch, int target, State &state)
+{
+	if (branch.opcode != IrInstruction::BRANCH || branch.targets[0] == branch.targets[1] || branch.type == IrInstruction::F64) {
+		return true;
+	}
+	auto condition = target == branch.targets[0] ? branch.condition : IrInstruction::inverse(branch.condition);
+	Range a = range(branch.a, state), b = range(branch.b, state);
+	switch (condition) {
+	case IrInstruction::EQ:
+		a.low = b.low = std::max(a.low, b.low);
+		a.high = b.high = std::min(a.high, b.high);
+		break;
+	case IrInstruction::NE: {
+		// a value differing from a constant at an end of the range of the other one
+		Range oldA = a;
+		if (b.low == b.high) {
+			a.low += a.low == b.low;
+			a.high -= a.high == b.low;
+		}
+		if (oldA.low == oldA.high) {
+			b.low += b.low == oldA.low;
+			b.high -= b.high == oldA.low;
+		}
+		break;
+	}
+	case IrInstruction::LT:
+		a.high = std::min(a.high, b.high - 1);
+		b.low = std::max(b.low, a.low + 1);
+		break;
+	case IrInstruction::LE:
+		a.high = std::min(a.high, b.high);
+		b.low = std::max(b.low, a.low);
+		break;
+	case IrInstruction::GT:
+		a.low = std::max(a.low, b.low + 1);
+		b.high = std::min(b.high, a.high - 1);
+		break;
+	case IrInstruction::GE:
+		a.low = std::max(a.low, b.low);
+		b.high = std::min(b.high, a.high);
+		break;
+	}
+	if (a.low > a.high || b.low > b.high) {
+		return false;
+	}
+	if (branch.a.isRegister()) {
+		state[branch.a.value] = a;
+	}
+	if (branch.b.isRegister()) {
+		state[branch.b.value] = b;
+	}
+	return true;
+}
+
+RangeCheckEliminator::Range RangeCheckEliminator::range(const IrOperand &operand, const State &state)
+{
+	if (operand.isRegister()) {
+		return state[operand.value];
+	}
+	if (operand.isImmediate()) {
+		return { operand.value, operand.value };
+	}
+	return { minInt, maxInt };
+}
+
+void RangeCheckEliminator::removeRedundant()
+{
+	analyze();
+	for (auto &block : function.blocks) {
+		if (!reached[block.id]) {
+			continue;
+		}
+		State state = in[block.id];
+		auto &instructions = block.instructions;
+		for (int i = 0; i < instructions.size(); ) {
+			auto &instruction = instructions[i];
+			if (instruction.opcode == IrInstruction::CHECK) {
+				Range index = range(instruction.a, state);
+				if (index.low >= 0 && index.high <= instruction.b.value) {
+					instructions.erase(instructions.begin() + i);
+					continue;
+				}
+			}
+			transfer(instruction, state);
+			++i;
+		}
+	}
+}
+
+bool RangeCheckEliminator::hoist()
+{
+	analyze();
+	variable.assign(function.registerCnt, false);
+	for (auto &it : function.variables) {
+		variable[it.second] = true;
+	}
+	definitions.assign(function.registerCnt, 0);
+	definition.assign(function.registerCnt, nullptr);
+	for (auto &block : function.blocks) {
+		for (auto &instruction : block.instructions) {
+			if (instruction.def() != -1) {
+				++definitions[instruction.def()];
+				definition[instruction.def()] = &instruction;
+			}
+		}
+	}
+
+	for (auto &loop : cfg.loops) {
+		auto &test = function.blocks[loop.header].instructions;
+		if (test.empty() || test.back().opcode != IrInstruction::BRANCH || test.back().type != IrInstruction::I32) {
+			continue;
+		}
+		auto branch = test.back();
+		if (loop.contains[branch.targets[0]] == loop.contains[branch.targets[1]]) {
+			continue;
+		}
+		// an error may only be reported earlier if nothing is written or read before it
+		bool exits = false, effects = false;
+		for (int block : loop.blocks) {
+			for (int successor : cfg.successors[block]) {
+				exits |= block != loop.header && !loop.contains[successor];
+			}
+			for (auto &instruction : function.blocks[block].instructions) {
+				effects |= instruction.opcode == IrInstruction::WRITE || instruction.opcode == IrInstruction::READ ||
+					(instruction.opcode == IrInstruction::CALL && !pure.count(instruction.a.name));
+			}
+		}
+		auto condition = loop.contains[branch.targets[0]] ? branch.condition : IrInstruction::inverse(branch.condition);
+		if (exits || effects || !branch.a.isRegister() || (condition != IrInstruction::LE && condition != IrInstruction::GE)) {
+			continue;
+		}
+
+		int counter = branch.a.value;
+		loopDefinitions.assign(function.registerCnt, 0);
+		int stepBlock = -1, stepPosition = -1;
+		for (int block : loop.blocks) {
+			auto &instructions = function.blocks[block].instructions;
+			for (int i = 0; i < instructions.size(); ++i) {
+				int def = instructions[i].def();
+				if (def == -1) {
+					continue;
+				}
+				++loopDefinitions[def];
+				if (def == counter) {
+					stepBlock = block;
+					stepPosition = i;
+				}
+			}
+		}
+		if ((branch.b.isRegister() && loopDefinitions[branch.b.value] != 0) || loopDefinitions[counter] != 1) {
+			continue;
+		}
+		// the counter goes towards the bound by 1 once an iteration, in no loop nested in this one
+		auto &step = function.blocks[stepBlock].instructions[stepPosition];
+		int delta = step.opcode == IrInstruction::ADD ? 1 : step.opcode == IrInstruction::SUB ? -1 : 0;
+		if (step.a != IrOperand::reg(counter) || !step.b.isImmediate() || delta * step.b.value != (condition == IrInstruction::LE ? 1 : -1)) {
+			continue;
+		}
+		bool nested = false;
+		for (auto &other : cfg.loops) {
+			nested |= other.header != loop.header && loop.contains[other.header] && other.contains[stepBlock];
+		}
+		int preheader = -1, outside = 0;
+		for (int pred : cfg.predecessors[loop.header]) {
+			if (!loop.contains[pred]) {
+				preheader = pred;
+				++outside;
+			}
+		}
+		// a loop that never runs keeps its checks, its preheader has no state to test the bounds in
+		if (nested || outside != 1 || !reached[preheader] || function.blocks[preheader].instructions.back().opcode != IrInstruction::JUMP) {
+			continue;
+		}
+
+		// checks run in every iteration with the counter it started with, the header also runs after the last one
+		std::vector<Hoisted> checks;
+		for (int block : loop.blocks) {
+			auto &instructions = function.blocks[block].instructions;
+			for (int i = 0; i < instructions.size(); ++i) {
+				auto &instruction = instructions[i];
+				if (instruction.opcode != IrInstruction::CHECK || block == loop.header || instruction.b.value >= (1 << 30) ||
+					!cfg.dominates(block, stepBlock) || (block == stepBlock && i > stepPosition))
+				{
+					continue;
+				}
+				Hoisted check;
+				if (affine(instruction.a, counter, check)) {
+					check.block = block;
+					check.position = i;
+					check.last = instruction.b.value;
+					checks.push_back(check);
+				}
+			}
+		}
+		if (checks.empty()) {
+			continue;
+		}
+
+		// the first and the last index of a counter are checked, the others are between them
+		std::vector<IrInstruction> moved;
+		std::set<std::vector<int>> seen;
+		for (auto &check : checks) {
+			std::vector<IrOperand> roots = { IrOperand::reg(check.root) };
+			if (check.root == counter) {
+				roots.push_back(branch.b);
+			}
+			for (auto &root : roots) {
+				if (!seen.insert({ root.kind, root.value, check.scale, check.constant, check.last }).second) {
+					continue;
+				}
+				IrOperand index = root;
+				if (root.isImmediate()) {
+					index = IrOperand::immediate((int)((long long)check.scale * root.value + check.constant));
+				}
+				else if (check.scale == -1 || check.constant != 0) {
+					IrInstruction value(check.scale == -1 ? IrInstruction::SUB : IrInstruction::ADD);
+					value.dst = IrOperand::reg(function.newRegister());
+					value.a = check.scale == -1 ? IrOperand::immediate(check.constant) : root;
+					value.b = check.scale == -1 ? root : IrOperand::immediate(check.constant);
+					moved.push_back(value);
+					index = value.dst;
+				}
+				IrInstruction moving(IrInstruction::CHECK);
+				moving.a = index;
+				moving.b = IrOperand::immediate(check.last);
+				moved.push_back(moving);
+			}
+		}
+		for (auto it = checks.rbegin(); it != checks.rend(); ++it) {
+			auto &instructions = function.blocks[it->block].instructions;
+			instructions.erase(instructions.begin() + it->position);
+		}
+
+		// the checks run only if the loop does, unless it always does
+		State state = in[preheader];
+		for (auto &instruction : function.blocks[preheader].instructions) {
+			transfer(instruction, state);
+		}
+		Range first = range(IrOperand::reg(counter), state), last = range(branch.b, state);
+		if (condition == IrInstruction::LE ? first.high <= last.low : first.low >= last.high) {
+			auto &instructions = function.blocks[preheader].instructions;
+			instructions.insert(instructions.end() - 1, moved.begin(), moved.end());
+			return true;
+		}
+		int block = function.insertBlock(preheader + 1, "RANGE_CHECKS");
+		int header = loop.header >= block ? loop.header + 1 : loop.header;
+		IrInstruction guard(IrInstruction::BRANCH);
+		guard.condition = condition;
+		guard.a = IrOperand::reg(counter);
+		guard.b = branch.b;
+		guard.targets = { block, header };
+		function.blocks[preheader].instructions.back() = guard;
+		IrInstruction jump(IrInstruction::JUMP);
+		jump.targets = { header };
+		moved.push_back(jump);
+		function.blocks[block].instructions = moved;
+		cfg.update();
+		return true;
+	}
+	return false;
+}
+
+bool RangeCheckEliminator::affine(const IrOperand &index, int counter, Hoisted &res)
+{
+	if (!index.isRegister()) {
+		return false;
+	}
+	// values computed in the loop are computed again before it from the root
+	int reg = index.value, scale = 1;
+	long long constant = 0;
+	while (reg != counter && loopDefinitions[reg] != 0) {
+		if (definitions[reg] != 1 || variable[reg] || definition[reg]->type != IrInstruction::I32) {
+			return false;
+		}
+		auto &instruction = *definition[reg];
+		auto &a = instruction.a, &b = instruction.b;
+		if (instruction.opcode == IrInstruction::MOV && a.isRegister()) {
+			reg = a.value;
+		}
+		else if (instruction.opcode == IrInstruction::ADD && a.isRegister() != b.isRegister() && (a.isImmediate() || b.isImmediate())) {
+			constant += (long long)scale * (a.isImmediate() ? a.value : b.value);
+			reg = a.isRegister() ? a.value : b.value;
+		}
+		else if (instruction.opcode == IrInstruction::SUB && a.isRegister() && b.isImmediate()) {
+			constant -= (long long)scale * b.value;
+			reg = a.value;
+		}
+		else if (instruction.opcode == IrInstruction::SUB && a.isImmediate() && b.isRegister()) {
+			constant += (long long)scale * a.value;
+			scale = -scale;
+			reg = b.value;
+		}
+		else {
+			return false;
+		}
+		// the index stays within the int for every counter whose index is in the bounds
+		if (std::abs(constant) >= (1 << 24)) {
+			return false;
+		}
+	}
+	res.root = reg;
+	res.scale = scale;
+	res.constant = (int)constant;
+	return true;
+}
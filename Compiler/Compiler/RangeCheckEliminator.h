@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <set>
+
+#include "Ir.h"
+#include "Cfg.h"
+
+// Removes the range checks of array indexes that can't fail and moves the rest out of for loops.
+// The ranges of the integer registers are found by running the function over intervals, narrowed by
+// the branches taken and the checks passed, widened at loop headers so that the run ends. A check of
+// an index within its bounds is dropped. In a loop left only by its header test of a counter stepped
+// by 1, a check run every iteration of the counter plus or minus a constant, or of a value invariant
+// in the loop, is replaced by checks before the loop of the first and the last index, so an error
+// is reported before the loop runs rather than in the iteration reaching the bad index.
+class RangeCheckEliminator {
+public:
+	// pure holds the labels of the side-effect free routines, a loop calling others isn't changed,
+	// the graph of the function is updated when checks get a block of their own
+	RangeCheckEliminator(IrFunction &function, Cfg &cfg, const std::set<std::string> &pure);
+	void run();
+
+private:
+	// values from low to high, those of a register that isn't an integer span the whole int
+	struct Range {
+		long long low, high;
+	};
+	typedef std::vector<Range> State;
+
+	// index checked, scale * root + constant, the root is the counter or a register invariant in the loop
+	struct Hoisted {
+		int block, position;
+		int root, scale, constant, last;
+	};
+
+	IrFunction &function;
+	Cfg &cfg;
+	const std::set<std::string> &pure;
+	// ranges of the registers at the start of each block, reached tells the blocks that may run
+	std::vector<State> in;
+	std::vector<bool> reached;
+	// registers of variables, the definitions of each register and those in the loop whose checks are moved
+	std::vector<bool> variable;
+	std::vector<int> definitions, loopDefinitions;
+	std::vector<const IrInstruction *> definition;
+
+	void analyze();
+	// the state after the instruction
+	void transfer(const IrInstruction &instruction, State &state);
+	// the state on the edge of the block's terminator to the target, false if it is never taken
+	bool edge(const IrInstruction &branch, int target, State &state);
+	Range range(const IrOperand &operand, const State &state);
+	void removeRedundant();
+	// moves the checks out of one loop, false if there is none to move
+	bool hoist();
+	// the index as a multiple of a root plus a constant, false if it isn't one
+	bool affine(const IrOperand &index, int counter, Hoisted &res);
+};
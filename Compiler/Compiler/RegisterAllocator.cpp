@@ -0,0 +1,696 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <set>
+#include "RegisterAllocator.h"
+#include "Layout.h"
+
+// in order of preference, temporaries take the registers clobbered by printf and idiv first,
+// the general registers are followed by the xmm ones
+static const std::vector<AsmRegister::RegisterType> allocatable32 = {
+	AsmRegister::eax, AsmRegister::ecx, AsmRegister::edx, AsmRegister::ebx, AsmRegister::esi, AsmRegister::edi,
+	AsmRegister::xmm0, AsmRegister::xmm1, AsmRegister::xmm2, AsmRegister::xmm3, AsmRegister::xmm4, AsmRegister::xmm5, AsmRegister::xmm6,
+};
+
+// on x86-64 the registers clobbered by calls come before those the routines save
+static const std::vector<AsmRegister::RegisterType> allocatable64 = {
+	AsmRegister::eax, AsmRegister::ecx, AsmRegister::edx, AsmRegister::esi, AsmRegister::edi,
+	AsmRegister::r8d, AsmRegister::r9d, AsmRegister::r10d, AsmRegister::r11d,
+	AsmRegister::ebx, AsmRegister::r12d, AsmRegister::r13d, AsmRegister::r14d, AsmRegister::r15d,
+	AsmRegister::xmm0, AsmRegister::xmm1, AsmRegister::xmm2, AsmRegister::xmm3, AsmRegister::xmm4, AsmRegister::xmm5, AsmRegister::xmm6,
+	AsmRegister::xmm7, AsmRegister::xmm8, AsmRegister::xmm9, AsmRegister::xmm10, AsmRegister::xmm11, AsmRegister::xmm12,
+	AsmRegister::xmm13, AsmRegister::xmm14,
+};
+
+// values of 4, 8 and 16 bytes are integers, doubles and vectors
+static AsmMemory::DataSize slotSize(int size)
+{
+	return size == 4 ? AsmMemory::dword : size == 8 ? AsmMemory::qword : AsmMemory::xmmword;
+}
+
+static AsmCommand::CommandType moveCommand(int size)
+{
+	return size == 4 ? AsmCommand::mov : size == 8 ? AsmCommand::movsd : AsmCommand::movdqa;
+}
+
+static const std::set<AsmCommand::CommandType> jumpCommands = {
+	AsmCommand::jmp, AsmCommand::jz, AsmCommand::jnz, AsmCommand::jge, AsmCommand::jle, AsmCommand::jl, AsmCommand::jg,
+	AsmCommand::jp, AsmCommand::jnp, AsmCommand::loop, AsmCommand::ja, AsmCommand::jae, AsmCommand::jb, AsmCommand::jbe,
+};
+
+enum OperandRole {
+	USE, DEF, USE_DEF,
+};
+
+static OperandRole operandRole(AsmCommand::CommandType type, int position)
+{
+	switch (type) {
+	case AsmCommand::mov:
+	case AsmCommand::movzx:
+	case AsmCommand::movsx:
+	case AsmCommand::lea:
+	case AsmCommand::movsd:
+	case AsmCommand::cvtsi2sd:
+	case AsmCommand::cvttsd2si:
+	case AsmCommand::movd:
+	case AsmCommand::movdqa:
+	case AsmCommand::movdqu:
+	case AsmCommand::movapd:
+	case AsmCommand::movupd:
+	case AsmCommand::pshufd:
+		return position == 0 ? DEF : USE;
+	case AsmCommand::add:
+	case AsmCommand::sub:
+	case AsmCommand::imul:
+	case AsmCommand::and:
+	case AsmCommand::or:
+	case AsmCommand::xor:
+	case AsmCommand::mulsd:
+	case AsmCommand::addsd:
+	case AsmCommand::divsd:
+	case AsmCommand::subsd:
+	case AsmCommand::unpcklpd:
+	case AsmCommand::unpckhpd:
+	case AsmCommand::paddd:
+	case AsmCommand::psubd:
+	case AsmCommand::pand:
+	case AsmCommand::pandn:
+	case AsmCommand::por:
+	case AsmCommand::pcmpgtd:
+	case AsmCommand::addpd:
+	case AsmCommand::subpd:
+	case AsmCommand::mulpd:
+	case AsmCommand::divpd:
+	case AsmCommand::minpd:
+	case AsmCommand::maxpd:
+		return position == 0 ? USE_DEF : USE;
+	case AsmCommand::inc:
+	case AsmCommand::dec:
+	case AsmCommand::neg:
+	case AsmCommand::not:
+		return USE_DEF;
+	case AsmCommand::pop:
+	case AsmCommand::setge:
+	case AsmCommand::setg:
+	case AsmCommand::setle:
+	case AsmCommand::setl:
+	case AsmCommand::sete:
+	case AsmCommand::setne:
+	case AsmCommand::setbe:
+	case AsmCommand::setb:
+	case AsmCommand::seta:
+	case AsmCommand::setae:
+	case AsmCommand::setp:
+	case AsmCommand::setnp:
+		return DEF;
+	default:
+		return USE;
+	}
+}
+
+// physical registers a command reads and writes without naming them
+static void implicitOperands(AsmCommand::CommandType type, std::vector<AsmRegister::RegisterType> &use, std::vector<AsmRegister::RegisterType> &def,
+	bool x64)
+{
+	if (type == AsmCommand::cdq) {
+		use = { AsmRegister::eax };
+		def = { AsmRegister::edx };
+	}
+	else if (type == AsmCommand::idiv) {
+		use = def = { AsmRegister::eax, AsmRegister::edx };
+	}
+	else if (type == AsmCommand::printf) {
+		def = { AsmRegister::eax, AsmRegister::ecx, AsmRegister::edx };
+	}
+	else if (type == AsmCommand::call && x64) {
+		// routines preserve ebx and r12d-r15d
+		def = {
+			AsmRegister::eax, AsmRegister::ecx, AsmRegister::edx, AsmRegister::esi, AsmRegister::edi,
+			AsmRegister::r8d, AsmRegister::r9d, AsmRegister::r10d, AsmRegister::r11d, AsmRegister::xmm0,
+		};
+	}
+	else if (type == AsmCommand::call) {
+		// routines preserve ebx, esi and edi, the result is returned in eax or xmm0
+		def = { AsmRegister::eax, AsmRegister::ecx, AsmRegister::edx, AsmRegister::xmm0 };
+	}
+	else if (type == AsmCommand::lahf) {
+		def = { AsmRegister::eax };
+	}
+}
+
+static bool isMemory(std::shared_ptr<AsmParameter> par)
+{
+	auto reg = std::dynamic_pointer_cast<AsmRegister>(par);
+	if (reg) {
+		return reg->full;
+	}
+	return std::dynamic_pointer_cast<AsmValue>(par) == nullptr;
+}
+
+// whether a register operand can be replaced by a memory one
+static bool memoryAllowed(AsmCommand &command, int position)
+{
+	for (int i = 0; i < command.parameters.size(); ++i) {
+		if (i != position && isMemory(command.parameters[i])) {
+			return false;
+		}
+	}
+	switch (command.commandType) {
+	case AsmCommand::movzx:
+	case AsmCommand::movsx:
+	case AsmCommand::lea:
+	case AsmCommand::imul:
+	case AsmCommand::addsd:
+	case AsmCommand::subsd:
+	case AsmCommand::mulsd:
+	case AsmCommand::divsd:
+	case AsmCommand::comisd:
+	case AsmCommand::ucomisd:
+	case AsmCommand::cvtsi2sd:
+	case AsmCommand::cvttsd2si:
+	case AsmCommand::pshufd:
+	case AsmCommand::unpcklpd:
+	case AsmCommand::unpckhpd:
+	case AsmCommand::paddd:
+	case AsmCommand::psubd:
+	case AsmCommand::pand:
+	case AsmCommand::pandn:
+	case AsmCommand::por:
+	case AsmCommand::pcmpgtd:
+	case AsmCommand::addpd:
+	case AsmCommand::subpd:
+	case AsmCommand::mulpd:
+	case AsmCommand::divpd:
+	case AsmCommand::minpd:
+	case AsmCommand::maxpd:
+		return position != 0;
+	case AsmCommand::movd:
+		// only the general register can be replaced, a vector slot is wider than the moved dword
+		return !std::static_pointer_cast<AsmRegister>(command.parameters[position])->isXmm();
+	default:
+		return true;
+	}
+}
+
+RegisterAllocator::RegisterAllocator(AsmCode &code)
+	: code(code), x64(code.target == AsmCode::linux64), allocatable(x64 ? allocatable64 : allocatable32),
+	generalCount(x64 ? 14 : 6), physicalCount((int)allocatable.size()), registerCount(physicalCount + code.registerCnt)
+{
+}
+
+void RegisterAllocator::run()
+{
+	sizes.assign(code.registerCnt, 4);
+	uses.assign(code.commands.size(), {});
+	defs.assign(code.commands.size(), {});
+	for (int i = 0; i < code.commands.size(); ++i) {
+		collectOperands(code.commands[i], uses[i], defs[i]);
+	}
+	computeLiveness();
+	buildIntervals();
+	allocate();
+	rewrite();
+}
+
+int RegisterAllocator::physicalNumber(AsmRegister::RegisterType type)
+{
+	static const std::map<AsmRegister::RegisterType, AsmRegister::RegisterType> parts = {
+		{ AsmRegister::al, AsmRegister::eax },
+		{ AsmRegister::ah, AsmRegister::eax },
+		{ AsmRegister::ax, AsmRegister::eax },
+		{ AsmRegister::bl, AsmRegister::ebx },
+		{ AsmRegister::cl, AsmRegister::ecx },
+		{ AsmRegister::dl, AsmRegister::edx },
+	};
+
+	auto it = parts.find(type);
+	if (it != parts.end()) {
+		type = it->second;
+	}
+	auto position = std::find(allocatable.begin(), allocatable.end(), type);
+	return position == allocatable.end() ? -1 : (int)(position - allocatable.begin());
+}
+
+void RegisterAllocator::collectOperands(AsmCommand &command, std::vector<int> &use, std::vector<int> &def)
+{
+	for (int i = 0; i < command.parameters.size(); ++i) {
+		auto reg = std::dynamic_pointer_cast<AsmRegister>(command.parameters[i]);
+		if (reg == nullptr) {
+			continue;
+		}
+		int number = reg->isVirtual() ? physicalCount + reg->index : physicalNumber(reg->registerType);
+		if (number < 0) {
+			continue;
+		}
+		if (reg->isVirtual() && !reg->full && reg->isXmm()) {
+			sizes[reg->index] = reg->dataSize == AsmMemory::xmmword ? 16 : 8;
+		}
+		OperandRole role = reg->full ? USE : operandRole(command.commandType, i);
+		if (role != DEF) {
+			use.push_back(number);
+		}
+		if (role != USE) {
+			def.push_back(number);
+		}
+	}
+
+	std::vector<AsmRegister::RegisterType> implicitUse, implicitDef;
+	implicitOperands(command.commandType, implicitUse, implicitDef, x64);
+	for (auto it : implicitUse) {
+		use.push_back(physicalNumber(it));
+	}
+	for (auto it : implicitDef) {
+		def.push_back(physicalNumber(it));
+	}
+}
+
+void RegisterAllocator::computeLiveness()
+{
+	int n = (int)code.commands.size();
+	std::map<std::string, int> labels;
+	for (int i = 0; i < n; ++i) {
+		if (code.commands[i].commandType == AsmCommand::label) {
+			labels[code.commands[i].parameters[0]->toString()] = i;
+		}
+	}
+
+	// a jump to a label of the runtime, as that of a range check error, leaves the routine for good
+	std::vector<int> targets(n, -1);
+	std::vector<bool> starts(n + 1);
+	starts[0] = starts[n] = true;
+	for (int i = 0; i < n; ++i) {
+		auto type = code.commands[i].commandType;
+		if (type == AsmCommand::label) {
+			starts[i] = true;
+		}
+		if (!jumpCommands.count(type)) {
+			continue;
+		}
+		starts[i + 1] = true;
+		auto it = labels.find(code.commands[i].parameters[0]->toString());
+		if (it != labels.end()) {
+			targets[i] = it->second;
+		}
+	}
+
+	// a jump back to a label closes a loop around the commands in between
+	std::vector<int> depthChange(n + 1);
+	for (int i = 0; i < n; ++i) {
+		if (targets[i] != -1 && targets[i] < i) {
+			++depthChange[targets[i]];
+			--depthChange[i];
+		}
+	}
+	loopDepth.assign(n, 0);
+	for (int i = 0, depth = 0; i < n; ++i) {
+		depth += depthChange[i];
+		loopDepth[i] = depth;
+	}
+
+	blockStarts.clear();
+	std::vector<int> blockOf(n);
+	for (int i = 0; i <= n; ++i) {
+		if (starts[i]) {
+			blockStarts.push_back(i);
+		}
+		if (i < n) {
+			blockOf[i] = (int)blockStarts.size() - 1;
+		}
+	}
+	int count = (int)blockStarts.size() - 1;
+
+	std::vector<std::vector<int>> successors(count);
+	std::vector<BitSet> use(count, BitSet(registerCount)), def(use);
+	for (int b = 0; b < count; ++b) {
+		int last = blockStarts[b + 1] - 1;
+		if (targets[last] != -1) {
+			successors[b].push_back(blockOf[targets[last]]);
+		}
+		if (code.commands[last].commandType != AsmCommand::jmp && b + 1 < count) {
+			successors[b].push_back(b + 1);
+		}
+		for (int i = blockStarts[b]; i <= last; ++i) {
+			for (int r : uses[i]) {
+				if (!def[b][r]) {
+					use[b].set(r);
+				}
+			}
+			for (int r : defs[i]) {
+				def[b].set(r);
+			}
+		}
+	}
+
+	std::vector<BitSet> liveIn(count, BitSet(registerCount));
+	liveOut.assign(count, BitSet(registerCount));
+	for (bool changed = true; changed; ) {
+		changed = false;
+		for (int b = count - 1; b >= 0; --b) {
+			for (int s : successors[b]) {
+				liveOut[b].unite(liveIn[s]);
+			}
+			BitSet live = liveOut[b];
+			live.subtract(def[b]);
+			live.unite(use[b]);
+			if (live != liveIn[b]) {
+				liveIn[b] = live;
+				changed = true;
+			}
+		}
+	}
+}
+
+void RegisterAllocator::buildIntervals()
+{
+	// command i reads its operands at point 2i and writes them at point 2i + 1
+	fixed.assign(physicalCount, {});
+	std::vector<int> start(registerCount, INT_MAX), end(registerCount, -1);
+	std::vector<double> weight(registerCount);
+	auto touch = [&](int r, int point) {
+		if (r < physicalCount) {
+			fixed[r].push_back(point);
+			return;
+		}
+		start[r] = std::min(start[r], point);
+		end[r] = std::max(end[r], point);
+	};
+
+	// an interval spans the uses and definitions of its register and the ends of the blocks it is live at,
+	// the physical registers are busy at every point they are live at
+	liveAfterCall.clear();
+	for (int b = 0; b + 1 < blockStarts.size(); ++b) {
+		BitSet live = liveOut[b];
+		for (int r : live.elements()) {
+			touch(r, 2 * blockStarts[b + 1] - 1);
+		}
+		for (int i = blockStarts[b + 1] - 1; i >= blockStarts[b]; --i) {
+			auto type = code.commands[i].commandType;
+			if (type == AsmCommand::printf || type == AsmCommand::call) {
+				liveAfterCall[i] = live;
+			}
+			for (int r = 0; r < physicalCount; ++r) {
+				if (live[r]) touch(r, 2 * i + 1);
+			}
+			// every access of a spilled register costs a memory access, those in loops are repeated
+			double cost = pow(10.0, std::min(loopDepth[i], 6));
+			for (int r : defs[i]) {
+				touch(r, 2 * i + 1);
+				weight[r] += cost;
+				live.reset(r);
+			}
+			for (int r : uses[i]) {
+				touch(r, 2 * i);
+				weight[r] += cost;
+				live.set(r);
+			}
+			for (int r = 0; r < physicalCount; ++r) {
+				if (live[r]) touch(r, 2 * i);
+			}
+		}
+		for (int r : live.elements()) {
+			touch(r, 2 * blockStarts[b]);
+		}
+	}
+
+	for (auto &it : fixed) {
+		std::sort(it.begin(), it.end());
+	}
+	intervals.clear();
+	for (int r = physicalCount; r < registerCount; ++r) {
+		if (end[r] >= 0) {
+			Interval interval;
+			interval.index = r - physicalCount;
+			interval.size = sizes[interval.index];
+			interval.xmm = interval.size > 4;
+			interval.start = start[r];
+			interval.end = end[r];
+			interval.weight = weight[r];
+			intervals.push_back(interval);
+		}
+	}
+}
+
+bool RegisterAllocator::conflicts(int reg, Interval &interval)
+{
+	auto it = std::lower_bound(fixed[reg].begin(), fixed[reg].end(), interval.start);
+	return it != fixed[reg].end() && *it <= interval.end;
+}
+
+int RegisterAllocator::copyHint(Interval &interval)
+{
+	// a register defined by a copy of one that dies there can take its register and make the copy a no-op
+	if (interval.start % 2 == 0) {
+		return -1;
+	}
+	auto &command = code.commands[interval.start / 2];
+	static const std::set<AsmCommand::CommandType> copies = {
+		AsmCommand::mov, AsmCommand::movsd, AsmCommand::movdqa, AsmCommand::movapd,
+	};
+	if (!copies.count(command.commandType) || command.parameters.size() != 2) {
+		return -1;
+	}
+	auto source = std::dynamic_pointer_cast<AsmRegister>(command.parameters[1]);
+	if (source == nullptr || !source->isVirtual() || source->full) {
+		return -1;
+	}
+	Interval *sourceInterval = intervalOf[source->index];
+	return sourceInterval->end == interval.start - 1 ? sourceInterval->reg : -1;
+}
+
+void RegisterAllocator::allocate()
+{
+	std::sort(intervals.begin(), intervals.end(), [](const Interval &a, const Interval &b) {
+		return a.start < b.start;
+	});
+	intervalOf.assign(code.registerCnt, nullptr);
+	for (auto &it : intervals) {
+		intervalOf[it.index] = &it;
+	}
+
+	std::vector<Interval *> active;
+	for (auto &current : intervals) {
+		active.erase(std::remove_if(active.begin(), active.end(), [&current](Interval *it) {
+			return it->end < current.start;
+		}), active.end());
+
+		std::vector<bool> busy(physicalCount);
+		for (auto it : active) {
+			busy[it->reg] = true;
+		}
+		int first = current.xmm ? generalCount : 0, last = current.xmm ? physicalCount : generalCount;
+		int reg = -1;
+		int hint = copyHint(current);
+		if (hint >= first && hint < last && !busy[hint] && !conflicts(hint, current)) {
+			reg = hint;
+		}
+		for (int r = first; r < last && reg == -1; ++r) {
+			if (!busy[r] && !conflicts(r, current)) {
+				reg = r;
+			}
+		}
+
+		if (reg == -1) {
+			// the cheapest interval is spilled, among equally cheap ones the one ending last
+			Interval *victim = &current;
+			for (auto it : active) {
+				if (it->xmm == current.xmm && !conflicts(it->reg, current) && (it->weight < victim->weight ||
+					(it->weight == victim->weight && it->end > victim->end)))
+				{
+					victim = it;
+				}
+			}
+			if (victim != &current) {
+				reg = victim->reg;
+				victim->reg = -1;
+				active.erase(std::find(active.begin(), active.end(), victim));
+			}
+		}
+
+		current.reg = reg;
+		if (reg != -1) {
+			active.push_back(&current);
+		}
+	}
+
+	for (auto &it : intervals) {
+		if (it.reg == -1) {
+			code.size = Layout::alignUp(code.size + it.size, it.size);
+			code.frameAlignment = std::max(code.frameAlignment, it.size);
+			it.slot = code.size;
+		}
+	}
+}
+
+// xmm registers are all clobbered by printf and by routines, those holding values needed after a call are saved
+// to frame slots around it instead of keeping the values out of the registers for their whole lifetimes
+std::vector<RegisterAllocator::Interval *> RegisterAllocator::preservedIntervals(int i)
+{
+	std::vector<Interval *> res;
+	auto type = code.commands[i].commandType;
+	if (type != AsmCommand::printf && type != AsmCommand::call) {
+		return res;
+	}
+	for (auto &it : intervals) {
+		if (!it.xmm || it.reg == -1 || !liveAfterCall.at(i)[physicalCount + it.index]) {
+			continue;
+		}
+		auto key = std::make_pair(it.reg, it.size);
+		if (!saveSlots.count(key)) {
+			code.size = Layout::alignUp(code.size + it.size, it.size);
+			code.frameAlignment = std::max(code.frameAlignment, it.size);
+			saveSlots[key] = code.size;
+		}
+		res.push_back(&it);
+	}
+	return res;
+}
+
+void RegisterAllocator::rewrite()
+{
+	std::vector<AsmCommand> result;
+	saveSlots.clear();
+	scratchSlots.clear();
+	for (int i = 0; i < code.commands.size(); ++i) {
+		auto preserved = preservedIntervals(i);
+		for (auto it : preserved) {
+			auto slot = std::make_shared<AsmMemory>(slotSize(it->size), saveSlots[{ it->reg, it->size }]);
+			result.push_back({ moveCommand(it->size), slot, allocatable[it->reg] });
+		}
+		rewriteCommand(i, result);
+		for (auto it : preserved) {
+			auto slot = std::make_shared<AsmMemory>(slotSize(it->size), saveSlots[{ it->reg, it->size }]);
+			result.push_back({ moveCommand(it->size), allocatable[it->reg], slot });
+		}
+	}
+	code.commands = result;
+}
+
+void RegisterAllocator::rewriteCommand(int i, std::vector<AsmCommand> &result)
+{
+	AsmCommand command = code.commands[i];
+	std::vector<int> spilled;
+	for (int p = 0; p < command.parameters.size(); ++p) {
+		auto reg = std::dynamic_pointer_cast<AsmRegister>(command.parameters[p]);
+		if (reg == nullptr || !reg->isVirtual()) {
+			continue;
+		}
+		Interval *interval = intervalOf[reg->index];
+		if (interval->reg == -1) {
+			spilled.push_back(p);
+			continue;
+		}
+		auto type = allocatable[interval->reg];
+		command.parameters[p] = reg->full ?
+			std::make_shared<AsmRegister>(type, reg->dataSize, reg->offset) : std::make_shared<AsmRegister>(type);
+	}
+	if (spilled.empty()) {
+		result.push_back(command);
+		return;
+	}
+
+	// a spilled operand is read from its slot directly if the command allows one more memory operand,
+	// otherwise it is loaded to a scratch register saved on the stack around the command, on x86-64 to a frame slot,
+	// as arguments are stored relative to the stack pointer
+	std::vector<int> scratchOperands;
+	for (int p : spilled) {
+		auto reg = std::static_pointer_cast<AsmRegister>(command.parameters[p]);
+		if (!reg->full && memoryAllowed(command, p)) {
+			auto interval = intervalOf[reg->index];
+			command.parameters[p] = std::make_shared<AsmMemory>(slotSize(interval->size), interval->slot);
+		}
+		else {
+			scratchOperands.push_back(p);
+		}
+	}
+
+	std::set<int> taken;
+	for (auto &par : command.parameters) {
+		auto reg = std::dynamic_pointer_cast<AsmRegister>(par);
+		if (reg != nullptr && !reg->isVirtual() && physicalNumber(reg->registerType) >= 0) {
+			taken.insert(physicalNumber(reg->registerType));
+		}
+	}
+	std::vector<AsmRegister::RegisterType> implicitUse, implicitDef;
+	implicitOperands(command.commandType, implicitUse, implicitDef, x64);
+	for (auto it : implicitUse) {
+		taken.insert(physicalNumber(it));
+	}
+	for (auto it : implicitDef) {
+		taken.insert(physicalNumber(it));
+	}
+
+	std::map<int, AsmRegister::RegisterType> scratchOf;
+	std::vector<AsmCommand> before, stores;
+	std::vector<AsmRegister::RegisterType> saved;
+	for (int p : scratchOperands) {
+		auto reg = std::static_pointer_cast<AsmRegister>(command.parameters[p]);
+		if (!scratchOf.count(reg->index) && intervalOf[reg->index]->xmm) {
+			// xmm7 (xmm15 on x86-64) is never allocated, a command has at most one xmm operand that can't be in memory
+			auto scratch = x64 ? AsmRegister::xmm15 : AsmRegister::xmm7;
+			int number = physicalCount + reg->index;
+			auto interval = intervalOf[reg->index];
+			auto slot = std::make_shared<AsmMemory>(slotSize(interval->size), interval->slot);
+			scratchOf[reg->index] = scratch;
+			if (std::count(uses[i].begin(), uses[i].end(), number)) {
+				before.push_back({ moveCommand(interval->size), scratch, slot });
+			}
+			if (std::count(defs[i].begin(), defs[i].end(), number)) {
+				stores.push_back({ moveCommand(interval->size), slot, scratch });
+			}
+		}
+		if (!scratchOf.count(reg->index)) {
+			int scratch = -1;
+			for (int r = generalCount - 1; r >= 0 && scratch == -1; --r) {
+				if (!taken.count(r)) {
+					scratch = r;
+				}
+			}
+			if (scratch == -1) {
+				throw std::exception("No scratch register for a spilled operand");
+			}
+			taken.insert(scratch);
+
+			auto type = allocatable[scratch];
+			int number = physicalCount + reg->index;
+			auto slot = std::make_shared<AsmMemory>(AsmMemory::dword, intervalOf[reg->index]->slot);
+			scratchOf[reg->index] = type;
+			saved.push_back(type);
+			if (x64) {
+				before.push_back({ AsmCommand::mov, scratchSlot(scratch), type });
+			}
+			else {
+				before.push_back({ AsmCommand::push, type });
+			}
+			if (std::count(uses[i].begin(), uses[i].end(), number)) {
+				before.push_back({ AsmCommand::mov, type, slot });
+			}
+			if (std::count(defs[i].begin(), defs[i].end(), number)) {
+				stores.push_back({ AsmCommand::mov, slot, type });
+			}
+		}
+		auto type = scratchOf[reg->index];
+		command.parameters[p] = reg->full ?
+			std::make_shared<AsmRegister>(type, reg->dataSize, reg->offset) : std::make_shared<AsmRegister>(type);
+	}
+
+	result.insert(result.end(), before.begin(), before.end());
+	result.push_back(command);
+	result.insert(result.end(), stores.begin(), stores.end());
+	for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+		if (x64) {
+			result.push_back({ AsmCommand::mov, *it, scratchSlot(physicalNumber(*it)) });
+		}
+		else {
+			result.push_back({ AsmCommand::pop, *it });
+		}
+	}
+}
+
+std::shared_ptr<AsmMemory> RegisterAllocator::scratchSlot(int reg)
+{
+	if (!scratchSlots.count(reg)) {
+		code.size = Layout::alignUp(code.size + 4, 4);
+		scratchSlots[reg] = code.size;
+	}
+	return std::make_shared<AsmMemory>(AsmMemory::dword, scratchSlots[reg]);
+}
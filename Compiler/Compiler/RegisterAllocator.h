@@ -0,0 +1,71 @@
+#pragma once
+#include <vector>
+#include <map>
+
+#include "Generator.h"
+#include "BitSet.h"
+
+// Linear-scan allocation of the virtual registers of the code to eax, ebx, ecx, edx, esi and edi,
+// those of the xmm class holding doubles and vectors get xmm0-xmm6. On x86-64 r8d-r15d and xmm7-xmm14
+// are allocated as well. Physical registers named by the commands themselves (idiv, cdq, printf, call, setcc)
+// form fixed intervals, virtual registers that don't get a register are spilled to frame slots.
+class RegisterAllocator {
+public:
+	RegisterAllocator(AsmCode &code);
+	void run();
+
+
+private:
+	struct Interval {
+		int index;
+		bool xmm;
+		// bytes of the value, 4, 8 or 16
+		int size;
+		int start, end;
+		// position in allocatable, -1 for a spilled register
+		int reg = -1;
+		int slot = 0;
+		// estimated cost of keeping the register in memory
+		double weight = 0;
+	};
+
+	AsmCode &code;
+	bool x64;
+	const std::vector<AsmRegister::RegisterType> &allocatable;
+	// registers 0..physicalCount - 1 are the allocatable physical ones, the first generalCount of them
+	// are general registers, virtual register k is numbered k + physicalCount
+	int generalCount, physicalCount;
+	int registerCount;
+	// bytes of the value of each virtual register
+	std::vector<int> sizes;
+	std::vector<std::vector<int>> uses, defs;
+	// blocks start at labels and after jumps, block k holds the commands from blockStarts[k] to blockStarts[k + 1]
+	std::vector<int> blockStarts;
+	// registers live at the end of each block
+	std::vector<BitSet> liveOut;
+	// registers live after each call, the xmm ones are saved around it
+	std::map<int, BitSet> liveAfterCall;
+	std::vector<int> loopDepth;
+	// sorted positions where a physical register is busy
+	std::vector<std::vector<int>> fixed;
+	std::vector<Interval> intervals;
+	// interval of each virtual register
+	std::vector<Interval *> intervalOf;
+	// frame slots of the xmm registers saved around calls by the register and the size of the value
+	std::map<std::pair<int, int>, int> saveSlots;
+	// frame slots of the scratch registers on x86-64
+	std::map<int, int> scratchSlots;
+
+	int physicalNumber(AsmRegister::RegisterType type);
+	void collectOperands(AsmCommand &command, std::vector<int> &use, std::vector<int> &def);
+	void computeLiveness();
+	// walks each block back from its end, the commands get the registers live there
+	void buildIntervals();
+	bool conflicts(int reg, Interval &interval);
+	int copyHint(Interval &interval);
+	void allocate();
+	std::vector<Interval *> preservedIntervals(int i);
+	void rewrite();
+	void rewriteCommand(int i, std::vector<AsmCommand> &result);
+	std::shared_ptr<AsmMemory> scratchSlot(int reg);
+};
@@ -0,0 +1,696 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "Runtime.h"
+#include "Layout.h"
+
+const std::string Runtime::start = "_start";
+const std::string Runtime::main = "$main@";
+const std::string Runtime::writeInt = "$write_int@";
+const std::string Runtime::writeChar = "$write_char@";
+const std::string Runtime::writeDouble = "$write_double@";
+const std::string Runtime::readInt = "$read_int@";
+const std::string Runtime::readChar = "$read_char@";
+const std::string Runtime::readDouble = "$read_double@";
+const std::string Runtime::exit = "$exit@";
+const std::string Runtime::rangeError = "$range_error@";
+const std::string Runtime::flush = "$flush@";
+const std::string Runtime::reserve = "$reserve@";
+const std::string Runtime::digits = "$digits@";
+const std::string Runtime::newLine = "$new_line@";
+const std::string Runtime::buffer = "$buffer@";
+const std::string Runtime::length = "$length@";
+const std::string Runtime::peek = "$peek@";
+const std::string Runtime::next = "$next@";
+const std::string Runtime::skip = "$skip@";
+const std::string Runtime::sign = "$sign@";
+const std::string Runtime::input = "$input@";
+const std::string Runtime::inputPosition = "$input_position@";
+const std::string Runtime::inputLength = "$input_length@";
+const std::string Runtime::fail = "$fail@";
+const std::string Runtime::fault = "$fault@";
+const std::string Runtime::stackBase = "$stack_base@";
+const std::string Runtime::signalStack = "$signal_stack@";
+const std::string Runtime::rangeMessage = "$range_message@";
+const std::string Runtime::divisionMessage = "$division_message@";
+const std::string Runtime::stackMessage = "$stack_message@";
+const std::string Runtime::accessMessage = "$access_message@";
+
+static const std::string rangeText = "Range check error\n";
+static const std::string divisionText = "Division by zero\n";
+static const std::string stackText = "Stack overflow\n";
+static const std::string accessText = "Access violation\n";
+// the digits of the mantissa of a double read beyond the 18th are dropped, so it fits a signed qword,
+// and an exponent is read up to 5 digits
+static const long long mantissaLimit = 100000000000000000LL;
+static const int exponentLimit = 10000;
+
+// memory at the address in a 64-bit register plus the offset
+static PAsmRegister at(AsmRegister::RegisterType base, AsmMemory::DataSize dataSize, int offset = 0)
+{
+	return std::make_shared<AsmRegister>(base, dataSize, -offset);
+}
+
+static std::shared_ptr<AsmParameter> label(const std::string &name, AsmMemory::DataSize dataSize)
+{
+	return std::make_shared<AsmLabelMemory>(dataSize, name);
+}
+
+static AsmRoutine routine(const std::string &label)
+{
+	AsmRoutine res;
+	res.label = label;
+	res.naked = true;
+	return res;
+}
+
+int Runtime::stackBytes(int frameSize)
+{
+	if (frameSize > maxFrameSize) {
+		throw std::exception("Variables of the main program take more than 1 GB");
+	}
+	return stackSize + Layout::alignUp(frameSize, 4096);
+}
+
+// the next byte of the input, -1 at its end
+static int peekInput()
+{
+	int c = getchar();
+	if (c != EOF) {
+		ungetc(c, stdin);
+	}
+	return c;
+}
+
+// takes the byte peeked and peeks the next one
+static int nextInput()
+{
+	getchar();
+	return peekInput();
+}
+
+// takes a sign at the byte c, negative tells whether it was a minus
+static int signInput(int c, bool &negative)
+{
+	negative = c == '-';
+	return c == '-' || c == '+' ? nextInput() : c;
+}
+
+static bool isDigit(int c)
+{
+	return c >= '0' && c <= '9';
+}
+
+// white space is any byte up to the space
+static int skipInput()
+{
+	int c = peekInput();
+	while (c >= 0 && c <= ' ') {
+		c = nextInput();
+	}
+	return c;
+}
+
+int Runtime::inputInt()
+{
+	bool negative;
+	int c = signInput(skipInput(), negative);
+	unsigned value = 0;
+	for (; isDigit(c); c = nextInput()) {
+		value = value * 10 + (c - '0');
+	}
+	return (int)(negative ? 0 - value : value);
+}
+
+int Runtime::inputChar()
+{
+	int c = getchar();
+	return c == EOF ? 0 : c;
+}
+
+// the mantissa is scaled by a power of 10 computed by multiplications, which is exact up to 10^22
+double Runtime::inputDouble()
+{
+	bool negative;
+	int c = signInput(skipInput(), negative);
+	long long mantissa = 0;
+	int exponent = 0;
+	for (; isDigit(c); c = nextInput()) {
+		if (mantissa < mantissaLimit) {
+			mantissa = mantissa * 10 + (c - '0');
+		}
+		else {
+			++exponent;
+		}
+	}
+	if (c == '.') {
+		for (c = nextInput(); isDigit(c); c = nextInput()) {
+			if (mantissa < mantissaLimit) {
+				mantissa = mantissa * 10 + (c - '0');
+				--exponent;
+			}
+		}
+	}
+	if (c == 'e' || c == 'E') {
+		bool negativeExponent;
+		c = signInput(nextInput(), negativeExponent);
+		int value = 0;
+		for (; isDigit(c); c = nextInput()) {
+			if (value < exponentLimit) {
+				value = value * 10 + (c - '0');
+			}
+		}
+		exponent += negativeExponent ? -value : value;
+	}
+	double res = (double)mantissa;
+	if (mantissa != 0) {
+		double power = 1;
+		for (int i = abs(exponent); i > 0; --i) {
+			power *= 10;
+		}
+		res = exponent < 0 ? res / power : res * power;
+	}
+	return negative ? res * -1.0 : res;
+}
+
+void Runtime::addMessage(AsmCode &code, const std::string &label, const std::string &text)
+{
+	AsmData message(label, true);
+	message.bytes.assign(text.begin(), text.end());
+	message.runs = { { AsmData::db, (int)text.size() } };
+	code.data.push_back(message);
+}
+
+void Runtime::add(AsmCode &code)
+{
+	AsmData bufferData(buffer, false);
+	bufferData.alignment = 16;
+	bufferData.reserved = bufferSize;
+	code.data.push_back(bufferData);
+	AsmData lengthData(length, false);
+	lengthData.reserved = 4;
+	code.data.push_back(lengthData);
+	AsmData stackBaseData(stackBase, false);
+	stackBaseData.alignment = 8;
+	stackBaseData.reserved = 8;
+	code.data.push_back(stackBaseData);
+	AsmData signalStackData(signalStack, false);
+	signalStackData.alignment = 16;
+	signalStackData.reserved = signalStackSize;
+	code.data.push_back(signalStackData);
+	addMessage(code, divisionMessage, divisionText);
+	addMessage(code, stackMessage, stackText);
+	addMessage(code, accessMessage, accessText);
+
+	// sigaltstack of the signal stack and rt_sigaction of SIGFPE and SIGSEGV with SA_SIGINFO, SA_ONSTACK and
+	// SA_RESTORER, the structures are pushed, then the mmap of an anonymous private readable and writable
+	// region with MAP_32BIT holds the stack
+	int bytes = stackBytes(code.size);
+	auto entry = routine(start);
+	entry.commands = {
+		{ AsmCommand::push, std::to_string(signalStackSize) },
+		{ AsmCommand::push, "0" },
+		{ AsmCommand::lea, AsmRegister::rax, label(signalStack, AsmMemory::qword) },
+		{ AsmCommand::push, AsmRegister::rax },
+		{ AsmCommand::mov, AsmRegister::eax, "131" },
+		{ AsmCommand::mov, AsmRegister::rdi, AsmRegister::rsp },
+		{ AsmCommand::xor, AsmRegister::esi, AsmRegister::esi },
+		{ AsmCommand::syscall },
+		{ AsmCommand::push, "0" },
+		{ AsmCommand::lea, AsmRegister::rax, label(fault, AsmMemory::qword) },
+		{ AsmCommand::push, AsmRegister::rax },
+		{ AsmCommand::push, "201326596" },
+		{ AsmCommand::push, AsmRegister::rax },
+	};
+	for (int signal : { 8, 11 }) {
+		entry.commands.insert(entry.commands.end(), {
+			{ AsmCommand::mov, AsmRegister::eax, "13" },
+			{ AsmCommand::mov, AsmRegister::edi, std::to_string(signal) },
+			{ AsmCommand::mov, AsmRegister::rsi, AsmRegister::rsp },
+			{ AsmCommand::xor, AsmRegister::edx, AsmRegister::edx },
+			{ AsmCommand::mov, AsmRegister::r10d, "8" },
+			{ AsmCommand::syscall },
+		});
+	}
+	entry.commands.insert(entry.commands.end(), {
+		{ AsmCommand::mov, AsmRegister::eax, "9" },
+		{ AsmCommand::xor, AsmRegister::edi, AsmRegister::edi },
+		{ AsmCommand::mov, AsmRegister::esi, std::to_string(bytes) },
+		{ AsmCommand::mov, AsmRegister::edx, "3" },
+		{ AsmCommand::mov, AsmRegister::r10d, "98" },
+		{ AsmCommand::mov, AsmRegister::r8, "-1" },
+		{ AsmCommand::xor, AsmRegister::r9d, AsmRegister::r9d },
+		{ AsmCommand::syscall },
+		{ AsmCommand::mov, label(stackBase, AsmMemory::qword), AsmRegister::rax },
+		{ AsmCommand::lea, AsmRegister::rsp, at(AsmRegister::rax, AsmMemory::qword, bytes) },
+		{ AsmCommand::call, main },
+		{ AsmCommand::jmp, exit },
+	});
+	code.routines.push_back(entry);
+
+	// writes the message at rsi of edx bytes to stderr after the text written so far
+	// and ends the program with the exit code in ebx
+	auto failRoutine = routine(fail);
+	failRoutine.commands = {
+		{ AsmCommand::push, AsmRegister::rsi },
+		{ AsmCommand::push, AsmRegister::rdx },
+		{ AsmCommand::call, flush },
+		{ AsmCommand::pop, AsmRegister::rdx },
+		{ AsmCommand::pop, AsmRegister::rsi },
+		{ AsmCommand::mov, AsmRegister::eax, "1" },
+		{ AsmCommand::mov, AsmRegister::edi, "2" },
+		{ AsmCommand::syscall },
+		{ AsmCommand::mov, AsmRegister::eax, "60" },
+		{ AsmCommand::mov, AsmRegister::edi, AsmRegister::ebx },
+		{ AsmCommand::syscall },
+	};
+	code.routines.push_back(failRoutine);
+
+	// the handler of the signals runs on the signal stack with the signal in edi and its information in rsi,
+	// the address of the fault is at offset 16
+	std::string report = code.getLabel("REPORT"), access = code.getLabel("ACCESS");
+	auto faultRoutine = routine(fault);
+	faultRoutine.commands = {
+		{ AsmCommand::mov, AsmRegister::rax, at(AsmRegister::rsi, AsmMemory::qword, 16) },
+		{ AsmCommand::mov, AsmRegister::rcx, label(stackBase, AsmMemory::qword) },
+		{ AsmCommand::lea, AsmRegister::rsi, label(divisionMessage, AsmMemory::byte) },
+		{ AsmCommand::mov, AsmRegister::edx, std::to_string(divisionText.size()) },
+		{ AsmCommand::mov, AsmRegister::ebx, std::to_string(divisionErrorCode) },
+		{ AsmCommand::cmp, AsmRegister::edi, "8" },
+		{ AsmCommand::jz, report },
+		{ AsmCommand::cmp, AsmRegister::rax, AsmRegister::rcx },
+		{ AsmCommand::jae, access },
+		{ AsmCommand::sub, AsmRegister::rcx, std::to_string(guardSize) },
+		{ AsmCommand::cmp, AsmRegister::rax, AsmRegister::rcx },
+		{ AsmCommand::jb, access },
+		{ AsmCommand::lea, AsmRegister::rsi, label(stackMessage, AsmMemory::byte) },
+		{ AsmCommand::mov, AsmRegister::edx, std::to_string(stackText.size()) },
+		{ AsmCommand::mov, AsmRegister::ebx, std::to_string(stackOverflowCode) },
+		{ AsmCommand::jmp, report },
+		{ AsmCommand::label, access },
+		{ AsmCommand::lea, AsmRegister::rsi, label(accessMessage, AsmMemory::byte) },
+		{ AsmCommand::mov, AsmRegister::edx, std::to_string(accessText.size()) },
+		{ AsmCommand::mov, AsmRegister::ebx, std::to_string(accessViolationCode) },
+		{ AsmCommand::label, report },
+		{ AsmCommand::jmp, fail },
+	};
+	code.routines.push_back(faultRoutine);
+
+	auto exitRoutine = routine(exit);
+	exitRoutine.commands = {
+		{ AsmCommand::call, flush },
+		{ AsmCommand::mov, AsmRegister::eax, "60" },
+		{ AsmCommand::xor, AsmRegister::edi, AsmRegister::edi },
+		{ AsmCommand::syscall },
+	};
+	code.routines.push_back(exitRoutine);
+
+	auto flushRoutine = routine(flush);
+	flushRoutine.commands = {
+		{ AsmCommand::mov, AsmRegister::eax, "1" },
+		{ AsmCommand::mov, AsmRegister::edi, "1" },
+		{ AsmCommand::lea, AsmRegister::rsi, label(buffer, AsmMemory::byte) },
+		{ AsmCommand::mov, AsmRegister::edx, label(length, AsmMemory::dword) },
+		{ AsmCommand::syscall },
+		{ AsmCommand::mov, label(length, AsmMemory::dword), "0" },
+		{ AsmCommand::ret },
+	};
+	code.routines.push_back(flushRoutine);
+
+	// r8 = the end of the buffered text, there is room for any value after it
+	std::string room = code.getLabel("ROOM");
+	auto reserveRoutine = routine(reserve);
+	reserveRoutine.commands = {
+		{ AsmCommand::cmp, label(length, AsmMemory::dword), std::to_string(bufferSize - 64) },
+		{ AsmCommand::jle, room },
+		{ AsmCommand::call, flush },
+		{ AsmCommand::label, room },
+		{ AsmCommand::lea, AsmRegister::r8, label(buffer, AsmMemory::byte) },
+		{ AsmCommand::mov, AsmRegister::eax, label(length, AsmMemory::dword) },
+		{ AsmCommand::add, AsmRegister::r8, AsmRegister::rax },
+		{ AsmCommand::ret },
+	};
+	code.routines.push_back(reserveRoutine);
+
+	// ends the value written up to r8 with a line break
+	auto newLineRoutine = routine(newLine);
+	newLineRoutine.commands = {
+		{ AsmCommand::mov, at(AsmRegister::r8, AsmMemory::byte), "10" },
+		{ AsmCommand::inc, AsmRegister::r8 },
+		{ AsmCommand::lea, AsmRegister::rax, label(buffer, AsmMemory::byte) },
+		{ AsmCommand::sub, AsmRegister::r8, AsmRegister::rax },
+		{ AsmCommand::mov, label(length, AsmMemory::dword), AsmRegister::r8d },
+		{ AsmCommand::ret },
+	};
+	code.routines.push_back(newLineRoutine);
+
+	// writes the unsigned rax with at least ecx digits at r8, they are formed backwards below the stack pointer
+	std::string divide = code.getLabel("DIGIT"), copy = code.getLabel("COPY");
+	auto digitsRoutine = routine(digits);
+	digitsRoutine.commands = {
+		{ AsmCommand::mov, AsmRegister::r9, AsmRegister::rsp },
+		{ AsmCommand::mov, AsmRegister::r10d, "10" },
+		{ AsmCommand::label, divide },
+		{ AsmCommand::xor, AsmRegister::edx, AsmRegister::edx },
+		{ AsmCommand::div, AsmRegister::r10 },
+		{ AsmCommand::add, AsmRegister::edx, "48" },
+		{ AsmCommand::dec, AsmRegister::r9 },
+		{ AsmCommand::mov, at(AsmRegister::r9, AsmMemory::byte), AsmRegister::dl },
+		{ AsmCommand::dec, AsmRegister::ecx },
+		{ AsmCommand::test, AsmRegister::rax, AsmRegister::rax },
+		{ AsmCommand::jnz, divide },
+		{ AsmCommand::test, AsmRegister::ecx, AsmRegister::ecx },
+		{ AsmCommand::jg, divide },
+		{ AsmCommand::label, copy },
+		{ AsmCommand::mov, AsmRegister::dl, at(AsmRegister::r9, AsmMemory::byte) },
+		{ AsmCommand::mov, at(AsmRegister::r8, AsmMemory::byte), AsmRegister::dl },
+		{ AsmCommand::inc, AsmRegister::r8 },
+		{ AsmCommand::inc, AsmRegister::r9 },
+		{ AsmCommand::cmp, AsmRegister::r9, AsmRegister::rsp },
+		{ AsmCommand::jnz, copy },
+		{ AsmCommand::ret },
+	};
+	code.routines.push_back(digitsRoutine);
+
+	// the upper half of rdi isn't a part of the argument, the magnitude of a negative value fits an unsigned dword
+	std::string positive = code.getLabel("POSITIVE");
+	auto intRoutine = routine(writeInt);
+	intRoutine.commands = {
+		{ AsmCommand::push, AsmRegister::rdi },
+		{ AsmCommand::call, reserve },
+		{ AsmCommand::pop, AsmRegister::rax },
+		{ AsmCommand::mov, AsmRegister::eax, AsmRegister::eax },
+		{ AsmCommand::test, AsmRegister::eax, AsmRegister::eax },
+		{ AsmCommand::jge, positive },
+		{ AsmCommand::mov, at(AsmRegister::r8, AsmMemory::byte), "45" },
+		{ AsmCommand::inc, AsmRegister::r8 },
+		{ AsmCommand::neg, AsmRegister::eax },
+		{ AsmCommand::label, positive },
+		{ AsmCommand::mov, AsmRegister::ecx, "1" },
+		{ AsmCommand::call, digits },
+		{ AsmCommand::jmp, newLine },
+	};
+	code.routines.push_back(intRoutine);
+
+	auto charRoutine = routine(writeChar);
+	charRoutine.commands = {
+		{ AsmCommand::push, AsmRegister::rdi },
+		{ AsmCommand::call, reserve },
+		{ AsmCommand::pop, AsmRegister::rax },
+		{ AsmCommand::mov, at(AsmRegister::r8, AsmMemory::byte), AsmRegister::al },
+		{ AsmCommand::inc, AsmRegister::r8 },
+		{ AsmCommand::jmp, newLine },
+	};
+	code.routines.push_back(charRoutine);
+
+	// as printf("%f"), the value scaled by 10^6 is rounded to the nearest integer, so the magnitude
+	// has to be below 2^63 / 10^6, the syscalls of the flush keep xmm0
+	std::string magnitude = code.getLabel("MAGNITUDE");
+	auto doubleRoutine = routine(writeDouble);
+	doubleRoutine.commands = {
+		{ AsmCommand::call, reserve },
+		{ AsmCommand::movmskpd, AsmRegister::eax, AsmRegister::xmm0 },
+		{ AsmCommand::test, AsmRegister::eax, "1" },
+		{ AsmCommand::jz, magnitude },
+		{ AsmCommand::mov, at(AsmRegister::r8, AsmMemory::byte), "45" },
+		{ AsmCommand::inc, AsmRegister::r8 },
+		{ AsmCommand::mulsd, AsmRegister::xmm0, label(code.doubleLabel(-1.0), AsmMemory::qword) },
+		{ AsmCommand::label, magnitude },
+		{ AsmCommand::mulsd, AsmRegister::xmm0, label(code.doubleLabel(1000000.0), AsmMemory::qword) },
+		{ AsmCommand::cvtsd2si, AsmRegister::rax, AsmRegister::xmm0 },
+		{ AsmCommand::xor, AsmRegister::edx, AsmRegister::edx },
+		{ AsmCommand::mov, AsmRegister::ecx, "1000000" },
+		{ AsmCommand::div, AsmRegister::rcx },
+		{ AsmCommand::push, AsmRegister::rdx },
+		{ AsmCommand::mov, AsmRegister::ecx, "1" },
+		{ AsmCommand::call, digits },
+		{ AsmCommand::mov, at(AsmRegister::r8, AsmMemory::byte), "46" },
+		{ AsmCommand::inc, AsmRegister::r8 },
+		{ AsmCommand::pop, AsmRegister::rax },
+		{ AsmCommand::mov, AsmRegister::ecx, "6" },
+		{ AsmCommand::call, digits },
+		{ AsmCommand::jmp, newLine },
+	};
+	code.routines.push_back(doubleRoutine);
+	addRead(code);
+}
+
+void Runtime::addRead(AsmCode &code)
+{
+	AsmData inputData(input, false);
+	inputData.alignment = 16;
+	inputData.reserved = bufferSize;
+	code.data.push_back(inputData);
+	for (auto &name : { inputPosition, inputLength }) {
+		AsmData data(name, false);
+		data.reserved = 4;
+		code.data.push_back(data);
+	}
+	auto position = label(inputPosition, AsmMemory::dword);
+
+	// eax = the next byte of the input, -1 at its end, the buffer is filled by the read syscall
+	// after the text written so far is flushed. r8-r10 are kept.
+	std::string available = code.getLabel("AVAILABLE"), filled = code.getLabel("FILLED");
+	auto peekRoutine = routine(peek);
+	peekRoutine.commands = {
+		{ AsmCommand::mov, AsmRegister::eax, position },
+		{ AsmCommand::cmp, AsmRegister::eax, label(inputLength, AsmMemory::dword) },
+		{ AsmCommand::jl, available },
+		{ AsmCommand::call, flush },
+		{ AsmCommand::xor, AsmRegister::eax, AsmRegister::eax },
+		{ AsmCommand::xor, AsmRegister::edi, AsmRegister::edi },
+		{ AsmCommand::lea, AsmRegister::rsi, label(input, AsmMemory::byte) },
+		{ AsmCommand::mov, AsmRegister::edx, std::to_string(bufferSize) },
+		{ AsmCommand::syscall },
+		{ AsmCommand::mov, position, "0" },
+		{ AsmCommand::mov, label(inputLength, AsmMemory::dword), "0" },
+		{ AsmCommand::test, AsmRegister::eax, AsmRegister::eax },
+		{ AsmCommand::jg, filled },
+		{ AsmCommand::mov, AsmRegister::eax, "-1" },
+		{ AsmCommand::ret },
+		{ AsmCommand::label, filled },
+		{ AsmCommand::mov, label(inputLength, AsmMemory::dword), AsmRegister::eax },
+		{ AsmCommand::xor, AsmRegister::eax, AsmRegister::eax },
+		{ AsmCommand::label, available },
+		{ AsmCommand::lea, AsmRegister::rcx, label(input, AsmMemory::byte) },
+		{ AsmCommand::add, AsmRegister::rcx, AsmRegister::rax },
+		{ AsmCommand::movzx, AsmRegister::eax, at(AsmRegister::rcx, AsmMemory::byte) },
+		{ AsmCommand::ret },
+	};
+	code.routines.push_back(peekRoutine);
+
+	// takes the byte peeked and peeks the next one
+	auto nextRoutine = routine(next);
+	nextRoutine.commands = {
+		{ AsmCommand::inc, position },
+		{ AsmCommand::jmp, peek },
+	};
+	code.routines.push_back(nextRoutine);
+
+	// white space is any byte up to the space
+	std::string skipLoop = code.getLabel("SKIP"), skipped = code.getLabel("SKIPPED");
+	auto skipRoutine = routine(skip);
+	skipRoutine.commands = {
+		{ AsmCommand::call, peek },
+		{ AsmCommand::label, skipLoop },
+		{ AsmCommand::cmp, AsmRegister::eax, "32" },
+		{ AsmCommand::jg, skipped },
+		{ AsmCommand::test, AsmRegister::eax, AsmRegister::eax },
+		{ AsmCommand::jl, skipped },
+		{ AsmCommand::call, next },
+		{ AsmCommand::jmp, skipLoop },
+		{ AsmCommand::label, skipped },
+		{ AsmCommand::ret },
+	};
+	code.routines.push_back(skipRoutine);
+
+	// takes a sign at the byte in eax, r9d = 1 if it was a minus
+	std::string plus = code.getLabel("PLUS");
+	auto signRoutine = routine(sign);
+	signRoutine.commands = {
+		{ AsmCommand::xor, AsmRegister::r9d, AsmRegister::r9d },
+		{ AsmCommand::cmp, AsmRegister::eax, "45" },
+		{ AsmCommand::jnz, plus },
+		{ AsmCommand::inc, AsmRegister::r9d },
+		{ AsmCommand::jmp, next },
+		{ AsmCommand::label, plus },
+		{ AsmCommand::cmp, AsmRegister::eax, "43" },
+		{ AsmCommand::jz, next },
+		{ AsmCommand::ret },
+	};
+	code.routines.push_back(signRoutine);
+
+	// the digits are accumulated in r8d, a byte that isn't one is above 9 when 48 is subtracted as unsigned
+	std::string intDigit = code.getLabel("DIGIT"), intEnd = code.getLabel("NUMBER"), intDone = code.getLabel("DONE");
+	auto intRoutine = routine(readInt);
+	intRoutine.commands = {
+		{ AsmCommand::call, skip },
+		{ AsmCommand::call, sign },
+		{ AsmCommand::xor, AsmRegister::r8d, AsmRegister::r8d },
+		{ AsmCommand::label, intDigit },
+		{ AsmCommand::sub, AsmRegister::eax, "48" },
+		{ AsmCommand::cmp, AsmRegister::eax, "9" },
+		{ AsmCommand::ja, intEnd },
+		{ AsmCommand::imul, AsmRegister::r8d, "10" },
+		{ AsmCommand::add, AsmRegister::r8d, AsmRegister::eax },
+		{ AsmCommand::call, next },
+		{ AsmCommand::jmp, intDigit },
+		{ AsmCommand::label, intEnd },
+		{ AsmCommand::mov, AsmRegister::eax, AsmRegister::r8d },
+		{ AsmCommand::test, AsmRegister::r9d, AsmRegister::r9d },
+		{ AsmCommand::jz, intDone },
+		{ AsmCommand::neg, AsmRegister::eax },
+		{ AsmCommand::label, intDone },
+		{ AsmCommand::ret },
+	};
+	code.routines.push_back(intRoutine);
+
+	std::string end = code.getLabel("END");
+	auto charRoutine = routine(readChar);
+	charRoutine.commands = {
+		{ AsmCommand::call, peek },
+		{ AsmCommand::test, AsmRegister::eax, AsmRegister::eax },
+		{ AsmCommand::jl, end },
+		{ AsmCommand::inc, position },
+		{ AsmCommand::ret },
+		{ AsmCommand::label, end },
+		{ AsmCommand::xor, AsmRegister::eax, AsmRegister::eax },
+		{ AsmCommand::ret },
+	};
+	code.routines.push_back(charRoutine);
+
+	// as inputDouble, the mantissa is accumulated in r8 and the exponent in r10d, the sign of the value
+	// is kept in ebx while r12d holds the exponent written
+	std::string integer = code.getLabel("INTEGER"), dropped = code.getLabel("DROPPED"), point = code.getLabel("POINT");
+	std::string fraction = code.getLabel("FRACTION"), fractionNext = code.getLabel("FRACTION_NEXT");
+	std::string exponent = code.getLabel("EXPONENT"), written = code.getLabel("WRITTEN"), exponentDigit = code.getLabel("EXPONENT_DIGIT");
+	std::string exponentNext = code.getLabel("EXPONENT_NEXT"), exponentEnd = code.getLabel("EXPONENT_END"), positiveExponent = code.getLabel("POSITIVE_EXPONENT");
+	std::string scale = code.getLabel("SCALE"), power = code.getLabel("POWER"), apply = code.getLabel("APPLY");
+	std::string divide = code.getLabel("DIVIDE"), negate = code.getLabel("NEGATE"), done = code.getLabel("DONE");
+	auto limit = std::to_string(mantissaLimit);
+	auto doubleRoutine = routine(readDouble);
+	doubleRoutine.commands = {
+		{ AsmCommand::push, AsmRegister::rbx },
+		{ AsmCommand::push, AsmRegister::r12 },
+		{ AsmCommand::call, skip },
+		{ AsmCommand::call, sign },
+		{ AsmCommand::xor, AsmRegister::r8d, AsmRegister::r8d },
+		{ AsmCommand::xor, AsmRegister::r10d, AsmRegister::r10d },
+		{ AsmCommand::label, integer },
+		{ AsmCommand::sub, AsmRegister::eax, "48" },
+		{ AsmCommand::cmp, AsmRegister::eax, "9" },
+		{ AsmCommand::ja, point },
+		{ AsmCommand::mov, AsmRegister::rcx, limit },
+		{ AsmCommand::cmp, AsmRegister::r8, AsmRegister::rcx },
+		{ AsmCommand::jge, dropped },
+		{ AsmCommand::imul, AsmRegister::r8, "10" },
+		{ AsmCommand::add, AsmRegister::r8, AsmRegister::rax },
+		{ AsmCommand::call, next },
+		{ AsmCommand::jmp, integer },
+		{ AsmCommand::label, dropped },
+		{ AsmCommand::inc, AsmRegister::r10d },
+		{ AsmCommand::call, next },
+		{ AsmCommand::jmp, integer },
+		// the point is 46 and e and E are 101 and 69 with 48 subtracted
+		{ AsmCommand::label, point },
+		{ AsmCommand::cmp, AsmRegister::eax, "-2" },
+		{ AsmCommand::jnz, exponent },
+		{ AsmCommand::call, next },
+		{ AsmCommand::label, fraction },
+		{ AsmCommand::sub, AsmRegister::eax, "48" },
+		{ AsmCommand::cmp, AsmRegister::eax, "9" },
+		{ AsmCommand::ja, exponent },
+		{ AsmCommand::mov, AsmRegister::rcx, limit },
+		{ AsmCommand::cmp, AsmRegister::r8, AsmRegister::rcx },
+		{ AsmCommand::jge, fractionNext },
+		{ AsmCommand::imul, AsmRegister::r8, "10" },
+		{ AsmCommand::add, AsmRegister::r8, AsmRegister::rax },
+		{ AsmCommand::dec, AsmRegister::r10d },
+		{ AsmCommand::label, fractionNext },
+		{ AsmCommand::call, next },
+		{ AsmCommand::jmp, fraction },
+		{ AsmCommand::label, exponent },
+		{ AsmCommand::cmp, AsmRegister::eax, "53" },
+		{ AsmCommand::jz, written },
+		{ AsmCommand::cmp, AsmRegister::eax, "21" },
+		{ AsmCommand::jnz, scale },
+		{ AsmCommand::label, written },
+		{ AsmCommand::mov, AsmRegister::ebx, AsmRegister::r9d },
+		{ AsmCommand::call, next },
+		{ AsmCommand::call, sign },
+		{ AsmCommand::xor, AsmRegister::r12d, AsmRegister::r12d },
+		{ AsmCommand::label, exponentDigit },
+		{ AsmCommand::sub, AsmRegister::eax, "48" },
+		{ AsmCommand::cmp, AsmRegister::eax, "9" },
+		{ AsmCommand::ja, exponentEnd },
+		{ AsmCommand::cmp, AsmRegister::r12d, std::to_string(exponentLimit) },
+		{ AsmCommand::jge, exponentNext },
+		{ AsmCommand::imul, AsmRegister::r12d, "10" },
+		{ AsmCommand::add, AsmRegister::r12d, AsmRegister::eax },
+		{ AsmCommand::label, exponentNext },
+		{ AsmCommand::call, next },
+		{ AsmCommand::jmp, exponentDigit },
+		{ AsmCommand::label, exponentEnd },
+		{ AsmCommand::test, AsmRegister::r9d, AsmRegister::r9d },
+		{ AsmCommand::jz, positiveExponent },
+		{ AsmCommand::neg, AsmRegister::r12d },
+		{ AsmCommand::label, positiveExponent },
+		{ AsmCommand::add, AsmRegister::r10d, AsmRegister::r12d },
+		{ AsmCommand::mov, AsmRegister::r9d, AsmRegister::ebx },
+		// xmm1 = 10^|r10d|
+		{ AsmCommand::label, scale },
+		{ AsmCommand::cvtsi2sd, AsmRegister::xmm0, AsmRegister::r8 },
+		{ AsmCommand::test, AsmRegister::r8, AsmRegister::r8 },
+		{ AsmCommand::jz, negate },
+		{ AsmCommand::movsd, AsmRegister::xmm1, label(code.doubleLabel(1.0), AsmMemory::qword) },
+		{ AsmCommand::mov, AsmRegister::ecx, AsmRegister::r10d },
+		{ AsmCommand::test, AsmRegister::ecx, AsmRegister::ecx },
+		{ AsmCommand::jge, power },
+		{ AsmCommand::neg, AsmRegister::ecx },
+		{ AsmCommand::label, power },
+		{ AsmCommand::test, AsmRegister::ecx, AsmRegister::ecx },
+		{ AsmCommand::jz, apply },
+		{ AsmCommand::mulsd, AsmRegister::xmm1, label(code.doubleLabel(10.0), AsmMemory::qword) },
+		{ AsmCommand::dec, AsmRegister::ecx },
+		{ AsmCommand::jmp, power },
+		{ AsmCommand::label, apply },
+		{ AsmCommand::test, AsmRegister::r10d, AsmRegister::r10d },
+		{ AsmCommand::jl, divide },
+		{ AsmCommand::mulsd, AsmRegister::xmm0, AsmRegister::xmm1 },
+		{ AsmCommand::jmp, negate },
+		{ AsmCommand::label, divide },
+		{ AsmCommand::divsd, AsmRegister::xmm0, AsmRegister::xmm1 },
+		{ AsmCommand::label, negate },
+		{ AsmCommand::test, AsmRegister::r9d, AsmRegister::r9d },
+		{ AsmCommand::jz, done },
+		{ AsmCommand::mulsd, AsmRegister::xmm0, label(code.doubleLabel(-1.0), AsmMemory::qword) },
+		{ AsmCommand::label, done },
+		{ AsmCommand::pop, AsmRegister::r12 },
+		{ AsmCommand::pop, AsmRegister::rbx },
+		{ AsmCommand::ret },
+	};
+	code.routines.push_back(doubleRoutine);
+}
+
+void Runtime::addRangeError(AsmCode &code)
+{
+	auto errorRoutine = routine(rangeError);
+	if (code.target != AsmCode::linux64) {
+		errorRoutine.commands = {
+			{ AsmCommand::printf, "\"Range check error\\n\"" },
+			{ AsmCommand::push, std::to_string(rangeErrorCode) },
+			{ AsmCommand::call, "ExitProcess" },
+		};
+		code.routines.push_back(errorRoutine);
+		return;
+	}
+
+	addMessage(code, rangeMessage, rangeText);
+	errorRoutine.commands = {
+		{ AsmCommand::lea, AsmRegister::rsi, label(rangeMessage, AsmMemory::byte) },
+		{ AsmCommand::mov, AsmRegister::edx, std::to_string(rangeText.size()) },
+		{ AsmCommand::mov, AsmRegister::ebx, std::to_string(rangeErrorCode) },
+		{ AsmCommand::jmp, fail },
+	};
+	code.routines.push_back(errorRoutine);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+
+#include "Generator.h"
+
+// Runtime of the Linux x86-64 target written in commands. The entry point maps a stack in the low 2 GB,
+// so the addresses of the program fit its 32-bit registers as they do those of the data linked there,
+// and calls the main program. Integers, characters and doubles are written to a buffer with a line break
+// after each one, the buffer is flushed by the write syscall when it fills up, before the program waits
+// for input and at exit. The input is read by the read syscall into a buffer of its own. A division
+// by zero or a fault of the program ends it with a message after the text written before it.
+// The routines follow the System V calling convention.
+class Runtime {
+public:
+	static const std::string start;
+	// label of the main program
+	static const std::string main;
+	// the value is in edi, a double in xmm0
+	static const std::string writeInt, writeChar, writeDouble;
+	// the value is returned in eax, a double in xmm0. An integer is an optional sign and decimal digits
+	// after white space, a double may have a fraction and an exponent too, the value is 0 if there are
+	// no digits. A character is the next byte, 0 at the end of the input.
+	static const std::string readInt, readChar, readDouble;
+	static const std::string exit;
+	// jumped to by a failed range check, it ends the program with exit code 201
+	static const std::string rangeError;
+	static const int rangeErrorCode = 201;
+	// exit codes of the program stopped by SIGFPE, by overflowing its stack or by another SIGSEGV
+	static const int divisionErrorCode = 200, stackOverflowCode = 202, accessViolationCode = 216;
+
+	// stack of the routines, the frame of the main program holding its variables is mapped on top of it
+	static const int stackSize = 8 << 20;
+	static const int maxFrameSize = 1 << 30;
+	// a fault at an address this close below the stack is its overflow
+	static const int guardSize = 1 << 20;
+	static const int signalStackSize = 64 << 10;
+	static const int bufferSize = 4096;
+
+	// bytes of the stack mapped for the program whose main program has the frame
+	static int stackBytes(int frameSize);
+
+	// read the values from stdin as the routines do for the program run in the compiler
+	static int inputInt();
+	static int inputChar();
+	static double inputDouble();
+
+	// adds the routines and their data to the code
+	static void add(AsmCode &code);
+	// adds the routine reporting range check errors, on Windows the message is printed by printf
+	static void addRangeError(AsmCode &code);
+
+private:
+	static const std::string flush, reserve, digits, newLine, fail, fault, peek, next, skip, sign;
+	static const std::string buffer, length, input, inputPosition, inputLength, stackBase, signalStack;
+	static const std::string rangeMessage, divisionMessage, stackMessage, accessMessage;
+
+	static void addMessage(AsmCode &code, const std::string &label, const std::string &text);
+	static void addRead(AsmCode &code);
+};
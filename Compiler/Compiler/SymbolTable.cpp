@@ -1,5 +1,6 @@
 #include <algorithm>
 #include "SymbolTable.h"
+#include "IrBuilder.h"
 #include "Utils.h"
 
 const std::vector<std::string> Symbol::categoryName = {
@@ -61,10 +62,10 @@ PSymbol SymbolTable::getSymbol(PToken token)
 	return nullptr;
 }
 
-void SymbolTable::toAsmCode(AsmCode &code)
+void SymbolTable::toIr(IrBuilder &builder)
 {
 	for (auto symbol : symbolsArray) {
-		code.addSymbol(symbol);
+		builder.declare(symbol);
 	}
 }
 
@@ -50,7 +50,7 @@ public:
 
 	PSymbol getSymbol(PToken token);
 
-	void toAsmCode(AsmCode &code);
+	void toIr(IrBuilder &builder);
 
 private:
 	void addSymbol(PSymbol symbol);
@@ -1,233 +1,641 @@
 ﻿#include <codecvt>
+#include <sstream>
+#include <cstring>
 #include "SyntaxObject.h"
 #include "Utils.h"
 #include "Types.h"
 #include "Operation.h"
+#include "IrBuilder.h"
+#include "Vectorizer.h"
 
 SyntaxNode::SyntaxNode(PToken token, PType type, std::vector<PSyntaxNode> children, Category category)
 	: token(token), type(type), children(children), category(category)
 {
 }
 
-void SyntaxNode::print(std::string &output, std::string prefix, bool end)
+void SyntaxNode::print(TreePrinter &printer, bool end)
 {
-	//std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
 	if (token) {
-		output += prefix + (end ? "--- " : "|-- ") + token->text + "\n"; //converter.from_bytes(token->text) << std::endl;
+		printer.indent() << (end ? "--- " : "|-- ") << token->text << '\n';
 	}
 
 	if (children.empty()) {
 		return;
 	}
 
-	prefix += (end ? "    " : "|   ");
+	printer.pushIndent(end ? "    " : "|   ");
 	if (token) {
-		increaseIndent(prefix, (int)token->text.length() - 1);
+		printer.pushIndent((int)token->text.length() - 1);
 	}
-	children[0]->print(output, prefix, false);
+	children[0]->print(printer, false);
 
 	for (int i = 1; i < children.size(); ++i) {
-		children[i]->print(output, prefix, i == (int)children.size() - 1);
+		children[i]->print(printer, i == (int)children.size() - 1);
 	}
 
 	if (token) {
-		decreaseIndent(prefix, token->text.length());
+		printer.popIndent();
 	}
+	printer.popIndent();
 }
 
 std::string SyntaxNode::toString(std::string prefix)
 {
-	std::string res;
-	print(res, prefix, false);
-	return res;
+	std::ostringstream res;
+	TreePrinter printer(res);
+	printer.pushIndent(prefix);
+	print(printer, false);
+	return res.str();
 }
 
-void SyntaxNode::toAsmCode(AsmCode & code)
+void ConstData::store(PType type, int offset, PIdentifierValue value)
+{
+	char *p = bytes.data() + offset;
+	if (type->category == Type::INTEGER) {
+		int integer = value->toInteger();
+		memcpy(p, &integer, sizeof(integer));
+	}
+	else if (type->category == Type::DOUBLE) {
+		double _double = value->toDouble();
+		memcpy(p, &_double, sizeof(_double));
+	}
+	else if (type->category == Type::CHAR) {
+		*p = (char)value->toInteger();
+	}
+	else if (type->category == Type::STRING) {
+		int index = (int)strings.size();
+		strings.push_back(value->getString());
+		memcpy(p, &index, sizeof(index));
+	}
+}
+
+PIdentifierValue ConstData::load(PType type, int offset)
+{
+	const char *p = bytes.data() + offset;
+	if (type->category == Type::INTEGER) {
+		int integer;
+		memcpy(&integer, p, sizeof(integer));
+		return std::make_shared<IdentifierValue>(integer);
+	}
+	else if (type->category == Type::DOUBLE) {
+		double _double;
+		memcpy(&_double, p, sizeof(_double));
+		return std::make_shared<IdentifierValue>(_double);
+	}
+	else if (type->category == Type::CHAR) {
+		return std::make_shared<IdentifierValue>(*p);
+	}
+	else if (type->category == Type::STRING) {
+		int index;
+		memcpy(&index, p, sizeof(index));
+		return std::make_shared<IdentifierValue>(strings[index]);
+	}
+	throw std::exception("Constant of this type can't be loaded");
+}
+
+TypedConstNode::TypedConstNode(PType type, PConstData data, int offset)
+	: SyntaxNode(std::make_shared<Token>(IDENTIFIER, 0, 0, Type::categoryName[type->category]), type,
+		std::vector<PSyntaxNode>(), CONST_NODE), data(data), offset(offset)
+{
+}
+
+PSyntaxNode TypedConstNode::element(PType elementType, int elementOffset)
+{
+	static const std::map<Type::Category, TokenType> tokenTypes = {
+		{ Type::INTEGER, CONST_INTEGER },
+		{ Type::DOUBLE, CONST_DOUBLE },
+		{ Type::CHAR, CONST_CHARACTER },
+		{ Type::STRING, CONST_STRING },
+	};
+
+	if (!tokenTypes.count(elementType->category)) {
+		return std::make_shared<TypedConstNode>(elementType, data, offset + elementOffset);
+	}
+	return std::make_shared<ConstNode>(std::make_shared<Token>(tokenTypes.at(elementType->category), token->row, token->col, ""),
+		elementType, data->load(elementType, offset + elementOffset));
+}
+
+// prints the same tree as a node per element would give
+static void printConstData(TreePrinter &printer, PType type, ConstData &data, int offset, bool end)
+{
+	bool simple = Type::simpleCategories.count(type->category) != 0;
+	std::string text = simple ? data.load(type, offset)->toString() : Type::categoryName[type->category];
+	printer.indent() << (end ? "--- " : "|-- ") << text << '\n';
+	if (simple) {
+		return;
+	}
+
+	int count;
+	if (type->category == Type::ARRAY) {
+		auto arrayType = std::static_pointer_cast<ArrayType>(type);
+		count = arrayType->right->value->toInteger() - arrayType->left->value->toInteger() + 1;
+	}
+	else {
+		count = (int)std::static_pointer_cast<RecordType>(type)->fields->symbolsArray.size();
+	}
+	if (count == 0) {
+		return;
+	}
+
+	printer.pushIndent(end ? "    " : "|   ");
+	printer.pushIndent((int)text.length() - 1);
+	for (int i = 0; i < count; ++i) {
+		bool last = (i != 0 && i == count - 1);
+		if (type->category == Type::ARRAY) {
+			PType elementType = std::static_pointer_cast<ArrayType>(type)->elementType;
+			printConstData(printer, elementType, data, offset + i * elementType->size, last);
+		}
+		else {
+			auto recordType = std::static_pointer_cast<RecordType>(type);
+			printConstData(printer, recordType->fields->symbolsArray[i]->type, data, offset + recordType->fieldOffset(i), last);
+		}
+	}
+	printer.popIndent();
+	printer.popIndent();
+}
+
+void TypedConstNode::print(TreePrinter &printer, bool end)
+{
+	printConstData(printer, type, *data, offset, end);
+}
+
+IrOperand TypedConstNode::addressToIr(IrBuilder &builder)
+{
+	if (!builder.code.constantLabels.count(this)) {
+		throw std::exception("Typed constant is not placed in memory");
+	}
+	return builder.emit(IrInstruction::ADDR, IrOperand::label(builder.code.constantLabels[this]));
+}
+
+void SyntaxNode::toIr(IrBuilder &builder)
 {
 	for (auto child : children) {
-		child->toAsmCode(code);
+		child->toIr(builder);
 	}
 }
 
-void WriteNode::toAsmCode(AsmCode &code)
+IrOperand SyntaxNode::valueToIr(IrBuilder &builder)
+{
+	throw std::exception("Expression can't be evaluated");
+}
+
+IrOperand SyntaxNode::addressToIr(IrBuilder &builder)
+{
+	throw std::exception("Variable expected");
+}
+
+void SyntaxNode::conditionToIr(IrBuilder &builder, int trueBlock, int falseBlock)
+{
+	builder.branch(IrInstruction::NE, valueToIr(builder), IrOperand::immediate(0), trueBlock, falseBlock);
+}
+
+// type of the values of a simple type in memory
+static IrInstruction::Type irType(PType type)
+{
+	if (type->category == Type::CHAR) {
+		return IrInstruction::I8;
+	}
+	if (type->category == Type::INTEGER || type->category == Type::STRING) {
+		return IrInstruction::I32;
+	}
+	if (type->category == Type::DOUBLE) {
+		return IrInstruction::F64;
+	}
+	throw std::exception("Values of this type can't be loaded");
+}
+
+// integers and chars are both kept as integers in registers, doubles are converted
+static IrOperand convertIr(IrBuilder &builder, IrOperand value, PType from, PType to)
+{
+	bool fromDouble = from->category == Type::DOUBLE, toDouble = to->category == Type::DOUBLE;
+	if (fromDouble == toDouble) {
+		return value;
+	}
+	if (toDouble) {
+		return builder.emit(IrInstruction::ITOF, value, IrOperand(), IrInstruction::F64);
+	}
+	return builder.emit(IrInstruction::FTOI, value);
+}
+
+static IrOperand loadIr(IrBuilder &builder, PType type, IrOperand address)
+{
+	return builder.emit(IrInstruction::LOAD, address, IrOperand(), irType(type));
+}
+
+static void storeIr(IrBuilder &builder, PType type, IrOperand address, IrOperand value)
+{
+	IrInstruction store(IrInstruction::STORE, irType(type));
+	store.a = address;
+	store.b = value;
+	builder.emit(store);
+}
+
+void WriteNode::toIr(IrBuilder &builder)
 {
 	if (children.size() != 1) {
 		throw std::exception("Write can't contain more than one argument");
 	}
-	
-	std::string res = "\"";
+
 	auto child = children[0];
-	AsmMemory::DataSize size;
+	IrInstruction write(IrInstruction::WRITE, child->type->category == Type::CHAR ? IrInstruction::I8 :
+		child->type->category == Type::DOUBLE ? IrInstruction::F64 : IrInstruction::I32);
+	write.a = child->valueToIr(builder);
+	builder.emit(write);
+}
 
-	if (child->type->category == Type::Category::CHAR) {
-		res += "%c";
-		size = AsmMemory::DataSize::byte;
+IrOperand ConstNode::valueToIr(IrBuilder &builder)
+{
+	if (type->category == Type::DOUBLE) {
+		return builder.emit(IrInstruction::LOAD, IrOperand::label(builder.code.doubleLabel(value->toDouble())), IrOperand(), IrInstruction::F64);
 	}
-	else if (child->type->category == Type::Category::INTEGER) {
-		res += "%d";
-		size = AsmMemory::DataSize::dword;
+	if (type->category != Type::INTEGER && type->category != Type::CHAR) {
+		throw std::exception("Expression can't be evaluated");
 	}
+	return IrOperand::immediate(value->toInteger());
+}
 
-	res += "\\n\"";
-	child->toAsmCode(code);
-	code.push_back({ AsmCommand::CommandType::pop, AsmRegister::eax });
+IrOperand CastNode::valueToIr(IrBuilder &builder)
+{
+	return convertIr(builder, children[0]->valueToIr(builder), children[0]->type, newType);
+}
 
-	code.push_back({ AsmCommand::CommandType::printf });
-	code.commands.back().push_back(std::make_shared<AsmValue>(res));
-	code.commands.back().push_back(std::make_shared<AsmRegister>(AsmRegister::eax));
+IrOperand VarNode::valueToIr(IrBuilder &builder)
+{
+	std::string name = lowerString(token->text);
+	int reg = builder.variableRegister(name);
+	if (reg != -1) {
+		return IrOperand::reg(reg);
+	}
+	return loadIr(builder, type, builder.storage(name));
 }
 
-void ConstNode::toAsmCode(AsmCode & code)
+IrOperand VarNode::addressToIr(IrBuilder &builder)
 {
-	code.push_back({ AsmCommand::CommandType::push, value->toString() });
+	auto address = builder.storage(lowerString(token->text));
+	return address.isRegister() ? address : builder.emit(IrInstruction::ADDR, address);
 }
 
-void VarNode::toAsmCode(AsmCode & code)
+IrOperand IndexNode::valueToIr(IrBuilder &builder)
 {
-	code.push_back({ AsmCommand::CommandType::push, AsmMemory::DataSize::dword, code.offsets[lowerString(token->text)] });
+	return loadIr(builder, type, addressToIr(builder));
 }
 
-void logicalOpAsmCode(AsmCode &code, PSyntaxNode node)
+IrOperand IndexNode::addressToIr(IrBuilder &builder)
 {
-	std::map<TokenType, AsmCommand::CommandType> comTypes = {
-		{ OP_GREATER, AsmCommand::setle },
-		{ OP_LESS, AsmCommand::setge },
-		{ OP_GREATER_OR_EQUAL, AsmCommand::setl },
-		{ OP_LESS_OR_EQUAL, AsmCommand::setg },
-		{ OP_EQUAL, AsmCommand::setne },
-		{ OP_NOT_EQUAL, AsmCommand::sete },
-	};
+	auto arrayType = std::static_pointer_cast<ArrayType>(children[0]->type);
+	int left = arrayType->left->value->toInteger();
+	int elementSize = arrayType->elementType->size;
+
+	auto address = children[0]->addressToIr(builder);
+	if (children[1]->category == CONST_NODE) {
+		int offset = (std::static_pointer_cast<ConstNode>(children[1])->value->toInteger() - left) * elementSize;
+		return offset != 0 ? builder.emit(IrInstruction::ADD, address, IrOperand::immediate(offset)) : address;
+	}
+
+	auto index = children[1]->valueToIr(builder);
+	if (left != 0) {
+		index = builder.emit(IrInstruction::SUB, index, IrOperand::immediate(left));
+	}
+	if (builder.rangeChecks) {
+		IrInstruction check(IrInstruction::CHECK);
+		check.a = index;
+		check.b = IrOperand::immediate(arrayType->right->value->toInteger() - left);
+		builder.emit(check);
+	}
+	if (elementSize != 1) {
+		index = builder.emit(IrInstruction::MUL, index, IrOperand::immediate(elementSize));
+	}
+	return builder.emit(IrInstruction::ADD, address, index);
+}
 
-	auto tmp = comTypes[node->token->type];
+IrOperand FieldAccessNode::valueToIr(IrBuilder &builder)
+{
+	return loadIr(builder, type, addressToIr(builder));
+}
 
-	node->children[0]->toAsmCode(code);
-	node->children[1]->toAsmCode(code);
+IrOperand FieldAccessNode::addressToIr(IrBuilder &builder)
+{
+	auto recordType = std::static_pointer_cast<RecordType>(children[0]->type);
+	auto address = children[0]->addressToIr(builder);
+	int offset = recordType->fieldOffset(recordType->fieldIndex(children[1]->token->text));
+	return offset != 0 ? builder.emit(IrInstruction::ADD, address, IrOperand::immediate(offset)) : address;
+}
 
-	code.push_back({ AsmCommand::pop, AsmRegister::ebx });
-	code.push_back({ AsmCommand::cmp, AsmMemory::DataSize::dword, AsmRegister::esp, AsmRegister::ebx });
-	
-	code.push_back({ comTypes[node->token->type], AsmRegister::al });
-	code.push_back({ AsmCommand::sub, AsmRegister::al, "1" });
-	code.push_back({ AsmCommand::movsx, AsmRegister::eax, AsmRegister::al });
-	code.push_back({ AsmCommand::mov, AsmMemory::DataSize::dword, AsmRegister::esp, AsmRegister::eax });
+// number of registers needed to evaluate an expression, division ties up eax and edx
+static int registerNeed(PSyntaxNode node)
+{
+	if (node->children.empty()) {
+		return 1;
+	}
+	int need = registerNeed(node->children[0]);
+	if (node->children.size() > 1) {
+		int right = registerNeed(node->children[1]);
+		need = need == right ? need + 1 : std::max(need, right);
+	}
+	if (node->token->type == KEYWORD_DIV || node->token->type == KEYWORD_MOD) {
+		need = std::max(need, 3);
+	}
+	return need;
 }
 
-void BinaryOpNode::toAsmCode(AsmCode &code)
+// evaluates the operand needing more registers first so that fewer values are live across it
+static void operandsToIr(IrBuilder &builder, SyntaxNode &node, IrOperand &left, IrOperand &right)
 {
-	if (Operation::logicalTypes.count(token->type)) {
-		logicalOpAsmCode(code, std::make_shared<SyntaxNode>(*this));
+	if (registerNeed(node.children[1]) > registerNeed(node.children[0])) {
+		right = node.children[1]->valueToIr(builder);
+		left = node.children[0]->valueToIr(builder);
 		return;
 	}
+	left = node.children[0]->valueToIr(builder);
+	right = node.children[1]->valueToIr(builder);
+}
+
+// comparisons of doubles are done in SSE registers, all other operations take integers
+static IrInstruction::Type irOperandsType(SyntaxNode &node)
+{
+	return node.children[0]->type->category == Type::DOUBLE ? IrInstruction::F64 : IrInstruction::I32;
+}
+
+static const std::map<TokenType, IrInstruction::Condition> conditions = {
+	{ OP_EQUAL, IrInstruction::EQ },
+	{ OP_NOT_EQUAL, IrInstruction::NE },
+	{ OP_LESS, IrInstruction::LT },
+	{ OP_LESS_OR_EQUAL, IrInstruction::LE },
+	{ OP_GREATER, IrInstruction::GT },
+	{ OP_GREATER_OR_EQUAL, IrInstruction::GE },
+};
 
-	std::map<TokenType, AsmCommand::CommandType> comTypes = {
-		{ OP_PLUS, AsmCommand::add },
-		{ OP_MINUS, AsmCommand::sub },
-		{ OP_MULT, AsmCommand::imul },
-		{ KEYWORD_DIV, AsmCommand::idiv },
+IrOperand BinaryOpNode::valueToIr(IrBuilder &builder)
+{
+	static const std::map<TokenType, IrInstruction::Opcode> opcodes = {
+		{ OP_PLUS, IrInstruction::ADD },
+		{ OP_MINUS, IrInstruction::SUB },
+		{ OP_MULT, IrInstruction::MUL },
+		{ KEYWORD_DIV, IrInstruction::DIV },
+		{ KEYWORD_MOD, IrInstruction::MOD },
+		{ KEYWORD_AND, IrInstruction::AND },
+		{ KEYWORD_OR, IrInstruction::OR },
+		{ KEYWORD_XOR, IrInstruction::XOR },
+		{ OP_DIVISION, IrInstruction::DIV },
 	};
 
-	AsmCommand::CommandType comType = comTypes[token->type];
-	auto left = children[0];
-	auto right = children[1];
-	auto reg1 = AsmRegister::eax;
-	auto reg2 = AsmRegister::ebx;
+	IrOperand left, right;
+	operandsToIr(builder, *this, left, right);
 
-	left->toAsmCode(code);
-	right->toAsmCode(code);
+	if (Operation::logicalTypes.count(token->type)) {
+		IrInstruction set(IrInstruction::SET, irOperandsType(*this));
+		set.condition = conditions.at(token->type);
+		set.dst = IrOperand::reg(builder.function.newRegister());
+		set.a = left;
+		set.b = right;
+		builder.emit(set);
+		return set.dst;
+	}
+	return builder.emit(opcodes.at(token->type), left, right, irOperandsType(*this));
+}
 
-	code.push_back({ AsmCommand::pop, reg2 });
-	code.push_back({ AsmCommand::pop, reg1 });
+// comparisons and logical operations on them are 0 or -1, bitwise and jumping code agree on them
+static bool isBoolean(PSyntaxNode node)
+{
+	if (std::dynamic_pointer_cast<NotNode>(node)) {
+		return isBoolean(node->children[0]);
+	}
+	if (!std::dynamic_pointer_cast<BinaryOpNode>(node)) {
+		return false;
+	}
+	auto type = node->token->type;
+	if (type == KEYWORD_AND || type == KEYWORD_OR || type == KEYWORD_XOR) {
+		return isBoolean(node->children[0]) && isBoolean(node->children[1]);
+	}
+	return Operation::logicalTypes.count(type) > 0;
+}
 
-	if (token->type == KEYWORD_DIV) {
-		code.push_back({ AsmCommand::cdq });
-		code.push_back({ comType, reg2 });
+// a comparison used as a condition branches on the flags without materializing the boolean
+void BinaryOpNode::conditionToIr(IrBuilder &builder, int trueBlock, int falseBlock)
+{
+	bool jumping = (token->type == KEYWORD_AND || token->type == KEYWORD_OR) && builder.shortCircuit;
+	if (jumping && isBoolean(children[0]) && isBoolean(children[1])) {
+		// the right operand is evaluated only if the left one doesn't decide the result
+		if (token->type == KEYWORD_AND) {
+			int right = builder.newBlock("AND_RIGHT");
+			children[0]->conditionToIr(builder, right, falseBlock);
+			builder.startBlock(right);
+		}
+		else {
+			int right = builder.newBlock("OR_RIGHT");
+			children[0]->conditionToIr(builder, trueBlock, right);
+			builder.startBlock(right);
+		}
+		children[1]->conditionToIr(builder, trueBlock, falseBlock);
+		return;
 	}
-	else {
-		code.push_back({ comType, reg1, reg2 });
+	if (!Operation::logicalTypes.count(token->type)) {
+		SyntaxNode::conditionToIr(builder, trueBlock, falseBlock);
+		return;
+	}
+	IrOperand left, right;
+	operandsToIr(builder, *this, left, right);
+	builder.branch(conditions.at(token->type), left, right, trueBlock, falseBlock, irOperandsType(*this));
+}
+
+IrOperand UnaryMinusNode::valueToIr(IrBuilder &builder)
+{
+	return builder.emit(IrInstruction::NEG, children[0]->valueToIr(builder), IrOperand(), irOperandsType(*this));
+}
+
+IrOperand NotNode::valueToIr(IrBuilder &builder)
+{
+	return builder.emit(IrInstruction::NOT, children[0]->valueToIr(builder));
+}
+
+void NotNode::conditionToIr(IrBuilder &builder, int trueBlock, int falseBlock)
+{
+	if (!isBoolean(children[0])) {
+		SyntaxNode::conditionToIr(builder, trueBlock, falseBlock);
+		return;
+	}
+	children[0]->conditionToIr(builder, falseBlock, trueBlock);
+}
+
+// the value of the type of the variable is moved to its register or stored to its memory
+static void assignIr(IrBuilder &builder, PSyntaxNode left, IrOperand value)
+{
+	if (std::dynamic_pointer_cast<VarNode>(left)) {
+		std::string name = lowerString(left->token->text);
+		int reg = builder.variableRegister(name);
+		if (reg != -1) {
+			builder.move(reg, value, left->type->category == Type::DOUBLE ? IrInstruction::F64 : IrInstruction::I32);
+			return;
+		}
+		storeIr(builder, left->type, builder.storage(name), value);
+		return;
 	}
-	code.push_back({ AsmCommand::push, reg1 });
+	storeIr(builder, left->type, left->addressToIr(builder), value);
 }
 
-void AssignStatement::toAsmCode(AsmCode &code)
+void AssignStatement::toIr(IrBuilder &builder)
 {
 	auto left = children[0];
 	auto right = children[1];
 
-	right->toAsmCode(code);
-	code.push_back({ AsmCommand::pop, AsmMemory::dword, code.offsets[lowerString(left->token->text)] });
+	// the parser leaves the conversion of the value to the type of the variable implicit
+	assignIr(builder, left, convertIr(builder, right->valueToIr(builder), right->type, left->type));
 }
 
-void IfStatement::toAsmCode(AsmCode &code)
+// the variables are read in order, each from the text after the previous one
+void ReadNode::toIr(IrBuilder &builder)
 {
-	std::string elseLabel = code.getLabel("IFFAIL");
-	std::string endLabel = code.getLabel("IFEND");
+	for (auto child : children) {
+		auto category = child->type->category;
+		if (category != Type::INTEGER && category != Type::CHAR && category != Type::DOUBLE) {
+			throw std::exception("Values of this type can't be read");
+		}
+		assignIr(builder, child, builder.emit(IrInstruction::READ, IrOperand(), IrOperand(), irType(child->type)));
+	}
+}
 
-	condition->toAsmCode(code);
-	code.push_back({ AsmCommand::pop, AsmRegister::eax });
-	code.push_back({ AsmCommand::test, AsmRegister::eax, AsmRegister::eax });
-	code.push_back({ AsmCommand::jz, elseLabel });
 
+void IfStatement::toIr(IrBuilder &builder)
+{
+	int thenBlock = builder.newBlock("IFTHEN");
+	int elseBlock = elsePart != nullptr ? builder.newBlock("IFFAIL") : -1;
+	int endBlock = builder.newBlock("IFEND");
+
+	condition->conditionToIr(builder, thenBlock, elsePart != nullptr ? elseBlock : endBlock);
+	builder.startBlock(thenBlock);
 	if (ifPart != nullptr) {
-		ifPart->toAsmCode(code);
+		ifPart->toIr(builder);
 	}
-	code.push_back({ AsmCommand::jmp, endLabel });
-	
-	code.push_back({ AsmCommand::label, elseLabel });
+	builder.jump(endBlock);
+
 	if (elsePart != nullptr) {
-		elsePart->toAsmCode(code);
+		builder.startBlock(elseBlock);
+		elsePart->toIr(builder);
 	}
-	code.push_back({ AsmCommand::label, endLabel });
+	builder.startBlock(endBlock);
 }
 
-void WhileNode::toAsmCode(AsmCode &code)
+void WhileNode::toIr(IrBuilder &builder)
 {
-	std::string condLabel = code.getLabel("WHILE_COND");
-	std::string bodyLabel = code.getLabel("WHILE_BODY");
-	std::string endLabel = code.getLabel("WHILE_END");
-
-	code.push_back({ AsmCommand::jmp, condLabel });
-
-	code.push_back({ AsmCommand::label, bodyLabel });
-	body->toAsmCode(code);
+	int bodyBlock = builder.newBlock("WHILE_BODY");
+	int condBlock = builder.newBlock("WHILE_COND");
+	int endBlock = builder.newBlock("WHILE_END");
+
+	builder.jump(condBlock);
+	builder.startBlock(bodyBlock);
+	builder.loops.push_back({ condBlock, endBlock });
+	if (body != nullptr) {
+		body->toIr(builder);
+	}
+	builder.loops.pop_back();
 
-	code.push_back({ AsmCommand::label, condLabel });
-	condition->toAsmCode(code);
-	code.push_back({ AsmCommand::pop, AsmRegister::eax });
-	code.push_back({ AsmCommand::test, AsmRegister::eax, AsmRegister::eax });
-	code.push_back({ AsmCommand::jnz, bodyLabel });
-	code.push_back({ AsmCommand::label, endLabel });
+	builder.startBlock(condBlock);
+	condition->conditionToIr(builder, bodyBlock, endBlock);
+	builder.startBlock(endBlock);
 }
 
-void ForNode::toAsmCode(AsmCode &code)
+void ForNode::toIr(IrBuilder &builder)
 {
-	std::string condLabel = code.getLabel("FOR_COND");
-	std::string bodyLabel = code.getLabel("FOR_BODY");
-	std::string endLabel = code.getLabel("FOR_END");
+	int bodyBlock = builder.newBlock("FOR_BODY");
+	int nextBlock = builder.newBlock("FOR_NEXT");
+	int condBlock = builder.newBlock("FOR_COND");
+	int endBlock = builder.newBlock("FOR_END");
+
+	// the bound is evaluated once, a variable used as the bound may change in the body
+	auto bound = to->valueToIr(builder);
+	if (builder.isVariable(bound)) {
+		bound = builder.emit(IrInstruction::MOV, bound);
+	}
+	auto start = from->valueToIr(builder);
+
+	std::string name = lowerString(counter->token->text);
+	int reg = builder.variableRegister(name);
+	IrOperand counterValue;
+	if (reg != -1) {
+		counterValue = IrOperand::reg(reg);
+		builder.move(reg, start);
+	}
+	else {
+		storeIr(builder, counter->type, builder.storage(name), start);
+	}
+	if (builder.code.vectorize) {
+		Vectorizer(builder, *this).run(reg, bound);
+	}
+	builder.jump(condBlock);
 
-	to->toAsmCode(code);
-	from->toAsmCode(code);
+	builder.startBlock(bodyBlock);
+	builder.loops.push_back({ nextBlock, endBlock });
+	if (body != nullptr) {
+		body->toIr(builder);
+	}
+	builder.loops.pop_back();
+
+	builder.startBlock(nextBlock);
+	if (reg != -1) {
+		IrInstruction step(downTo ? IrInstruction::SUB : IrInstruction::ADD);
+		step.dst = step.a = counterValue;
+		step.b = IrOperand::immediate(1);
+		builder.emit(step);
+	}
+	else {
+		auto value = builder.emit(downTo ? IrInstruction::SUB : IrInstruction::ADD, loadIr(builder, counter->type, builder.storage(name)), IrOperand::immediate(1));
+		storeIr(builder, counter->type, builder.storage(name), value);
+	}
+
+	builder.startBlock(condBlock);
+	if (reg == -1) {
+		counterValue = loadIr(builder, counter->type, builder.storage(name));
+	}
+	builder.branch(downTo ? IrInstruction::GE : IrInstruction::LE, counterValue, bound, bodyBlock, endBlock);
+	builder.startBlock(endBlock);
+}
 
-	int counterOffset = code.offsets[lowerString(counter->token->text)];
+IrOperand FunctionCallNode::valueToIr(IrBuilder &builder)
+{
+	auto it = builder.code.routineLabels.find(function.get());
+	if (it == builder.code.routineLabels.end()) {
+		throw std::exception("Call of a routine that isn't compiled");
+	}
 
-	// assign from value
-	code.push_back({ AsmCommand::pop, AsmMemory::DataSize::dword, counterOffset, AsmRegister::ebp });
+	// the parser has converted scalar arguments to the types of the parameters
+	auto &parameters = function->parameters->symbolsArray;
+	IrInstruction call(IrInstruction::CALL, type->category == Type::DOUBLE ? IrInstruction::F64 : IrInstruction::I32);
+	call.a = IrOperand::label(it->second);
+	call.line = token->row;
+	for (int i = 0; i < parameters.size(); ++i) {
+		bool byReference = IrBuilder::byReference(parameters[i]);
+		call.arguments.push_back(byReference ? children[i]->addressToIr(builder) : children[i]->valueToIr(builder));
+		call.argumentTypes.push_back(!byReference && parameters[i]->type->category == Type::DOUBLE ? IrInstruction::F64 : IrInstruction::I32);
+	}
+	if (type->category != Type::NIL) {
+		call.dst = IrOperand::reg(builder.function.newRegister());
+	}
+	builder.emit(call);
+	return call.dst;
+}
 
-	// decrease and jump to condition
-	code.push_back({ (downTo ? AsmCommand::inc : AsmCommand::dec), AsmMemory::DataSize::dword, counterOffset, AsmRegister::ebp });
-	code.push_back({ AsmCommand::jmp, condLabel });
-	
-	code.push_back({ AsmCommand::label, bodyLabel });
-	body->toAsmCode(code);
+void FunctionCallNode::toIr(IrBuilder &builder)
+{
+	valueToIr(builder);
+}
 
-	// decrease/increase
-	code.push_back({ AsmCommand::label, condLabel });
-	code.push_back({ (downTo ? AsmCommand::dec : AsmCommand::inc), AsmMemory::DataSize::dword, counterOffset, AsmRegister::ebp });
+void ContinueNode::toIr(IrBuilder &builder)
+{
+	if (builder.loops.empty()) {
+		throw std::exception("Continue outside of a loop");
+	}
+	builder.jump(builder.loops.back().continueTarget);
+}
 
-	// put 'from' to eax
-	code.push_back({ AsmCommand::mov, AsmRegister::eax, AsmMemory::DataSize::dword, AsmRegister::esp, 0 });
-	code.push_back({ AsmCommand::cmp, AsmMemory::DataSize::dword, AsmRegister::ebp, counterOffset, AsmRegister::eax });
-	code.push_back({ (downTo ? AsmCommand::jge : AsmCommand::jle), bodyLabel });
+void BreakNode::toIr(IrBuilder &builder)
+{
+	if (builder.loops.empty()) {
+		throw std::exception("Break outside of a loop");
+	}
+	builder.jump(builder.loops.back().breakTarget);
+}
 
-	code.push_back({ AsmCommand::label, endLabel });
-	code.push_back({ AsmCommand::add, AsmRegister::esp, "4" });
+void ExitNode::toIr(IrBuilder &builder)
+{
+	builder.exit();
 }
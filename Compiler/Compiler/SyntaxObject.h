@@ -6,13 +6,17 @@
 #include <set>
 
 #include "Token.h"
-#include "Generator.h"
+#include "Ir.h"
+#include "TreePrinter.h"
 
 class SyntaxNode;
 typedef std::shared_ptr<SyntaxNode> PSyntaxNode;
 
 class Type;
 typedef std::shared_ptr<Type> PType;
+class FunctionType;
+
+class IrBuilder;
 
 class SyntaxNode {
 public:
@@ -28,9 +32,15 @@ public:
 
 	SyntaxNode() {}
 	SyntaxNode(PToken token, PType type, std::vector<PSyntaxNode> children = {}, Category category = NIL);
-	void print(std::string &output, std::string prefix = "", bool end = true);
+	virtual void print(TreePrinter &printer, bool end = true);
 	std::string toString(std::string prefix = "");
-	virtual void toAsmCode(AsmCode &code);
+	virtual void toIr(IrBuilder &builder);
+	// evaluates an expression into a register or an immediate
+	virtual IrOperand valueToIr(IrBuilder &builder);
+	// evaluates the address of a variable instead of its value
+	virtual IrOperand addressToIr(IrBuilder &builder);
+	// jumps to one of the blocks depending on the value of a boolean expression
+	virtual void conditionToIr(IrBuilder &builder, int trueBlock, int falseBlock);
 };
 
 class VarNode : public SyntaxNode {
@@ -38,21 +48,28 @@ public:
 	VarNode(PToken token, PType type, std::vector<PSyntaxNode> children = {}, Category category = VAR_NODE)
 		: SyntaxNode(token, type, children, category)
 	{}
-	void toAsmCode(AsmCode &code) override;
+	IrOperand valueToIr(IrBuilder &builder) override;
+	IrOperand addressToIr(IrBuilder &builder) override;
 };
 
 class UnaryMinusNode : public SyntaxNode {
 	using SyntaxNode::SyntaxNode;
+
+	IrOperand valueToIr(IrBuilder &builder) override;
 };
 
 class BinaryOpNode : public SyntaxNode {
 	using SyntaxNode::SyntaxNode;
 
-	void toAsmCode(AsmCode &code) override;
+	IrOperand valueToIr(IrBuilder &builder) override;
+	void conditionToIr(IrBuilder &builder, int trueBlock, int falseBlock) override;
 };
 
 class NotNode : public SyntaxNode {
 	using SyntaxNode::SyntaxNode;
+
+	IrOperand valueToIr(IrBuilder &builder) override;
+	void conditionToIr(IrBuilder &builder, int trueBlock, int falseBlock) override;
 };
 
 class ConstNode : public SyntaxNode {
@@ -65,17 +82,38 @@ public:
 			token->text = value->toString();
 	}
 
-	void toAsmCode(AsmCode &code) override;
+	IrOperand valueToIr(IrBuilder &builder) override;
 };
 
 typedef std::shared_ptr<ConstNode> PConstNode;
 
-class TypedConstNode : public SyntaxNode {
+// Value of a typed constant laid out exactly as it is placed in memory.
+// Strings are stored as indices into the strings vector.
+class ConstData {
 public:
-	PType type;
-	TypedConstNode(PType type, std::string name)
-		: SyntaxNode(std::make_shared<Token>(IDENTIFIER, 0, 0, name), type, std::vector<PSyntaxNode>(), CONST_NODE)
+	std::vector<char> bytes;
+	std::vector<std::string> strings;
+
+	ConstData(int size)
+		: bytes(size)
 	{}
+
+	void store(PType type, int offset, PIdentifierValue value);
+	PIdentifierValue load(PType type, int offset);
+};
+
+typedef std::shared_ptr<ConstData> PConstData;
+
+class TypedConstNode : public SyntaxNode {
+public:
+	// elements of nested arrays and records are views into the data of the outermost constant
+	PConstData data;
+	int offset;
+
+	TypedConstNode(PType type, PConstData data, int offset = 0);
+	PSyntaxNode element(PType elementType, int elementOffset);
+	void print(TreePrinter &printer, bool end = true) override;
+	IrOperand addressToIr(IrBuilder &builder) override;
 };
 
 class CastNode : public SyntaxNode {
@@ -85,6 +123,8 @@ public:
 		: SyntaxNode(std::make_shared<Token>(UNDEFINED, node->token->row, node->token->col, typeName),
 			newType, std::vector<PSyntaxNode>({ node })), newType(newType)
 	{}
+
+	IrOperand valueToIr(IrBuilder &builder) override;
 };
 
 class IndexNode : public SyntaxNode {
@@ -93,6 +133,9 @@ public:
 	IndexNode(PType type, std::vector<PSyntaxNode> children, PToken variableToken)
 		: SyntaxNode(std::make_shared<Token>(SEP_BRACKET_SQUARE_LEFT, 0, 0, "[]"), type, children, VAR_NODE), variableToken(variableToken)
 	{}
+
+	IrOperand valueToIr(IrBuilder &builder) override;
+	IrOperand addressToIr(IrBuilder &builder) override;
 };
 
 class FieldAccessNode : public SyntaxNode {
@@ -101,6 +144,9 @@ public:
 	FieldAccessNode(PType type, std::vector<PSyntaxNode> children, PToken variableToken)
 		: SyntaxNode(std::make_shared<Token>(SEP_DOT, 0, 0, "."), type, children, VAR_NODE), variableToken(variableToken)
 	{}
+
+	IrOperand valueToIr(IrBuilder &builder) override;
+	IrOperand addressToIr(IrBuilder &builder) override;
 };
 
 class AssignStatement : public SyntaxNode {
@@ -109,7 +155,7 @@ public:
 		: SyntaxNode(std::make_shared<Token>(KEYWORD_ASSIGN, 0, 0, ":="), type, children)
 	{}
 
-	void toAsmCode(AsmCode &code) override;
+	void toIr(IrBuilder &builder) override;
 };
 
 class IfStatement : public SyntaxNode {
@@ -124,7 +170,7 @@ public:
 		if (elsePart != nullptr) children.push_back(elsePart);
 	}
 
-	void toAsmCode(AsmCode &code) override;
+	void toIr(IrBuilder &builder) override;
 };
 
 class WhileNode : public SyntaxNode {
@@ -137,7 +183,7 @@ public:
 		if (body != nullptr) children.push_back(body);
 	}
 
-	void toAsmCode(AsmCode &code) override;
+	void toIr(IrBuilder &builder) override;
 };
 
 class ForNode : public SyntaxNode {
@@ -152,19 +198,25 @@ public:
 		if (body != nullptr) children.push_back(body);
 	}
 
-	void toAsmCode(AsmCode &code) override;
+	void toIr(IrBuilder &builder) override;
 };
 
 class ContinueNode : public SyntaxNode {
 	using SyntaxNode::SyntaxNode;
+
+	void toIr(IrBuilder &builder) override;
 };
 
 class BreakNode : public SyntaxNode {
 	using SyntaxNode::SyntaxNode;
+
+	void toIr(IrBuilder &builder) override;
 };
 
 class ExitNode : public SyntaxNode {
 	using SyntaxNode::SyntaxNode;
+
+	void toIr(IrBuilder &builder) override;
 };
 
 class ReadNode : public SyntaxNode {
@@ -172,6 +224,7 @@ public:
 	ReadNode(PToken token, PType type, std::vector<PSyntaxNode> children)
 		: SyntaxNode(std::make_shared<Token>(KEYWORD_READ, token->row, token->col, "Read"), type, children)
 	{}
+	void toIr(IrBuilder &builder) override;
 };
 
 class WriteNode : public SyntaxNode {
@@ -179,12 +232,19 @@ public:
 	WriteNode(PToken token, PType type, std::vector<PSyntaxNode> children)
 		: SyntaxNode(std::make_shared<Token>(KEYWORD_WRITE, token->row, token->col, "Write"), type, children)
 	{}
-	void toAsmCode(AsmCode &code) override;
+	void toIr(IrBuilder &builder) override;
 };
 
 class FunctionCallNode : public SyntaxNode {
 public:
-	FunctionCallNode(PToken token, PType type, std::vector<PSyntaxNode> children)
-		: SyntaxNode(std::make_shared<Token>(token->type, token->row, token->col, "Call " + token->text), type, children, VAR_NODE)
+	// the routine called, unknown for a tree read back from its binary form
+	std::shared_ptr<FunctionType> function;
+
+	FunctionCallNode(PToken token, PType type, std::vector<PSyntaxNode> children, std::shared_ptr<FunctionType> function = nullptr)
+		: SyntaxNode(std::make_shared<Token>(token->type, token->row, token->col, "Call " + token->text), type, children, VAR_NODE),
+		function(function)
 	{}
+
+	void toIr(IrBuilder &builder) override;
+	IrOperand valueToIr(IrBuilder &builder) override;
 };
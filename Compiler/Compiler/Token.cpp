@@ -97,6 +97,7 @@ std::string TokenName[] = {
 	"KEYWORD_NOT",
 	"KEYWORD_OF",
 	"KEYWORD_OR",
+	"KEYWORD_PACKED",
 	"KEYWORD_PROCEDURE",
 	"KEYWORD_RECORD",
 	"KEYWORD_REPEAT",
@@ -188,6 +189,7 @@ std::string TokenFriendlyName[] = {
 	"Not",
 	"Of",
 	"Or",
+	"Packed",
 	"Procedure",
 	"Record",
 	"Repeat",
@@ -348,17 +350,6 @@ double IdentifierValue::toDouble()
 	else return getDouble();
 }
 
-IdentifierValue::Value IdentifierValue::cloneValue()
-{
-	if (category == CHAR || category == STRING) {
-		Value res;
-		res.string = new char[strlen(get.string) + 1];
-		strcpy(res.string, get.string);
-		return res;
-	}
-	return get;
-}
-
 void IdentifierValue::requireCategory(std::initializer_list<Category> categories)
 {
 	for (auto it : categories) {
@@ -43,8 +43,6 @@ public:
 	int toInteger();
 	double toDouble();
 
-	IdentifierValue::Value cloneValue();
-	
 	~IdentifierValue() {
 		releaseMemory();
 	}
@@ -107,6 +105,7 @@ enum TokenType {
 	KEYWORD_NOT,
 	KEYWORD_OF,
 	KEYWORD_OR,
+	KEYWORD_PACKED,
 	KEYWORD_PROCEDURE,
 	KEYWORD_RECORD,
 	KEYWORD_REPEAT,
@@ -63,6 +63,7 @@ std::map<std::string, TokenType> keywords = {
 	{ "not",       KEYWORD_NOT },
 	{ "of",        KEYWORD_OF },
 	{ "or",        KEYWORD_OR },
+	{ "packed",    KEYWORD_PACKED },
 	{ "procedure", KEYWORD_PROCEDURE },
 	{ "record",    KEYWORD_RECORD },
 	{ "repeat",    KEYWORD_REPEAT },
@@ -368,13 +369,18 @@ void Tokenizer::parseSeparator(char c)
 			}
 		}
 	}
-	// comment using symbols '{' and '}'
+	// comment using symbols '{' and '}', a compiler directive if it starts with '$'
 	else if (c == '{') {
+		std::string text;
 		while (c != '}') {
 			if (reader.endOfFile()) {
 				throw LexicalException(token->row, token->col, "Unclosed comment");
 			}
 			c = reader.nextSymbol();
+			text.push_back(c);
+		}
+		if (text[0] == '$') {
+			parseDirective(text.substr(1, text.length() - 2));
 		}
 	}
 	else if (c == '(') {
@@ -410,6 +416,37 @@ void Tokenizer::parseSeparator(char c)
 	}
 }
 
+// switches are written as {$B-} or {$B+,R-}, other directives as {$NAME VALUE}
+void Tokenizer::parseDirective(std::string text)
+{
+	std::transform(text.begin(), text.end(), text.begin(), ::toupper);
+	size_t begin = 0;
+	while (begin < text.length()) {
+		size_t end = text.find(',', begin);
+		if (end == std::string::npos) {
+			end = text.length();
+		}
+		std::string item = text.substr(begin, end - begin);
+		begin = end + 1;
+
+		item.erase(0, item.find_first_not_of(' '));
+		item.erase(item.find_last_not_of(' ') + 1);
+		size_t space = item.find(' ');
+		if (space != std::string::npos) {
+			directives[item.substr(0, space)] = item.substr(item.find_first_not_of(' ', space));
+		}
+		else if (!item.empty() && (item.back() == '+' || item.back() == '-')) {
+			directives[item.substr(0, item.length() - 1)] = item.substr(item.length() - 1);
+		}
+	}
+}
+
+std::string Tokenizer::getDirective(const std::string &name)
+{
+	auto it = directives.find(name);
+	return it != directives.end() ? it->second : "";
+}
+
 void Tokenizer::parseOperator(char c)
 {
 	token->text = c;
@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <memory>
+#include <map>
 
 #include "FileReader.h"
 #include "Token.h"
@@ -11,10 +12,15 @@ public:
 	bool next();
 	std::shared_ptr<Token> getCurrentToken();
 	std::shared_ptr<Token> getNextToken();
+	std::string getDirective(const std::string &name);
 
 private:
 	FileReader reader;
 	std::shared_ptr<Token> token;
+	// values of the compiler directives met so far
+	std::map<std::string, std::string> directives;
+
+	void parseDirective(std::string text);
 
 	void parseSpecialNumber(char c);
 	void parseNumber(char c);
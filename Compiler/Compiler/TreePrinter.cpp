@@ -0,0 +1,34 @@
+#include "TreePrinter.h"
+
+TreePrinter::TreePrinter(std::ostream &output)
+	: output(output)
+{
+}
+
+void TreePrinter::pushIndent(const std::string &s)
+{
+	indentStack.push_back(prefix.length());
+	prefix += s;
+}
+
+void TreePrinter::pushIndent(int cnt)
+{
+	indentStack.push_back(prefix.length());
+	prefix.append(cnt > 0 ? cnt : 0, ' ');
+}
+
+void TreePrinter::popIndent()
+{
+	prefix.resize(indentStack.back());
+	indentStack.pop_back();
+}
+
+std::ostream &TreePrinter::indent()
+{
+	return output << prefix;
+}
+
+int TreePrinter::indentLength()
+{
+	return (int)prefix.length();
+}
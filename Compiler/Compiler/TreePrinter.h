@@ -0,0 +1,21 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <vector>
+
+class TreePrinter {
+public:
+	std::ostream &output;
+
+	TreePrinter(std::ostream &output);
+
+	void pushIndent(const std::string &s);
+	void pushIndent(int cnt = 3);
+	void popIndent();
+	std::ostream &indent();
+	int indentLength();
+
+private:
+	std::string prefix;
+	std::vector<size_t> indentStack;
+};
@@ -1,3 +1,5 @@
+#include <sstream>
+#include <unordered_map>
 #include "Types.h"
 #include "Utils.h"
 
@@ -20,55 +22,182 @@ const std::set<Type::Category> Type::simpleCategories = {
 	Type::NIL,
 };
 
-std::string FunctionType::indent = "";
-
 PType Type::getSimpleType(Type::Category category)
 {
 	static const std::map<Category, PType> types = {
-		{ INTEGER, std::make_shared<Type>(INTEGER, 4) },
-		{ DOUBLE, std::make_shared<Type>(DOUBLE, 8) },
-		{ CHAR, std::make_shared<Type>(CHAR, 1) },
-		{ STRING, std::make_shared<Type>(STRING, 0) },
-		{ NIL, std::make_shared<Type>(NIL, 0) },
+		{ INTEGER, intern(std::make_shared<Type>(INTEGER, 4, 4)) },
+		{ DOUBLE, intern(std::make_shared<Type>(DOUBLE, 8, 8)) },
+		{ CHAR, intern(std::make_shared<Type>(CHAR, 1, 1)) },
+		{ STRING, intern(std::make_shared<Type>(STRING, 4, 4)) },
+		{ NIL, intern(std::make_shared<Type>(NIL, 0, 1)) },
 	};
 	return types.at(category);
 	//return types[category];
 }
 
+static std::vector<PType> &internedTypes()
+{
+	static std::vector<PType> types;
+	return types;
+}
+
+PType Type::intern(PType type)
+{
+	static std::unordered_map<std::string, PType> canonical;
+
+	// parts are interned before the aggregate, so their ids describe them completely
+	std::string key = std::to_string(type->category);
+	if (type->category == ARRAY) {
+		auto arrayType = std::static_pointer_cast<ArrayType>(type);
+		key += std::string(arrayType->packed ? " packed" : "") + ' ' + std::to_string(arrayType->elementType->id) +
+			' ' + std::to_string(arrayType->left->value->toInteger()) +
+			' ' + std::to_string(arrayType->right->value->toInteger());
+	}
+	else if (type->category == RECORD) {
+		auto recordType = std::static_pointer_cast<RecordType>(type);
+		key += std::string(recordType->packed ? " packed" : "") + (recordType->reordered ? " reordered" : "");
+		for (auto it : recordType->fields->symbolsArray) {
+			key += ' ' + it->token->text + ':' + std::to_string(it->type->id);
+		}
+	}
+
+	auto it = canonical.find(key);
+	if (it != canonical.end()) {
+		return it->second;
+	}
+	type->id = (int)internedTypes().size();
+	internedTypes().push_back(type);
+	canonical[key] = type;
+	return type;
+}
+
+static bool structurallyCompatible(PType left, PType right)
+{
+	static const std::set<std::pair<Type::Category, Type::Category>> pairs = {
+		{ Type::DOUBLE, Type::INTEGER },
+		{ Type::INTEGER, Type::CHAR },
+		{ Type::CHAR, Type::INTEGER },
+		{ Type::STRING, Type::CHAR },
+	};
+
+	if (left->category == Type::ARRAY && right->category == Type::ARRAY) {
+		auto leftArr = std::static_pointer_cast<ArrayType>(left);
+		auto rightArr = std::static_pointer_cast<ArrayType>(right);
+
+		return leftArr->packed == rightArr->packed &&
+			leftArr->left->value->toInteger() == rightArr->left->value->toInteger() &&
+			leftArr->right->value->toInteger() == rightArr->right->value->toInteger() &&
+			Type::compatible(leftArr->elementType, rightArr->elementType);
+	}
+
+	if (left->category == Type::RECORD && right->category == Type::RECORD) {
+		auto leftRecord = std::static_pointer_cast<RecordType>(left);
+		auto rightRecord = std::static_pointer_cast<RecordType>(right);
+		auto &leftFields = leftRecord->fields->symbolsArray;
+		auto &rightFields = rightRecord->fields->symbolsArray;
+
+		// fields are found by their offsets, which depend on the layout
+		if (leftRecord->packed != rightRecord->packed || leftRecord->reordered != rightRecord->reordered ||
+			leftFields.size() != rightFields.size())
+		{
+			return false;
+		}
+		for (int i = 0; i < leftFields.size(); ++i) {
+			if (!Type::compatible(leftFields[i]->type, rightFields[i]->type)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	return left->category == right->category || pairs.count({ left->category, right->category });
+}
+
+bool Type::compatible(PType left, PType right)
+{
+	// pairwise results of interned types, 0 - unknown, 1 - compatible, 2 - incompatible
+	static std::vector<std::vector<char>> cache;
+
+	if (left->id == right->id && left->id >= 0) {
+		return true;
+	}
+	if (left->id < 0 || right->id < 0) {
+		return structurallyCompatible(left, right);
+	}
+
+	if (cache.size() < internedTypes().size()) {
+		cache.resize(internedTypes().size());
+	}
+	auto &row = cache[left->id];
+	if (row.size() <= right->id) {
+		row.resize(internedTypes().size());
+	}
+	if (row[right->id] == 0) {
+		row[right->id] = structurallyCompatible(left, right) ? 1 : 2;
+	}
+	return row[right->id] == 1;
+}
+
 std::string Type::toString()
 {
-	return categoryName[category];
+	std::ostringstream res;
+	TreePrinter printer(res);
+	print(printer);
+	return res.str();
 }
 
-std::string FunctionType::toString()
+void Type::print(TreePrinter &printer)
 {
-	std::string res;
-	res += indent + name + " : function(" + (parameters->symbolsArray.empty() ? ")\n" : "\n");
+	printer.output << categoryName[category];
+}
+
+static void printSymbol(TreePrinter &printer, PSymbol symbol)
+{
+	std::string symcat = Symbol::categoryName[symbol->category];
+	printer.indent() << symbol->token->text << " : " << symcat << (!symcat.empty() ? " " : "");
+	symbol->type->print(printer);
+	printer.output << '\n';
+}
+
+static void printSymbolValue(TreePrinter &printer, PSymbol symbol)
+{
+	printer.pushIndent((int)symbol->token->text.length() - 1);
+	symbol->value->print(printer, false);
+	printer.popIndent();
+}
+
+void FunctionType::print(TreePrinter &printer)
+{
+	std::ostream &output = printer.output;
+	printer.indent() << name << " : function(" << (parameters->symbolsArray.empty() ? ")\n" : "\n");
 	if (!parameters->symbolsArray.empty()) {
-		increaseIndent(indent);
+		printer.pushIndent();
 
 		for (auto it : parameters->symbolsArray) {
-			std::string symcat = Symbol::categoryName[it->category];
-			res += indent + it->token->text + " : " + symcat + (!symcat.empty() ? " " : "") + it->type->toString() + "\n";
-			std::string strValue;
+			printSymbol(printer, it);
 			if (it->value != nullptr) {
-				strValue = it->value->toString(std::string((indent + it->token->text).length() - 1, ' '));
+				printSymbolValue(printer, it);
+				output << '\n';
 			}
-			res += (strValue.empty() ? "" : strValue + "\n");
 		}
 
-		decreaseIndent(indent);
-		res += indent + ") resultType : " + returnType->toString() + "\n";
+		printer.popIndent();
+		printer.indent() << ") resultType : ";
+		returnType->print(printer);
+		output << '\n';
 	}
 	else {
-		increaseIndent(indent);
-		res += indent + "resultType : " + returnType->toString() + "\n";
-		decreaseIndent(indent);
+		printer.pushIndent();
+		printer.indent() << "resultType : ";
+		returnType->print(printer);
+		output << '\n';
+		printer.popIndent();
 	}
 
 	if (!declarations->symbolsArray.empty()) {
-		res += "\n" + indent + name + " declarations:\n";
-		increaseIndent(indent);
+		output << '\n';
+		printer.indent() << name << " declarations:\n";
+		printer.pushIndent();
 
 		for (auto it : declarations->symbolsArray) {
 			if (it->token->text == "result") {
@@ -76,53 +205,63 @@ std::string FunctionType::toString()
 			}
 
 			if (it->type->category == Type::FUNCTION) {
-				res += it->type->toString();
+				it->type->print(printer);
 				continue;
 			}
 
-			std::string symcat = Symbol::categoryName[it->category];
-			res += indent + it->token->text + " : " + symcat + (!symcat.empty() ? " " : "") + it->type->toString() + "\n";
-			std::string strValue;
+			printSymbol(printer, it);
 			if (it->value != nullptr) {
-				strValue = it->value->toString(std::string((indent + it->token->text).length() - 1, ' '));
+				printSymbolValue(printer, it);
 			}
-			//res += (strValue.empty() ? "" : strValue + (strValue.back() == '\n' ? "" : "\n"));
-			res += strValue + "\n";
+			output << '\n';
 		}
-		decreaseIndent(indent);
+		printer.popIndent();
 	}
 
 	if (!body->children.empty()) {
-		//res += "\n" + indent + name + " statements:\n";
-		//increaseIndent(indent);
-		res += body->toString(indent) + "\n";
-		//decreaseIndent(indent);
+		body->print(printer, false);
+		output << '\n';
 	}
-	return res;
 }
 
-std::string ArrayType::toString()
+void ArrayType::print(TreePrinter &printer)
 {
-	std::string res;
-	std::shared_ptr<ArrayType> cur = std::make_shared<ArrayType>(*this);
-	while (cur->category == Type::Category::ARRAY) {
-		res += "Array [" + cur->left->token->text + ", " + cur->right->token->text + "] of ";
+	ArrayType *cur = this;
+	while (true) {
+		printer.output << (cur->packed ? "Packed " : "") << "Array [" << cur->left->token->text << ", " << cur->right->token->text << "] of ";
 		if (cur->elementType->category != Type::Category::ARRAY) {
 			break;
 		}
-		cur = std::static_pointer_cast<ArrayType>(cur->elementType);
+		cur = static_cast<ArrayType *>(cur->elementType.get());
+	}
+	cur->elementType->print(printer);
+}
+
+int RecordType::fieldOffset(int index)
+{
+	return offsets[index];
+}
+
+int RecordType::fieldIndex(std::string name)
+{
+	name = lowerString(name);
+	for (int i = 0; i < fields->symbolsArray.size(); ++i) {
+		if (lowerString(fields->symbolsArray[i]->token->text) == name) {
+			return i;
+		}
 	}
-	return res + cur->elementType->toString();
+	return -1;
 }
 
-std::string RecordType::toString()
+void RecordType::print(TreePrinter &printer)
 {
-	std::string res = "Record\n";
-	increaseIndent(indent);
+	printer.output << (packed ? "Packed " : "") << "Record\n";
+	printer.pushIndent();
 	for (auto it : fields->symbolsArray) {
-		res += indent + it->token->text + " : " + it->type->toString() + "\n";
+		printer.indent() << it->token->text << " : ";
+		it->type->print(printer);
+		printer.output << '\n';
 	}
-	decreaseIndent(indent);
-	res += indent + "end";
-	return res;
+	printer.popIndent();
+	printer.indent() << "end";
 }
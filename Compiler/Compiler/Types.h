@@ -6,6 +6,8 @@
 #include "SymbolTable.h"
 #include "SyntaxObject.h"
 #include "Utils.h"
+#include "TreePrinter.h"
+#include "Layout.h"
 
 class Type;
 typedef std::shared_ptr<Type> PType;
@@ -28,38 +30,56 @@ public:
 
 	Category category;
 	int size;
+	int alignment;
+	// canonical id, structurally equal interned types share one instance and id
+	int id = -1;
 
-	Type(Category category = Category::NIL, int size = 0)
-		: category(category), size(size)
+	Type(Category category = Category::NIL, int size = 0, int alignment = 1)
+		: category(category), size(size), alignment(alignment)
 	{}
 
-	static std::string indent;
-
 	static PType getSimpleType(Type::Category category);
-	virtual std::string toString();
+	static PType intern(PType type);
+	static bool compatible(PType left, PType right);
+	virtual void print(TreePrinter &printer);
+	std::string toString();
 };
 
 class ArrayType : public Type {
 public:
 	PType elementType;
 	PConstNode left, right;
+	bool packed;
 
-	ArrayType(PType elementType, PConstNode left, PConstNode right)
-		: Type(Category::ARRAY), elementType(elementType), left(left), right(right)
-	{}
+	ArrayType(PType elementType, PConstNode left, PConstNode right, bool packed = false)
+		: Type(Category::ARRAY), elementType(elementType), left(left), right(right), packed(packed)
+	{
+		if (elementType != nullptr) {
+			Layout::apply(*this);
+		}
+	}
 
-	std::string toString();
+	void print(TreePrinter &printer) override;
 };
 
 class RecordType : public Type {
 public:
 	PSymbolTable fields;
-
-	RecordType(PSymbolTable table)
-		: Type(Category::RECORD), fields(table)
-	{}
-
-	std::string toString();
+	bool packed, reordered;
+	// offsets of the fields in declaration order
+	std::vector<int> offsets;
+
+	RecordType(PSymbolTable table, bool packed = false, bool reordered = false)
+		: Type(Category::RECORD), fields(table), packed(packed), reordered(reordered)
+	{
+		if (table != nullptr) {
+			Layout::apply(*this);
+		}
+	}
+
+	int fieldOffset(int index);
+	int fieldIndex(std::string name);
+	void print(TreePrinter &printer) override;
 };
 
 class FunctionType : public Type {
@@ -73,5 +93,5 @@ public:
 		: Type(Category::FUNCTION), parameters(parameters), declarations(declarations), returnType(returnType), body(body), name(name)
 	{}
 
-	std::string toString();
+	void print(TreePrinter &printer) override;
 };
@@ -2,5 +2,3 @@
 #include <string>
 
 std::string lowerString(std::string s);
-void increaseIndent(std::string &s, int cnt = 3);
-void decreaseIndent(std::string &s, int cnt = 3);
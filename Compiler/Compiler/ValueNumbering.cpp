@@ -0,0 +1,261 @@
+#include <algorithm>
+#include "ValueNumbering.h"
+
+ValueNumbering::ValueNumbering(IrFunction &function, Cfg &cfg, AsmCode &code, const std::set<std::string> &pure)
+	: function(function), cfg(cfg), code(code), pure(pure)
+{
+}
+
+void ValueNumbering::run()
+{
+	if (function.blocks.empty()) {
+		return;
+	}
+	std::vector<int> definitions(function.registerCnt);
+	std::set<std::string> addressed;
+	for (auto &block : function.blocks) {
+		for (auto &instruction : block.instructions) {
+			if (instruction.def() != -1) {
+				++definitions[instruction.def()];
+			}
+			if (instruction.opcode == IrInstruction::ADDR && instruction.a.kind == IrOperand::VARIABLE) {
+				addressed.insert(instruction.a.name);
+			}
+		}
+	}
+	for (auto &it : code.offsets) {
+		if (!addressed.count(it.first)) {
+			int number = function.registerCnt + (int)frameVariables.size();
+			frameVariables[it.first] = number;
+		}
+	}
+	memory = function.registerCnt + (int)frameVariables.size();
+	changing.assign(memory + 1, true);
+	for (int reg = 0; reg < function.registerCnt; ++reg) {
+		changing[reg] = definitions[reg] > 1;
+	}
+	for (auto &it : function.variables) {
+		changing[it.second] = true;
+	}
+	versions.assign(memory + 1, 0);
+
+	blockChanges.assign(function.blocks.size(), {});
+	removed.assign(function.blocks.size(), {});
+	for (auto &block : function.blocks) {
+		for (auto &instruction : block.instructions) {
+			auto states = changes(instruction);
+			blockChanges[block.id].insert(blockChanges[block.id].end(), states.begin(), states.end());
+		}
+		removed[block.id].assign(block.instructions.size(), false);
+	}
+	replacement.assign(function.registerCnt, -1);
+
+	visit(0);
+
+	for (auto &block : function.blocks) {
+		auto &instructions = block.instructions;
+		for (int i = (int)instructions.size() - 1; i >= 0; --i) {
+			if (removed[block.id][i]) {
+				instructions.erase(instructions.begin() + i);
+			}
+		}
+		for (auto &instruction : instructions) {
+			std::vector<IrOperand *> operands = { &instruction.a, &instruction.b };
+			for (auto &argument : instruction.arguments) {
+				operands.push_back(&argument);
+			}
+			for (auto operand : operands) {
+				if (operand->isRegister()) {
+					operand->value = resolve(operand->value);
+				}
+			}
+		}
+	}
+}
+
+void ValueNumbering::visit(int block)
+{
+	std::vector<Key> inserted;
+	std::vector<std::pair<int, int>> oldVersions;
+	auto change = [&](int state) {
+		oldVersions.push_back({ state, versions[state] });
+		versions[state] = ++lastVersion;
+	};
+
+	if (block != 0) {
+		for (int state : killed(block)) {
+			change(state);
+		}
+	}
+	auto &instructions = function.blocks[block].instructions;
+	for (int i = 0; i < instructions.size(); ++i) {
+		auto &instruction = instructions[i];
+		int def = instruction.def();
+		Key k;
+		if (def != -1 && !changing[def] && key(instruction, k)) {
+			// a copy of a register that doesn't change is that register
+			if (instruction.opcode == IrInstruction::MOV) {
+				replacement[def] = resolve(instruction.a.value);
+				removed[block][i] = true;
+				continue;
+			}
+			auto it = available.find(k);
+			if (it != available.end()) {
+				replacement[def] = it->second;
+				removed[block][i] = true;
+				continue;
+			}
+			available[k] = def;
+			inserted.push_back(k);
+		}
+		for (int state : changes(instruction)) {
+			change(state);
+		}
+		// a load of the stored address gives the value stored, bytes would be truncated by it
+		if (instruction.opcode == IrInstruction::STORE && instruction.type != IrInstruction::I8 &&
+			instruction.b.isRegister() && !changing[resolve(instruction.b.value)])
+		{
+			IrInstruction load(IrInstruction::LOAD, instruction.type);
+			load.a = instruction.a;
+			key(load, k);
+			if (!available.count(k)) {
+				available[k] = resolve(instruction.b.value);
+				inserted.push_back(k);
+			}
+		}
+	}
+
+	for (int child : cfg.dominated[block]) {
+		visit(child);
+	}
+
+	for (auto &k : inserted) {
+		available.erase(k);
+	}
+	for (int i = (int)oldVersions.size() - 1; i >= 0; --i) {
+		versions[oldVersions[i].first] = oldVersions[i].second;
+	}
+}
+
+std::vector<int> ValueNumbering::killed(int block)
+{
+	std::vector<bool> seen(function.blocks.size());
+	std::vector<int> stack = cfg.predecessors[block], res;
+	while (!stack.empty()) {
+		int top = stack.back();
+		stack.pop_back();
+		if (top == cfg.idom[block] || seen[top]) {
+			continue;
+		}
+		seen[top] = true;
+		res.insert(res.end(), blockChanges[top].begin(), blockChanges[top].end());
+		stack.insert(stack.end(), cfg.predecessors[top].begin(), cfg.predecessors[top].end());
+	}
+	std::sort(res.begin(), res.end());
+	res.erase(std::unique(res.begin(), res.end()), res.end());
+	return res;
+}
+
+int ValueNumbering::state(const IrOperand &address)
+{
+	// labels are those of constant doubles
+	if (address.kind == IrOperand::LABEL) {
+		return -1;
+	}
+	if (address.kind == IrOperand::VARIABLE && frameVariables.count(address.name)) {
+		return frameVariables.at(address.name);
+	}
+	return memory;
+}
+
+std::vector<int> ValueNumbering::changes(const IrInstruction &instruction)
+{
+	std::vector<int> res;
+	int def = instruction.def();
+	if (def != -1 && changing[def]) {
+		res.push_back(def);
+	}
+	if (instruction.opcode == IrInstruction::STORE) {
+		res.push_back(state(instruction.a));
+	}
+	if (instruction.opcode == IrInstruction::CALL && !pure.count(instruction.a.name)) {
+		res.push_back(memory);
+	}
+	return res;
+}
+
+bool ValueNumbering::key(const IrInstruction &instruction, Key &res)
+{
+	static const std::set<IrInstruction::Opcode> commutative = {
+		IrInstruction::ADD, IrInstruction::MUL, IrInstruction::AND, IrInstruction::OR, IrInstruction::XOR,
+		IrInstruction::MIN, IrInstruction::MAX,
+	};
+
+	switch (instruction.opcode) {
+	case IrInstruction::MOV:
+		return instruction.a.isRegister() && !changing[resolve(instruction.a.value)];
+	case IrInstruction::STORE:
+	case IrInstruction::WRITE:
+	case IrInstruction::READ:
+	case IrInstruction::PARAM:
+	case IrInstruction::RETURN:
+	case IrInstruction::JUMP:
+	case IrInstruction::BRANCH:
+		return false;
+	case IrInstruction::CALL:
+		if (!pure.count(instruction.a.name)) {
+			return false;
+		}
+		break;
+	}
+
+	res = { instruction.opcode, instruction.type, instruction.condition };
+	Key a, b;
+	operandKey(instruction.a, a);
+	operandKey(instruction.b, b);
+	if (commutative.count(instruction.opcode) && b < a) {
+		std::swap(a, b);
+	}
+	res.insert(res.end(), a.begin(), a.end());
+	res.insert(res.end(), b.begin(), b.end());
+	for (int i = 0; i < instruction.arguments.size(); ++i) {
+		res.push_back(instruction.argumentTypes[i]);
+		operandKey(instruction.arguments[i], res);
+	}
+	// loads and calls depend on the memory they may read
+	if (instruction.opcode == IrInstruction::LOAD || instruction.opcode == IrInstruction::CALL) {
+		int memoryState = instruction.opcode == IrInstruction::LOAD ? state(instruction.a) : memory;
+		res.push_back(memoryState == -1 ? 0 : versions[memoryState]);
+	}
+	return true;
+}
+
+void ValueNumbering::operandKey(const IrOperand &operand, Key &res)
+{
+	res.push_back(operand.kind);
+	switch (operand.kind) {
+	case IrOperand::REGISTER: {
+		int reg = resolve(operand.value);
+		res.push_back(reg);
+		res.push_back(changing[reg] ? versions[reg] : 0);
+		break;
+	}
+	case IrOperand::IMMEDIATE:
+		res.push_back(operand.value);
+		break;
+	case IrOperand::VARIABLE:
+	case IrOperand::LABEL: {
+		auto it = names.insert({ operand.name, (int)names.size() }).first;
+		res.push_back(it->second);
+		break;
+	}
+	}
+}
+
+int ValueNumbering::resolve(int reg)
+{
+	while (replacement[reg] != -1) {
+		reg = replacement[reg];
+	}
+	return reg;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+
+#include "Ir.h"
+#include "Cfg.h"
+#include "Generator.h"
+
+// Removes instructions computing values already computed on every path to them, like the addresses of
+// the same array elements and fields, repeated subexpressions and loads of memory that is unchanged or was
+// just stored to. The blocks are visited along the dominator tree with a table of the values available,
+// keyed by the instruction and the numbers of its operands. Registers of variables and memory get a new
+// version whenever they change, in the block or on a path from its dominator, which makes the values
+// depending on them unknown. Frame variables whose address isn't taken change only by stores to them,
+// the rest of the memory changes by any other store and by the calls of routines with side effects.
+class ValueNumbering {
+public:
+	// pure holds the labels of the side-effect free routines, their calls are values like the others,
+	// the graph is the one of the function, which keeps its blocks and jumps
+	ValueNumbering(IrFunction &function, Cfg &cfg, AsmCode &code, const std::set<std::string> &pure);
+	void run();
+
+private:
+	typedef std::vector<int> Key;
+
+	IrFunction &function;
+	Cfg &cfg;
+	AsmCode &code;
+	const std::set<std::string> &pure;
+	// registers defined more than once, registers of variables and the states of memory have versions
+	std::vector<bool> changing;
+	// states of memory follow the registers: frame variables whose address isn't taken, then the rest
+	std::map<std::string, int> frameVariables;
+	int memory;
+	std::vector<int> versions;
+	int lastVersion = 0;
+	// states each block changes
+	std::vector<std::vector<int>> blockChanges;
+	std::map<std::string, int> names;
+	// registers holding the values computed by the instructions visited
+	std::map<Key, int> available;
+	// the register holding the value of a removed definition, -1 for the others
+	std::vector<int> replacement;
+	std::vector<std::vector<bool>> removed;
+
+	void visit(int block);
+	// states changed on the paths to the block that don't pass its immediate dominator
+	std::vector<int> killed(int block);
+	// state of the memory read or written at the address, -1 for constants
+	int state(const IrOperand &address);
+	std::vector<int> changes(const IrInstruction &instruction);
+	// key of the value computed by the instruction, false if it can't be reused
+	bool key(const IrInstruction &instruction, Key &res);
+	void operandKey(const IrOperand &operand, Key &res);
+	int resolve(int reg);
+};
@@ -0,0 +1,415 @@
+#include <typeinfo>
+#include "Vectorizer.h"
+#include "Types.h"
+#include "Utils.h"
+
+Vectorizer::Vectorizer(IrBuilder &builder, ForNode &loop)
+	: builder(builder), loop(loop), elementType(IrInstruction::I32), typed(false)
+{
+	counterName = lowerString(loop.counter->token->text);
+}
+
+void Vectorizer::run(int counter, IrOperand bound)
+{
+	if (loop.downTo) {
+		reason = "the counter goes down";
+	}
+	else if (counter == -1) {
+		reason = "the counter is kept in memory";
+	}
+	else if (builder.rangeChecks) {
+		// a check of the counter would miss the other lanes
+		reason = "indexes are range checked";
+	}
+	if (!reason.empty() || !analyze()) {
+		report("not vectorized, " + reason);
+		return;
+	}
+	auto type = vectorType();
+	int lanes = IrInstruction::lanes(type);
+	report(std::string("vectorized, ") + std::to_string(lanes) + (elementType == IrInstruction::F64 ? " x double" : " x integer"));
+
+	// the last iteration of the vector loop starts at most lanes - 1 below the bound
+	IrOperand limit = bound.isImmediate() ? IrOperand::immediate(bound.value - (lanes - 1)) :
+		builder.emit(IrInstruction::SUB, bound, IrOperand::immediate(lanes - 1));
+	for (auto &statement : statements) {
+		if (statement.element != nullptr) {
+			continue;
+		}
+		// sums start from zero lanes, a minimum or a maximum from the current value
+		IrOperand start = IrOperand::reg(statement.reg);
+		if (statement.opcode == IrInstruction::ADD || statement.opcode == IrInstruction::SUB) {
+			start = elementType == IrInstruction::F64 ? builder.emit(IrInstruction::LOAD,
+				IrOperand::label(builder.code.doubleLabel(0.0)), IrOperand(), IrInstruction::F64) : IrOperand::immediate(0);
+		}
+		statement.accumulator = builder.emit(IrInstruction::SPLAT, start, IrOperand(), type);
+	}
+
+	int bodyBlock = builder.newBlock("VEC_BODY");
+	int condBlock = builder.newBlock("VEC_COND");
+	int endBlock = builder.newBlock("VEC_END");
+	builder.jump(condBlock);
+	builder.startBlock(bodyBlock);
+	for (auto &statement : statements) {
+		statementToIr(statement);
+	}
+	IrInstruction step(IrInstruction::ADD);
+	step.dst = step.a = IrOperand::reg(counter);
+	step.b = IrOperand::immediate(lanes);
+	builder.emit(step);
+
+	builder.startBlock(condBlock);
+	builder.branch(IrInstruction::LE, IrOperand::reg(counter), limit, bodyBlock, endBlock);
+	builder.startBlock(endBlock);
+
+	// the lanes are combined, so the sum of doubles is added up in another order than by the scalar loop
+	static const std::map<IrInstruction::Opcode, IrInstruction::Opcode> horizontal = {
+		{ IrInstruction::ADD, IrInstruction::HADD },
+		{ IrInstruction::SUB, IrInstruction::HADD },
+		{ IrInstruction::MIN, IrInstruction::HMIN },
+		{ IrInstruction::MAX, IrInstruction::HMAX },
+	};
+	for (auto &statement : statements) {
+		if (statement.element != nullptr) {
+			continue;
+		}
+		auto value = builder.emit(horizontal.at(statement.opcode), statement.accumulator, IrOperand(), type);
+		if (statement.opcode == IrInstruction::ADD || statement.opcode == IrInstruction::SUB) {
+			value = builder.emit(statement.opcode, IrOperand::reg(statement.reg), value, elementType);
+		}
+		builder.move(statement.reg, value, elementType);
+	}
+}
+
+bool Vectorizer::analyze()
+{
+	std::vector<PSyntaxNode> body;
+	if (loop.body != nullptr) {
+		flatten(loop.body, body);
+	}
+	if (body.empty()) {
+		reason = "the body is empty";
+		return false;
+	}
+	for (auto node : body) {
+		if (!addStatement(node)) {
+			return false;
+		}
+	}
+
+	// a reduction variable is updated by its statement alone, values are computed from invariants and elements
+	for (auto &statement : statements) {
+		auto others = reductionVariables;
+		others.erase(statement.variable);
+		if (mentions(statement.value, others) || (statement.element != nullptr && mentions(statement.element, others))) {
+			reason = "a reduction variable is read by another statement";
+			return false;
+		}
+		if (!vectorizable(statement.value)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// statements of nested compound statements in order
+void Vectorizer::flatten(PSyntaxNode node, std::vector<PSyntaxNode> &res)
+{
+	if (typeid(*node) != typeid(SyntaxNode)) {
+		res.push_back(node);
+		return;
+	}
+	for (auto child : node->children) {
+		flatten(child, res);
+	}
+}
+
+bool Vectorizer::addStatement(PSyntaxNode node)
+{
+	if (std::dynamic_pointer_cast<IfStatement>(node)) {
+		return addMinMax(node);
+	}
+	if (!std::dynamic_pointer_cast<AssignStatement>(node)) {
+		reason = "statement " + node->token->text + " in the body";
+		return false;
+	}
+	auto left = node->children[0];
+	if (std::dynamic_pointer_cast<VarNode>(left)) {
+		return addReduction(node);
+	}
+
+	auto element = std::dynamic_pointer_cast<IndexNode>(left);
+	if (element == nullptr || !std::dynamic_pointer_cast<VarNode>(element->children[0])) {
+		reason = "an assignment to something else than an array element or a variable";
+		return false;
+	}
+	std::string name = lowerString(element->children[0]->token->text);
+	if (!isCounter(element->children[1])) {
+		reason = name + " is assigned at another index than the counter";
+		return false;
+	}
+	if (!setType(element->type)) {
+		return false;
+	}
+	writtenArrays.insert(name);
+	statements.push_back({ element, node->children[1], "", IrInstruction::MOV, -1, IrOperand() });
+	return true;
+}
+
+// s := s + e, s := e + s or s := s - e
+bool Vectorizer::addReduction(PSyntaxNode node)
+{
+	auto left = node->children[0], right = node->children[1];
+	std::string name = lowerString(left->token->text);
+	std::set<std::string> variable = { name };
+	int reg = builder.variableRegister(name);
+	if (name == counterName) {
+		reason = "the counter is assigned";
+		return false;
+	}
+	if (reg == -1 || reductionVariables.count(name) || !setType(left->type)) {
+		reason = reason.empty() ? name + " is not a reduction" : reason;
+		return false;
+	}
+
+	auto op = std::dynamic_pointer_cast<BinaryOpNode>(right);
+	IrInstruction::Opcode opcode = IrInstruction::ADD;
+	PSyntaxNode value;
+	if (op != nullptr && (op->token->type == OP_PLUS || op->token->type == OP_MINUS)) {
+		auto a = op->children[0], b = op->children[1];
+		bool first = std::dynamic_pointer_cast<VarNode>(a) && lowerString(a->token->text) == name;
+		bool second = std::dynamic_pointer_cast<VarNode>(b) && lowerString(b->token->text) == name;
+		if (op->token->type == OP_MINUS) {
+			opcode = IrInstruction::SUB;
+			second = false;
+		}
+		value = first ? b : second ? a : nullptr;
+	}
+	if (value == nullptr || mentions(value, variable)) {
+		reason = name + " is not a reduction";
+		return false;
+	}
+	reductionVariables.insert(name);
+	statements.push_back({ nullptr, value, name, opcode, reg, IrOperand() });
+	return true;
+}
+
+// if e > m then m := e, the comparison may be reversed and is a minimum for <
+bool Vectorizer::addMinMax(PSyntaxNode node)
+{
+	auto statement = std::static_pointer_cast<IfStatement>(node);
+	std::vector<PSyntaxNode> ifPart;
+	if (statement->ifPart != nullptr) {
+		flatten(statement->ifPart, ifPart);
+	}
+	auto condition = std::dynamic_pointer_cast<BinaryOpNode>(statement->condition);
+	auto type = condition != nullptr ? condition->token->type : UNDEFINED;
+	bool greater = type == OP_GREATER || type == OP_GREATER_OR_EQUAL;
+	bool less = type == OP_LESS || type == OP_LESS_OR_EQUAL;
+	if (statement->elsePart != nullptr || ifPart.size() != 1 || !std::dynamic_pointer_cast<AssignStatement>(ifPart[0]) ||
+		!std::dynamic_pointer_cast<VarNode>(ifPart[0]->children[0]) || (!greater && !less))
+	{
+		reason = "a conditional statement";
+		return false;
+	}
+
+	auto assign = ifPart[0];
+	std::string name = lowerString(assign->children[0]->token->text);
+	auto value = assign->children[1];
+	auto isVariable = [&name](PSyntaxNode node) {
+		return std::dynamic_pointer_cast<VarNode>(node) && lowerString(node->token->text) == name;
+	};
+	// the value is compared by its tree, so e is computed once per iteration
+	bool variableFirst = isVariable(condition->children[0]);
+	auto other = condition->children[variableFirst ? 1 : 0];
+	if ((!variableFirst && !isVariable(condition->children[1])) || other->toString() != value->toString()) {
+		reason = "a conditional statement";
+		return false;
+	}
+
+	int reg = builder.variableRegister(name);
+	if (name == counterName || reg == -1 || reductionVariables.count(name) || mentions(value, { name }) || !setType(assign->children[0]->type)) {
+		reason = reason.empty() ? name + " is not a reduction" : reason;
+		return false;
+	}
+	reductionVariables.insert(name);
+	statements.push_back({ nullptr, value, name, greater != variableFirst ? IrInstruction::MAX : IrInstruction::MIN, reg, IrOperand() });
+	return true;
+}
+
+bool Vectorizer::setType(PType type)
+{
+	if (type->category != Type::INTEGER && type->category != Type::DOUBLE) {
+		reason = "values are not integers or doubles";
+		return false;
+	}
+	auto res = type->category == Type::DOUBLE ? IrInstruction::F64 : IrInstruction::I32;
+	if (typed && res != elementType) {
+		reason = "integers and doubles are mixed";
+		return false;
+	}
+	elementType = res;
+	typed = true;
+	return true;
+}
+
+bool Vectorizer::isCounter(PSyntaxNode node)
+{
+	return std::dynamic_pointer_cast<VarNode>(node) && lowerString(node->token->text) == counterName;
+}
+
+bool Vectorizer::mentions(PSyntaxNode node, const std::set<std::string> &names)
+{
+	if (std::dynamic_pointer_cast<VarNode>(node) && names.count(lowerString(node->token->text))) {
+		return true;
+	}
+	for (auto child : node->children) {
+		if (mentions(child, names)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// the same in every iteration, so it is computed as a scalar and copied to all lanes
+bool Vectorizer::invariant(PSyntaxNode node)
+{
+	if (std::dynamic_pointer_cast<FunctionCallNode>(node)) {
+		return false;
+	}
+	if (isCounter(node) || mentions(node, reductionVariables) || mentions(node, writtenArrays)) {
+		return false;
+	}
+	for (auto child : node->children) {
+		if (!invariant(child)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Vectorizer::counterOffset(PSyntaxNode index, int &offset)
+{
+	offset = 0;
+	if (isCounter(index)) {
+		return true;
+	}
+	auto op = std::dynamic_pointer_cast<BinaryOpNode>(index);
+	if (op == nullptr || (op->token->type != OP_PLUS && op->token->type != OP_MINUS)) {
+		return false;
+	}
+	auto a = op->children[0], b = op->children[1];
+	if (op->token->type == OP_PLUS && !isCounter(a)) {
+		std::swap(a, b);
+	}
+	if (!isCounter(a) || b->category != SyntaxNode::CONST_NODE || b->type->category != Type::INTEGER) {
+		return false;
+	}
+	offset = std::static_pointer_cast<ConstNode>(b)->value->toInteger();
+	offset = op->token->type == OP_MINUS ? -offset : offset;
+	return true;
+}
+
+bool Vectorizer::vectorizable(PSyntaxNode node)
+{
+	if (node->type->category != (elementType == IrInstruction::F64 ? Type::DOUBLE : Type::INTEGER)) {
+		reason = "integers and doubles are mixed";
+		return false;
+	}
+	if (invariant(node)) {
+		return true;
+	}
+	if (isCounter(node)) {
+		reason = "the counter is used as a value";
+		return false;
+	}
+
+	auto element = std::dynamic_pointer_cast<IndexNode>(node);
+	if (element != nullptr) {
+		int offset;
+		auto array = element->children[0];
+		if (!std::dynamic_pointer_cast<VarNode>(array) || !counterOffset(element->children[1], offset)) {
+			reason = "an element is read at an index other than the counter plus a constant";
+			return false;
+		}
+		std::string name = lowerString(array->token->text);
+		if (offset != 0 && writtenArrays.count(name)) {
+			reason = "elements of " + name + " are read in other iterations than written";
+			return false;
+		}
+		return true;
+	}
+
+	if (std::dynamic_pointer_cast<CastNode>(node)) {
+		reason = "integers are converted to doubles";
+		return false;
+	}
+	auto op = std::dynamic_pointer_cast<BinaryOpNode>(node);
+	if (op == nullptr) {
+		reason = "expression " + node->token->text + " has no packed form";
+		return false;
+	}
+	switch (op->token->type) {
+	case OP_PLUS:
+	case OP_MINUS:
+		break;
+	case OP_MULT:
+	case OP_DIVISION:
+		if (elementType == IrInstruction::F64) {
+			break;
+		}
+	default:
+		reason = "operation " + op->token->text + " on integers has no SSE2 packed form";
+		return false;
+	}
+	return vectorizable(op->children[0]) && vectorizable(op->children[1]);
+}
+
+IrInstruction::Type Vectorizer::vectorType()
+{
+	return elementType == IrInstruction::F64 ? IrInstruction::V2F64 : IrInstruction::V4I32;
+}
+
+IrOperand Vectorizer::vectorToIr(PSyntaxNode node)
+{
+	static const std::map<TokenType, IrInstruction::Opcode> opcodes = {
+		{ OP_PLUS, IrInstruction::ADD },
+		{ OP_MINUS, IrInstruction::SUB },
+		{ OP_MULT, IrInstruction::MUL },
+		{ OP_DIVISION, IrInstruction::DIV },
+	};
+
+	auto type = vectorType();
+	if (invariant(node)) {
+		return builder.emit(IrInstruction::SPLAT, node->valueToIr(builder), IrOperand(), type);
+	}
+	if (std::dynamic_pointer_cast<IndexNode>(node)) {
+		// elements of a vector are loaded unaligned, arrays aren't aligned to 16
+		return builder.emit(IrInstruction::LOAD, node->addressToIr(builder), IrOperand(), type);
+	}
+	auto left = vectorToIr(node->children[0]);
+	auto right = vectorToIr(node->children[1]);
+	return builder.emit(opcodes.at(node->token->type), left, right, type);
+}
+
+void Vectorizer::statementToIr(Statement &statement)
+{
+	auto value = vectorToIr(statement.value);
+	if (statement.element != nullptr) {
+		IrInstruction store(IrInstruction::STORE, vectorType());
+		store.a = statement.element->addressToIr(builder);
+		store.b = value;
+		builder.emit(store);
+		return;
+	}
+	// a difference is accumulated as a sum and subtracted at the end
+	IrInstruction update(statement.opcode == IrInstruction::SUB ? IrInstruction::ADD : statement.opcode, vectorType());
+	update.dst = update.a = statement.accumulator;
+	update.b = value;
+	builder.emit(update);
+}
+
+void Vectorizer::report(const std::string &text)
+{
+	builder.code.vectorizerReport.push_back("line " + std::to_string(loop.token->row) + ": " + text);
+}
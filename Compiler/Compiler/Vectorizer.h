@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <set>
+
+#include "SyntaxObject.h"
+#include "IrBuilder.h"
+
+// Runs a for loop over arrays 4 integers or 2 doubles at a time with SSE2 packed instructions.
+// The body may only assign array elements at the counter and accumulate a sum, a minimum or a maximum
+// in a scalar variable. The vector loop is emitted before the scalar one, which runs the iterations left.
+class Vectorizer {
+public:
+	Vectorizer(IrBuilder &builder, ForNode &loop);
+	// emits the vector loop for the counter already set to its start, reports whether it was possible
+	void run(int counter, IrOperand bound);
+
+private:
+	// an element assigned at the counter or a variable combined with the value of every iteration
+	struct Statement {
+		PSyntaxNode element, value;
+		std::string variable;
+		// ADD, SUB, MIN or MAX for reductions
+		IrInstruction::Opcode opcode;
+		int reg;
+		IrOperand accumulator;
+	};
+
+	IrBuilder &builder;
+	ForNode &loop;
+	std::string counterName;
+	std::vector<Statement> statements;
+	std::set<std::string> writtenArrays;
+	std::set<std::string> reductionVariables;
+	// type of the lanes, I32 or F64 until a statement fixes it
+	IrInstruction::Type elementType;
+	bool typed;
+	std::string reason;
+
+	bool analyze();
+	void flatten(PSyntaxNode node, std::vector<PSyntaxNode> &res);
+	bool addStatement(PSyntaxNode node);
+	bool addReduction(PSyntaxNode node);
+	bool addMinMax(PSyntaxNode node);
+	bool setType(PType type);
+	bool isCounter(PSyntaxNode node);
+	bool mentions(PSyntaxNode node, const std::set<std::string> &names);
+	bool invariant(PSyntaxNode node);
+	bool vectorizable(PSyntaxNode node);
+	// constant offset of an index from the counter
+	bool counterOffset(PSyntaxNode index, int &offset);
+
+	IrInstruction::Type vectorType();
+	IrOperand vectorToIr(PSyntaxNode node);
+	void statementToIr(Statement &statement);
+	void report(const std::string &text);
+};
@@ -0,0 +1,750 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include "Vm.h"
+#include "Encoder.h"
+#include "Linker.h"
+#include "Layout.h"
+#include "Runtime.h"
+
+#if defined(__GNUC__)
+#define VM_THREADED
+#endif
+
+static const size_t outputSize = 1 << 16;
+// data starts above the null address
+static const int dataStart = 16;
+static std::string output;
+
+static void flushOutput()
+{
+	fwrite(output.data(), 1, output.size(), stdout);
+	fflush(stdout);
+	output.clear();
+}
+
+// the program ends as the compiled one does, after the text written before the error
+static void runtimeError(const char *message, int code)
+{
+	flushOutput();
+	fputs(message, stderr);
+	exit(code);
+}
+
+// integers wrap around as in the machine code
+static int32_t wrap(int64_t value)
+{
+	return (int32_t)(uint32_t)value;
+}
+
+Vm::Vm(AsmCode &code)
+	: code(code)
+{
+}
+
+void Vm::emit(Opcode opcode, std::initializer_list<int> operands)
+{
+	opcodes.push_back((int)words.size());
+	words.push_back(opcode);
+	words.insert(words.end(), operands.begin(), operands.end());
+}
+
+int Vm::constant(Value value)
+{
+	auto &routine = routines.back();
+	routine.values.push_back(value);
+	return routine.constants + (int)routine.values.size() - 1;
+}
+
+int Vm::slot(const IrOperand &operand)
+{
+	if (operand.isRegister()) {
+		return operand.value;
+	}
+	if (!operand.isImmediate()) {
+		throw std::exception("Register or immediate expected");
+	}
+	auto it = immediates.find(operand.value);
+	if (it != immediates.end()) {
+		return it->second;
+	}
+	Value value = {};
+	value.i = operand.value;
+	return immediates[operand.value] = constant(value);
+}
+
+// the address is known once the data is placed
+int Vm::labelAddress(const std::string &label)
+{
+	auto it = labelConstants.find(label);
+	if (it != labelConstants.end()) {
+		return it->second;
+	}
+	int res = constant({});
+	addresses.push_back(std::make_tuple((int)routines.size() - 1, (int)routines.back().values.size() - 1, label));
+	return labelConstants[label] = res;
+}
+
+int Vm::frameOffset(const IrOperand &operand)
+{
+	if (operand.kind != IrOperand::VARIABLE) {
+		return -1;
+	}
+	auto it = code.offsets.find(operand.name);
+	return it == code.offsets.end() ? -1 : it->second;
+}
+
+// slot holding the address of a static variable or a label, or the register holding an address
+int Vm::address(const IrOperand &operand)
+{
+	switch (operand.kind) {
+	case IrOperand::REGISTER:
+		return operand.value;
+	case IrOperand::LABEL:
+		return labelAddress(operand.name);
+	case IrOperand::VARIABLE: {
+		auto it = code.labels.find(operand.name);
+		if (it != code.labels.end()) {
+			return labelAddress(it->second);
+		}
+		// static variables of inlined routines are named by their labels
+		if (operand.name[0] == '$') {
+			return labelAddress(operand.name);
+		}
+		throw std::exception("Variable is not placed in memory");
+	}
+	default:
+		throw std::exception("Address expected");
+	}
+}
+
+void Vm::jump(int target)
+{
+	emit(JUMP, { 0 });
+	jumps.push_back({ (int)words.size() - 1, target });
+}
+
+void Vm::branch(IrInstruction::Condition condition, IrInstruction::Type type, const IrOperand &a, const IrOperand &b,
+	const std::vector<int> &targets, int next)
+{
+	int target = targets[0], otherTarget = targets[1];
+	if (a.isImmediate() && b.isImmediate()) {
+		int taken = IrInstruction::evaluate(condition, a.value, b.value) ? target : otherTarget;
+		if (taken != next) {
+			jump(taken);
+		}
+		return;
+	}
+	// the inverse of a comparison of doubles holds for NaN, so such a branch isn't inverted to fall through
+	if (target == next && type != IrInstruction::F64) {
+		std::swap(target, otherTarget);
+		condition = IrInstruction::inverse(condition);
+	}
+	emit((Opcode)((type == IrInstruction::F64 ? FBREQ : BREQ) + condition), { slot(a), slot(b), 0 });
+	jumps.push_back({ (int)words.size() - 1, target });
+	if (otherTarget != next) {
+		jump(otherTarget);
+	}
+}
+
+void Vm::add(IrFunction &function, const std::string &label)
+{
+	Routine routine;
+	routine.label = label;
+	routine.start = (int)words.size();
+	routine.parameters = function.registerCnt;
+	routine.constants = routine.parameters + (int)function.parameterTypes.size();
+	routine.frameSize = Layout::alignUp(code.size, 16);
+	routineIndexes[label] = (int)routines.size();
+	routines.push_back(routine);
+	immediates.clear();
+	labelConstants.clear();
+	jumps.clear();
+
+	useCounts.assign(function.registerCnt, 0);
+	for (auto &block : function.blocks) {
+		for (auto &instruction : block.instructions) {
+			for (int reg : instruction.uses()) {
+				++useCounts[reg];
+			}
+		}
+	}
+
+	std::vector<int> starts(function.blocks.size());
+	for (int i = 0; i < function.blocks.size(); ++i) {
+		auto &block = function.blocks[i];
+		starts[block.id] = (int)words.size();
+		int next = i + 1 < function.blocks.size() ? function.blocks[i + 1].id : -1;
+		for (int j = 0; j < block.instructions.size(); ++j) {
+			j += lower(block, j, next);
+		}
+	}
+	emit(LEAVE, {});
+	for (auto &it : jumps) {
+		words[it.first] = starts[it.second];
+	}
+	routines.back().size = routines.back().constants + (int)routines.back().values.size();
+}
+
+int Vm::lower(IrBlock &block, int index, int next)
+{
+	auto &instruction = block.instructions[index];
+	auto *following = index + 1 < block.instructions.size() ? &block.instructions[index + 1] : nullptr;
+	if (IrInstruction::isVector(instruction.type)) {
+		throw std::exception("Vector operations aren't supported by the VM");
+	}
+	bool doubles = instruction.type == IrInstruction::F64;
+	int dst = instruction.dst.isRegister() ? instruction.dst.value : -1;
+	switch (instruction.opcode) {
+	case IrInstruction::MOV:
+		emit(MOV, { dst, slot(instruction.a) });
+		break;
+	case IrInstruction::ADD:
+	case IrInstruction::SUB:
+	case IrInstruction::MUL:
+	case IrInstruction::DIV: {
+		static const Opcode integerOpcodes[] = { ADD, SUB, MUL, DIV }, doubleOpcodes[] = { FADD, FSUB, FMUL, FDIV };
+		int operation = instruction.opcode - IrInstruction::ADD;
+		emit(doubles ? doubleOpcodes[operation] : integerOpcodes[operation], { dst, slot(instruction.a), slot(instruction.b) });
+		break;
+	}
+	case IrInstruction::MOD:
+	case IrInstruction::AND:
+	case IrInstruction::OR:
+	case IrInstruction::XOR: {
+		static const std::map<IrInstruction::Opcode, Opcode> opcodes = {
+			{ IrInstruction::MOD, MOD }, { IrInstruction::AND, AND }, { IrInstruction::OR, OR }, { IrInstruction::XOR, XOR },
+		};
+		emit(opcodes.at(instruction.opcode), { dst, slot(instruction.a), slot(instruction.b) });
+		break;
+	}
+	case IrInstruction::NEG:
+		emit(doubles ? FNEG : NEG, { dst, slot(instruction.a) });
+		break;
+	case IrInstruction::NOT:
+		emit(NOT, { dst, slot(instruction.a) });
+		break;
+	case IrInstruction::ITOF:
+		emit(ITOF, { dst, slot(instruction.a) });
+		break;
+	case IrInstruction::FTOI:
+		emit(FTOI, { dst, slot(instruction.a) });
+		break;
+	case IrInstruction::SET:
+		// a comparison only tested by the branch after it becomes the condition of the branch
+		if (following != nullptr && following->opcode == IrInstruction::BRANCH && following->a == instruction.dst &&
+			following->b == IrOperand::immediate(0) && useCounts[dst] == 1 &&
+			(following->condition == IrInstruction::EQ || following->condition == IrInstruction::NE))
+		{
+			// a branch on a false comparison takes the targets the other way round
+			auto targets = following->targets;
+			if (following->condition == IrInstruction::EQ) {
+				std::swap(targets[0], targets[1]);
+			}
+			branch(instruction.condition, instruction.type, instruction.a, instruction.b, targets, next);
+			return 1;
+		}
+		emit((Opcode)((doubles ? FSETEQ : SETEQ) + instruction.condition), { dst, slot(instruction.a), slot(instruction.b) });
+		break;
+	case IrInstruction::ADDR: {
+		int offset = frameOffset(instruction.a);
+		if (offset >= 0) {
+			emit(FRAME, { dst, offset });
+			break;
+		}
+		emit(MOV, { dst, address(instruction.a) });
+		break;
+	}
+	case IrInstruction::LOAD: {
+		int offset = frameOffset(instruction.a);
+		// a loaded integer only added to a value is added by the load
+		if (instruction.type == IrInstruction::I32 && following != nullptr && following->opcode == IrInstruction::ADD &&
+			following->type == IrInstruction::I32 && useCounts[dst] == 1 && (following->a == instruction.dst) != (following->b == instruction.dst))
+		{
+			int other = slot(following->a == instruction.dst ? following->b : following->a);
+			if (offset >= 0) {
+				emit(ADDLOADL, { following->dst.value, other, offset });
+			}
+			else {
+				emit(ADDLOAD, { following->dst.value, other, address(instruction.a) });
+			}
+			return 1;
+		}
+		if (offset >= 0) {
+			emit(doubles ? FLOADL : instruction.type == IrInstruction::I8 ? LOADLB : LOADL, { dst, offset });
+			break;
+		}
+		emit(doubles ? FLOAD : instruction.type == IrInstruction::I8 ? LOADB : LOAD, { dst, address(instruction.a) });
+		break;
+	}
+	case IrInstruction::STORE: {
+		int offset = frameOffset(instruction.a);
+		if (offset >= 0) {
+			emit(doubles ? FSTOREL : instruction.type == IrInstruction::I8 ? STORELB : STOREL, { offset, slot(instruction.b) });
+			break;
+		}
+		emit(doubles ? FSTORE : instruction.type == IrInstruction::I8 ? STOREB : STORE, { address(instruction.a), slot(instruction.b) });
+		break;
+	}
+	case IrInstruction::WRITE:
+		emit(doubles ? FWRITE : instruction.type == IrInstruction::I8 ? WRITEB : WRITE, { slot(instruction.a) });
+		break;
+	case IrInstruction::READ:
+		emit(doubles ? FREAD : instruction.type == IrInstruction::I8 ? READB : READ, { dst });
+		break;
+	case IrInstruction::CHECK:
+		emit(CHECK, { slot(instruction.a), slot(instruction.b) });
+		break;
+	case IrInstruction::PARAM:
+		emit(MOV, { dst, routines.back().parameters + instruction.a.value });
+		break;
+	case IrInstruction::CALL: {
+		std::vector<int> arguments;
+		for (auto &argument : instruction.arguments) {
+			arguments.push_back(slot(argument));
+		}
+		emit(CALL, { 0, dst, (int)arguments.size() });
+		calls.push_back({ (int)words.size() - 3, instruction.a.name });
+		words.insert(words.end(), arguments.begin(), arguments.end());
+		break;
+	}
+	case IrInstruction::RETURN:
+		if (instruction.a.kind == IrOperand::NONE) {
+			emit(LEAVE, {});
+			break;
+		}
+		emit(RETURN, { slot(instruction.a) });
+		break;
+	case IrInstruction::JUMP:
+		if (instruction.targets[0] != next) {
+			jump(instruction.targets[0]);
+		}
+		break;
+	case IrInstruction::BRANCH:
+		branch(instruction.condition, instruction.type, instruction.a, instruction.b, instruction.targets, next);
+		break;
+	default:
+		throw std::exception("Operation isn't supported by the VM");
+	}
+	return 0;
+}
+
+// the data is placed as the linker places it for the executable, no code is encoded,
+// so every label it resolves is one of the data
+void Vm::load(const Routine &main)
+{
+	Encoder encoder(code);
+	Linker linker(code, encoder);
+	int dataSize = dataStart;
+	linker.place(true, true, dataSize);
+	linker.place(false, true, dataSize);
+	linker.place(false, false, dataSize);
+	linker.locate(0, 0);
+	memory.assign(Layout::alignUp(dataSize, 16) + Runtime::stackBytes(main.frameSize), 0);
+	linker.writeData(memory.data());
+
+	for (auto &it : addresses) {
+		routines[std::get<0>(it)].values[std::get<1>(it)].i = (int32_t)linker.address(std::get<2>(it));
+	}
+	for (auto &it : calls) {
+		auto routine = routineIndexes.find(it.second);
+		if (routine == routineIndexes.end()) {
+			throw std::exception("Call of an undefined routine");
+		}
+		words[it.first] = routine->second;
+	}
+}
+
+void Vm::run()
+{
+	auto start = std::chrono::steady_clock::now();
+	auto &main = routines.at(routineIndexes.at(Runtime::main));
+	load(main);
+	auto loaded = std::chrono::steady_clock::now();
+	try {
+		execute(main);
+	}
+	catch (...) {
+		flushOutput();
+		throw;
+	}
+	auto finished = std::chrono::steady_clock::now();
+	flushOutput();
+	loadTime = std::chrono::duration<double>(loaded - start).count();
+	runTime = std::chrono::duration<double>(finished - loaded).count();
+}
+
+#ifdef VM_THREADED
+#define CASE(name) do_##name:
+#define DISPATCH() goto *(const void *)*pc
+#else
+#define CASE(name) case name:
+#define DISPATCH() continue
+#endif
+#define SLOT(n) window[pc[n]]
+
+// variables of a frame are below its end, as those of the machine code are below its frame base
+void Vm::execute(const Routine &main)
+{
+#ifdef VM_THREADED
+	static const void *const handlers[] = {
+#define VM_HANDLER(name) &&do_##name,
+		VM_OPCODES(VM_HANDLER)
+#undef VM_HANDLER
+	};
+	for (int position : opcodes) {
+		words[position] = (intptr_t)handlers[words[position]];
+	}
+#endif
+	std::unique_ptr<Value[]> registers(new Value[windowSize]);
+	std::vector<Frame> frames;
+	char *m = memory.data();
+	const intptr_t *base = words.data();
+	Value *window = registers.get(), *windowEnd = registers.get() + windowSize;
+	uint32_t frame = Layout::alignUp((int)memory.size() - Runtime::stackBytes(main.frameSize), 16) + main.frameSize;
+	if (main.size > windowSize || frame > memory.size()) {
+		runtimeError("Stack overflow\n", Runtime::stackOverflowCode);
+	}
+	std::copy(main.values.begin(), main.values.end(), window + main.constants);
+	int size = main.size;
+	const intptr_t *pc = base + main.start;
+
+#ifdef VM_THREADED
+	DISPATCH();
+#else
+	for (;;) switch (*pc) {
+#endif
+	CASE(MOV)
+		SLOT(1) = SLOT(2);
+		pc += 3;
+		DISPATCH();
+	CASE(ADD)
+		SLOT(1).i = wrap((int64_t)SLOT(2).i + SLOT(3).i);
+		pc += 4;
+		DISPATCH();
+	CASE(SUB)
+		SLOT(1).i = wrap((int64_t)SLOT(2).i - SLOT(3).i);
+		pc += 4;
+		DISPATCH();
+	CASE(MUL)
+		SLOT(1).i = wrap((int64_t)SLOT(2).i * SLOT(3).i);
+		pc += 4;
+		DISPATCH();
+	CASE(DIV)
+		if (SLOT(3).i == 0) {
+			runtimeError("Division by zero\n", Runtime::divisionErrorCode);
+		}
+		SLOT(1).i = wrap((int64_t)SLOT(2).i / SLOT(3).i);
+		pc += 4;
+		DISPATCH();
+	CASE(MOD)
+		if (SLOT(3).i == 0) {
+			runtimeError("Division by zero\n", Runtime::divisionErrorCode);
+		}
+		SLOT(1).i = (int32_t)((int64_t)SLOT(2).i % SLOT(3).i);
+		pc += 4;
+		DISPATCH();
+	CASE(AND)
+		SLOT(1).i = SLOT(2).i & SLOT(3).i;
+		pc += 4;
+		DISPATCH();
+	CASE(OR)
+		SLOT(1).i = SLOT(2).i | SLOT(3).i;
+		pc += 4;
+		DISPATCH();
+	CASE(XOR)
+		SLOT(1).i = SLOT(2).i ^ SLOT(3).i;
+		pc += 4;
+		DISPATCH();
+	CASE(NEG)
+		SLOT(1).i = wrap(-(int64_t)SLOT(2).i);
+		pc += 3;
+		DISPATCH();
+	CASE(NOT)
+		SLOT(1).i = ~SLOT(2).i;
+		pc += 3;
+		DISPATCH();
+	CASE(FADD)
+		SLOT(1).d = SLOT(2).d + SLOT(3).d;
+		pc += 4;
+		DISPATCH();
+	CASE(FSUB)
+		SLOT(1).d = SLOT(2).d - SLOT(3).d;
+		pc += 4;
+		DISPATCH();
+	CASE(FMUL)
+		SLOT(1).d = SLOT(2).d * SLOT(3).d;
+		pc += 4;
+		DISPATCH();
+	CASE(FDIV)
+		SLOT(1).d = SLOT(2).d / SLOT(3).d;
+		pc += 4;
+		DISPATCH();
+	CASE(FNEG)
+		SLOT(1).d = -SLOT(2).d;
+		pc += 3;
+		DISPATCH();
+	CASE(ITOF)
+		SLOT(1).d = SLOT(2).i;
+		pc += 3;
+		DISPATCH();
+	CASE(FTOI)
+		SLOT(1).i = (int32_t)SLOT(2).d;
+		pc += 3;
+		DISPATCH();
+	CASE(SETEQ)
+		SLOT(1).i = SLOT(2).i == SLOT(3).i ? -1 : 0;
+		pc += 4;
+		DISPATCH();
+	CASE(SETNE)
+		SLOT(1).i = SLOT(2).i != SLOT(3).i ? -1 : 0;
+		pc += 4;
+		DISPATCH();
+	CASE(SETLT)
+		SLOT(1).i = SLOT(2).i < SLOT(3).i ? -1 : 0;
+		pc += 4;
+		DISPATCH();
+	CASE(SETLE)
+		SLOT(1).i = SLOT(2).i <= SLOT(3).i ? -1 : 0;
+		pc += 4;
+		DISPATCH();
+	CASE(SETGT)
+		SLOT(1).i = SLOT(2).i > SLOT(3).i ? -1 : 0;
+		pc += 4;
+		DISPATCH();
+	CASE(SETGE)
+		SLOT(1).i = SLOT(2).i >= SLOT(3).i ? -1 : 0;
+		pc += 4;
+		DISPATCH();
+	CASE(FSETEQ)
+		SLOT(1).i = SLOT(2).d == SLOT(3).d ? -1 : 0;
+		pc += 4;
+		DISPATCH();
+	CASE(FSETNE)
+		SLOT(1).i = SLOT(2).d != SLOT(3).d ? -1 : 0;
+		pc += 4;
+		DISPATCH();
+	CASE(FSETLT)
+		SLOT(1).i = SLOT(2).d < SLOT(3).d ? -1 : 0;
+		pc += 4;
+		DISPATCH();
+	CASE(FSETLE)
+		SLOT(1).i = SLOT(2).d <= SLOT(3).d ? -1 : 0;
+		pc += 4;
+		DISPATCH();
+	CASE(FSETGT)
+		SLOT(1).i = SLOT(2).d > SLOT(3).d ? -1 : 0;
+		pc += 4;
+		DISPATCH();
+	CASE(FSETGE)
+		SLOT(1).i = SLOT(2).d >= SLOT(3).d ? -1 : 0;
+		pc += 4;
+		DISPATCH();
+	CASE(FRAME)
+		SLOT(1).i = (int32_t)(frame - pc[2]);
+		pc += 3;
+		DISPATCH();
+	CASE(LOAD)
+		memcpy(&SLOT(1).i, m + (uint32_t)SLOT(2).i, 4);
+		pc += 3;
+		DISPATCH();
+	CASE(LOADB)
+		SLOT(1).i = (unsigned char)m[(uint32_t)SLOT(2).i];
+		pc += 3;
+		DISPATCH();
+	CASE(FLOAD)
+		memcpy(&SLOT(1).d, m + (uint32_t)SLOT(2).i, 8);
+		pc += 3;
+		DISPATCH();
+	CASE(LOADL)
+		memcpy(&SLOT(1).i, m + frame - pc[2], 4);
+		pc += 3;
+		DISPATCH();
+	CASE(LOADLB)
+		SLOT(1).i = (unsigned char)m[frame - pc[2]];
+		pc += 3;
+		DISPATCH();
+	CASE(FLOADL)
+		memcpy(&SLOT(1).d, m + frame - pc[2], 8);
+		pc += 3;
+		DISPATCH();
+	CASE(STORE)
+		memcpy(m + (uint32_t)SLOT(1).i, &SLOT(2).i, 4);
+		pc += 3;
+		DISPATCH();
+	CASE(STOREB)
+		m[(uint32_t)SLOT(1).i] = (char)SLOT(2).i;
+		pc += 3;
+		DISPATCH();
+	CASE(FSTORE)
+		memcpy(m + (uint32_t)SLOT(1).i, &SLOT(2).d, 8);
+		pc += 3;
+		DISPATCH();
+	CASE(STOREL)
+		memcpy(m + frame - pc[1], &SLOT(2).i, 4);
+		pc += 3;
+		DISPATCH();
+	CASE(STORELB)
+		m[frame - pc[1]] = (char)SLOT(2).i;
+		pc += 3;
+		DISPATCH();
+	CASE(FSTOREL)
+		memcpy(m + frame - pc[1], &SLOT(2).d, 8);
+		pc += 3;
+		DISPATCH();
+	CASE(ADDLOAD) {
+		int32_t value;
+		memcpy(&value, m + (uint32_t)SLOT(3).i, 4);
+		SLOT(1).i = wrap((int64_t)SLOT(2).i + value);
+		pc += 4;
+		DISPATCH();
+	}
+	CASE(ADDLOADL) {
+		int32_t value;
+		memcpy(&value, m + frame - pc[3], 4);
+		SLOT(1).i = wrap((int64_t)SLOT(2).i + value);
+		pc += 4;
+		DISPATCH();
+	}
+	CASE(WRITE) {
+		char text[16];
+		output.append(text, sprintf(text, "%d\n", SLOT(1).i));
+		if (output.size() >= outputSize) {
+			flushOutput();
+		}
+		pc += 2;
+		DISPATCH();
+	}
+	CASE(WRITEB)
+		output += (char)SLOT(1).i;
+		output += '\n';
+		if (output.size() >= outputSize) {
+			flushOutput();
+		}
+		pc += 2;
+		DISPATCH();
+	CASE(FWRITE) {
+		// %f of the largest double is 318 characters long
+		char text[320];
+		output.append(text, snprintf(text, sizeof(text), "%f\n", SLOT(1).d));
+		if (output.size() >= outputSize) {
+			flushOutput();
+		}
+		pc += 2;
+		DISPATCH();
+	}
+	// pending output is flushed first, so a prompt shows before the program blocks on stdin
+	CASE(READ)
+		flushOutput();
+		SLOT(1).i = Runtime::inputInt();
+		pc += 2;
+		DISPATCH();
+	CASE(READB)
+		flushOutput();
+		SLOT(1).i = Runtime::inputChar();
+		pc += 2;
+		DISPATCH();
+	CASE(FREAD)
+		flushOutput();
+		SLOT(1).d = Runtime::inputDouble();
+		pc += 2;
+		DISPATCH();
+	CASE(CHECK)
+		if ((uint32_t)SLOT(1).i > (uint32_t)SLOT(2).i) {
+			runtimeError("Range check error\n", Runtime::rangeErrorCode);
+		}
+		pc += 3;
+		DISPATCH();
+	CASE(JUMP)
+		pc = base + pc[1];
+		DISPATCH();
+	CASE(BREQ)
+		pc = SLOT(1).i == SLOT(2).i ? base + pc[3] : pc + 4;
+		DISPATCH();
+	CASE(BRNE)
+		pc = SLOT(1).i != SLOT(2).i ? base + pc[3] : pc + 4;
+		DISPATCH();
+	CASE(BRLT)
+		pc = SLOT(1).i < SLOT(2).i ? base + pc[3] : pc + 4;
+		DISPATCH();
+	CASE(BRLE)
+		pc = SLOT(1).i <= SLOT(2).i ? base + pc[3] : pc + 4;
+		DISPATCH();
+	CASE(BRGT)
+		pc = SLOT(1).i > SLOT(2).i ? base + pc[3] : pc + 4;
+		DISPATCH();
+	CASE(BRGE)
+		pc = SLOT(1).i >= SLOT(2).i ? base + pc[3] : pc + 4;
+		DISPATCH();
+	CASE(FBREQ)
+		pc = SLOT(1).d == SLOT(2).d ? base + pc[3] : pc + 4;
+		DISPATCH();
+	CASE(FBRNE)
+		pc = SLOT(1).d != SLOT(2).d ? base + pc[3] : pc + 4;
+		DISPATCH();
+	CASE(FBRLT)
+		pc = SLOT(1).d < SLOT(2).d ? base + pc[3] : pc + 4;
+		DISPATCH();
+	CASE(FBRLE)
+		pc = SLOT(1).d <= SLOT(2).d ? base + pc[3] : pc + 4;
+		DISPATCH();
+	CASE(FBRGT)
+		pc = SLOT(1).d > SLOT(2).d ? base + pc[3] : pc + 4;
+		DISPATCH();
+	CASE(FBRGE)
+		pc = SLOT(1).d >= SLOT(2).d ? base + pc[3] : pc + 4;
+		DISPATCH();
+	CASE(CALL) {
+		// the window of the routine follows that of the caller, its frame follows the frame of the caller
+		auto &routine = routines[pc[1]];
+		Value *callee = window + size;
+		if (routine.size > windowEnd - callee || frame + routine.frameSize > memory.size()) {
+			runtimeError("Stack overflow\n", Runtime::stackOverflowCode);
+		}
+		int count = (int)pc[3];
+		for (int i = 0; i < count; ++i) {
+			callee[routine.parameters + i] = SLOT(4 + i);
+		}
+		std::copy(routine.values.begin(), routine.values.end(), callee + routine.constants);
+		frames.push_back({ pc + 4 + count, window, size, (int)pc[2], frame });
+		window = callee;
+		size = routine.size;
+		frame += routine.frameSize;
+		pc = base + routine.start;
+		DISPATCH();
+	}
+	CASE(RETURN) {
+		Value result = SLOT(1);
+		if (frames.empty()) {
+			return;
+		}
+		auto &caller = frames.back();
+		pc = caller.pc;
+		window = caller.window;
+		size = caller.size;
+		frame = caller.frame;
+		if (caller.dst >= 0) {
+			window[caller.dst] = result;
+		}
+		frames.pop_back();
+		DISPATCH();
+	}
+	CASE(LEAVE) {
+		if (frames.empty()) {
+			return;
+		}
+		auto &caller = frames.back();
+		pc = caller.pc;
+		window = caller.window;
+		size = caller.size;
+		frame = caller.frame;
+		frames.pop_back();
+		DISPATCH();
+	}
+#ifndef VM_THREADED
+	}
+#endif
+}
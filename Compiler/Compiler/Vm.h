@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <map>
+
+#include "Generator.h"
+#include "Ir.h"
+
+// handlers of the bytecode, the operands follow the opcode in the words of the code
+#define VM_OPCODES(X) \
+	X(MOV) X(ADD) X(SUB) X(MUL) X(DIV) X(MOD) X(AND) X(OR) X(XOR) X(NEG) X(NOT) \
+	X(FADD) X(FSUB) X(FMUL) X(FDIV) X(FNEG) X(ITOF) X(FTOI) \
+	X(SETEQ) X(SETNE) X(SETLT) X(SETLE) X(SETGT) X(SETGE) \
+	X(FSETEQ) X(FSETNE) X(FSETLT) X(FSETLE) X(FSETGT) X(FSETGE) \
+	X(FRAME) X(LOAD) X(LOADB) X(FLOAD) X(LOADL) X(LOADLB) X(FLOADL) \
+	X(STORE) X(STOREB) X(FSTORE) X(STOREL) X(STORELB) X(FSTOREL) \
+	X(ADDLOAD) X(ADDLOADL) \
+	X(WRITE) X(WRITEB) X(FWRITE) X(READ) X(READB) X(FREAD) X(CHECK) \
+	X(JUMP) X(BREQ) X(BRNE) X(BRLT) X(BRLE) X(BRGT) X(BRGE) \
+	X(FBREQ) X(FBRNE) X(FBRLT) X(FBRLE) X(FBRGT) X(FBRGE) \
+	X(CALL) X(RETURN) X(LEAVE)
+
+// Interpreter of a compact register-based bytecode lowered from the IR of the main program and its routines.
+// Each routine has a window of slots holding its registers, its parameters and its constants, so every operand
+// is a slot and an instruction takes no operand kinds. Variables are in a memory of bytes holding the data as
+// the linker places it and a stack of the frames, addresses are offsets in it. Loads feeding an addition and
+// comparisons feeding a branch are fused into one instruction. The code is run by direct threading through
+// computed gotos where the compiler has them and by a switch otherwise.
+class Vm {
+public:
+	enum Opcode {
+#define VM_ENUM(name) name,
+		VM_OPCODES(VM_ENUM)
+#undef VM_ENUM
+	};
+
+	Vm(AsmCode &code);
+	// lowers the function compiled in the current frame of the code, the main program is added last
+	void add(IrFunction &function, const std::string &label);
+	// the text written by the program is buffered and printed when the buffer fills up and when it ends,
+	// a runtime error ends the process with the exit code of the compiled program after the text
+	void run();
+
+	static const int windowSize = 1 << 20;
+	// seconds spent placing the data and running the program
+	double loadTime = 0, runTime = 0;
+
+private:
+	union Value {
+		int32_t i;
+		double d;
+	};
+
+	struct Routine {
+		std::string label;
+		int start;
+		// parameters follow the registers in the window, the constants follow them
+		int parameters;
+		int constants;
+		int size;
+		int frameSize;
+		std::vector<Value> values;
+	};
+
+	// the caller to return to, dst is the slot receiving the result or -1
+	struct Frame {
+		const intptr_t *pc;
+		Value *window;
+		int size;
+		int dst;
+		uint32_t frame;
+	};
+
+	AsmCode &code;
+	std::vector<intptr_t> words;
+	// positions of the opcodes, they are replaced by the addresses of their handlers when threaded
+	std::vector<int> opcodes;
+	std::vector<Routine> routines;
+	std::map<std::string, int> routineIndexes;
+	// words holding the index of the called routine by its label, and constants holding the address of a label
+	std::vector<std::pair<int, std::string>> calls;
+	std::vector<std::tuple<int, int, std::string>> addresses;
+	std::vector<char> memory;
+
+	// lowering of the current function
+	std::vector<int> useCounts;
+	std::map<int, int> immediates;
+	std::map<std::string, int> labelConstants;
+	std::vector<std::pair<int, int>> jumps;
+
+	void emit(Opcode opcode, std::initializer_list<int> operands);
+	int slot(const IrOperand &operand);
+	int constant(Value value);
+	int labelAddress(const std::string &label);
+	// offset of a variable in the frame, -1 for the static ones
+	int frameOffset(const IrOperand &operand);
+	int address(const IrOperand &operand);
+	void jump(int target);
+	void branch(IrInstruction::Condition condition, IrInstruction::Type type, const IrOperand &a, const IrOperand &b,
+		const std::vector<int> &targets, int next);
+	// lowers the instruction, returns how many of the following ones it was fused with
+	int lower(IrBlock &block, int index, int next);
+	// the stack follows the data, the frame of the main program is on top of the stack of the routines
+	void load(const Routine &main);
+	void execute(const Routine &main);
+};
@@ -1,4 +1,6 @@
+#include <chrono>
 #include <fstream>
+#include <iterator>
 #include <iostream>
 #include <locale>
 
@@ -7,6 +9,12 @@
 #include "Parser.h"
 #include "Exceptions.h"
 #include "Generator.h"
+#include "Elf.h"
+#include "Jit.h"
+#include "Vm.h"
+#include "AstSerializer.h"
+#include "Peephole.h"
+#include "Cfg.h"
 
 int main(int argc, char *argv[])
 {
@@ -18,6 +26,16 @@ int main(int argc, char *argv[])
 		std::cout << "[options] <file name>" << std::endl;
 		std::cout << "-l option to show a table of tokens" << std::endl;
 		std::cout << "-exp option to show a syntax-tree of an arithmetic expression" << std::endl;
+		std::cout << "-ast-bin option to write the syntax-tree and symbol tables to ast.bin" << std::endl;
+		std::cout << "-ast-read option to show a syntax-tree stored by -ast-bin" << std::endl;
+		std::cout << "-peephole option to generate code and show how often each peephole rule fired" << std::endl;
+		std::cout << "-ir option to show the intermediate code with its control-flow graph" << std::endl;
+		std::cout << "-vectorize option to generate code with vectorized loops and show which loops were vectorized" << std::endl;
+		std::cout << "-inline-report option to generate code and show which calls were inlined" << std::endl;
+		std::cout << "-g64 option to generate GNU assembly of a Linux x86-64 executable" << std::endl;
+		std::cout << "-elf option to write a Linux x86-64 executable to a.out without an assembler and a linker" << std::endl;
+		std::cout << "-run option to compile the program in memory and run it, the times go to the error stream" << std::endl;
+		std::cout << "-vm option to run the program by the bytecode interpreter, the times go to the error stream" << std::endl;
 	}
 	else if (argc == 3) {
 		if (strcmp(argv[1], "-l") == 0) {
@@ -62,7 +80,8 @@ int main(int argc, char *argv[])
 
 			try {
 				PType mainFunction = parser.parse();
-				output << mainFunction->toString();
+				TreePrinter printer(output);
+				mainFunction->print(printer);
 			}
 			catch (LexicalException e) {
 				output << e.what() << std::endl;
@@ -74,6 +93,41 @@ int main(int argc, char *argv[])
 				output << e.what() << std::endl;
 			}
 		}
+		else if (strcmp(argv[1], "-ast-bin") == 0) {
+			Parser parser(std::shared_ptr<Tokenizer>(new Tokenizer(argv[2])));
+			std::ofstream output("output.txt");
+
+			try {
+				PType mainFunction = parser.parse();
+				std::ofstream image("ast.bin", std::ios::binary);
+				AstBinaryWriter writer;
+				writer.write(image, mainFunction);
+			}
+			catch (LexicalException e) {
+				output << e.what() << std::endl;
+			}
+			catch (SyntaxException e) {
+				output << e.what() << std::endl;
+			}
+			catch (std::exception e) {
+				output << e.what() << std::endl;
+			}
+		}
+		else if (strcmp(argv[1], "-ast-read") == 0) {
+			std::ifstream image(argv[2], std::ios::binary);
+			std::vector<char> data((std::istreambuf_iterator<char>(image)), std::istreambuf_iterator<char>());
+			std::ofstream output("output.txt");
+
+			try {
+				AstBinaryReader reader(data.data(), data.size());
+				PType mainFunction = AstBinaryLoader(reader).load();
+				TreePrinter printer(output);
+				mainFunction->print(printer);
+			}
+			catch (std::exception e) {
+				output << e.what() << std::endl;
+			}
+		}
 		else if (strcmp(argv[1], "-g") == 0) {
 			Parser parser(std::shared_ptr<Tokenizer>(new Tokenizer(argv[2])));
 			std::ofstream syntaxTree("syntax_tree.txt");
@@ -81,10 +135,37 @@ int main(int argc, char *argv[])
 
 			try {
 				PType mainFunction = parser.parse();
-				syntaxTree << mainFunction->toString();
+				TreePrinter printer(syntaxTree);
+				mainFunction->print(printer);
+				AsmCode code;
+				parser.toAsmCode(code);
+				AsmWriter writer(asmCode);
+				code.emit(writer);
+			}
+			catch (LexicalException e) {
+				syntaxTree << e.what() << std::endl;
+			}
+			catch (SyntaxException e) {
+				syntaxTree << e.what() << std::endl;
+			}
+			catch (std::exception e) {
+				syntaxTree << e.what() << std::endl;
+			}
+		}
+		else if (strcmp(argv[1], "-g64") == 0) {
+			Parser parser(std::shared_ptr<Tokenizer>(new Tokenizer(argv[2])));
+			std::ofstream syntaxTree("syntax_tree.txt");
+			std::ofstream asmCode("asm_code.txt");
+
+			try {
+				PType mainFunction = parser.parse();
+				TreePrinter printer(syntaxTree);
+				mainFunction->print(printer);
 				AsmCode code;
+				code.target = AsmCode::linux64;
 				parser.toAsmCode(code);
-				asmCode << code.toString();
+				AsmWriter writer(asmCode);
+				code.emit(writer);
 			}
 			catch (LexicalException e) {
 				syntaxTree << e.what() << std::endl;
@@ -96,6 +177,177 @@ int main(int argc, char *argv[])
 				syntaxTree << e.what() << std::endl;
 			}
 		}
+		else if (strcmp(argv[1], "-elf") == 0) {
+			Parser parser(std::shared_ptr<Tokenizer>(new Tokenizer(argv[2])));
+			std::ofstream output("output.txt");
+
+			try {
+				parser.parse();
+				AsmCode code;
+				code.target = AsmCode::linux64;
+				parser.toAsmCode(code);
+				std::ofstream image("a.out", std::ios::binary);
+				ElfWriter(code).write(image);
+			}
+			catch (LexicalException e) {
+				output << e.what() << std::endl;
+			}
+			catch (SyntaxException e) {
+				output << e.what() << std::endl;
+			}
+			catch (std::exception e) {
+				output << e.what() << std::endl;
+			}
+		}
+		else if (strcmp(argv[1], "-run") == 0) {
+			try {
+				auto start = std::chrono::steady_clock::now();
+				Parser parser(std::shared_ptr<Tokenizer>(new Tokenizer(argv[2])));
+				parser.parse();
+				AsmCode code;
+				code.target = AsmCode::linux64;
+				parser.toAsmCode(code);
+				double compileTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				Jit jit(code);
+				jit.run();
+				std::cerr << "compile: " << (compileTime + jit.loadTime) * 1000 << " ms" << std::endl;
+				std::cerr << "execute: " << jit.runTime * 1000 << " ms" << std::endl;
+			}
+			catch (LexicalException e) {
+				std::cerr << e.what() << std::endl;
+			}
+			catch (SyntaxException e) {
+				std::cerr << e.what() << std::endl;
+			}
+			catch (std::exception e) {
+				std::cerr << e.what() << std::endl;
+			}
+		}
+		else if (strcmp(argv[1], "-vm") == 0) {
+			try {
+				auto start = std::chrono::steady_clock::now();
+				Parser parser(std::shared_ptr<Tokenizer>(new Tokenizer(argv[2])));
+				parser.parse();
+				AsmCode code;
+				Vm vm(code);
+				parser.toBytecode(code, vm);
+				double compileTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				vm.run();
+				std::cerr << "compile: " << (compileTime + vm.loadTime) * 1000 << " ms" << std::endl;
+				std::cerr << "execute: " << vm.runTime * 1000 << " ms" << std::endl;
+			}
+			catch (LexicalException e) {
+				std::cerr << e.what() << std::endl;
+			}
+			catch (SyntaxException e) {
+				std::cerr << e.what() << std::endl;
+			}
+			catch (std::exception e) {
+				std::cerr << e.what() << std::endl;
+			}
+		}
+		else if (strcmp(argv[1], "-ir") == 0) {
+			Parser parser(std::shared_ptr<Tokenizer>(new Tokenizer(argv[2])));
+			std::ofstream output("output.txt");
+
+			try {
+				parser.parse();
+				AsmCode code;
+				IrFunction function;
+				parser.toIr(code, function);
+				AsmWriter writer(output);
+				Cfg(function).print(writer);
+			}
+			catch (LexicalException e) {
+				output << e.what() << std::endl;
+			}
+			catch (SyntaxException e) {
+				output << e.what() << std::endl;
+			}
+			catch (std::exception e) {
+				output << e.what() << std::endl;
+			}
+		}
+		else if (strcmp(argv[1], "-vectorize") == 0) {
+			Parser parser(std::shared_ptr<Tokenizer>(new Tokenizer(argv[2])));
+			std::ofstream output("output.txt");
+			std::ofstream asmCode("asm_code.txt");
+
+			try {
+				parser.parse();
+				AsmCode code;
+				code.vectorize = true;
+				parser.toAsmCode(code);
+				AsmWriter writer(asmCode);
+				code.emit(writer);
+				for (auto &line : code.vectorizerReport) {
+					output << line << std::endl;
+				}
+			}
+			catch (LexicalException e) {
+				output << e.what() << std::endl;
+			}
+			catch (SyntaxException e) {
+				output << e.what() << std::endl;
+			}
+			catch (std::exception e) {
+				output << e.what() << std::endl;
+			}
+		}
+		else if (strcmp(argv[1], "-inline-report") == 0) {
+			Parser parser(std::shared_ptr<Tokenizer>(new Tokenizer(argv[2])));
+			std::ofstream output("output.txt");
+			std::ofstream asmCode("asm_code.txt");
+
+			try {
+				parser.parse();
+				AsmCode code;
+				parser.toAsmCode(code);
+				AsmWriter writer(asmCode);
+				code.emit(writer);
+				for (auto &line : code.inlinerReport) {
+					output << line << std::endl;
+				}
+			}
+			catch (LexicalException e) {
+				output << e.what() << std::endl;
+			}
+			catch (SyntaxException e) {
+				output << e.what() << std::endl;
+			}
+			catch (std::exception e) {
+				output << e.what() << std::endl;
+			}
+		}
+		else if (strcmp(argv[1], "-peephole") == 0) {
+			Parser parser(std::shared_ptr<Tokenizer>(new Tokenizer(argv[2])));
+			std::ofstream output("output.txt");
+			std::ofstream asmCode("asm_code.txt");
+
+			try {
+				parser.parse();
+				AsmCode code;
+				parser.toAsmCode(code);
+				AsmWriter writer(asmCode);
+				code.emit(writer);
+
+				std::set<std::string> printed;
+				for (auto &rule : Peephole::rules) {
+					if (printed.insert(rule.name).second) {
+						output << rule.name << ": " << code.peepholeCounts[rule.name] << std::endl;
+					}
+				}
+			}
+			catch (LexicalException e) {
+				output << e.what() << std::endl;
+			}
+			catch (SyntaxException e) {
+				output << e.what() << std::endl;
+			}
+			catch (std::exception e) {
+				output << e.what() << std::endl;
+			}
+		}
 	}
 
 	return 0;
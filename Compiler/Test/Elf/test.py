@@ -0,0 +1,33 @@
+from os import listdir
+import re
+import subprocess
+import sys
+import os
+
+# the executables are built for Linux x86-64, each one is assembled, written and run with its output compared
+if not sys.platform.startswith('linux'):
+    print('Tests skipped, the executables run on Linux only')
+    sys.exit()
+# path of the compiler built on Linux
+compiler = sys.argv[1] if len(sys.argv) > 1 else './Compiler'
+r = re.compile('(?P<name>.+)\.in')
+for i in listdir('./'):
+    name = r.match(i)
+    if name:
+        # the text a program reads is in the file with the extension .stdin
+        stdin = '{}.stdin'.format(name.group('name'))
+        stdin = open(stdin) if os.path.exists(stdin) else subprocess.DEVNULL
+        subprocess.call([compiler, '-elf', i])
+        os.chmod('a.out', 0o755)
+        b = subprocess.run(['./a.out'], stdin=stdin, stdout=subprocess.PIPE, universal_newlines=True).stdout
+        f1 = open('{}.out'.format(name.group('name')))
+        a = f1.read();
+        if a != b:
+            print('Test "{}" failed'.format(i))
+            print(b, file=open('{}_failed.out'.format(name.group('name')), 'w'), end='')
+        else:
+            print('Test "{}" passed'.format(i))
+        f1.close()
+
+os.remove('a.out')
+os.remove('output.txt')
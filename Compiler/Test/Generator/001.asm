@@ -5,12 +5,8 @@ include c:\masm32\include\masm32rt.inc
 start:
 push ebp
 mov ebp, esp
-sub esp, 4
-push 123
-pop dword ptr [ebp - 4]
-push dword ptr [ebp - 4]
-pop eax
-printf("%d\n", eax)
+sub esp, 0
+printf("%d\n", 123)
 mov esp, ebp
 pop ebp
 exit
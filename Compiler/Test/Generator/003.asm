@@ -5,16 +5,9 @@ include c:\masm32\include\masm32rt.inc
 start:
 push ebp
 mov ebp, esp
-sub esp, 4
-push 123
-pop dword ptr [ebp - 4]
-push dword ptr [ebp - 4]
-push 200
-pop ebx
-pop eax
-sub eax, ebx
-push eax
-pop eax
+sub esp, 0
+mov eax, 123
+sub eax, 200
 printf("%d\n", eax)
 mov esp, ebp
 pop ebp
@@ -5,16 +5,9 @@ include c:\masm32\include\masm32rt.inc
 start:
 push ebp
 mov ebp, esp
-sub esp, 4
-push 128
-pop dword ptr [ebp - 4]
-push dword ptr [ebp - 4]
-push 128
-pop ebx
-pop eax
-imul eax, ebx
-push eax
-pop eax
+sub esp, 0
+mov eax, 128
+imul eax, 128
 printf("%d\n", eax)
 mov esp, ebp
 pop ebp
@@ -5,17 +5,11 @@ include c:\masm32\include\masm32rt.inc
 start:
 push ebp
 mov ebp, esp
-sub esp, 4
-push 100
-pop dword ptr [ebp - 4]
-push dword ptr [ebp - 4]
-push 25
-pop ebx
-pop eax
+sub esp, 0
+mov eax, 100
 cdq 
-idiv ebx
-push eax
-pop eax
+mov ecx, 25
+idiv ecx
 printf("%d\n", eax)
 mov esp, ebp
 pop ebp
@@ -5,34 +5,16 @@ include c:\masm32\include\masm32rt.inc
 start:
 push ebp
 mov ebp, esp
-sub esp, 8
-push 10
-pop dword ptr [ebp - 4]
-push 4
-pop dword ptr [ebp - 8]
-push 5
-push dword ptr [ebp - 4]
-pop ebx
-pop eax
-imul eax, ebx
-push eax
-push dword ptr [ebp - 8]
-push dword ptr [ebp - 4]
-pop ebx
-pop eax
-imul eax, ebx
-push eax
-push dword ptr [ebp - 8]
-pop ebx
-pop eax
-imul eax, ebx
-push eax
-pop ebx
-pop eax
-add eax, ebx
-push eax
-pop eax
-printf("%d\n", eax)
+sub esp, 0
+mov eax, 10
+mov ecx, 4
+mov edx, 5
+imul edx, eax
+mov ebx, ecx
+imul ebx, eax
+imul ebx, ecx
+add edx, ebx
+printf("%d\n", edx)
 mov esp, ebp
 pop ebp
 exit
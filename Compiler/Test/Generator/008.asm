@@ -0,0 +1,28 @@
+include c:\masm32\include\masm32rt.inc
+.xmm
+.const
+align 4
+$primes0@ dd 2, 3, 5, 7, 11, 13, 17, 19
+.data
+align 4
+$a1@ dd 10
+.code
+start:
+push ebp
+mov ebp, esp
+sub esp, 0
+mov eax, dword ptr [$a1@]
+mov ecx, 1
+jmp $FOR_COND3@
+$FOR_BODY2@:
+add eax, 7
+inc ecx
+$FOR_COND3@:
+cmp ecx, 3
+jle $FOR_BODY2@
+$FOR_END4@:
+printf("%d\n", eax)
+mov esp, ebp
+pop ebp
+exit
+end start
@@ -0,0 +1,64 @@
+include c:\masm32\include\masm32rt.inc
+.xmm
+.const
+align 4
+$squares0@ dd 0, 1, 4, 9, 16
+.code
+start:
+push ebp
+mov ebp, esp
+sub esp, 48
+mov eax, 1
+lea ecx, dword ptr [ebp - 40]
+mov edx, eax
+imul edx, 4
+add edx, -4
+add edx, ecx
+jmp $FOR_COND2@
+$FOR_BODY1@:
+mov ecx, eax
+imul ecx, eax
+mov dword ptr [edx - 0], ecx
+inc eax
+add edx, 4
+$FOR_COND2@:
+cmp eax, 10
+jle $FOR_BODY1@
+$FOR_END3@:
+mov ecx, 0
+mov eax, 0
+lea edx, dword ptr [ebp - 40]
+lea ebx, dword ptr [$squares0@]
+mov esi, eax
+imul esi, 4
+add esi, edx
+mov edx, eax
+imul edx, 4
+add edx, ebx
+jmp $FOR_COND5@
+$FOR_BODY4@:
+add ecx, dword ptr [esi - 0]
+sub ecx, dword ptr [edx - 0]
+inc eax
+add edx, 4
+add esi, 4
+$FOR_COND5@:
+cmp eax, 4
+jle $FOR_BODY4@
+$FOR_END6@:
+lea eax, dword ptr [ebp - 48]
+mov byte ptr [eax - 0], 107
+lea edx, dword ptr [ebp - 40]
+add edx, 36
+mov ebx, ecx
+add ebx, dword ptr [edx - 0]
+mov ecx, eax
+add ecx, 4
+mov dword ptr [ecx - 0], ebx
+movzx eax, byte ptr [eax - 0]
+printf("%c\n", eax)
+printf("%d\n", ebx)
+mov esp, ebp
+pop ebp
+exit
+end start
@@ -0,0 +1,122 @@
+include c:\masm32\include\masm32rt.inc
+.xmm
+.const
+align 8
+$DBL0@ dq 04010000000000000h
+align 8
+$DBL1@ dq 00000000000000000h
+align 8
+$DBL2@ dq 03FE0000000000000h
+align 8
+$DBL3@ dq 04008000000000000h
+align 8
+$DBL4@ dq 04024000000000000h
+align 8
+$DBL5@ dq 0BFF8000000000000h
+align 8
+$DBL15@ dq 0BFF0000000000000h
+.code
+start:
+push ebp
+mov eax, esp
+and esp, -8
+mov ebp, esp
+sub esp, 92
+mov dword ptr [ebp - 92], eax
+mov eax, 8
+mov ecx, eax
+mov edx, 1
+movsd xmm0, qword ptr [$DBL0@]
+lea ebx, dword ptr [ebp - 64]
+mov esi, edx
+imul esi, 8
+add esi, -8
+add esi, ebx
+jmp $FOR_COND7@
+$FOR_BODY6@:
+cvtsi2sd xmm1, edx
+divsd xmm1, xmm0
+movsd qword ptr [esi - 0], xmm1
+inc edx
+add esi, 8
+$FOR_COND7@:
+cmp edx, ecx
+jle $FOR_BODY6@
+$FOR_END8@:
+movsd xmm0, qword ptr [$DBL1@]
+mov edx, 1
+lea ecx, dword ptr [ebp - 64]
+movsd xmm1, qword ptr [$DBL2@]
+mov ebx, edx
+imul ebx, 8
+add ebx, -8
+add ebx, ecx
+jmp $FOR_COND10@
+$FOR_BODY9@:
+movsd xmm2, qword ptr [ebx - 0]
+movsd xmm3, xmm2
+mulsd xmm3, xmm2
+addsd xmm0, xmm3
+subsd xmm0, xmm1
+inc edx
+add ebx, 8
+$FOR_COND10@:
+cmp edx, eax
+jle $FOR_BODY9@
+$FOR_END11@:
+movsd qword ptr [ebp - 72], xmm0
+movsd qword ptr [ebp - 80], xmm0
+printf("%f\n", qword ptr [ebp - 72])
+movsd xmm0, qword ptr [ebp - 80]
+movsd xmm1, xmm0
+mulsd xmm1, qword ptr [$DBL15@]
+divsd xmm1, qword ptr [$DBL3@]
+movsd qword ptr [ebp - 72], xmm1
+movsd qword ptr [ebp - 80], xmm0
+movsd qword ptr [ebp - 88], xmm1
+printf("%f\n", qword ptr [ebp - 72])
+movsd xmm0, qword ptr [ebp - 80]
+movsd xmm1, qword ptr [ebp - 88]
+cvttsd2si eax, xmm1
+movsd qword ptr [ebp - 80], xmm0
+movsd qword ptr [ebp - 88], xmm1
+printf("%d\n", eax)
+movsd xmm0, qword ptr [ebp - 80]
+movsd xmm1, qword ptr [ebp - 88]
+ucomisd xmm0, qword ptr [$DBL4@]
+setbe al
+dec al
+movsx ecx, al
+movsd xmm2, qword ptr [$DBL5@]
+ucomisd xmm2, xmm1
+setb al
+dec al
+movsx eax, al
+and ecx, eax
+test ecx, ecx
+jz $IFFAIL13@
+$IFTHEN12@:
+movsd qword ptr [ebp - 80], xmm0
+movsd qword ptr [ebp - 88], xmm1
+printf("%d\n", 1)
+movsd xmm0, qword ptr [ebp - 80]
+movsd xmm1, qword ptr [ebp - 88]
+jmp $IFEND14@
+$IFFAIL13@:
+movsd qword ptr [ebp - 80], xmm0
+movsd qword ptr [ebp - 88], xmm1
+printf("%d\n", 0)
+movsd xmm0, qword ptr [ebp - 80]
+movsd xmm1, qword ptr [ebp - 88]
+$IFEND14@:
+ucomisd xmm0, xmm1
+setne al
+setp ah
+or al, ah
+dec al
+movsx eax, al
+printf("%d\n", eax)
+mov esp, dword ptr [ebp - 92]
+pop ebp
+exit
+end start
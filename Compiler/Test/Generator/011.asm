@@ -0,0 +1,134 @@
+include c:\masm32\include\masm32rt.inc
+.xmm
+.const
+align 8
+$DBL13@ dq 04000000000000000h
+align 8
+$DBL21@ dq 04008000000000000h
+.data
+align 4
+$total7@ db 4 dup (0)
+.code
+start:
+push ebp
+mov eax, esp
+and esp, -8
+mov ebp, esp
+sub esp, 20
+mov dword ptr [ebp - 20], eax
+printf("%d\n", 3628800)
+printf("%d\n", 55)
+movsd xmm0, qword ptr [$DBL21@]
+movsd qword ptr [ebp - 16], xmm0
+printf("%f\n", qword ptr [ebp - 16])
+mov dword ptr [ebp - 4], 3
+mov dword ptr [ebp - 8], 7
+lea eax, dword ptr [ebp - 4]
+lea ecx, dword ptr [ebp - 8]
+mov edx, ecx
+call $swap3@
+printf("%d\n", dword ptr [ebp - 4])
+printf("%d\n", dword ptr [ebp - 8])
+mov dword ptr [$total7@], 0
+mov dword ptr [ebp - 4], 1
+jmp $FOR_COND23@
+$FOR_BODY22@:
+mov eax, ebx
+call $add4@
+inc dword ptr [ebp - 4]
+$FOR_COND23@:
+mov ebx, dword ptr [ebp - 4]
+cmp ebx, 10
+jle $FOR_BODY22@
+$FOR_END24@:
+printf("%d\n", dword ptr [$total7@])
+printf("%d\n", 36)
+printf("%d\n", 3001)
+mov esp, dword ptr [ebp - 20]
+pop ebp
+exit
+$fact0@:
+push ebx
+push esi
+mov ebx, eax
+cmp ebx, 1
+jg $IFFAIL9@
+$IFTHEN8@:
+mov esi, 1
+jmp $IFEND10@
+$IFFAIL9@:
+mov eax, ebx
+dec eax
+call $fact0@
+mov esi, ebx
+imul esi, eax
+$IFEND10@:
+$EXIT11@:
+mov eax, esi
+pop esi
+pop ebx
+ret
+$weighted1@:
+push ebp
+mov ebp, esp
+sub esp, 8
+push dword ptr [ebp + 8]
+pop dword ptr [ebp - 4]
+push dword ptr [ebp + 12]
+pop dword ptr [ebp - 8]
+push ebx
+push esi
+mov ebx, dword ptr [ebp - 4]
+mov esi, dword ptr [ebp - 8]
+imul edx, 2
+add eax, edx
+imul ecx, 3
+add eax, ecx
+imul ebx, 4
+add eax, ebx
+imul esi, 5
+add eax, esi
+$EXIT12@:
+pop esi
+pop ebx
+mov esp, ebp
+pop ebp
+ret
+$half2@:
+divsd xmm0, qword ptr [$DBL13@]
+$EXIT14@:
+ret
+$swap3@:
+push ebx
+mov ecx, edx
+mov edx, dword ptr [eax - 0]
+mov ebx, dword ptr [ecx - 0]
+mov dword ptr [eax - 0], ebx
+mov dword ptr [ecx - 0], edx
+$EXIT15@:
+pop ebx
+ret
+$add4@:
+add dword ptr [$total7@], eax
+$EXIT16@:
+ret
+$inner5@:
+imul eax, 10
+$EXIT17@:
+ret
+$outer6@:
+push ebx
+mov ebx, eax
+mov eax, ebx
+call $inner5@
+inc eax
+cmp ebx, 100
+jle $IFEND19@
+$IFTHEN18@:
+jmp $EXIT20@
+$IFEND19@:
+add eax, 5
+$EXIT20@:
+pop ebx
+ret
+end start
@@ -0,0 +1,72 @@
+include c:\masm32\include\masm32rt.inc
+.xmm
+.const
+.code
+start:
+push ebp
+mov ebp, esp
+sub esp, 40
+mov eax, 1
+lea ecx, dword ptr [ebp - 40]
+mov edx, eax
+imul edx, 4
+add edx, -4
+add edx, ecx
+jmp $FOR_COND1@
+$FOR_BODY0@:
+mov dword ptr [edx - 0], eax
+inc eax
+add edx, 4
+$FOR_COND1@:
+cmp eax, 10
+jle $FOR_BODY0@
+$FOR_END2@:
+lea ebx, dword ptr [ebp - 40]
+mov ecx, ebx
+add ecx, 8
+mov ecx, dword ptr [ecx - 0]
+mov edx, ebx
+add edx, 12
+mov edx, dword ptr [edx - 0]
+mov esi, ecx
+add esi, edx
+mov ecx, 0
+mov edx, esi
+mov eax, 1
+cmp eax, edx
+jg $PREHEADER5@
+$RANGE_CHECKS3@:
+mov edi, edx
+add edi, -1
+cmp edi, 9
+ja $range_error@
+jmp $PREHEADER5@
+$FOR_BODY4@:
+add ecx, dword ptr [edi - 0]
+inc eax
+add edi, 4
+jmp $FOR_COND6@
+$PREHEADER5@:
+mov edi, eax
+imul edi, 4
+add edi, -4
+add edi, ebx
+$FOR_COND6@:
+cmp eax, edx
+jle $FOR_BODY4@
+$FOR_END7@:
+printf("%d\n", ecx)
+dec esi
+cmp esi, 9
+ja $range_error@
+imul esi, 4
+add ebx, esi
+printf("%d\n", dword ptr [ebx - 0])
+mov esp, ebp
+pop ebp
+exit
+$range_error@:
+printf("Range check error\n")
+push 201
+call ExitProcess
+end start
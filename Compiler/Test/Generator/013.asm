@@ -0,0 +1,63 @@
+include c:\masm32\include\masm32rt.inc
+.xmm
+.const
+.code
+start:
+push ebp
+mov ebp, esp
+sub esp, 0
+mov ebx, 0
+cmp ebx, 1
+setle al
+dec al
+movsx eax, al
+and eax, -1
+not eax
+test eax, eax
+jz $IFFAIL1@
+$IFTHEN0@:
+printf("%d\n", 1)
+jmp $IFEND2@
+$IFFAIL1@:
+printf("%d\n", 0)
+$IFEND2@:
+mov eax, -1
+not eax
+test eax, eax
+jz $IFFAIL4@
+$IFTHEN3@:
+printf("%d\n", 0)
+jmp $IFEND5@
+$IFFAIL4@:
+printf("%d\n", 1)
+$IFEND5@:
+cmp ebx, 0
+setge al
+dec al
+movsx eax, al
+or eax, -1
+not eax
+test eax, eax
+jz $IFFAIL7@
+$IFTHEN6@:
+printf("%d\n", 0)
+jmp $IFEND8@
+$IFFAIL7@:
+printf("%d\n", 1)
+$IFEND8@:
+printf("%d\n", -1)
+cmp ebx, 2
+setg al
+dec al
+movsx esi, al
+printf("%d\n", esi)
+not esi
+printf("%d\n", esi)
+printf("%d\n", -1)
+printf("%d\n", -6)
+not ebx
+printf("%d\n", ebx)
+mov esp, ebp
+pop ebp
+exit
+end start
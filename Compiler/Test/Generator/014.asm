@@ -0,0 +1,216 @@
+include c:\masm32\include\masm32rt.inc
+.xmm
+.const
+align 8
+$DBL0@ dq 00000000000000000h
+align 8
+$DBL1@ dq 03FF0000000000000h
+.code
+start:
+push ebp
+mov eax, esp
+and esp, -8
+mov ebp, esp
+sub esp, 20
+mov dword ptr [ebp - 20], eax
+movsd xmm0, qword ptr [$DBL0@]
+movsd xmm1, qword ptr [$DBL1@]
+movsd xmm2, xmm0
+divsd xmm2, xmm0
+ucomisd xmm1, xmm2
+jbe $IFFAIL3@
+$IFTHEN2@:
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", 1)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+jmp $IFEND4@
+$IFFAIL3@:
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", 0)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+$IFEND4@:
+ucomisd xmm1, xmm2
+jb $IFFAIL6@
+$IFTHEN5@:
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", 1)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+jmp $IFEND7@
+$IFFAIL6@:
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", 0)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+$IFEND7@:
+ucomisd xmm2, xmm1
+jbe $IFFAIL9@
+$IFTHEN8@:
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", 1)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+jmp $IFEND10@
+$IFFAIL9@:
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", 0)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+$IFEND10@:
+ucomisd xmm2, xmm1
+jb $IFFAIL12@
+$IFTHEN11@:
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", 1)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+jmp $IFEND13@
+$IFFAIL12@:
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", 0)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+$IFEND13@:
+ucomisd xmm2, xmm2
+jp $IFFAIL15@
+jnz $IFFAIL15@
+$IFTHEN14@:
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", 1)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+jmp $IFEND16@
+$IFFAIL15@:
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", 0)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+$IFEND16@:
+ucomisd xmm2, xmm2
+jp $IFTHEN17@
+jz $IFFAIL18@
+$IFTHEN17@:
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", 1)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+jmp $IFEND19@
+$IFFAIL18@:
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", 0)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+$IFEND19@:
+ucomisd xmm2, xmm1
+ja $IFFAIL21@
+$IFTHEN20@:
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", 1)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+jmp $IFEND22@
+$IFFAIL21@:
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", 0)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+$IFEND22@:
+ucomisd xmm1, xmm2
+setbe al
+dec al
+movsx eax, al
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", eax)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+ucomisd xmm1, xmm2
+setb al
+dec al
+movsx eax, al
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", eax)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+ucomisd xmm2, xmm1
+setbe al
+dec al
+movsx eax, al
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", eax)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+ucomisd xmm2, xmm1
+setb al
+dec al
+movsx eax, al
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", eax)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+ucomisd xmm2, xmm2
+setne al
+setp ah
+or al, ah
+dec al
+movsx eax, al
+movsd qword ptr [ebp - 8], xmm1
+movsd qword ptr [ebp - 16], xmm2
+printf("%d\n", eax)
+movsd xmm1, qword ptr [ebp - 8]
+movsd xmm2, qword ptr [ebp - 16]
+ucomisd xmm2, xmm2
+sete al
+setnp ah
+and al, ah
+dec al
+movsx eax, al
+movsd qword ptr [ebp - 8], xmm1
+printf("%d\n", eax)
+movsd xmm1, qword ptr [ebp - 8]
+ucomisd xmm1, xmm1
+setne al
+setp ah
+or al, ah
+dec al
+movsx eax, al
+movsd qword ptr [ebp - 8], xmm1
+printf("%d\n", eax)
+movsd xmm1, qword ptr [ebp - 8]
+ucomisd xmm1, xmm1
+sete al
+setnp ah
+and al, ah
+dec al
+movsx eax, al
+movsd qword ptr [ebp - 8], xmm1
+printf("%d\n", eax)
+movsd xmm1, qword ptr [ebp - 8]
+ucomisd xmm1, xmm1
+setb al
+dec al
+movsx eax, al
+printf("%d\n", eax)
+mov esp, dword ptr [ebp - 20]
+pop ebp
+exit
+end start
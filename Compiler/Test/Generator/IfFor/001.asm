@@ -5,110 +5,47 @@ include c:\masm32\include\masm32rt.inc
 start:
 push ebp
 mov ebp, esp
-sub esp, 8
-push 123
-pop dword ptr [ebp - 4]
-push dword ptr [ebp - 4]
-push 123
-pop ebx
-cmp dword ptr [esp - 0], ebx
-setne al
-sub al, 1
-movsx eax, al
-mov dword ptr [esp - 0], eax
-pop eax
-test eax, eax
-jz $IFFAIL0@
-push 1
-pop eax
-printf("%d\n", eax)
-jmp $IFEND1@
-$IFFAIL0@:
-push 0
-pop eax
-printf("%d\n", eax)
-$IFEND1@:
-push dword ptr [ebp - 4]
-push 123
-pop ebx
-cmp dword ptr [esp - 0], ebx
-sete al
-sub al, 1
-movsx eax, al
-mov dword ptr [esp - 0], eax
-pop eax
-test eax, eax
-jz $IFFAIL2@
-push dword ptr [ebp - 4]
-pop eax
-printf("%d\n", eax)
-jmp $IFEND3@
-$IFFAIL2@:
-push 0
-pop eax
-printf("%d\n", eax)
-$IFEND3@:
-push 200
-pop dword ptr [ebp - 8]
-push dword ptr [ebp - 4]
-push dword ptr [ebp - 8]
-pop ebx
-cmp dword ptr [esp - 0], ebx
-setge al
-sub al, 1
-movsx eax, al
-mov dword ptr [esp - 0], eax
-pop eax
-test eax, eax
+sub esp, 0
+mov ebx, 123
+cmp ebx, 123
+jnz $IFFAIL1@
+$IFTHEN0@:
+printf("%d\n", 1)
+jmp $IFEND2@
+$IFFAIL1@:
+printf("%d\n", 0)
+$IFEND2@:
+cmp ebx, 123
 jz $IFFAIL4@
-push -1
-pop eax
-printf("%d\n", eax)
+$IFTHEN3@:
+printf("%d\n", ebx)
 jmp $IFEND5@
 $IFFAIL4@:
-push 1
-pop eax
-printf("%d\n", eax)
+printf("%d\n", 0)
 $IFEND5@:
-push dword ptr [ebp - 4]
-push dword ptr [ebp - 8]
-pop ebx
-cmp dword ptr [esp - 0], ebx
-setle al
-sub al, 1
-movsx eax, al
-mov dword ptr [esp - 0], eax
-pop eax
-test eax, eax
-jz $IFFAIL6@
-push 1
-pop eax
-printf("%d\n", eax)
-jmp $IFEND7@
-$IFFAIL6@:
-push -1
-pop eax
-printf("%d\n", eax)
-$IFEND7@:
-push 2
-pop dword ptr [ebp - 4]
-push dword ptr [ebp - 4]
-push 2
-pop ebx
-cmp dword ptr [esp - 0], ebx
-setne al
-sub al, 1
-movsx eax, al
-mov dword ptr [esp - 0], eax
-pop eax
-test eax, eax
-jz $IFFAIL8@
-push 123123123
-pop eax
-printf("%d\n", eax)
-jmp $IFEND9@
-$IFFAIL8@:
-$IFEND9@:
+mov esi, 200
+cmp ebx, esi
+jge $IFFAIL7@
+$IFTHEN6@:
+printf("%d\n", -1)
+jmp $IFEND8@
+$IFFAIL7@:
+printf("%d\n", 1)
+$IFEND8@:
+cmp ebx, esi
+jle $IFFAIL10@
+$IFTHEN9@:
+printf("%d\n", 1)
+jmp $IFEND11@
+$IFFAIL10@:
+printf("%d\n", -1)
+$IFEND11@:
+mov ebx, 2
+cmp ebx, 2
+jnz $IFEND13@
+$IFTHEN12@:
+printf("%d\n", 123123123)
+$IFEND13@:
 mov esp, ebp
 pop ebp
 exit
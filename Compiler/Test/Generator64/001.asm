@@ -0,0 +1,502 @@
+.intel_syntax noprefix
+.section .rodata
+.balign 8
+.LDBL4: .quad 0x3FF0000000000000
+.balign 8
+.LDBL5: .quad 0x4000000000000000
+.balign 8
+.LDBL6: .quad 0x4008000000000000
+.balign 8
+.LDBL7: .quad 0x4010000000000000
+.balign 8
+.LDBL8: .quad 0x4014000000000000
+.balign 8
+.LDBL9: .quad 0x4018000000000000
+.balign 8
+.LDBL10: .quad 0x401C000000000000
+.balign 8
+.LDBL11: .quad 0x4020000000000000
+.balign 8
+.LDBL12: .quad 0x4022000000000000
+.balign 8
+.LDBL13: .quad 0x4024000000000000
+.balign 8
+.LDBL17: .quad 0xBFF0000000000000
+.balign 4
+.Ldivision_message: .byte 68, 105, 118, 105, 115, 105, 111, 110, 32, 98, 121, 32, 122, 101, 114, 111
+.byte 10
+.balign 4
+.Lstack_message: .byte 83, 116, 97, 99, 107, 32, 111, 118, 101, 114, 102, 108, 111, 119, 10
+.balign 4
+.Laccess_message: .byte 65, 99, 99, 101, 115, 115, 32, 118, 105, 111, 108, 97, 116, 105, 111, 110
+.byte 10
+.balign 8
+.LDBL25: .quad 0x412E848000000000
+.data
+.balign 16
+.Lbuffer: .zero 4096
+.balign 4
+.Llength: .zero 4
+.balign 8
+.Lstack_base: .zero 8
+.balign 16
+.Lsignal_stack: .zero 65536
+.balign 16
+.Linput: .zero 4096
+.balign 4
+.Linput_position: .zero 4
+.balign 4
+.Linput_length: .zero 4
+.text
+.globl _start
+.Lmain:
+push rbp
+mov rbp, rsp
+sub rsp, 16
+push rbx
+push r12
+mov ebx, 40
+mov edi, ebx
+call .Lwrite_int
+mov r12d, 1
+jmp .LFOR_COND15
+.LFOR_BODY14:
+sub rsp, 16
+mov dword ptr [rsp + 8], ebx
+mov dword ptr [rsp - 0], r12d
+mov edi, r12d
+mov esi, r12d
+mov edx, r12d
+mov ecx, r12d
+mov r8d, r12d
+mov r9d, r12d
+call .Lmix0
+add rsp, 16
+cdq 
+mov ecx, 2
+idiv ecx
+mov edi, eax
+call .Lwrite_int
+inc r12d
+.LFOR_COND15:
+cmp r12d, 3
+jle .LFOR_BODY14
+.LFOR_END16:
+movsd xmm0, qword ptr [rip + .LDBL4]
+movsd xmm1, qword ptr [rip + .LDBL5]
+movsd xmm2, qword ptr [rip + .LDBL6]
+movsd xmm3, qword ptr [rip + .LDBL7]
+movsd xmm4, qword ptr [rip + .LDBL8]
+movsd xmm5, qword ptr [rip + .LDBL9]
+movsd xmm8, qword ptr [rip + .LDBL10]
+movsd xmm7, qword ptr [rip + .LDBL11]
+movsd xmm6, qword ptr [rip + .LDBL12]
+movsd xmm9, qword ptr [rip + .LDBL13]
+sub rsp, 16
+movsd qword ptr [rsp + 8], xmm9
+movsd qword ptr [rsp - 0], xmm6
+movsd xmm6, xmm8
+mov edi, ebx
+movsd qword ptr [rbp - 8], xmm8
+call .Lpoly1
+movsd xmm8, qword ptr [rbp - 8]
+add rsp, 16
+movsd xmm1, xmm0
+movsd xmm0, xmm1
+movsd qword ptr [rbp - 8], xmm8
+movsd qword ptr [rbp - 16], xmm1
+call .Lwrite_double
+movsd xmm8, qword ptr [rbp - 8]
+movsd xmm1, qword ptr [rbp - 16]
+mulsd xmm1, qword ptr [rip + .LDBL17]
+divsd xmm1, xmm8
+movsd xmm0, xmm1
+call .Lwrite_double
+mov edi, 122
+call .Lwrite_char
+pop r12
+pop rbx
+mov rsp, rbp
+pop rbp
+ret
+.Lmix0:
+push rbp
+mov rbp, rsp
+mov eax, edi
+mov edi, r8d
+mov r8d, r9d
+mov r9d, dword ptr [rbp + 16]
+mov r10d, dword ptr [rbp + 24]
+sub eax, esi
+imul edx, ecx
+add eax, edx
+sub eax, edi
+imul r8d, r9d
+add eax, r8d
+sub eax, r10d
+.LEXIT2:
+mov rsp, rbp
+pop rbp
+ret
+.Lpoly1:
+push rbp
+mov rbp, rsp
+movsd xmm8, qword ptr [rbp + 16]
+movsd xmm9, qword ptr [rbp + 24]
+mov eax, edi
+mulsd xmm1, xmm2
+addsd xmm0, xmm1
+subsd xmm0, xmm3
+mulsd xmm4, xmm5
+addsd xmm0, xmm4
+subsd xmm0, xmm6
+mulsd xmm7, xmm8
+addsd xmm0, xmm7
+subsd xmm0, xmm9
+cvtsi2sd xmm1, eax
+addsd xmm0, xmm1
+.LEXIT3:
+mov rsp, rbp
+pop rbp
+ret
+_start:
+push 65536
+push 0
+lea rax, qword ptr [rip + .Lsignal_stack]
+push rax
+mov eax, 131
+mov rdi, rsp
+xor esi, esi
+syscall 
+push 0
+lea rax, qword ptr [rip + .Lfault]
+push rax
+push 201326596
+push rax
+mov eax, 13
+mov edi, 8
+mov rsi, rsp
+xor edx, edx
+mov r10d, 8
+syscall 
+mov eax, 13
+mov edi, 11
+mov rsi, rsp
+xor edx, edx
+mov r10d, 8
+syscall 
+mov eax, 9
+xor edi, edi
+mov esi, 8392704
+mov edx, 3
+mov r10d, 98
+mov r8, -1
+xor r9d, r9d
+syscall 
+mov qword ptr [rip + .Lstack_base], rax
+lea rsp, qword ptr [rax + 8392704]
+call .Lmain
+jmp .Lexit
+.Lfail:
+push rsi
+push rdx
+call .Lflush
+pop rdx
+pop rsi
+mov eax, 1
+mov edi, 2
+syscall 
+mov eax, 60
+mov edi, ebx
+syscall 
+.Lfault:
+mov rax, qword ptr [rsi + 16]
+mov rcx, qword ptr [rip + .Lstack_base]
+lea rsi, byte ptr [rip + .Ldivision_message]
+mov edx, 17
+mov ebx, 200
+cmp edi, 8
+jz .LREPORT18
+cmp rax, rcx
+jae .LACCESS19
+sub rcx, 1048576
+cmp rax, rcx
+jb .LACCESS19
+lea rsi, byte ptr [rip + .Lstack_message]
+mov edx, 15
+mov ebx, 202
+jmp .LREPORT18
+.LACCESS19:
+lea rsi, byte ptr [rip + .Laccess_message]
+mov edx, 17
+mov ebx, 216
+.LREPORT18:
+jmp .Lfail
+.Lexit:
+call .Lflush
+mov eax, 60
+xor edi, edi
+syscall 
+.Lflush:
+mov eax, 1
+mov edi, 1
+lea rsi, byte ptr [rip + .Lbuffer]
+mov edx, dword ptr [rip + .Llength]
+syscall 
+mov dword ptr [rip + .Llength], 0
+ret
+.Lreserve:
+cmp dword ptr [rip + .Llength], 4032
+jle .LROOM20
+call .Lflush
+.LROOM20:
+lea r8, byte ptr [rip + .Lbuffer]
+mov eax, dword ptr [rip + .Llength]
+add r8, rax
+ret
+.Lnew_line:
+mov byte ptr [r8 - 0], 10
+inc r8
+lea rax, byte ptr [rip + .Lbuffer]
+sub r8, rax
+mov dword ptr [rip + .Llength], r8d
+ret
+.Ldigits:
+mov r9, rsp
+mov r10d, 10
+.LDIGIT21:
+xor edx, edx
+div r10
+add edx, 48
+dec r9
+mov byte ptr [r9 - 0], dl
+dec ecx
+test rax, rax
+jnz .LDIGIT21
+test ecx, ecx
+jg .LDIGIT21
+.LCOPY22:
+mov dl, byte ptr [r9 - 0]
+mov byte ptr [r8 - 0], dl
+inc r8
+inc r9
+cmp r9, rsp
+jnz .LCOPY22
+ret
+.Lwrite_int:
+push rdi
+call .Lreserve
+pop rax
+mov eax, eax
+test eax, eax
+jge .LPOSITIVE23
+mov byte ptr [r8 - 0], 45
+inc r8
+neg eax
+.LPOSITIVE23:
+mov ecx, 1
+call .Ldigits
+jmp .Lnew_line
+.Lwrite_char:
+push rdi
+call .Lreserve
+pop rax
+mov byte ptr [r8 - 0], al
+inc r8
+jmp .Lnew_line
+.Lwrite_double:
+call .Lreserve
+movmskpd eax, xmm0
+test eax, 1
+jz .LMAGNITUDE24
+mov byte ptr [r8 - 0], 45
+inc r8
+mulsd xmm0, qword ptr [rip + .LDBL17]
+.LMAGNITUDE24:
+mulsd xmm0, qword ptr [rip + .LDBL25]
+cvtsd2si rax, xmm0
+xor edx, edx
+mov ecx, 1000000
+div rcx
+push rdx
+mov ecx, 1
+call .Ldigits
+mov byte ptr [r8 - 0], 46
+inc r8
+pop rax
+mov ecx, 6
+call .Ldigits
+jmp .Lnew_line
+.Lpeek:
+mov eax, dword ptr [rip + .Linput_position]
+cmp eax, dword ptr [rip + .Linput_length]
+jl .LAVAILABLE26
+call .Lflush
+xor eax, eax
+xor edi, edi
+lea rsi, byte ptr [rip + .Linput]
+mov edx, 4096
+syscall 
+mov dword ptr [rip + .Linput_position], 0
+mov dword ptr [rip + .Linput_length], 0
+test eax, eax
+jg .LFILLED27
+mov eax, -1
+ret
+.LFILLED27:
+mov dword ptr [rip + .Linput_length], eax
+xor eax, eax
+.LAVAILABLE26:
+lea rcx, byte ptr [rip + .Linput]
+add rcx, rax
+movzx eax, byte ptr [rcx - 0]
+ret
+.Lnext:
+inc dword ptr [rip + .Linput_position]
+jmp .Lpeek
+.Lskip:
+call .Lpeek
+.LSKIP28:
+cmp eax, 32
+jg .LSKIPPED29
+test eax, eax
+jl .LSKIPPED29
+call .Lnext
+jmp .LSKIP28
+.LSKIPPED29:
+ret
+.Lsign:
+xor r9d, r9d
+cmp eax, 45
+jnz .LPLUS30
+inc r9d
+jmp .Lnext
+.LPLUS30:
+cmp eax, 43
+jz .Lnext
+ret
+.Lread_int:
+call .Lskip
+call .Lsign
+xor r8d, r8d
+.LDIGIT31:
+sub eax, 48
+cmp eax, 9
+ja .LNUMBER32
+imul r8d, 10
+add r8d, eax
+call .Lnext
+jmp .LDIGIT31
+.LNUMBER32:
+mov eax, r8d
+test r9d, r9d
+jz .LDONE33
+neg eax
+.LDONE33:
+ret
+.Lread_char:
+call .Lpeek
+test eax, eax
+jl .LEND34
+inc dword ptr [rip + .Linput_position]
+ret
+.LEND34:
+xor eax, eax
+ret
+.Lread_double:
+push rbx
+push r12
+call .Lskip
+call .Lsign
+xor r8d, r8d
+xor r10d, r10d
+.LINTEGER35:
+sub eax, 48
+cmp eax, 9
+ja .LPOINT37
+mov rcx, 100000000000000000
+cmp r8, rcx
+jge .LDROPPED36
+imul r8, 10
+add r8, rax
+call .Lnext
+jmp .LINTEGER35
+.LDROPPED36:
+inc r10d
+call .Lnext
+jmp .LINTEGER35
+.LPOINT37:
+cmp eax, -2
+jnz .LEXPONENT40
+call .Lnext
+.LFRACTION38:
+sub eax, 48
+cmp eax, 9
+ja .LEXPONENT40
+mov rcx, 100000000000000000
+cmp r8, rcx
+jge .LFRACTION_NEXT39
+imul r8, 10
+add r8, rax
+dec r10d
+.LFRACTION_NEXT39:
+call .Lnext
+jmp .LFRACTION38
+.LEXPONENT40:
+cmp eax, 53
+jz .LWRITTEN41
+cmp eax, 21
+jnz .LSCALE46
+.LWRITTEN41:
+mov ebx, r9d
+call .Lnext
+call .Lsign
+xor r12d, r12d
+.LEXPONENT_DIGIT42:
+sub eax, 48
+cmp eax, 9
+ja .LEXPONENT_END44
+cmp r12d, 10000
+jge .LEXPONENT_NEXT43
+imul r12d, 10
+add r12d, eax
+.LEXPONENT_NEXT43:
+call .Lnext
+jmp .LEXPONENT_DIGIT42
+.LEXPONENT_END44:
+test r9d, r9d
+jz .LPOSITIVE_EXPONENT45
+neg r12d
+.LPOSITIVE_EXPONENT45:
+add r10d, r12d
+mov r9d, ebx
+.LSCALE46:
+cvtsi2sd xmm0, r8
+test r8, r8
+jz .LNEGATE50
+movsd xmm1, qword ptr [rip + .LDBL4]
+mov ecx, r10d
+test ecx, ecx
+jge .LPOWER47
+neg ecx
+.LPOWER47:
+test ecx, ecx
+jz .LAPPLY48
+mulsd xmm1, qword ptr [rip + .LDBL13]
+dec ecx
+jmp .LPOWER47
+.LAPPLY48:
+test r10d, r10d
+jl .LDIVIDE49
+mulsd xmm0, xmm1
+jmp .LNEGATE50
+.LDIVIDE49:
+divsd xmm0, xmm1
+.LNEGATE50:
+test r9d, r9d
+jz .LDONE51
+mulsd xmm0, qword ptr [rip + .LDBL17]
+.LDONE51:
+pop r12
+pop rbx
+ret
@@ -0,0 +1,4 @@
+arg1=$1
+as --64 "$arg1.asm" -o "$arg1.o"
+ld "$arg1.o" -o "$arg1"
+rm "$arg1.o"
@@ -0,0 +1,325 @@
+include c:\masm32\include\masm32rt.inc
+.xmm
+.const
+align 8
+$DBL37@ dq 03FF8000000000000h
+.data
+align 4
+$calls6@ db 4 dup (0)
+.code
+start:
+push ebp
+mov eax, esp
+and esp, -8
+mov ebp, esp
+sub esp, 68
+mov dword ptr [ebp - 68], eax
+mov eax, 1
+lea ecx, dword ptr [ebp - 40]
+mov edx, eax
+imul edx, 4
+add edx, -4
+add edx, ecx
+jmp $FOR_COND57@
+$FOR_BODY38@:
+mov ecx, eax
+mov ebx, ecx
+imul ebx, ecx
+sub ebx, 5
+mov ecx, 0
+mov esi, 50
+cmp ebx, ecx
+jge $IFFAIL40@
+$IFTHEN39@:
+jmp $IFEND44@
+$IFFAIL40@:
+cmp ebx, esi
+jle $IFFAIL42@
+$IFTHEN41@:
+mov ecx, esi
+jmp $IFEND43@
+$IFFAIL42@:
+mov ecx, ebx
+$IFEND43@:
+$IFEND44@:
+test ecx, ecx
+jnz $IFEND46@
+$IFTHEN45@:
+mov ecx, 1
+$IFEND46@:
+cmp ecx, 10
+jnz $IFEND48@
+$IFTHEN47@:
+mov ecx, 9
+$IFEND48@:
+cmp ecx, 20
+jnz $IFEND50@
+$IFTHEN49@:
+mov ecx, 19
+$IFEND50@:
+cmp ecx, 30
+jnz $IFEND52@
+$IFTHEN51@:
+mov ecx, 29
+$IFEND52@:
+cmp ecx, 40
+jnz $IFEND54@
+$IFTHEN53@:
+mov ecx, 39
+$IFEND54@:
+cmp ecx, 45
+jnz $IFEND56@
+$IFTHEN55@:
+mov ecx, 44
+$IFEND56@:
+mov dword ptr [edx - 0], ecx
+inc eax
+add edx, 4
+$FOR_COND57@:
+cmp eax, 10
+jle $FOR_BODY38@
+$FOR_END58@:
+lea ebx, dword ptr [ebp - 40]
+mov eax, ebx
+add eax, 8
+mov eax, dword ptr [eax - 0]
+mov edx, 2
+mov ecx, 8
+call $clamp4@
+mov esi, eax
+mov eax, 0
+mov ecx, 1
+mov edx, ecx
+imul edx, 4
+add edx, -4
+add edx, ebx
+jmp $FOR_COND60@
+$FOR_BODY59@:
+add eax, dword ptr [edx - 0]
+inc ecx
+add edx, 4
+$FOR_COND60@:
+cmp ecx, 10
+jle $FOR_BODY59@
+$FOR_END61@:
+mov ecx, 0
+mov edx, 1
+mov edi, edx
+imul edi, 4
+add edi, -4
+add edi, ebx
+jmp $FOR_COND63@
+$FOR_BODY62@:
+add ecx, dword ptr [edi - 0]
+inc edx
+add edi, 4
+$FOR_COND63@:
+cmp edx, 10
+jle $FOR_BODY62@
+$FOR_END64@:
+add eax, ecx
+mov ecx, 0
+mov edx, 1
+mov edi, edx
+imul edi, 4
+add edi, -4
+add edi, ebx
+jmp $FOR_COND66@
+$FOR_BODY65@:
+add ecx, dword ptr [edi - 0]
+inc edx
+add edi, 4
+$FOR_COND66@:
+cmp edx, 10
+jle $FOR_BODY65@
+$FOR_END67@:
+add eax, ecx
+mov ecx, 0
+mov edx, 1
+mov edi, edx
+imul edi, 4
+add edi, -4
+add edi, ebx
+jmp $FOR_COND69@
+$FOR_BODY68@:
+add ecx, dword ptr [edi - 0]
+inc edx
+add edi, 4
+$FOR_COND69@:
+cmp edx, 10
+jle $FOR_BODY68@
+$FOR_END70@:
+add eax, ecx
+mov ecx, 0
+mov edx, 1
+mov edi, edx
+imul edi, 4
+add edi, -4
+add edi, ebx
+jmp $FOR_COND72@
+$FOR_BODY71@:
+add ecx, dword ptr [edi - 0]
+inc edx
+add edi, 4
+$FOR_COND72@:
+cmp edx, 10
+jle $FOR_BODY71@
+$FOR_END73@:
+add eax, ecx
+mov ecx, 0
+mov edx, 1
+mov edi, edx
+imul edi, 4
+add edi, -4
+add edi, ebx
+jmp $FOR_COND75@
+$FOR_BODY74@:
+add ecx, dword ptr [edi - 0]
+inc edx
+add edi, 4
+$FOR_COND75@:
+cmp edx, 10
+jle $FOR_BODY74@
+$FOR_END76@:
+mov edi, eax
+add edi, ecx
+mov eax, ebx
+call $sum3@
+add edi, eax
+add edi, eax
+mov dword ptr [ebp - 44], edi
+lea eax, dword ptr [ebp - 44]
+add dword ptr [eax - 0], esi
+inc dword ptr [$calls6@]
+movsd xmm0, qword ptr [$DBL37@]
+mov eax, esi
+cvtsi2sd xmm1, eax
+mulsd xmm0, xmm1
+movsd xmm1, xmm0
+$INLINE_END77@:
+mov eax, esi
+movsd qword ptr [ebp - 64], xmm1
+call $fact5@
+movsd xmm1, qword ptr [ebp - 64]
+mov esi, eax
+movsd qword ptr [ebp - 64], xmm1
+printf("%d\n", dword ptr [ebp - 44])
+movsd xmm1, qword ptr [ebp - 64]
+movsd qword ptr [ebp - 64], xmm1
+printf("%d\n", esi)
+movsd xmm1, qword ptr [ebp - 64]
+movsd qword ptr [ebp - 64], xmm1
+printf("%d\n", dword ptr [$calls6@])
+movsd xmm1, qword ptr [ebp - 64]
+movsd qword ptr [ebp - 56], xmm1
+printf("%f\n", qword ptr [ebp - 56])
+mov esp, dword ptr [ebp - 68]
+pop ebp
+exit
+$sqr0@:
+mov ecx, eax
+imul ecx, eax
+$EXIT7@:
+mov eax, ecx
+ret
+$scale1@:
+cvtsi2sd xmm1, eax
+mulsd xmm0, xmm1
+$EXIT8@:
+ret
+$bump2@:
+add dword ptr [eax - 0], edx
+inc dword ptr [$calls6@]
+$EXIT9@:
+ret
+$sum3@:
+push ebx
+mov ecx, 0
+mov edx, 1
+mov ebx, edx
+imul ebx, 4
+add ebx, -4
+add ebx, eax
+jmp $FOR_COND11@
+$FOR_BODY10@:
+add ecx, dword ptr [ebx - 0]
+inc edx
+add ebx, 4
+$FOR_COND11@:
+cmp edx, 10
+jle $FOR_BODY10@
+$FOR_END12@:
+$EXIT13@:
+mov eax, ecx
+pop ebx
+ret
+$clamp4@:
+cmp eax, edx
+jge $IFFAIL15@
+$IFTHEN14@:
+jmp $IFEND19@
+$IFFAIL15@:
+cmp eax, ecx
+jle $IFFAIL17@
+$IFTHEN16@:
+mov edx, ecx
+jmp $IFEND18@
+$IFFAIL17@:
+mov edx, eax
+$IFEND18@:
+$IFEND19@:
+test edx, edx
+jnz $IFEND21@
+$IFTHEN20@:
+mov edx, 1
+$IFEND21@:
+cmp edx, 10
+jnz $IFEND23@
+$IFTHEN22@:
+mov edx, 9
+$IFEND23@:
+cmp edx, 20
+jnz $IFEND25@
+$IFTHEN24@:
+mov edx, 19
+$IFEND25@:
+cmp edx, 30
+jnz $IFEND27@
+$IFTHEN26@:
+mov edx, 29
+$IFEND27@:
+cmp edx, 40
+jnz $IFEND29@
+$IFTHEN28@:
+mov edx, 39
+$IFEND29@:
+cmp edx, 45
+jnz $IFEND31@
+$IFTHEN30@:
+mov edx, 44
+$IFEND31@:
+$EXIT32@:
+mov eax, edx
+ret
+$fact5@:
+push ebx
+push esi
+mov ebx, eax
+cmp ebx, 1
+jg $IFFAIL34@
+$IFTHEN33@:
+mov esi, 1
+jmp $IFEND35@
+$IFFAIL34@:
+mov eax, ebx
+dec eax
+call $fact5@
+mov esi, ebx
+imul esi, eax
+$IFEND35@:
+$EXIT36@:
+mov eax, esi
+pop esi
+pop ebx
+ret
+end start
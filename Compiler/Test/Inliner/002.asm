@@ -0,0 +1,31 @@
+include c:\masm32\include\masm32rt.inc
+.xmm
+.const
+.data
+align 4
+$g12@ db 4 dup (0)
+.code
+start:
+push ebp
+mov ebp, esp
+sub esp, 0
+mov dword ptr [$g12@], 4
+mov eax, dword ptr [$g12@]
+inc eax
+printf("%d\n", eax)
+$INLINE_END5@:
+mov esp, ebp
+pop ebp
+exit
+$f00@:
+mov eax, dword ptr [$g12@]
+inc eax
+$EXIT3@:
+ret
+$q21@:
+mov eax, dword ptr [$g12@]
+inc eax
+printf("%d\n", eax)
+$EXIT4@:
+ret
+end start
@@ -0,0 +1,22 @@
+from os import listdir
+import re
+import subprocess
+import os
+import sys
+
+# the JIT runs on Linux x86-64 only
+if not sys.platform.startswith('linux'):
+    print('Outputs not generated, the JIT runs on Linux only')
+    sys.exit()
+# path of the compiler built on Linux
+compiler = sys.argv[1] if len(sys.argv) > 1 else './Compiler'
+r = re.compile('(?P<name>.+)\.in')
+for i in listdir('./'):
+    name = r.match(i)
+    if name:
+        # the text a program reads is in the file with the extension .stdin
+        stdin = '{}.stdin'.format(name.group('name'))
+        stdin = open(stdin) if os.path.exists(stdin) else subprocess.DEVNULL
+        f1 = open('{}.out'.format(name.group('name')), 'w')
+        f1.write(subprocess.run([compiler, '-run', i], stdin=stdin, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, universal_newlines=True).stdout)
+        f1.close()
@@ -0,0 +1,28 @@
+from os import listdir
+import re
+import subprocess
+import os
+import sys
+
+# the JIT runs on Linux x86-64 only, the program writes to the standard output, the times go to the error stream
+if not sys.platform.startswith('linux'):
+    print('Tests skipped, the JIT runs on Linux only')
+    sys.exit()
+# path of the compiler built on Linux
+compiler = sys.argv[1] if len(sys.argv) > 1 else './Compiler'
+r = re.compile('(?P<name>.+)\.in')
+for i in listdir('./'):
+    name = r.match(i)
+    if name:
+        # the text a program reads is in the file with the extension .stdin
+        stdin = '{}.stdin'.format(name.group('name'))
+        stdin = open(stdin) if os.path.exists(stdin) else subprocess.DEVNULL
+        b = subprocess.run([compiler, '-run', i], stdin=stdin, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, universal_newlines=True).stdout
+        f1 = open('{}.out'.format(name.group('name')))
+        a = f1.read();
+        if a != b:
+            print('Test "{}" failed'.format(i))
+            print(b, file=open('{}_failed.out'.format(name.group('name')), 'w'), end='')
+        else:
+            print('Test "{}" passed'.format(i))
+        f1.close()
@@ -0,0 +1,50 @@
+include c:\masm32\include\masm32rt.inc
+.xmm
+.const
+.code
+start:
+push ebp
+mov ebp, esp
+sub esp, 0
+mov ebx, 0
+mov eax, 10
+mov esi, 0
+mov ecx, eax
+mov edx, 1
+mov edi, edx
+imul edi, 2
+jmp $FOR_COND4@
+$FOR_BODY0@:
+inc ebx
+cmp ebx, 5
+jle $IFFAIL2@
+$IFTHEN1@:
+add esi, edi
+jmp $IFEND3@
+$IFFAIL2@:
+dec esi
+$IFEND3@:
+inc edx
+add edi, 2
+$FOR_COND4@:
+cmp edx, ecx
+jle $FOR_BODY0@
+$FOR_END5@:
+jmp $WHILE_COND7@
+$WHILE_BODY6@:
+sub esi, 3
+$WHILE_COND7@:
+cmp esi, eax
+jg $WHILE_BODY6@
+$WHILE_END8@:
+test esi, esi
+jnz $IFEND10@
+$IFTHEN9@:
+printf("%d\n", 0)
+$IFEND10@:
+printf("%d\n", ebx)
+printf("%d\n", esi)
+mov esp, ebp
+pop ebp
+exit
+end start
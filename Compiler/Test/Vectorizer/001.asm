@@ -0,0 +1,319 @@
+include c:\masm32\include\masm32rt.inc
+.xmm
+.const
+align 8
+$DBL0@ dq 04000000000000000h
+align 8
+$DBL1@ dq 00000000000000000h
+align 8
+$DBL2@ dq 04004000000000000h
+.code
+start:
+push ebp
+mov eax, esp
+and esp, -8
+mov ebp, esp
+sub esp, 308
+mov dword ptr [ebp - 308], eax
+mov eax, 1
+lea ecx, dword ptr [ebp - 40]
+lea edx, dword ptr [ebp - 80]
+movsd xmm0, qword ptr [$DBL0@]
+lea ebx, dword ptr [ebp - 200]
+mov esi, eax
+imul esi, 4
+add esi, -4
+add esi, ecx
+mov ecx, eax
+imul ecx, 4
+add ecx, -4
+add ecx, edx
+mov edx, eax
+imul edx, 8
+add edx, -8
+add edx, ebx
+jmp $FOR_COND4@
+$FOR_BODY3@:
+mov dword ptr [esi - 0], eax
+mov ebx, 10
+sub ebx, eax
+mov dword ptr [ecx - 0], ebx
+cvtsi2sd xmm1, eax
+divsd xmm1, xmm0
+movsd qword ptr [edx - 0], xmm1
+inc eax
+add edx, 8
+add ecx, 4
+add esi, 4
+$FOR_COND4@:
+cmp eax, 10
+jle $FOR_BODY3@
+$FOR_END5@:
+mov eax, 1
+lea ecx, dword ptr [ebp - 40]
+lea edx, dword ptr [ebp - 80]
+mov ebx, 1
+movd xmm0, ebx
+pshufd xmm0, xmm0, 0
+lea ebx, dword ptr [ebp - 120]
+mov esi, eax
+imul esi, 4
+add esi, -4
+add esi, ecx
+mov ecx, eax
+imul ecx, 4
+add ecx, -4
+add ecx, edx
+mov edx, eax
+imul edx, 4
+add edx, -4
+add edx, ebx
+jmp $VEC_COND7@
+$VEC_BODY6@:
+movdqu xmm1, xmmword ptr [esi - 0]
+movdqu xmm2, xmmword ptr [ecx - 0]
+paddd xmm1, xmm2
+psubd xmm1, xmm0
+movdqu xmmword ptr [edx - 0], xmm1
+add eax, 4
+add edx, 16
+add ecx, 16
+add esi, 16
+$VEC_COND7@:
+cmp eax, 7
+jle $VEC_BODY6@
+$VEC_END8@:
+lea ecx, dword ptr [ebp - 40]
+lea edx, dword ptr [ebp - 80]
+lea ebx, dword ptr [ebp - 120]
+mov esi, eax
+imul esi, 4
+add esi, -4
+add esi, ecx
+mov ecx, eax
+imul ecx, 4
+add ecx, -4
+add ecx, edx
+mov edx, eax
+imul edx, 4
+add edx, -4
+add edx, ebx
+jmp $FOR_COND10@
+$FOR_BODY9@:
+mov ebx, dword ptr [esi - 0]
+add ebx, dword ptr [ecx - 0]
+dec ebx
+mov dword ptr [edx - 0], ebx
+inc eax
+add edx, 4
+add ecx, 4
+add esi, 4
+$FOR_COND10@:
+cmp eax, 10
+jle $FOR_BODY9@
+$FOR_END11@:
+mov ecx, 0
+mov dword ptr [ebp - 292], 0
+mov eax, 1
+mov edx, 0
+movd xmm0, edx
+pshufd xmm0, xmm0, 0
+movd xmm1, dword ptr [ebp - 292]
+pshufd xmm1, xmm1, 0
+lea edx, dword ptr [ebp - 120]
+lea esi, dword ptr [ebp - 40]
+mov edi, eax
+imul edi, 4
+add edi, -4
+add edi, edx
+mov edx, eax
+imul edx, 4
+add edx, -4
+add edx, esi
+jmp $VEC_COND13@
+$VEC_BODY12@:
+movdqu xmm2, xmmword ptr [edi - 0]
+paddd xmm0, xmm2
+movdqu xmm2, xmmword ptr [edx - 0]
+movdqa xmm3, xmm1
+pcmpgtd xmm3, xmm2
+movdqa xmm4, xmm1
+pand xmm4, xmm3
+pandn xmm3, xmm2
+por xmm4, xmm3
+movdqa xmm1, xmm4
+add eax, 4
+add edx, 16
+add edi, 16
+$VEC_COND13@:
+cmp eax, 7
+jle $VEC_BODY12@
+$VEC_END14@:
+pshufd xmm2, xmm0, 238
+paddd xmm2, xmm0
+pshufd xmm0, xmm2, 85
+paddd xmm0, xmm2
+movd edx, xmm0
+add ecx, edx
+pshufd xmm0, xmm1, 238
+movdqa xmm2, xmm0
+pcmpgtd xmm2, xmm1
+movdqa xmm3, xmm0
+pand xmm3, xmm2
+pandn xmm2, xmm1
+por xmm3, xmm2
+movdqa xmm0, xmm3
+pshufd xmm1, xmm0, 85
+movdqa xmm2, xmm1
+pcmpgtd xmm2, xmm0
+movdqa xmm3, xmm1
+pand xmm3, xmm2
+pandn xmm2, xmm0
+por xmm3, xmm2
+movdqa xmm1, xmm3
+movd dword ptr [ebp - 292], xmm1
+lea edx, dword ptr [ebp - 120]
+lea esi, dword ptr [ebp - 40]
+mov edi, eax
+imul edi, 4
+add edi, -4
+add edi, edx
+mov edx, eax
+imul edx, 4
+add edx, -4
+add edx, esi
+jmp $FOR_COND18@
+$FOR_BODY15@:
+add ecx, dword ptr [edi - 0]
+mov esi, edx
+push edi
+mov edi, dword ptr [ebp - 292]
+cmp dword ptr [edx - 0], edi
+pop edi
+jle $IFEND17@
+$IFTHEN16@:
+push edi
+mov edi, dword ptr [esi - 0]
+mov dword ptr [ebp - 292], edi
+pop edi
+$IFEND17@:
+inc eax
+add edx, 4
+add edi, 4
+$FOR_COND18@:
+cmp eax, 10
+jle $FOR_BODY15@
+$FOR_END19@:
+movsd xmm0, qword ptr [$DBL1@]
+mov eax, 1
+movsd xmm1, qword ptr [$DBL1@]
+unpcklpd xmm1, xmm1
+lea edx, dword ptr [ebp - 200]
+movsd xmm2, qword ptr [$DBL2@]
+unpcklpd xmm2, xmm2
+lea esi, dword ptr [ebp - 280]
+mov edi, eax
+imul edi, 8
+add edi, -8
+add edi, edx
+mov edx, eax
+imul edx, 8
+add edx, -8
+add edx, esi
+jmp $VEC_COND21@
+$VEC_BODY20@:
+movupd xmm3, xmmword ptr [edi - 0]
+mulpd xmm3, xmm2
+movupd xmmword ptr [edx - 0], xmm3
+addpd xmm1, xmm3
+add eax, 2
+add edx, 16
+add edi, 16
+$VEC_COND21@:
+cmp eax, 9
+jle $VEC_BODY20@
+$VEC_END22@:
+movapd xmm2, xmm1
+unpckhpd xmm2, xmm2
+addpd xmm2, xmm1
+addsd xmm0, xmm2
+lea edx, dword ptr [ebp - 200]
+movsd xmm1, qword ptr [$DBL2@]
+lea esi, dword ptr [ebp - 280]
+mov edi, eax
+imul edi, 8
+add edi, -8
+add edi, edx
+mov edx, eax
+imul edx, 8
+add edx, -8
+add edx, esi
+jmp $FOR_COND24@
+$FOR_BODY23@:
+movsd xmm2, qword ptr [edi - 0]
+mulsd xmm2, xmm1
+movsd qword ptr [edx - 0], xmm2
+addsd xmm0, xmm2
+inc eax
+add edx, 8
+add edi, 8
+$FOR_COND24@:
+cmp eax, 10
+jle $FOR_BODY23@
+$FOR_END25@:
+mov eax, 2
+push edi
+lea edi, dword ptr [ebp - 40]
+mov dword ptr [ebp - 296], edi
+pop edi
+mov esi, eax
+imul esi, 4
+add esi, dword ptr [ebp - 296]
+mov edi, eax
+imul edi, 4
+add edi, -8
+add edi, dword ptr [ebp - 296]
+mov edx, eax
+imul edx, 4
+add edx, -4
+add edx, dword ptr [ebp - 296]
+jmp $FOR_COND27@
+$FOR_BODY26@:
+mov ebx, dword ptr [esi - 0]
+sub ebx, dword ptr [edi - 0]
+mov dword ptr [edx - 0], ebx
+inc eax
+add edx, 4
+add edi, 4
+add esi, 4
+$FOR_COND27@:
+cmp eax, 9
+jle $FOR_BODY26@
+$FOR_END28@:
+mov eax, 10
+lea edx, dword ptr [ebp - 80]
+mov ebx, eax
+imul ebx, 4
+add ebx, -4
+add ebx, edx
+jmp $FOR_COND30@
+$FOR_BODY29@:
+mov dword ptr [ebx - 0], 0
+dec eax
+add ebx, -4
+$FOR_COND30@:
+cmp eax, 1
+jge $FOR_BODY29@
+$FOR_END31@:
+movsd qword ptr [ebp - 304], xmm0
+printf("%d\n", ecx)
+movsd xmm0, qword ptr [ebp - 304]
+movsd qword ptr [ebp - 304], xmm0
+printf("%d\n", dword ptr [ebp - 292])
+movsd xmm0, qword ptr [ebp - 304]
+movsd qword ptr [ebp - 288], xmm0
+printf("%f\n", qword ptr [ebp - 288])
+mov esp, dword ptr [ebp - 308]
+pop ebp
+exit
+end start
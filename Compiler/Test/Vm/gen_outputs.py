@@ -0,0 +1,16 @@
+from os import listdir
+import re
+import subprocess
+import os
+
+compiler = r'C:\Users\danilov\Desktop\5_semester\COMPILER\PascalCompiler\Compiler\Debug\Compiler.exe'
+r = re.compile('(?P<name>.+)\.in')
+for i in listdir('./'):
+    name = r.match(i)
+    if name:
+        # the text a program reads is in the file with the extension .stdin
+        stdin = '{}.stdin'.format(name.group('name'))
+        stdin = open(stdin) if os.path.exists(stdin) else subprocess.DEVNULL
+        f1 = open('{}.out'.format(name.group('name')), 'w')
+        f1.write(subprocess.run([compiler, '-vm', i], stdin=stdin, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, universal_newlines=True).stdout)
+        f1.close()